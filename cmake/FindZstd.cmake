@@ -0,0 +1,40 @@
+find_library(Zstd_LIBRARY
+  NAMES zstd
+  PATHS /lib /usr/lib /usr/local/lib
+)
+
+find_path(Zstd_INCLUDE_DIR zstd.h
+/usr/local/include
+/usr/include
+)
+
+if (Zstd_LIBRARY AND Zstd_INCLUDE_DIR)
+  set(Zstd_LIBRARIES ${Zstd_LIBRARY})
+  set(Zstd_FOUND "YES")
+else ()
+  set(Zstd_FOUND "NO")
+endif ()
+
+if (Zstd_FOUND)
+   if (NOT Zstd_FIND_QUIETLY)
+      message(STATUS "Found zstd: ${Zstd_LIBRARIES}")
+   endif ()
+   if (NOT TARGET zstd::zstd)
+      add_library(zstd::zstd UNKNOWN IMPORTED)
+      set_target_properties(zstd::zstd PROPERTIES
+         INTERFACE_INCLUDE_DIRECTORIES ${Zstd_INCLUDE_DIR}
+         IMPORTED_LOCATION ${Zstd_LIBRARY}
+      )
+   endif ()
+else ()
+   if (Zstd_FIND_REQUIRED)
+      message( "library: ${Zstd_LIBRARY}" )
+      message( "include: ${Zstd_INCLUDE_DIR}" )
+      message(FATAL_ERROR "Could not find zstd library")
+   endif ()
+endif ()
+
+mark_as_advanced(
+  Zstd_LIBRARY
+  Zstd_INCLUDE_DIR
+)
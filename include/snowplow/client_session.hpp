@@ -109,6 +109,13 @@ public:
    */
   unsigned long long get_foreground_timeout() const { return m_foreground_timeout; }
 
+  /**
+   * @brief Get the persistent user ID of the session
+   *
+   * @return const string& User ID that stays the same across sessions
+   */
+  const string &get_user_id() const { return m_user_id; }
+
 private:
   // Constructor
   shared_ptr<SessionStore> m_session_store;
@@ -36,6 +36,20 @@ void EmitterConfiguration::shared_init() {
   m_byte_limit_get = SNOWPLOW_EMITTER_DEFAULT_BYTE_LIMIT_GET;
   m_byte_limit_post = SNOWPLOW_EMITTER_DEFAULT_BYTE_LIMIT_POST;
   m_flush_timeout_ms = 30000;
+  m_request_callback_queue_size = SNOWPLOW_EMITTER_DEFAULT_CALLBACK_QUEUE_SIZE;
+  m_request_callback_coalescing_window_ms = 0;
+  m_request_callback_max_queued_event_ids = SNOWPLOW_EMITTER_DEFAULT_CALLBACK_QUEUED_EVENT_IDS;
+  m_max_requests_in_flight = SNOWPLOW_EMITTER_DEFAULT_MAX_REQUESTS_IN_FLIGHT;
+  m_max_attempts = 0;
+  m_circuit_breaker_failure_threshold = 0;
+  m_circuit_breaker_open_duration_ms = SNOWPLOW_EMITTER_DEFAULT_CIRCUIT_BREAKER_OPEN_DURATION_MS;
+  m_max_queue_events = 0;
+  m_max_queue_bytes = 0;
+  m_queue_overflow_policy = DROP_NEWEST;
+  m_queue_block_timeout_ms = 1000;
+  m_deduplication_window_ms = 0;
+  m_deduplication_capacity = SNOWPLOW_EMITTER_DEFAULT_DEDUPLICATION_CAPACITY;
+  m_deduplication_false_positive_rate = SNOWPLOW_EMITTER_DEFAULT_DEDUPLICATION_FALSE_POSITIVE_RATE;
 }
 
 void EmitterConfiguration::set_event_store(shared_ptr<EventStore> event_store) {
@@ -51,6 +65,90 @@ void EmitterConfiguration::set_request_callback(const EmitterCallback &callback,
   m_callback_emit_status = emit_status;
 }
 
+void EmitterConfiguration::set_request_callback_queue_size(int request_callback_queue_size) {
+  if (request_callback_queue_size <= 0) {
+    throw std::invalid_argument("Request callback queue size must be greater than 0");
+  }
+  m_request_callback_queue_size = request_callback_queue_size;
+}
+
+void EmitterConfiguration::set_request_callback_coalescing_window_ms(int request_callback_coalescing_window_ms) {
+  if (request_callback_coalescing_window_ms < 0) {
+    throw std::invalid_argument("Request callback coalescing window can't be negative");
+  }
+  m_request_callback_coalescing_window_ms = request_callback_coalescing_window_ms;
+}
+
+void EmitterConfiguration::set_request_callback_max_queued_event_ids(int request_callback_max_queued_event_ids) {
+  if (request_callback_max_queued_event_ids <= 0) {
+    throw std::invalid_argument("Request callback maximum number of queued event IDs must be greater than 0");
+  }
+  m_request_callback_max_queued_event_ids = request_callback_max_queued_event_ids;
+}
+
+void EmitterConfiguration::set_max_requests_in_flight(int max_requests_in_flight) {
+  if (max_requests_in_flight <= 0) {
+    throw std::invalid_argument("Maximum number of requests in flight must be greater than 0");
+  }
+  m_max_requests_in_flight = max_requests_in_flight;
+}
+
+void EmitterConfiguration::set_max_attempts(int max_attempts) {
+  if (max_attempts < 0) {
+    throw std::invalid_argument("Maximum number of attempts can't be negative");
+  }
+  m_max_attempts = max_attempts;
+}
+
+void EmitterConfiguration::set_circuit_breaker(int failure_threshold, int open_duration_ms) {
+  if (failure_threshold < 0) {
+    throw std::invalid_argument("Circuit breaker failure threshold can't be negative");
+  }
+  if (open_duration_ms <= 0) {
+    throw std::invalid_argument("Circuit breaker open duration must be greater than 0");
+  }
+  m_circuit_breaker_failure_threshold = failure_threshold;
+  m_circuit_breaker_open_duration_ms = open_duration_ms;
+}
+
+void EmitterConfiguration::set_max_queue_size(int max_events, long long max_bytes) {
+  if (max_events < 0) {
+    throw std::invalid_argument("Maximum number of queued events can't be negative");
+  }
+  if (max_bytes < 0) {
+    throw std::invalid_argument("Maximum size of queued events can't be negative");
+  }
+  m_max_queue_events = max_events;
+  m_max_queue_bytes = max_bytes;
+}
+
+void EmitterConfiguration::set_queue_overflow_policy(QueueOverflowPolicy policy, int block_timeout_ms) {
+  if (block_timeout_ms < 0) {
+    throw std::invalid_argument("Queue block timeout can't be negative");
+  }
+  m_queue_overflow_policy = policy;
+  m_queue_block_timeout_ms = block_timeout_ms;
+}
+
+void EmitterConfiguration::set_deduplication(const vector<string> &fields, int window_ms, int capacity, double false_positive_rate) {
+  if (fields.empty()) {
+    throw std::invalid_argument("Deduplication requires at least one payload field");
+  }
+  if (window_ms <= 0) {
+    throw std::invalid_argument("Deduplication window must be greater than 0");
+  }
+  if (capacity <= 0) {
+    throw std::invalid_argument("Deduplication capacity must be greater than 0");
+  }
+  if (false_positive_rate <= 0 || false_positive_rate >= 1) {
+    throw std::invalid_argument("Deduplication false positive rate must be between 0 and 1");
+  }
+  m_deduplication_fields = fields;
+  m_deduplication_window_ms = window_ms;
+  m_deduplication_capacity = capacity;
+  m_deduplication_false_positive_rate = false_positive_rate;
+}
+
 void EmitterConfiguration::set_custom_retry_for_status_code(int http_status_code, bool retry) {
   if (http_status_code < 300) {
     throw std::invalid_argument("Retry rules can only be set for status codes >= 300");
@@ -15,14 +15,18 @@ See the Apache License Version 2.0 for the specific language governing permissio
 #define EMITTER_CONFIGURATION_H
 
 #include <string>
+#include <vector>
+#include "../constants.hpp"
 #include "../storage/event_store.hpp"
 #include "../emitter/emit_status.hpp"
+#include "../emitter/queue_overflow_policy.hpp"
 #include "../storage/sqlite_storage.hpp"
 
 namespace snowplow {
 
 using std::shared_ptr;
 using std::string;
+using std::vector;
 using std::make_shared;
 
 typedef std::function<void(list<string>, EmitStatus)> EmitterCallback;
@@ -79,7 +83,7 @@ public:
    * 
    * To subscribe to multiple emit statuses, use binary operations such as `EmitStatus::FAILED_WILL_RETRY | EmitStatus::FAILED_WONT_RETRY`.
    * Calling this function overwrites any previously set callbacks.
-   * The callback will be fired in a new thread.
+   * The callback will be called on a dispatcher thread owned by the Emitter, in the order the requests completed.
    * 
    * @param callback Callback function
    * @param emit_status Emit status to trigger the callback for
@@ -96,6 +100,99 @@ public:
    */
   void set_custom_retry_for_status_code(int http_status_code, bool retry);
 
+  /**
+   * @brief Set the maximum number of request callback deliveries waiting for the callback to return.
+   *
+   * When the queue is full, event IDs are merged into the last pending delivery with the same emit status.
+   *
+   * @param request_callback_queue_size Maximum number of pending deliveries (default: 100).
+   */
+  void set_request_callback_queue_size(int request_callback_queue_size);
+
+  /**
+   * @brief Set the time to collect further emit results before calling the request callback.
+   *
+   * With a coalescing window, the callback is called once per emit status with event IDs from all requests completed within the window.
+   *
+   * @param request_callback_coalescing_window_ms Coalescing window in milliseconds (default: 0, calls the callback for each request batch).
+   */
+  void set_request_callback_coalescing_window_ms(int request_callback_coalescing_window_ms);
+
+  /**
+   * @brief Set the maximum number of event IDs in all request callback deliveries waiting for the callback to return.
+   *
+   * Further event IDs are dropped without calling the callback and counted in `Emitter::get_callback_dropped_event_count()`,
+   * so a slow callback can't grow the queue without bound.
+   *
+   * @param request_callback_max_queued_event_ids Maximum number of queued event IDs (default: 25000).
+   */
+  void set_request_callback_max_queued_event_ids(int request_callback_max_queued_event_ids);
+
+  /**
+   * @brief Set the maximum number of requests to the collector in flight at a time.
+   *
+   * The Emitter keeps up to this many requests open and issues a new one as soon as any of them completes.
+   *
+   * @param max_requests_in_flight Maximum number of concurrent requests (default: 15).
+   */
+  void set_max_requests_in_flight(int max_requests_in_flight);
+
+  /**
+   * @brief Set the maximum number of attempts to send an event.
+   *
+   * Events that fail with a retryable error this many times are removed from the event queue and moved
+   * to the dead-letter queue of the event store (`SqliteStorage` keeps them in a separate table).
+   * Requires an event store that records failed attempts.
+   *
+   * @param max_attempts Maximum number of attempts (default: 0, retry indefinitely)
+   */
+  void set_max_attempts(int max_attempts);
+
+  /**
+   * @brief Enable the circuit breaker that pauses sending to a failing collector.
+   *
+   * After the given number of consecutive requests fail with a retryable error, the Emitter stops sending
+   * requests for the open duration. It then sends a single probe request with one event and resumes sending
+   * only if the probe succeeds.
+   *
+   * @param failure_threshold Consecutive failed requests to open the circuit (default: 0, circuit breaker disabled)
+   * @param open_duration_ms Time to wait before a probe request (default: 30000)
+   */
+  void set_circuit_breaker(int failure_threshold, int open_duration_ms = SNOWPLOW_EMITTER_DEFAULT_CIRCUIT_BREAKER_OPEN_DURATION_MS);
+
+  /**
+   * @brief Limit the number of events and bytes kept in the event queue.
+   *
+   * When adding an event would exceed a limit, the queue overflow policy decides what happens to it.
+   * Requires an event store that reports its queue size (`SqliteStorage` does), limits are not enforced otherwise.
+   *
+   * @param max_events Maximum number of queued events (0 = unlimited)
+   * @param max_bytes Maximum total size of the queued event payloads in bytes (default: 0, unlimited)
+   */
+  void set_max_queue_size(int max_events, long long max_bytes = 0);
+
+  /**
+   * @brief Set what happens to new events when the event queue is full.
+   *
+   * @param policy Queue overflow policy (default: DROP_NEWEST)
+   * @param block_timeout_ms Maximum time the BLOCK policy waits for room in the queue before dropping the event (default: 1000)
+   */
+  void set_queue_overflow_policy(QueueOverflowPolicy policy, int block_timeout_ms = 1000);
+
+  /**
+   * @brief Drop events that repeat the given payload fields of an event added within the deduplication window.
+   *
+   * Use it to drop events tracked multiple times with different event IDs, e.g., when the tracking code is retried.
+   * Seen events are remembered in rotating Bloom filters with a fixed memory size, so a small fraction of
+   * unique events may be dropped as well (see `Emitter::get_deduplication_false_positive_rate`).
+   *
+   * @param fields Payload fields that identify a logical event (e.g., "e", "se_ca", "se_ac", "se_la", "uid")
+   * @param window_ms Minimum time for which events are remembered
+   * @param capacity Number of events remembered per window, older events are forgotten sooner when exceeded (default: 100000)
+   * @param false_positive_rate Target probability of dropping a unique event (default: 0.001)
+   */
+  void set_deduplication(const vector<string> &fields, int window_ms, int capacity = SNOWPLOW_EMITTER_DEFAULT_DEDUPLICATION_CAPACITY, double false_positive_rate = SNOWPLOW_EMITTER_DEFAULT_DEDUPLICATION_FALSE_POSITIVE_RATE);
+
   /**
    * @brief Set the maximum time flush() will wait for the event queue to drain before stopping.
    *
@@ -156,6 +253,111 @@ public:
    */
   EmitStatus get_request_callback_emit_status() const { return m_callback_emit_status; }
 
+  /**
+   * @brief Get the maximum number of pending request callback deliveries.
+   *
+   * @return int Request callback queue size
+   */
+  int get_request_callback_queue_size() const { return m_request_callback_queue_size; }
+
+  /**
+   * @brief Get the request callback coalescing window.
+   *
+   * @return int Coalescing window in milliseconds (0 = no coalescing)
+   */
+  int get_request_callback_coalescing_window_ms() const { return m_request_callback_coalescing_window_ms; }
+
+  /**
+   * @brief Get the maximum number of event IDs queued for the request callback.
+   *
+   * @return int Maximum number of queued event IDs
+   */
+  int get_request_callback_max_queued_event_ids() const { return m_request_callback_max_queued_event_ids; }
+
+  /**
+   * @brief Get the maximum number of requests in flight.
+   *
+   * @return int Maximum number of concurrent requests
+   */
+  int get_max_requests_in_flight() const { return m_max_requests_in_flight; }
+
+  /**
+   * @brief Get the maximum number of attempts to send an event.
+   *
+   * @return int Maximum attempts (0 = unlimited)
+   */
+  int get_max_attempts() const { return m_max_attempts; }
+
+  /**
+   * @brief Get the number of consecutive failed requests that open the circuit breaker.
+   *
+   * @return int Failure threshold (0 = circuit breaker disabled)
+   */
+  int get_circuit_breaker_failure_threshold() const { return m_circuit_breaker_failure_threshold; }
+
+  /**
+   * @brief Get the time the circuit breaker stays open before a probe request.
+   *
+   * @return int Open duration in milliseconds
+   */
+  int get_circuit_breaker_open_duration_ms() const { return m_circuit_breaker_open_duration_ms; }
+
+  /**
+   * @brief Get the maximum number of queued events.
+   *
+   * @return int Maximum queued events (0 = unlimited)
+   */
+  int get_max_queue_events() const { return m_max_queue_events; }
+
+  /**
+   * @brief Get the maximum total size of queued events.
+   *
+   * @return long long Maximum queued bytes (0 = unlimited)
+   */
+  long long get_max_queue_bytes() const { return m_max_queue_bytes; }
+
+  /**
+   * @brief Get the queue overflow policy.
+   *
+   * @return QueueOverflowPolicy What happens to new events when the queue is full
+   */
+  QueueOverflowPolicy get_queue_overflow_policy() const { return m_queue_overflow_policy; }
+
+  /**
+   * @brief Get the time the BLOCK queue overflow policy waits for room in the queue.
+   *
+   * @return int Block timeout in milliseconds
+   */
+  int get_queue_block_timeout_ms() const { return m_queue_block_timeout_ms; }
+
+  /**
+   * @brief Get the payload fields used to deduplicate events.
+   *
+   * @return vector<string> Payload fields (empty if deduplication is disabled)
+   */
+  vector<string> get_deduplication_fields() const { return m_deduplication_fields; }
+
+  /**
+   * @brief Get the deduplication window.
+   *
+   * @return int Minimum time for which events are remembered in milliseconds
+   */
+  int get_deduplication_window_ms() const { return m_deduplication_window_ms; }
+
+  /**
+   * @brief Get the deduplication capacity.
+   *
+   * @return int Number of events remembered per window
+   */
+  int get_deduplication_capacity() const { return m_deduplication_capacity; }
+
+  /**
+   * @brief Get the target false positive rate of the deduplication.
+   *
+   * @return double Target probability of dropping a unique event
+   */
+  double get_deduplication_false_positive_rate() const { return m_deduplication_false_positive_rate; }
+
   /**
    * @brief Get the custom retry rule settings for HTTP status codes.
    *
@@ -180,6 +382,21 @@ private:
   shared_ptr<EventStore> m_event_store;
   EmitterCallback m_callback;
   EmitStatus m_callback_emit_status;
+  int m_request_callback_queue_size;
+  int m_request_callback_coalescing_window_ms;
+  int m_request_callback_max_queued_event_ids;
+  int m_max_requests_in_flight;
+  int m_max_attempts;
+  int m_circuit_breaker_failure_threshold;
+  int m_circuit_breaker_open_duration_ms;
+  int m_max_queue_events;
+  long long m_max_queue_bytes;
+  QueueOverflowPolicy m_queue_overflow_policy;
+  int m_queue_block_timeout_ms;
+  vector<string> m_deduplication_fields;
+  int m_deduplication_window_ms;
+  int m_deduplication_capacity;
+  double m_deduplication_false_positive_rate;
   map<int, bool> m_custom_retry_for_status_codes;
   string m_db_name;
 };
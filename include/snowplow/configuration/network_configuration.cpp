@@ -25,6 +25,31 @@ NetworkConfiguration::NetworkConfiguration(const string &collector_url, Method m
 
   m_method = method;
   m_curl_cookie_file = curl_cookie_file;
+  m_connect_timeout_ms = SNOWPLOW_NETWORK_DEFAULT_CONNECT_TIMEOUT_MS;
+  m_request_timeout_ms = SNOWPLOW_NETWORK_DEFAULT_REQUEST_TIMEOUT_MS;
+  m_low_speed_limit = 0;
+  m_low_speed_timeout_ms = 0;
+  m_load_balancing = ROUND_ROBIN;
+
+  CollectorEndpoint endpoint = parse_collector_url(collector_url, 1);
+  m_protocol = endpoint.protocol;
+  m_collector_hostname = endpoint.hostname;
+  m_collector_endpoints.push_back(endpoint);
+}
+
+void NetworkConfiguration::add_collector_endpoint(const string &collector_url, int weight) {
+  if (collector_url.empty()) {
+    throw std::invalid_argument("Empty collector URL");
+  }
+  if (weight <= 0) {
+    throw std::invalid_argument("Collector endpoint weight must be greater than 0");
+  }
+  m_collector_endpoints.push_back(parse_collector_url(collector_url, weight));
+}
+
+CollectorEndpoint NetworkConfiguration::parse_collector_url(const string &collector_url, int weight) {
+  CollectorEndpoint endpoint;
+  endpoint.weight = weight;
 
   string collector_url_lower = collector_url;
   transform(collector_url_lower.begin(), collector_url_lower.end(), collector_url_lower.begin(), ::tolower);
@@ -34,17 +59,40 @@ NetworkConfiguration::NetworkConfiguration(const string &collector_url, Method m
 
   // starts with http://
   if (expected_http.size() <= collector_url_lower.size() && equal(expected_http.begin(), expected_http.end(), collector_url_lower.begin())) {
-    m_protocol = HTTP;
-    m_collector_hostname = collector_url.substr(expected_http.size());
+    endpoint.protocol = HTTP;
+    endpoint.hostname = collector_url.substr(expected_http.size());
   }
   // starts with https://
   else if (expected_https.size() <= collector_url_lower.size() && equal(expected_https.begin(), expected_https.end(), collector_url_lower.begin())) {
-    m_protocol = HTTPS;
-    m_collector_hostname = collector_url.substr(expected_https.size());
+    endpoint.protocol = HTTPS;
+    endpoint.hostname = collector_url.substr(expected_https.size());
   }
   // doesn't contain a protocol, default to HTTPS
   else {
-    m_protocol = HTTPS;
-    m_collector_hostname = collector_url;
+    endpoint.protocol = HTTPS;
+    endpoint.hostname = collector_url;
+  }
+  return endpoint;
+}
+
+void NetworkConfiguration::set_connect_timeout_ms(int connect_timeout_ms) {
+  if (connect_timeout_ms < 0) {
+    throw std::invalid_argument("Connect timeout can't be negative");
+  }
+  m_connect_timeout_ms = connect_timeout_ms;
+}
+
+void NetworkConfiguration::set_request_timeout_ms(int request_timeout_ms) {
+  if (request_timeout_ms < 0) {
+    throw std::invalid_argument("Request timeout can't be negative");
+  }
+  m_request_timeout_ms = request_timeout_ms;
+}
+
+void NetworkConfiguration::set_low_speed_limit(int low_speed_limit, int low_speed_timeout_ms) {
+  if (low_speed_limit < 0 || low_speed_timeout_ms < 0) {
+    throw std::invalid_argument("Low speed limit and timeout can't be negative");
   }
+  m_low_speed_limit = low_speed_limit;
+  m_low_speed_timeout_ms = low_speed_timeout_ms;
 }
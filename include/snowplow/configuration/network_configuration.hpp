@@ -16,6 +16,7 @@ See the Apache License Version 2.0 for the specific language governing permissio
 
 #include <memory>
 #include <string>
+#include <vector>
 #include "../http/http_enums.hpp"
 #include "../http/http_client.hpp"
 
@@ -24,6 +25,16 @@ namespace snowplow {
 using std::shared_ptr;
 using std::unique_ptr;
 using std::string;
+using std::vector;
+
+/**
+ * @brief Snowplow collector endpoint that the emitter sends requests to.
+ */
+struct CollectorEndpoint {
+  string hostname;   // hostname part of the collector URL without the protocol
+  Protocol protocol; // HTTP or HTTPS
+  int weight;        // share of requests relative to the other endpoints
+};
 
 /**
  * @brief Configuration object containing Snowplow collector settings used to initialize an emitter.
@@ -60,6 +71,37 @@ public:
    */
   Protocol get_protocol() const { return m_protocol; }
 
+  /**
+   * @brief Add another collector endpoint to send events to.
+   *
+   * The emitter spreads requests across the collector URL given in the constructor (with weight 1) and the added endpoints.
+   * Endpoints that fail with a retryable error are skipped for an increasing back-off period and their events
+   * are retried on the remaining endpoints.
+   *
+   * @param collector_url Full URL of the collector including the protocol (or defaults to HTTPS if protocol not present).
+   * @param weight Share of requests sent to the endpoint relative to the other endpoints (default: 1).
+   */
+  void add_collector_endpoint(const string &collector_url, int weight = 1);
+
+  /**
+   * @brief Set how requests are spread across multiple collector endpoints.
+   *
+   * @param load_balancing ROUND_ROBIN (weighted, default) or LEAST_OUTSTANDING_REQUESTS
+   */
+  void set_load_balancing(LoadBalancing load_balancing) { m_load_balancing = load_balancing; }
+
+  /**
+   * @brief Get all collector endpoints, starting with the one given in the constructor.
+   *
+   * @return vector<CollectorEndpoint> Collector endpoints
+   */
+  vector<CollectorEndpoint> get_collector_endpoints() const { return m_collector_endpoints; }
+
+  /**
+   * @return LoadBalancing Strategy for spreading requests across collector endpoints
+   */
+  LoadBalancing get_load_balancing() const { return m_load_balancing; }
+
   /**
    * @return string Path to a file where to store cookies in case the CURL HTTP client is used – only relevant under Linux (CURL is not used under Windows and macOS)
    */
@@ -72,6 +114,52 @@ public:
    */
   void set_http_client(unique_ptr<HttpClient> http_client) { m_http_client = std::move(http_client); }
 
+  /**
+   * @brief Set the maximum time to establish a connection to the collector.
+   *
+   * @param connect_timeout_ms Connect timeout in milliseconds (default: 10000, 0 for no timeout).
+   */
+  void set_connect_timeout_ms(int connect_timeout_ms);
+
+  /**
+   * @brief Set the maximum total time of a request to the collector including connecting and reading the response.
+   *
+   * Requests that exceed the timeout fail and their events are retried.
+   *
+   * @param request_timeout_ms Request timeout in milliseconds (default: 30000, 0 for no timeout).
+   */
+  void set_request_timeout_ms(int request_timeout_ms);
+
+  /**
+   * @brief Abort requests that transfer less than the given number of bytes per second for the given time.
+   *
+   * Only supported by the CURL HTTP client.
+   *
+   * @param low_speed_limit Minimum transfer speed in bytes per second (default: 0, disabled).
+   * @param low_speed_timeout_ms Time the transfer may stay below the limit in milliseconds.
+   */
+  void set_low_speed_limit(int low_speed_limit, int low_speed_timeout_ms);
+
+  /**
+   * @return int Connect timeout in milliseconds (0 = no timeout)
+   */
+  int get_connect_timeout_ms() const { return m_connect_timeout_ms; }
+
+  /**
+   * @return int Request timeout in milliseconds (0 = no timeout)
+   */
+  int get_request_timeout_ms() const { return m_request_timeout_ms; }
+
+  /**
+   * @return int Minimum transfer speed in bytes per second (0 = disabled)
+   */
+  int get_low_speed_limit() const { return m_low_speed_limit; }
+
+  /**
+   * @return int Time the transfer may stay below the low speed limit in milliseconds
+   */
+  int get_low_speed_timeout_ms() const { return m_low_speed_timeout_ms; }
+
 private:
   /**
    * @brief Retrieve and take ownership of the configured HTTP client. Can only be called once – by the Emitter.
@@ -80,10 +168,18 @@ private:
    */
   unique_ptr<HttpClient> move_http_client() { return m_http_client ? std::move(m_http_client) : nullptr; }
 
+  static CollectorEndpoint parse_collector_url(const string &collector_url, int weight);
+
   string m_collector_hostname;
   string m_curl_cookie_file;
   Method m_method;
   Protocol m_protocol;
+  int m_connect_timeout_ms;
+  int m_request_timeout_ms;
+  int m_low_speed_limit;
+  int m_low_speed_timeout_ms;
+  vector<CollectorEndpoint> m_collector_endpoints;
+  LoadBalancing m_load_balancing;
   unique_ptr<HttpClient> m_http_client;
 
   friend class Emitter;
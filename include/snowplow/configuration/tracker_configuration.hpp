@@ -15,11 +15,16 @@ See the Apache License Version 2.0 for the specific language governing permissio
 #define TRACKER_CONFIGURATION_H
 
 #include <string>
+#include <utility>
+#include <vector>
+#include "../events/event_filter.hpp"
 
 namespace snowplow {
 
 using std::shared_ptr;
+using std::pair;
 using std::string;
+using std::vector;
 
 /**
  * @brief Device platform that the app is run on.
@@ -35,6 +40,14 @@ enum Platform {
   iot // Internet of Things
 };
 
+/**
+ * @brief Source of the timestamps assigned to events.
+ */
+enum ClockSource {
+  SYSTEM_CLOCK, // Query the system clock for each timestamp (default)
+  CACHED_CLOCK // Read timestamps cached by a background thread that updates them every millisecond
+};
+
 /**
  * @brief Configuration object containing settings used to initialize a Snowplow tracker.
  *
@@ -49,7 +62,7 @@ public:
    * @param app_id Application ID (defaults to empty string).
    * @param platform The platform the Tracker is running on, can be one of: web, mob, pc, app, srv, tv, cnsl, iot (defaults to srv).
    */
-  TrackerConfiguration(const string &name_space, const string &app_id = SNOWPLOW_DEFAULT_APP_ID, Platform platform = srv) : m_namespace(name_space), m_app_id(app_id), m_platform(platform), m_use_base64(true), m_desktop_context(true) {}
+  TrackerConfiguration(const string &name_space, const string &app_id = SNOWPLOW_DEFAULT_APP_ID, Platform platform = srv) : m_namespace(name_space), m_app_id(app_id), m_platform(platform), m_use_base64(true), m_desktop_context(true), m_event_id_version(UUID_V4), m_clock_source(SYSTEM_CLOCK), m_aggregation_window_ms(10000), m_aggregation_capacity(1024), m_thread_buffer_size(0), m_thread_buffer_max_age_ms(1000) {}
 
   /**
    * @brief Set whether to use base64 encoding in events (defaults to true).
@@ -65,6 +78,86 @@ public:
    */
   void set_desktop_context(bool desktop_context) { m_desktop_context = desktop_context; }
 
+  /**
+   * @brief Set the version of UUIDs generated as event IDs (defaults to UUID_V4).
+   *
+   * Time-ordered UUID_V7 event IDs sort by the time they were generated which makes them more efficient to index in the warehouse.
+   *
+   * @param event_id_version UUID version to use for event IDs.
+   */
+  void set_event_id_version(EventIdVersion event_id_version) { m_event_id_version = event_id_version; }
+
+  /**
+   * @brief Set the source of timestamps assigned to events (defaults to SYSTEM_CLOCK).
+   *
+   * The CACHED_CLOCK avoids querying the system clock for each event which may be slow on virtual machines.
+   * While a tracker with the cached clock exists, it is used for all timestamps in the process (including sessions and sent timestamps).
+   *
+   * @param clock_source Clock to use for timestamps.
+   */
+  void set_clock_source(ClockSource clock_source) { m_clock_source = clock_source; }
+
+  /**
+   * @brief Add a filter that decides whether tracked events are kept or dropped before they are stored.
+   *
+   * Filters are evaluated in the order they were added on cheap event properties (event type, schema, user ID)
+   * before the event payload is built, so dropped events cost almost nothing. See `EventFilters` for built-in
+   * sampling and rate limiting filters.
+   *
+   * @param filter Predicate returning true to keep the event.
+   */
+  void add_event_filter(const EventFilter &filter) { m_event_filters.push_back(filter); }
+
+  /**
+   * @brief Roll up structured events with the given category and action into one summary event per aggregation window.
+   *
+   * Events with the same category, action and label are aggregated together. The summary is a structured event
+   * with the sum of values as its value and a JSON object with the count and the min and max of values as its property.
+   * Event subjects, contexts and timestamps of the aggregated events are not kept.
+   *
+   * @param category Category of the structured events to aggregate.
+   * @param action Action of the structured events to aggregate.
+   */
+  void add_aggregated_event(const string &category, const string &action) { m_aggregated_events.push_back({category, action}); }
+
+  /**
+   * @brief Set the length of the window over which structured events are aggregated (defaults to 10000 ms).
+   *
+   * Summaries are tracked with the first event tracked after the window is over and when the tracker is flushed or destroyed.
+   *
+   * @param window_ms Length of the aggregation window in milliseconds.
+   */
+  void set_aggregation_window(unsigned long long window_ms) { m_aggregation_window_ms = window_ms; }
+
+  /**
+   * @brief Set the maximum number of distinct category, action and label combinations aggregated within a window (defaults to 1024).
+   *
+   * Memory for the aggregates is allocated up front. Events over the capacity are tracked without aggregation.
+   *
+   * @param capacity Number of aggregates.
+   */
+  void set_aggregation_capacity(int capacity) { m_aggregation_capacity = capacity; }
+
+  /**
+   * @brief Set the number of events buffered by each tracking thread before they are passed to the Emitter (defaults to 0, disabled).
+   *
+   * Buffered events are passed to the Emitter in batches that are stored in a single transaction, which reduces
+   * contention when many threads track events. Buffers are also passed on once their oldest event is older than
+   * the maximum age, and buffers of all threads are passed on when the tracker is flushed or destroyed.
+   *
+   * @param size Number of events in a buffer (0 to disable buffering).
+   */
+  void set_thread_buffer_size(int size) { m_thread_buffer_size = size; }
+
+  /**
+   * @brief Set the age of the oldest buffered event after which a thread passes its buffer to the Emitter (defaults to 1000 ms).
+   *
+   * The age is checked when the thread tracks an event and by a background thread of the tracker, so buffers of idle threads are passed on as well.
+   *
+   * @param max_age_ms Maximum age in milliseconds (0 to pass on only full buffers).
+   */
+  void set_thread_buffer_max_age(unsigned long long max_age_ms) { m_thread_buffer_max_age_ms = max_age_ms; }
+
   /**
    * @return string Tracker namespace.
    */
@@ -111,12 +204,60 @@ public:
    */
   bool get_desktop_context() const { return m_desktop_context; }
 
+  /**
+   * @return EventIdVersion Version of UUIDs generated as event IDs.
+   */
+  EventIdVersion get_event_id_version() const { return m_event_id_version; }
+
+  /**
+   * @return ClockSource Source of the timestamps assigned to events.
+   */
+  ClockSource get_clock_source() const { return m_clock_source; }
+
+  /**
+   * @return vector<EventFilter> Filters evaluated before tracked events are stored.
+   */
+  vector<EventFilter> get_event_filters() const { return m_event_filters; }
+
+  /**
+   * @return vector<pair<string, string>> Category and action pairs of structured events to aggregate.
+   */
+  vector<pair<string, string>> get_aggregated_events() const { return m_aggregated_events; }
+
+  /**
+   * @return unsigned long long Length of the aggregation window in milliseconds.
+   */
+  unsigned long long get_aggregation_window() const { return m_aggregation_window_ms; }
+
+  /**
+   * @return int Maximum number of aggregates within a window.
+   */
+  int get_aggregation_capacity() const { return m_aggregation_capacity; }
+
+  /**
+   * @return int Number of events buffered by each tracking thread (0 if disabled).
+   */
+  int get_thread_buffer_size() const { return m_thread_buffer_size; }
+
+  /**
+   * @return unsigned long long Maximum age of buffered events in milliseconds.
+   */
+  unsigned long long get_thread_buffer_max_age() const { return m_thread_buffer_max_age_ms; }
+
 private:
   string m_namespace;
   string m_app_id;
   Platform m_platform;
   bool m_use_base64;
   bool m_desktop_context;
+  EventIdVersion m_event_id_version;
+  ClockSource m_clock_source;
+  vector<EventFilter> m_event_filters;
+  vector<pair<string, string>> m_aggregated_events;
+  unsigned long long m_aggregation_window_ms;
+  int m_aggregation_capacity;
+  int m_thread_buffer_size;
+  unsigned long long m_thread_buffer_max_age_ms;
 };
 } // namespace snowplow
 
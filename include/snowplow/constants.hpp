@@ -110,6 +110,18 @@ const unsigned long long SNOWPLOW_SESSION_DEFAULT_TIMEOUT = 30 * 1000 * 1000; //
 const int SNOWPLOW_EMITTER_DEFAULT_BATCH_SIZE = 250;
 const int SNOWPLOW_EMITTER_DEFAULT_BYTE_LIMIT_GET = 40000;
 const int SNOWPLOW_EMITTER_DEFAULT_BYTE_LIMIT_POST = 40000;
+const int SNOWPLOW_EMITTER_DEFAULT_CALLBACK_QUEUE_SIZE = 100;
+const int SNOWPLOW_EMITTER_DEFAULT_CALLBACK_QUEUED_EVENT_IDS = SNOWPLOW_EMITTER_DEFAULT_CALLBACK_QUEUE_SIZE * SNOWPLOW_EMITTER_DEFAULT_BATCH_SIZE;
+const int SNOWPLOW_EMITTER_DEFAULT_MAX_REQUESTS_IN_FLIGHT = 15;
+const int SNOWPLOW_EMITTER_DEFAULT_CIRCUIT_BREAKER_OPEN_DURATION_MS = 30000;
+const int SNOWPLOW_EMITTER_DEFAULT_DEDUPLICATION_CAPACITY = 100000;
+const double SNOWPLOW_EMITTER_DEFAULT_DEDUPLICATION_FALSE_POSITIVE_RATE = 0.001;
+const int SNOWPLOW_EMITTER_MAX_RETRY_AFTER_MS = 10 * 60 * 1000; // 10 minutes
+const int SNOWPLOW_EMITTER_MAINTENANCE_INTERVAL_MS = 60 * 1000; // 1 minute
+
+// network defaults
+const int SNOWPLOW_NETWORK_DEFAULT_CONNECT_TIMEOUT_MS = 10000;
+const int SNOWPLOW_NETWORK_DEFAULT_REQUEST_TIMEOUT_MS = 30000;
 
 // tracker defaults
 const string SNOWPLOW_DEFAULT_APP_ID = "";
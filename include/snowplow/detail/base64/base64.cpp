@@ -22,11 +22,25 @@
    3. This notice may not be removed or altered from any source distribution.
 
    René Nyffenegger rene.nyffenegger@adp-gmbh.ch
+
+   Altered by Snowplow Analytics Ltd: the encoder writes into a pre-sized buffer,
+   uses SSSE3/AVX2 when the CPU supports them and can produce URL-safe output.
 */
 
 #include "base64.hpp"
 #include <iostream>
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SNOWPLOW_BASE64_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SNOWPLOW_BASE64_TARGET(isa)
+#else
+#define SNOWPLOW_BASE64_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
 using unsigned_char_t = unsigned char;
 
 static const std::string base64_chars =
@@ -34,47 +48,188 @@ static const std::string base64_chars =
              "abcdefghijklmnopqrstuvwxyz"
              "0123456789+/";
 
+static const char base64_url_chars[] =
+             "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+             "abcdefghijklmnopqrstuvwxyz"
+             "0123456789-_";
+
 static inline bool is_base64(unsigned char c) {
-  return (isalnum(c) || (c == '+') || (c == '/'));
+  return (isalnum(c) || (c == '+') || (c == '/') || (c == '-') || (c == '_'));
 }
 
-std::string base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len) {
-  std::string ret;
-  int i = 0;
-  int j = 0;
-  unsigned char char_array_3[3];
-  unsigned char char_array_4[4];
-
-  while (in_len--) {
-    char_array_3[i++] = *(bytes_to_encode++);
-    if (i == 3) {
-      char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-      char_array_4[1] = unsigned_char_t(((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4));
-      char_array_4[2] = unsigned_char_t(((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6));
-      char_array_4[3] = char_array_3[2] & 0x3f;
-
-      for (i = 0; (i <4) ; i++)
-        ret += base64_chars[char_array_4[i]];
-      i = 0;
-    }
+static inline unsigned char base64_index(unsigned char c) {
+  if (c == '-') return 62;
+  if (c == '_') return 63;
+  return unsigned_char_t(base64_chars.find(char(c)));
+}
+
+// Encodes whole 3 byte groups and returns the number of bytes consumed
+typedef size_t (*encode_blocks_t)(unsigned char const* in, size_t len, char* out, bool url_safe);
+
+static size_t encode_blocks_scalar(unsigned char const* in, size_t len, char* out, bool url_safe) {
+  const char* chars = url_safe ? base64_url_chars : base64_chars.c_str();
+  size_t i = 0;
+  for (; i + 3 <= len; i += 3) {
+    unsigned int group = (unsigned(in[i]) << 16) | (unsigned(in[i + 1]) << 8) | unsigned(in[i + 2]);
+    *out++ = chars[(group >> 18) & 0x3f];
+    *out++ = chars[(group >> 12) & 0x3f];
+    *out++ = chars[(group >> 6) & 0x3f];
+    *out++ = chars[group & 0x3f];
   }
+  return i;
+}
 
-  if (i) {
-    for (j = i; j < 3; j++)
-      char_array_3[j] = '\0';
+#ifdef SNOWPLOW_BASE64_X86
+// Vectorised encoding after Wojciech Muła, "Base64 encoding with SIMD instructions":
+// bytes are shuffled so that each 32-bit lane holds one 3 byte group, the four 6-bit
+// indices are split out with two multiplications and mapped to ASCII with one shuffle.
+
+SNOWPLOW_BASE64_TARGET("ssse3")
+static inline __m128i base64_lookup_ssse3(__m128i indices, bool url_safe) {
+  // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12
+  __m128i offsets = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+  offsets = _mm_or_si128(offsets, _mm_and_si128(less, _mm_set1_epi8(13)));
+
+  const char c62 = url_safe ? '-' : '+';
+  const char c63 = url_safe ? '_' : '/';
+  const __m128i shift_lut = _mm_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, char(c62 - 62), char(c63 - 63), 'A', 0, 0);
+  return _mm_add_epi8(_mm_shuffle_epi8(shift_lut, offsets), indices);
+}
+
+SNOWPLOW_BASE64_TARGET("ssse3")
+static inline __m128i base64_split_ssse3(__m128i in) {
+  in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+  __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+  __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+  __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+  return _mm_or_si128(t1, t3);
+}
+
+SNOWPLOW_BASE64_TARGET("ssse3")
+static size_t encode_blocks_ssse3(unsigned char const* in, size_t len, char* out, bool url_safe) {
+  size_t i = 0;
+  // each step consumes 12 bytes but loads 16
+  for (; i + 16 <= len; i += 12) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), base64_lookup_ssse3(base64_split_ssse3(block), url_safe));
+    out += 16;
+  }
+  return i + encode_blocks_scalar(in + i, len - i, out, url_safe);
+}
+
+SNOWPLOW_BASE64_TARGET("avx2")
+static size_t encode_blocks_avx2(unsigned char const* in, size_t len, char* out, bool url_safe) {
+  const char c62 = url_safe ? '-' : '+';
+  const char c63 = url_safe ? '_' : '/';
+  const __m256i shuffle = _mm256_set_epi8(
+      10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+      10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+  const __m256i shift_lut = _mm256_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, char(c62 - 62), char(c63 - 63), 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, char(c62 - 62), char(c63 - 63), 'A', 0, 0);
+
+  size_t i = 0;
+  // each step consumes 24 bytes as two 12 byte lanes, the upper load reaches 28 bytes ahead
+  for (; i + 28 <= len; i += 24) {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 12));
+    __m256i block = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+    block = _mm256_shuffle_epi8(block, shuffle);
+    __m256i t0 = _mm256_and_si256(block, _mm256_set1_epi32(0x0fc0fc00));
+    __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    __m256i t2 = _mm256_and_si256(block, _mm256_set1_epi32(0x003f03f0));
+    __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    __m256i indices = _mm256_or_si256(t1, t3);
+
+    __m256i offsets = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    offsets = _mm256_or_si256(offsets, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    __m256i result = _mm256_add_epi8(_mm256_shuffle_epi8(shift_lut, offsets), indices);
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), result);
+    out += 32;
+  }
+  return i + encode_blocks_ssse3(in + i, len - i, out, url_safe);
+}
+
+static encode_blocks_t select_encode_blocks() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+  int max_leaf = info[0];
+  __cpuid(info, 1);
+  bool has_ssse3 = (info[2] & (1 << 9)) != 0;
+  bool has_osxsave_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0;
+  bool has_avx2 = false;
+  if (max_leaf >= 7 && has_osxsave_avx && (_xgetbv(0) & 0x6) == 0x6) {
+    __cpuidex(info, 7, 0);
+    has_avx2 = (info[1] & (1 << 5)) != 0;
+  }
+#else
+  __builtin_cpu_init();
+  bool has_ssse3 = __builtin_cpu_supports("ssse3");
+  bool has_avx2 = __builtin_cpu_supports("avx2");
+#endif
+  if (has_avx2) {
+    return encode_blocks_avx2;
+  }
+  if (has_ssse3) {
+    return encode_blocks_ssse3;
+  }
+  return encode_blocks_scalar;
+}
+#else
+static encode_blocks_t select_encode_blocks() {
+  return encode_blocks_scalar;
+}
+#endif
+
+size_t base64_encoded_length(size_t len, bool url_safe) {
+  if (url_safe) {
+    return len / 3 * 4 + (len % 3 ? len % 3 + 1 : 0);
+  }
+  return (len + 2) / 3 * 4;
+}
 
-    char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-    char_array_4[1] = unsigned_char_t(((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4));
-    char_array_4[2] = unsigned_char_t(((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6));
-    char_array_4[3] = char_array_3[2] & 0x3f;
+void base64_encode_into(unsigned char const* bytes_to_encode, size_t len, char* out, bool url_safe) {
+  static const encode_blocks_t encode_blocks = select_encode_blocks();
 
-    for (j = 0; (j < i + 1); j++)
-      ret += base64_chars[char_array_4[j]];
+  size_t done = encode_blocks(bytes_to_encode, len, out, url_safe);
+  out += done / 3 * 4;
 
-    while((i++ < 3))
-      ret += '=';
+  size_t rest = len - done;
+  if (rest) {
+    const char* chars = url_safe ? base64_url_chars : base64_chars.c_str();
+    unsigned int group = unsigned(bytes_to_encode[done]) << 16;
+    if (rest == 2) {
+      group |= unsigned(bytes_to_encode[done + 1]) << 8;
+    }
+    *out++ = chars[(group >> 18) & 0x3f];
+    *out++ = chars[(group >> 12) & 0x3f];
+    if (rest == 2) {
+      *out++ = chars[(group >> 6) & 0x3f];
+    }
+    if (!url_safe) {
+      if (rest == 1) {
+        *out++ = '=';
+      }
+      *out++ = '=';
+    }
   }
+}
 
+std::string base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len, bool url_safe) {
+  std::string ret(base64_encoded_length(in_len, url_safe), '\0');
+  if (in_len) {
+    base64_encode_into(bytes_to_encode, in_len, &ret[0], url_safe);
+  }
   return ret;
 }
 
@@ -90,7 +245,7 @@ std::string base64_decode(std::string const& encoded_string) {
     char_array_4[i++] = encoded_string[in_]; in_++;
     if (i == 4) {
       for (i = 0; i < 4; i++)
-        char_array_4[i] = unsigned_char_t(base64_chars.find(char_array_4[i]));
+        char_array_4[i] = base64_index(char_array_4[i]);
 
       char_array_3[0] = unsigned_char_t((char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4));
       char_array_3[1] = unsigned_char_t(((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2));
@@ -107,7 +262,7 @@ std::string base64_decode(std::string const& encoded_string) {
       char_array_4[j] = 0;
 
     for (j = 0; j < 4; j++)
-      char_array_4[j] = unsigned_char_t(base64_chars.find(char_array_4[j]));
+      char_array_4[j] = base64_index(char_array_4[j]);
 
     char_array_3[0] = unsigned_char_t((char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4));
     char_array_3[1] = unsigned_char_t(((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2));
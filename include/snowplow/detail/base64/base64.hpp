@@ -22,9 +22,32 @@
    3. This notice may not be removed or altered from any source distribution.
 
    René Nyffenegger rene.nyffenegger@adp-gmbh.ch
+
+   Altered by Snowplow Analytics Ltd: the encoder writes into a pre-sized buffer,
+   uses SSSE3/AVX2 when the CPU supports them and can produce URL-safe output.
 */
 
+#ifndef BASE64_H
+#define BASE64_H
+
+#include <cstddef>
 #include <string>
 
-std::string base64_encode(unsigned char const*, unsigned int len);
+/**
+ * @brief Length of the base64 encoding of len bytes.
+ *
+ * Standard output is padded with '=' to a multiple of 4 characters, URL-safe output is not padded.
+ */
+size_t base64_encoded_length(size_t len, bool url_safe = false);
+
+/**
+ * @brief Encode len bytes into out which must have room for base64_encoded_length(len, url_safe) characters.
+ *
+ * URL-safe output uses '-' and '_' in place of '+' and '/' and omits the padding.
+ */
+void base64_encode_into(unsigned char const* bytes_to_encode, size_t len, char* out, bool url_safe = false);
+
+std::string base64_encode(unsigned char const*, unsigned int len, bool url_safe = false);
 std::string base64_decode(std::string const& s);
+
+#endif
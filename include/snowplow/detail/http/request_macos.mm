@@ -16,10 +16,15 @@ See the Apache License Version 2.0 for the specific language governing permissio
 #import "request_macos_interface.h"
 #import "../../constants.hpp"
 #import <Foundation/Foundation.h>
+#include <chrono>
 
-int snowplow::make_request(bool is_post, const string &url, const string &post_data) {
+int snowplow::make_request(bool is_post, const string &url, const string &post_data, int connect_timeout_ms, int request_timeout_ms, const std::function<bool()> &is_cancelled, string *retry_after) {
     NSString *nsUrl = [NSString stringWithUTF8String:url.c_str()];
     NSMutableURLRequest *urlRequest = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:nsUrl]];
+    if (connect_timeout_ms > 0) {
+        // idle timeout, applies to connecting as well as to gaps in the transfer
+        [urlRequest setTimeoutInterval:connect_timeout_ms / 1000.0];
+    }
     [urlRequest setValue:@"Snowplow C++ Tracker (macOS)" forHTTPHeaderField:@"User-Agent"];
     [urlRequest setValue:@"keep-alive" forHTTPHeaderField:@"Connection"];
 
@@ -40,16 +45,29 @@ int snowplow::make_request(bool is_post, const string &url, const string &post_d
 
     sem = dispatch_semaphore_create(0);
 
-    [[[NSURLSession sharedSession] dataTaskWithRequest:urlRequest
+    NSURLSessionDataTask *task = [[NSURLSession sharedSession] dataTaskWithRequest:urlRequest
                                         completionHandler:^(NSData *data, NSURLResponse *urlResponse, NSError *error) {
 
         connectionError = error;
         httpResponse = (NSHTTPURLResponse*)urlResponse;
 
         dispatch_semaphore_signal(sem);
-    }] resume];
+    }];
+    [task resume];
+
+    // wait in short slices to notice cancellation and the request deadline
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(request_timeout_ms);
+    while (dispatch_semaphore_wait(sem, dispatch_time(DISPATCH_TIME_NOW, 50 * NSEC_PER_MSEC)) != 0) {
+        if (is_cancelled() || (request_timeout_ms > 0 && std::chrono::steady_clock::now() >= deadline)) {
+            [task cancel];
+            return 0;
+        }
+    }
 
-    dispatch_semaphore_wait(sem, DISPATCH_TIME_FOREVER);
+    NSString *retryAfter = [[httpResponse allHeaderFields] objectForKey:@"Retry-After"];
+    if (retryAfter != nil) {
+        *retry_after = string([retryAfter UTF8String]);
+    }
 
     return int([httpResponse statusCode]);
 }
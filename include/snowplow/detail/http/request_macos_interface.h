@@ -16,11 +16,12 @@ See the Apache License Version 2.0 for the specific language governing permissio
 
 #if defined(__APPLE__)
 
+#include <functional>
 #include <string>
 
 namespace snowplow {
 using std::string;
-int make_request(bool is_post, const string &url, const string &post_data);
+int make_request(bool is_post, const string &url, const string &post_data, int connect_timeout_ms, int request_timeout_ms, const std::function<bool()> &is_cancelled, string *retry_after);
 }
 
 #endif
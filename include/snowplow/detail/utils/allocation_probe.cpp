@@ -0,0 +1,86 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "allocation_probe.hpp"
+#include <atomic>
+#include <mutex>
+
+using namespace snowplow;
+using std::lock_guard;
+using std::mutex;
+
+namespace {
+std::atomic<unsigned long long> total_allocations(0);
+std::atomic<unsigned long long> total_bytes(0);
+
+// plain counters are safe to use from within operator new
+thread_local unsigned long long thread_allocations = 0;
+thread_local unsigned long long thread_bytes = 0;
+
+struct StageStats {
+  mutex access;
+  map<string, AllocationStats> stats;
+};
+
+StageStats &get_stage_stats() {
+  static StageStats *stage_stats = new StageStats(); // never destroyed so that probes in static destructors are safe
+  return *stage_stats;
+}
+} // namespace
+
+AllocationProbe::AllocationProbe(const char *stage) : m_stage(stage), m_allocations_before(thread_allocations), m_bytes_before(thread_bytes) {}
+
+AllocationProbe::~AllocationProbe() {
+  unsigned long long allocations = thread_allocations;
+  unsigned long long bytes = thread_bytes;
+
+  StageStats &stage_stats = get_stage_stats();
+  {
+    lock_guard<mutex> guard(stage_stats.access);
+    AllocationStats &stats = stage_stats.stats[m_stage];
+    stats.calls++;
+    stats.allocations += allocations - m_allocations_before;
+    stats.bytes += bytes - m_bytes_before;
+  }
+
+  // don't attribute the bookkeeping above to enclosing probes
+  thread_allocations = allocations;
+  thread_bytes = bytes;
+}
+
+void AllocationProbe::record_allocation(size_t bytes) {
+  thread_allocations++;
+  thread_bytes += bytes;
+  total_allocations.fetch_add(1, std::memory_order_relaxed);
+  total_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+unsigned long long AllocationProbe::get_allocation_count() {
+  return total_allocations.load();
+}
+
+unsigned long long AllocationProbe::get_allocated_bytes() {
+  return total_bytes.load();
+}
+
+map<string, AllocationStats> AllocationProbe::get_stats() {
+  StageStats &stage_stats = get_stage_stats();
+  lock_guard<mutex> guard(stage_stats.access);
+  return stage_stats.stats;
+}
+
+void AllocationProbe::reset_stats() {
+  StageStats &stage_stats = get_stage_stats();
+  lock_guard<mutex> guard(stage_stats.access);
+  stage_stats.stats.clear();
+}
@@ -0,0 +1,103 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#ifndef ALLOCATION_PROBE_H
+#define ALLOCATION_PROBE_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+namespace snowplow {
+
+using std::map;
+using std::string;
+
+/**
+ * @brief Heap allocations counted by probes of a single stage.
+ */
+struct AllocationStats {
+  unsigned long long calls = 0; // Number of times the stage was run
+  unsigned long long allocations = 0; // Number of allocations made in the stage
+  unsigned long long bytes = 0; // Number of bytes allocated in the stage
+};
+
+/**
+ * @brief Scoped probe that attributes the heap allocations made by the current thread within its scope to a stage.
+ *
+ * Allocations are only counted in programs linked with the counting allocator (`counting_allocator.cpp`), which
+ * the performance program always is and the test program is when built with the `SNOWPLOW_COUNT_ALLOCATIONS`
+ * CMake option. The probes in the tracker are placed using `SNOWPLOW_ALLOCATION_PROBE` which compiles to nothing
+ * unless the option is enabled. Nested probes count the allocations of their inner probes as well.
+ */
+class AllocationProbe {
+public:
+  /**
+   * @brief Start counting allocations of the stage.
+   *
+   * @param stage Name of the stage, must outlive the probe (e.g., a string literal)
+   */
+  explicit AllocationProbe(const char *stage);
+
+  /**
+   * @brief Add the allocations made since the probe was created to the stage statistics.
+   */
+  ~AllocationProbe();
+
+  AllocationProbe(const AllocationProbe &) = delete;
+  AllocationProbe &operator=(const AllocationProbe &) = delete;
+
+  /**
+   * @brief Count an allocation, called by the counting allocator.
+   *
+   * @param bytes Size of the allocation
+   */
+  static void record_allocation(size_t bytes);
+
+  /**
+   * @return unsigned long long Number of allocations counted in the process
+   */
+  static unsigned long long get_allocation_count();
+
+  /**
+   * @return unsigned long long Number of bytes allocated in the process
+   */
+  static unsigned long long get_allocated_bytes();
+
+  /**
+   * @return map<string, AllocationStats> Allocations per stage since the last reset
+   */
+  static map<string, AllocationStats> get_stats();
+
+  /**
+   * @brief Clear the statistics of all stages.
+   */
+  static void reset_stats();
+
+private:
+  const char *m_stage;
+  unsigned long long m_allocations_before;
+  unsigned long long m_bytes_before;
+};
+} // namespace snowplow
+
+#define SNOWPLOW_ALLOCATION_PROBE_CONCAT_INNER(a, b) a##b
+#define SNOWPLOW_ALLOCATION_PROBE_CONCAT(a, b) SNOWPLOW_ALLOCATION_PROBE_CONCAT_INNER(a, b)
+
+#ifdef SNOWPLOW_COUNT_ALLOCATIONS
+#define SNOWPLOW_ALLOCATION_PROBE(stage) snowplow::AllocationProbe SNOWPLOW_ALLOCATION_PROBE_CONCAT(snowplow_allocation_probe_, __LINE__)(stage)
+#else
+#define SNOWPLOW_ALLOCATION_PROBE(stage)
+#endif
+
+#endif
@@ -0,0 +1,72 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "cached_clock.hpp"
+
+using namespace snowplow;
+using std::lock_guard;
+using std::mutex;
+using std::unique_lock;
+using std::chrono::duration_cast;
+using std::chrono::system_clock;
+
+const milliseconds CachedClock::TICK_INTERVAL = milliseconds(1);
+
+std::atomic<bool> CachedClock::m_running(false);
+std::atomic<unsigned long long> CachedClock::m_now_ms(0);
+
+CachedClock::Ticker &CachedClock::get_ticker() {
+  // never destroyed so that trackers released during static destruction can still stop the thread
+  static Ticker *ticker = new Ticker();
+  return *ticker;
+}
+
+void CachedClock::acquire() {
+  Ticker &ticker = get_ticker();
+  lock_guard<mutex> guard(ticker.mutex);
+
+  if (ticker.users++ == 0) {
+    tick();
+    m_running = true;
+    ticker.thread = std::thread(&CachedClock::run, &ticker, ++ticker.generation);
+  }
+}
+
+void CachedClock::release() {
+  Ticker &ticker = get_ticker();
+  unique_lock<mutex> locker(ticker.mutex);
+
+  if (ticker.users == 0 || --ticker.users > 0) {
+    return;
+  }
+
+  m_running = false;
+  ticker.generation++;
+  std::thread thread = std::move(ticker.thread);
+  locker.unlock();
+
+  ticker.stop_requested.notify_all();
+  thread.join();
+}
+
+void CachedClock::run(Ticker *ticker, unsigned long generation) {
+  unique_lock<mutex> locker(ticker->mutex);
+  while (ticker->generation == generation) {
+    tick();
+    ticker->stop_requested.wait_for(locker, TICK_INTERVAL);
+  }
+}
+
+void CachedClock::tick() {
+  m_now_ms.store(duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+}
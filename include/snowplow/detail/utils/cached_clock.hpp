@@ -0,0 +1,78 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#ifndef CACHED_CLOCK_H
+#define CACHED_CLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace snowplow {
+
+using std::chrono::milliseconds;
+
+/**
+ * @brief Process-wide coarse clock serving Unix timestamps from a value cached by a background ticker thread.
+ *
+ * The ticker runs while at least one user has acquired the clock (e.g., a tracker configured with `CACHED_CLOCK`).
+ * During that time `Utils::get_unix_epoch_ms()` reads the cached value instead of querying the system clock.
+ */
+class CachedClock {
+public:
+  /**
+   * @brief Start the ticker thread if not already running and register a new user of the clock.
+   */
+  static void acquire();
+
+  /**
+   * @brief Unregister a user of the clock and stop the ticker thread if it was the last one.
+   */
+  static void release();
+
+  /**
+   * @brief Check whether the ticker thread is running and timestamps are served from the cache.
+   */
+  static bool is_running() { return m_running.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Get the cached Unix timestamp in milliseconds.
+   */
+  static unsigned long long get_unix_epoch_ms() { return m_now_ms.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Interval in which the ticker thread updates the cached timestamp.
+   */
+  static const milliseconds TICK_INTERVAL;
+
+private:
+  struct Ticker {
+    std::mutex mutex;
+    std::condition_variable stop_requested;
+    std::thread thread;
+    int users = 0;
+    unsigned long generation = 0;
+  };
+
+  static Ticker &get_ticker();
+  static void run(Ticker *ticker, unsigned long generation);
+  static void tick();
+
+  static std::atomic<bool> m_running;
+  static std::atomic<unsigned long long> m_now_ms;
+};
+} // namespace snowplow
+
+#endif
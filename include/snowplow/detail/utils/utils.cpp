@@ -12,67 +12,162 @@ See the Apache License Version 2.0 for the specific language governing permissio
 */
 
 #include "utils.hpp"
+#include "cached_clock.hpp"
+#include "allocation_probe.hpp"
+#include "../../payload/json_writer.hpp"
+#include <vector>
 
 using namespace snowplow;
-using std::hex;
-using std::nouppercase;
-using std::ostringstream;
 using std::runtime_error;
-using std::setw;
 using std::stringstream;
 using std::to_string;
-using std::uppercase;
+using std::vector;
 using std::chrono::duration_cast;
 using std::chrono::milliseconds;
 using std::chrono::system_clock;
 
+// --- UUIDs
+
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
 
-string Utils::get_uuid4() {
-  UUID uuid = {0};
-  string uid;
-
-  ::UuidCreate(&uuid);
-  RPC_CSTR szUuid = NULL;
-  if (::UuidToStringA(&uuid, &szUuid) == RPC_S_OK) {
-    uid = (char *)szUuid;
-    ::RpcStringFreeA(&szUuid);
-  } else {
+static void fill_random_bytes(unsigned char *buffer, size_t length) {
+  NTSTATUS status = ::BCryptGenRandom(NULL, buffer, ULONG(length), BCRYPT_USE_SYSTEM_PREFERRED_RNG);
+  if (!BCRYPT_SUCCESS(status)) {
     throw runtime_error("FATAL: Could not generate unique UUID");
   }
-
-  return uid;
 }
 
-#elif defined(__APPLE__)
-
-string Utils::get_uuid4() {
-  CFUUIDRef cf_uuid_ref = CFUUIDCreate(kCFAllocatorDefault);
-  CFStringRef cf_uuid_str_ref = CFUUIDCreateString(kCFAllocatorDefault, cf_uuid_ref);
+static void register_fork_handler() {}
 
-  string uuid(CFStringGetCStringPtr(cf_uuid_str_ref, kCFStringEncodingUTF8));
-  transform(uuid.begin(), uuid.end(), uuid.begin(), ::tolower);
+#elif defined(__APPLE__)
 
-  CFRelease(cf_uuid_ref);
-  CFRelease(cf_uuid_str_ref);
+#include <pthread.h>
+#include <stdlib.h>
 
-  return uuid;
+static void fill_random_bytes(unsigned char *buffer, size_t length) {
+  arc4random_buf(buffer, length);
 }
 
 #else
 
 #include <uuid/uuid.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+static void fill_random_bytes(unsigned char *buffer, size_t length) {
+  size_t filled = 0;
+
+#if defined(SYS_getrandom)
+  while (filled < length) {
+    long rc = syscall(SYS_getrandom, buffer + filled, length - filled, 0);
+    if (rc > 0) {
+      filled += size_t(rc);
+    } else if (rc < 0 && errno == EINTR) {
+      continue;
+    } else {
+      break; // getrandom is not available on kernels older than 3.17
+    }
+  }
+#endif
 
-string Utils::get_uuid4() {
-  uuid_t uuid;
-  char str[200];
-  uuid_generate_random(uuid);
-  uuid_unparse(uuid, str);
-  return string(str);
+  // fall back to libuuid, only taking the bytes that are not fixed by the UUID version and variant
+  while (filled < length) {
+    uuid_t uuid;
+    uuid_generate_random(uuid);
+    for (int i = 0; i < 16 && filled < length; i++) {
+      if (i != 6 && i != 8) {
+        buffer[filled++] = uuid[i];
+      }
+    }
+  }
 }
 
 #endif
 
+namespace {
+const size_t random_pool_size = 4096;
+
+// Per-thread pool of random bytes refilled from the OS CSPRNG in large chunks
+struct RandomPool {
+  unsigned char bytes[random_pool_size];
+  size_t offset;
+  unsigned int fork_generation;
+
+  RandomPool() : offset(random_pool_size), fork_generation(0) {}
+};
+
+thread_local RandomPool random_pool;
+
+// Incremented in forked child processes so that they don't reuse bytes already buffered by the parent
+std::atomic<unsigned int> fork_generation(0);
+} // namespace
+
+#if !defined(WIN32) && !defined(_WIN32) && !defined(__WIN32) || defined(__CYGWIN__)
+
+static void register_fork_handler() {
+  static bool registered = pthread_atfork(NULL, NULL, []() { fork_generation++; }) == 0;
+  (void)registered;
+}
+
+#endif
+
+static void take_random_bytes(unsigned char *out, size_t length) {
+  RandomPool &pool = random_pool;
+  unsigned int generation = fork_generation.load(std::memory_order_relaxed);
+
+  if (pool.offset + length > random_pool_size || pool.fork_generation != generation) {
+    register_fork_handler();
+    fill_random_bytes(pool.bytes, random_pool_size);
+    pool.offset = 0;
+    pool.fork_generation = generation;
+  }
+
+  memcpy(out, pool.bytes + pool.offset, length);
+  pool.offset += length;
+}
+
+static string format_uuid(const unsigned char *bytes) {
+  static const char hex_digits[] = "0123456789abcdef";
+  static const unsigned char offsets[16] = {0, 2, 4, 6, 9, 11, 14, 16, 19, 21, 24, 26, 28, 30, 32, 34};
+
+  char buffer[36];
+  for (int i = 0; i < 16; i++) {
+    buffer[offsets[i]] = hex_digits[bytes[i] >> 4];
+    buffer[offsets[i] + 1] = hex_digits[bytes[i] & 0x0f];
+  }
+  buffer[8] = buffer[13] = buffer[18] = buffer[23] = '-';
+
+  return string(buffer, sizeof(buffer));
+}
+
+string Utils::get_uuid4() {
+  unsigned char bytes[16];
+  take_random_bytes(bytes, sizeof(bytes));
+
+  bytes[6] = (bytes[6] & 0x0f) | 0x40; // version 4
+  bytes[8] = (bytes[8] & 0x3f) | 0x80; // RFC 4122 variant
+
+  return format_uuid(bytes);
+}
+
+string Utils::get_uuid7() {
+  unsigned char bytes[16];
+  take_random_bytes(bytes + 6, sizeof(bytes) - 6);
+
+  // 48-bit big-endian Unix timestamp in milliseconds
+  unsigned long long timestamp = get_unix_epoch_ms();
+  for (int i = 0; i < 6; i++) {
+    bytes[i] = (unsigned char)(timestamp >> (40 - 8 * i));
+  }
+
+  bytes[6] = (bytes[6] & 0x0f) | 0x70; // version 7
+  bytes[8] = (bytes[8] & 0x3f) | 0x80; // RFC 4122 variant
+
+  return format_uuid(bytes);
+}
+
 string Utils::int_list_to_string(const list<int> &int_list, const string &delimiter) {
   stringstream s;
   int i = 0;
@@ -89,46 +184,141 @@ string Utils::int_list_to_string(const list<int> &int_list, const string &delimi
   return s.str();
 }
 
-string Utils::map_to_query_string(map<string, string> m) {
-  stringstream s;
-  int i;
-  map<string, string>::iterator it;
+string Utils::uint_to_string(unsigned long long value) {
+  static const char digit_pairs[] =
+      "00010203040506070809"
+      "10111213141516171819"
+      "20212223242526272829"
+      "30313233343536373839"
+      "40414243444546474849"
+      "50515253545556575859"
+      "60616263646566676869"
+      "70717273747576777879"
+      "80818283848586878889"
+      "90919293949596979899";
+
+  // write two digits at a time from the end of the buffer
+  char buffer[20];
+  char *end = buffer + sizeof(buffer);
+  char *it = end;
+  while (value >= 100) {
+    unsigned int pair = unsigned(value % 100) * 2;
+    value /= 100;
+    *--it = digit_pairs[pair + 1];
+    *--it = digit_pairs[pair];
+  }
+  if (value >= 10) {
+    unsigned int pair = unsigned(value) * 2;
+    *--it = digit_pairs[pair + 1];
+    *--it = digit_pairs[pair];
+  } else {
+    *--it = char('0' + value);
+  }
 
-  int length = int(m.size());
-  for (i = 0, it = m.begin(); it != m.end(); ++it, ++i) {
-    s << Utils::url_encode(it->first) << "=" << Utils::url_encode(it->second);
-    if (i < length - 1) {
-      s << "&";
+  return string(it, end);
+}
+
+// --- URL encoding
+
+namespace {
+// Characters that are copied verbatim by url_encode (alphanumerics and "-_."), all others are percent-encoded
+struct UrlEncodeTable {
+  bool unreserved[256];
+
+  UrlEncodeTable() {
+    for (int c = 0; c < 256; c++) {
+      unreserved[c] = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '-' || c == '_' || c == '.';
     }
   }
+};
 
-  return s.str();
+const UrlEncodeTable &get_url_encode_table() {
+  static const UrlEncodeTable table;
+  return table;
 }
 
-string Utils::url_encode(string value) {
-  ostringstream escaped;
-  string::iterator i;
+const char UPPER_HEX_DIGITS[] = "0123456789ABCDEF";
 
-  escaped.fill('0');
-  escaped << hex;
+size_t url_encoded_length(const string &value, const UrlEncodeTable &table) {
+  size_t length = value.size();
+  for (unsigned char c : value) {
+    length += table.unreserved[c] ? 0 : 2;
+  }
+  return length;
+}
 
-  for (i = value.begin(); i != value.end(); ++i) {
-    char c = (*i);
-    if (isalnum(c) || c == '-' || c == '_' || c == '.') {
-      escaped << c;
-      continue;
+void url_encode_append(const string &value, const UrlEncodeTable &table, string &out) {
+  const unsigned char *it = reinterpret_cast<const unsigned char *>(value.data());
+  const unsigned char *end = it + value.size();
+
+  while (it != end) {
+    // copy runs of unreserved characters in one go
+    const unsigned char *run_start = it;
+    while (it != end && table.unreserved[*it]) {
+      ++it;
     }
-    escaped << uppercase;
-    escaped << '%' << uppercase << setw(2) << int((unsigned char)c);
-    escaped << nouppercase;
+    if (it != run_start) {
+      out.append(reinterpret_cast<const char *>(run_start), size_t(it - run_start));
+    }
+    if (it == end) {
+      break;
+    }
+
+    char escaped[3] = {'%', UPPER_HEX_DIGITS[*it >> 4], UPPER_HEX_DIGITS[*it & 0x0F]};
+    out.append(escaped, 3);
+    ++it;
+  }
+}
+} // namespace
+
+string Utils::map_to_query_string(const map<string, string> &m) {
+  const UrlEncodeTable &table = get_url_encode_table();
+
+  // compute the exact output size so that the buffer is allocated only once
+  size_t length = m.empty() ? 0 : m.size() * 2 - 1;
+  for (const auto &pair : m) {
+    length += url_encoded_length(pair.first, table) + url_encoded_length(pair.second, table);
   }
 
-  return escaped.str();
+  string query_string;
+  query_string.reserve(length);
+  for (auto it = m.begin(); it != m.end(); ++it) {
+    if (it != m.begin()) {
+      query_string += '&';
+    }
+    url_encode_append(it->first, table, query_string);
+    query_string += '=';
+    url_encode_append(it->second, table, query_string);
+  }
+
+  return query_string;
 }
 
-string Utils::serialize_payload(Payload payload) {
-  json j_map(payload.get());
-  return j_map.dump();
+string Utils::url_encode(const string &value) {
+  const UrlEncodeTable &table = get_url_encode_table();
+
+  string escaped;
+  escaped.reserve(url_encoded_length(value, table));
+  url_encode_append(value, table, escaped);
+  return escaped;
+}
+
+string Utils::serialize_payload(const Payload &payload) {
+  SNOWPLOW_ALLOCATION_PROBE("utils.serialize_payload");
+  const map<string, string> &pairs = payload.get_pairs();
+  size_t length = 2;
+  for (auto const &pair : pairs) {
+    length += pair.first.size() + pair.second.size() + 6;
+  }
+
+  // write the pairs directly instead of building a JSON tree, the output is the same as json(pairs).dump()
+  JsonWriter writer(length);
+  writer.begin_object();
+  for (auto const &pair : pairs) {
+    writer.key(pair.first).value(pair.second);
+  }
+  writer.end_object();
+  return writer.release();
 }
 
 Payload Utils::deserialize_json_str(const string &json_str) {
@@ -142,7 +332,117 @@ Payload Utils::deserialize_json_str(const string &json_str) {
   return p;
 }
 
+// --- Binary Payload Encoding
+
+// Payload keys encoded as their 1-based index in the binary format.
+// The indexes are persisted in stored events so keys may only be appended.
+static const vector<string> &get_binary_payload_keys() {
+  static const vector<string> keys = {
+      SNOWPLOW_EVENT, SNOWPLOW_EID, SNOWPLOW_TIMESTAMP, SNOWPLOW_SENT_TIMESTAMP, SNOWPLOW_TRUE_TIMESTAMP,
+      SNOWPLOW_TRACKER_VERSION, SNOWPLOW_APP_ID, SNOWPLOW_SP_NAMESPACE, SNOWPLOW_PLATFORM,
+      SNOWPLOW_CONTEXT, SNOWPLOW_CONTEXT_ENCODED, SNOWPLOW_UNSTRUCTURED, SNOWPLOW_UNSTRUCTURED_ENCODED,
+      SNOWPLOW_UID, SNOWPLOW_RESOLUTION, SNOWPLOW_VIEWPORT, SNOWPLOW_COLOR_DEPTH, SNOWPLOW_TIMEZONE,
+      SNOWPLOW_LANGUAGE, SNOWPLOW_USERAGENT, SNOWPLOW_IP_ADDRESS,
+      SNOWPLOW_SE_CATEGORY, SNOWPLOW_SE_ACTION, SNOWPLOW_SE_LABEL, SNOWPLOW_SE_PROPERTY, SNOWPLOW_SE_VALUE,
+      SNOWPLOW_PAGE_URL, SNOWPLOW_PAGE_TITLE, SNOWPLOW_PAGE_REFR};
+  return keys;
+}
+
+// first byte of payloads in the binary format, JSON payloads start with '{'
+static const unsigned char binary_payload_version = 1;
+
+static void write_varint(size_t value, string &out) {
+  while (value >= 0x80) {
+    out.push_back(char((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(char(value));
+}
+
+static size_t read_varint(const unsigned char **data, const unsigned char *end) {
+  size_t value = 0;
+  for (int shift = 0; *data < end && shift < 64; shift += 7) {
+    unsigned char byte = *(*data)++;
+    value |= size_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+  throw runtime_error("Truncated binary payload");
+}
+
+static string read_bytes(const unsigned char **data, const unsigned char *end) {
+  size_t length = read_varint(data, end);
+  if (length > size_t(end - *data)) {
+    throw runtime_error("Truncated binary payload");
+  }
+  string bytes((const char *)*data, length);
+  *data += length;
+  return bytes;
+}
+
+string Utils::serialize_payload_binary(const Payload &payload) {
+  static const map<string, size_t> key_ids = [] {
+    map<string, size_t> ids;
+    const vector<string> &keys = get_binary_payload_keys();
+    for (size_t i = 0; i < keys.size(); i++) {
+      ids[keys[i]] = i + 1;
+    }
+    return ids;
+  }();
+
+  const map<string, string> &pairs = payload.get_pairs();
+  size_t length = 1;
+  for (auto const &pair : pairs) {
+    length += pair.first.size() + pair.second.size() + 4;
+  }
+
+  // version byte followed by the key ID (0 for keys written inline), the value length and the value for each pair
+  string out;
+  out.reserve(length);
+  out.push_back(char(binary_payload_version));
+  for (auto const &pair : pairs) {
+    auto key_id = key_ids.find(pair.first);
+    if (key_id != key_ids.end()) {
+      write_varint(key_id->second, out);
+    } else {
+      write_varint(0, out);
+      write_varint(pair.first.size(), out);
+      out.append(pair.first);
+    }
+    write_varint(pair.second.size(), out);
+    out.append(pair.second);
+  }
+  return out;
+}
+
+Payload Utils::deserialize_payload(const char *data, size_t length) {
+  if (length == 0 || (unsigned char)data[0] != binary_payload_version) {
+    return deserialize_json_str(string(data, length));
+  }
+
+  Payload p;
+  const unsigned char *position = (const unsigned char *)data + 1;
+  const unsigned char *end = (const unsigned char *)data + length;
+  while (position < end) {
+    size_t key_id = read_varint(&position, end);
+    string key;
+    if (key_id == 0) {
+      key = read_bytes(&position, end);
+    } else if (key_id <= get_binary_payload_keys().size()) {
+      key = get_binary_payload_keys()[key_id - 1];
+    } else {
+      throw runtime_error("Unknown key in binary payload: " + to_string(key_id));
+    }
+    p.add(key, read_bytes(&position, end));
+  }
+  return p;
+}
+
 unsigned long long Utils::get_unix_epoch_ms() {
+  if (CachedClock::is_running()) {
+    return CachedClock::get_unix_epoch_ms();
+  }
   return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
 }
 
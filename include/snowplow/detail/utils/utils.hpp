@@ -24,6 +24,8 @@ See the Apache License Version 2.0 for the specific language governing permissio
 #include <chrono>
 #include <cstdint>
 #include <thread>
+#include <atomic>
+#include <cstring>
 #include "../../payload/self_describing_json.hpp"
 #include "../../payload/payload.hpp"
 #include "../../thirdparty/json.hpp"
@@ -31,9 +33,9 @@ See the Apache License Version 2.0 for the specific language governing permissio
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
 
 #include <Windows.h>
-#include <rpc.h>
+#include <bcrypt.h>
 
-#pragma comment (lib, "Rpcrt4.lib")
+#pragma comment (lib, "bcrypt.lib")
 
 #elif defined(__APPLE__)
 
@@ -55,11 +57,15 @@ using json = nlohmann::json;
 class Utils {
 public:
   static string get_uuid4();
+  static string get_uuid7();
   static string int_list_to_string(const list<int> &int_list, const string &delimiter);
-  static string map_to_query_string(map<string, string> m);
-  static string url_encode(string value);
-  static string serialize_payload(Payload payload);
+  static string uint_to_string(unsigned long long value);
+  static string map_to_query_string(const map<string, string> &m);
+  static string url_encode(const string &value);
+  static string serialize_payload(const Payload &payload);
   static Payload deserialize_json_str(const string &json_str);
+  static string serialize_payload_binary(const Payload &payload);
+  static Payload deserialize_payload(const char *data, size_t length);
   static unsigned long long get_unix_epoch_ms();
   static SelfDescribingJson get_desktop_context();
   static string get_os_type();
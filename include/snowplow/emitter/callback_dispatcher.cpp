@@ -0,0 +1,203 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "callback_dispatcher.hpp"
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+using namespace snowplow;
+using std::cerr;
+using std::endl;
+using std::lock_guard;
+using std::unique_lock;
+using std::chrono::steady_clock;
+
+CallbackDispatcher::CallbackDispatcher(size_t max_queue_size, milliseconds coalescing_window, size_t max_queued_event_ids) : m_state(std::make_shared<State>()) {
+  set_max_queue_size(max_queue_size);
+  set_coalescing_window(coalescing_window);
+  set_max_queued_event_ids(max_queued_event_ids);
+}
+
+CallbackDispatcher::~CallbackDispatcher() {
+  this->stop();
+  unique_lock<mutex> locker(m_state->queue_mutex);
+  join_stopped_thread(locker);
+}
+
+void CallbackDispatcher::start(const EmitterCallback &callback) {
+  unique_lock<mutex> locker(m_state->queue_mutex);
+  if (m_state->running) {
+    return;
+  }
+  join_stopped_thread(locker);
+  if (m_state->running) {
+    return; // started concurrently while joining the previous thread
+  }
+  m_state->running = true;
+  m_thread = thread(&CallbackDispatcher::run, m_state, callback, ++m_state->generation);
+}
+
+void CallbackDispatcher::stop() {
+  unique_lock<mutex> locker(m_state->queue_mutex);
+  if (!m_state->running) {
+    return;
+  }
+  m_state->running = false;
+  m_state->generation++;
+  if (m_thread.get_id() == std::this_thread::get_id()) {
+    return; // stopped from within the callback, the thread drains the queue once the callback returns
+  }
+  thread worker = std::move(m_thread);
+  locker.unlock();
+  m_state->queue_changed.notify_all();
+  worker.join();
+}
+
+void CallbackDispatcher::join_stopped_thread(unique_lock<mutex> &locker) {
+  if (!m_thread.joinable()) {
+    return;
+  }
+  thread worker = std::move(m_thread);
+  if (worker.get_id() == std::this_thread::get_id()) {
+    // exits on its own after the current callback returns, it holds a reference to the state
+    worker.detach();
+    return;
+  }
+  locker.unlock();
+  worker.join();
+  locker.lock();
+}
+
+void CallbackDispatcher::dispatch(list<string> event_ids, EmitStatus emit_status) {
+  {
+    lock_guard<mutex> guard(m_state->queue_mutex);
+
+    // drop event IDs over the limit rather than blocking the emitter
+    size_t room = m_state->max_queued_event_ids - std::min(m_state->queued_event_ids, m_state->max_queued_event_ids);
+    if (event_ids.size() > room) {
+      auto first_dropped = event_ids.begin();
+      std::advance(first_dropped, room);
+      m_state->dropped_event_ids += event_ids.size() - room;
+      event_ids.erase(first_dropped, event_ids.end());
+    }
+    if (event_ids.empty()) {
+      return;
+    }
+    m_state->queued_event_ids += event_ids.size();
+
+    if (m_state->queue.size() >= m_state->max_queue_size) {
+      // merge into the last pending delivery with the same status rather than blocking the emitter
+      for (auto it = m_state->queue.rbegin(); it != m_state->queue.rend(); ++it) {
+        if (it->emit_status == emit_status) {
+          it->event_ids.splice(it->event_ids.end(), event_ids);
+          return;
+        }
+      }
+    }
+    m_state->queue.push_back(Delivery{std::move(event_ids), emit_status});
+  }
+  m_state->queue_changed.notify_all();
+}
+
+void CallbackDispatcher::set_max_queue_size(size_t max_queue_size) {
+  if (max_queue_size == 0) {
+    throw std::invalid_argument("Callback queue size must be greater than 0");
+  }
+  lock_guard<mutex> guard(m_state->queue_mutex);
+  m_state->max_queue_size = max_queue_size;
+}
+
+void CallbackDispatcher::set_coalescing_window(milliseconds coalescing_window) {
+  lock_guard<mutex> guard(m_state->queue_mutex);
+  m_state->coalescing_window = coalescing_window;
+}
+
+void CallbackDispatcher::set_max_queued_event_ids(size_t max_queued_event_ids) {
+  if (max_queued_event_ids == 0) {
+    throw std::invalid_argument("Maximum number of queued callback event IDs must be greater than 0");
+  }
+  lock_guard<mutex> guard(m_state->queue_mutex);
+  m_state->max_queued_event_ids = max_queued_event_ids;
+}
+
+size_t CallbackDispatcher::get_max_queue_size() const {
+  lock_guard<mutex> guard(m_state->queue_mutex);
+  return m_state->max_queue_size;
+}
+
+milliseconds CallbackDispatcher::get_coalescing_window() const {
+  lock_guard<mutex> guard(m_state->queue_mutex);
+  return m_state->coalescing_window;
+}
+
+size_t CallbackDispatcher::get_max_queued_event_ids() const {
+  lock_guard<mutex> guard(m_state->queue_mutex);
+  return m_state->max_queued_event_ids;
+}
+
+unsigned long long CallbackDispatcher::get_dropped_event_id_count() const {
+  lock_guard<mutex> guard(m_state->queue_mutex);
+  return m_state->dropped_event_ids;
+}
+
+void CallbackDispatcher::run(shared_ptr<State> state, EmitterCallback callback, unsigned long generation) {
+  unique_lock<mutex> locker(state->queue_mutex);
+  while (true) {
+    state->queue_changed.wait(locker, [&] { return !state->queue.empty() || state->generation != generation; });
+    if (state->generation != generation && (state->running || state->queue.empty())) {
+      return; // drained, or restarted and a newer thread took over the queue
+    }
+
+    if (state->coalescing_window.count() > 0 && state->generation == generation) {
+      state->queue_changed.wait_until(locker, steady_clock::now() + state->coalescing_window,
+                                      [&] { return state->generation != generation || state->queue.size() >= state->max_queue_size; });
+    }
+
+    list<Delivery> deliveries;
+    deliveries.swap(state->queue);
+    state->queued_event_ids = 0;
+    milliseconds coalescing_window = state->coalescing_window;
+    locker.unlock();
+    deliver(callback, deliveries, coalescing_window);
+    locker.lock();
+  }
+}
+
+void CallbackDispatcher::deliver(const EmitterCallback &callback, list<Delivery> &deliveries, milliseconds coalescing_window) {
+  if (coalescing_window.count() > 0) {
+    // one call per emit status with the event IDs of all coalesced deliveries
+    list<Delivery> coalesced;
+    for (auto &delivery : deliveries) {
+      auto it = coalesced.begin();
+      while (it != coalesced.end() && it->emit_status != delivery.emit_status) {
+        ++it;
+      }
+      if (it == coalesced.end()) {
+        coalesced.push_back(std::move(delivery));
+      } else {
+        it->event_ids.splice(it->event_ids.end(), delivery.event_ids);
+      }
+    }
+    deliveries.swap(coalesced);
+  }
+
+  for (auto &delivery : deliveries) {
+    try {
+      callback(std::move(delivery.event_ids), delivery.emit_status);
+    } catch (std::exception &e) {
+      cerr << "Emitter request callback failed: " << e.what() << endl;
+    }
+  }
+}
@@ -0,0 +1,131 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#ifndef CALLBACK_DISPATCHER_H
+#define CALLBACK_DISPATCHER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "../constants.hpp"
+#include "../configuration/emitter_configuration.hpp"
+#include "emit_status.hpp"
+
+namespace snowplow {
+
+using std::chrono::milliseconds;
+using std::condition_variable;
+using std::list;
+using std::mutex;
+using std::shared_ptr;
+using std::string;
+using std::thread;
+
+/**
+ * @brief Delivers Emitter request callbacks on a single long-lived thread.
+ *
+ * Event IDs are queued by the Emitter thread and passed to the callback in the order they were queued.
+ * The queue holds at most `max_queue_size` pending deliveries. When it is full, event IDs are merged into
+ * the last pending delivery with the same emit status instead of blocking the Emitter.
+ * The total number of queued event IDs is bounded as well: event IDs that don't fit are dropped (and counted)
+ * rather than blocking the Emitter, so their callback is not called.
+ * With a coalescing window, the dispatcher waits for more deliveries after the first one arrives and
+ * passes all event IDs with the same emit status to a single callback call.
+ *
+ * The queue is shared with the dispatcher thread, so the dispatcher (and the Emitter owning it) may be destroyed
+ * from within the callback. The thread then finishes the remaining deliveries on its own.
+ */
+class CallbackDispatcher {
+public:
+  /**
+   * @brief Construct a new Callback Dispatcher object
+   *
+   * @param max_queue_size Maximum number of pending deliveries
+   * @param coalescing_window Time to wait for further deliveries to coalesce (0 to deliver each batch separately)
+   * @param max_queued_event_ids Maximum number of event IDs in all pending deliveries
+   */
+  CallbackDispatcher(size_t max_queue_size = SNOWPLOW_EMITTER_DEFAULT_CALLBACK_QUEUE_SIZE, milliseconds coalescing_window = milliseconds(0),
+                     size_t max_queued_event_ids = SNOWPLOW_EMITTER_DEFAULT_CALLBACK_QUEUED_EVENT_IDS);
+
+  ~CallbackDispatcher();
+
+  /**
+   * @brief Start the dispatcher thread which calls the callback.
+   *
+   * @param callback Callback function
+   */
+  void start(const EmitterCallback &callback);
+
+  /**
+   * @brief Deliver all queued event IDs and stop the dispatcher thread.
+   *
+   * If called from within the callback, the thread finishes the remaining deliveries after the callback returns
+   * and is joined by the next call to start() or the destructor (or detached if the destructor runs within the callback).
+   */
+  void stop();
+
+  /**
+   * @brief Queue event IDs for delivery to the callback.
+   *
+   * @param event_ids IDs of events in the emit request
+   * @param emit_status Result of the emit request
+   */
+  void dispatch(list<string> event_ids, EmitStatus emit_status);
+
+  void set_max_queue_size(size_t max_queue_size);
+  void set_coalescing_window(milliseconds coalescing_window);
+  void set_max_queued_event_ids(size_t max_queued_event_ids);
+
+  size_t get_max_queue_size() const;
+  milliseconds get_coalescing_window() const;
+  size_t get_max_queued_event_ids() const;
+
+  /**
+   * @return unsigned long long Number of event IDs dropped because the queue held the maximum number of event IDs
+   */
+  unsigned long long get_dropped_event_id_count() const;
+
+private:
+  struct Delivery {
+    list<string> event_ids;
+    EmitStatus emit_status;
+  };
+
+  // owned together with the dispatcher thread, which may outlive the dispatcher
+  struct State {
+    mutable mutex queue_mutex;
+    condition_variable queue_changed;
+    list<Delivery> queue;
+    size_t queued_event_ids = 0;
+    unsigned long long dropped_event_ids = 0;
+    bool running = false;
+    unsigned long generation = 0;
+    size_t max_queue_size = 0;
+    size_t max_queued_event_ids = 0;
+    milliseconds coalescing_window;
+  };
+
+  static void run(shared_ptr<State> state, EmitterCallback callback, unsigned long generation);
+  static void deliver(const EmitterCallback &callback, list<Delivery> &deliveries, milliseconds coalescing_window);
+  void join_stopped_thread(std::unique_lock<mutex> &locker);
+
+  shared_ptr<State> m_state;
+  thread m_thread;
+};
+} // namespace snowplow
+
+#endif
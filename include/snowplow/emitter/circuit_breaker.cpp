@@ -0,0 +1,78 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "circuit_breaker.hpp"
+
+using namespace snowplow;
+
+CircuitBreaker::CircuitBreaker(int failure_threshold, milliseconds open_duration) : m_state(CLOSED) {
+  m_failure_threshold = failure_threshold;
+  m_open_duration = open_duration;
+  m_consecutive_failures = 0;
+  m_probe_in_flight = false;
+}
+
+bool CircuitBreaker::allows_requests(steady_clock::time_point now) {
+  switch (m_state) {
+  case CLOSED:
+    return true;
+  case OPEN:
+    if (now < m_open_until) {
+      return false;
+    }
+    m_state = HALF_OPEN;
+    m_probe_in_flight = false;
+    return true;
+  case HALF_OPEN:
+  default:
+    return !m_probe_in_flight;
+  }
+}
+
+void CircuitBreaker::record_request() {
+  if (m_state == HALF_OPEN) {
+    m_probe_in_flight = true;
+  }
+}
+
+void CircuitBreaker::record_success() {
+  m_consecutive_failures = 0;
+  m_probe_in_flight = false;
+  m_state = CLOSED;
+}
+
+void CircuitBreaker::record_cancelled() {
+  m_probe_in_flight = false;
+}
+
+void CircuitBreaker::record_failure(steady_clock::time_point now) {
+  if (m_failure_threshold <= 0) {
+    return;
+  }
+
+  switch (m_state) {
+  case CLOSED:
+    if (++m_consecutive_failures < m_failure_threshold) {
+      return;
+    }
+    break;
+  case OPEN:
+    return; // a request sent before the circuit opened
+  case HALF_OPEN:
+    break; // probe failed
+  }
+
+  m_state = OPEN;
+  m_open_until = now + m_open_duration;
+  m_probe_in_flight = false;
+}
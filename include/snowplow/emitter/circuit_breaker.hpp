@@ -0,0 +1,101 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#ifndef CIRCUIT_BREAKER_H
+#define CIRCUIT_BREAKER_H
+
+#include <atomic>
+#include <chrono>
+#include "../constants.hpp"
+
+namespace snowplow {
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+/**
+ * @brief Stops the Emitter from sending requests to a collector that keeps failing.
+ *
+ * The circuit is closed while requests succeed. After `failure_threshold` consecutive requests fail
+ * with a retryable error, it opens and no requests are sent for `open_duration`. Then it becomes half-open
+ * and lets a single probe request through. The circuit closes if the probe succeeds, otherwise it opens again.
+ * A failure threshold of 0 disables the circuit breaker.
+ */
+class CircuitBreaker {
+public:
+  enum State {
+    CLOSED,
+    OPEN,
+    HALF_OPEN
+  };
+
+  /**
+   * @brief Construct a new Circuit Breaker object
+   *
+   * @param failure_threshold Number of consecutive failed requests to open the circuit (0 to disable)
+   * @param open_duration Time to wait before sending a probe request
+   */
+  CircuitBreaker(int failure_threshold = 0, milliseconds open_duration = milliseconds(SNOWPLOW_EMITTER_DEFAULT_CIRCUIT_BREAKER_OPEN_DURATION_MS));
+
+  void set_failure_threshold(int failure_threshold) { m_failure_threshold = failure_threshold; }
+
+  void set_open_duration(milliseconds open_duration) { m_open_duration = open_duration; }
+
+  /**
+   * @brief Check whether a request may be sent, moves an open circuit to half-open once the open duration passed.
+   *
+   * @param now Current time
+   * @return true if requests can be sent
+   */
+  bool allows_requests(steady_clock::time_point now);
+
+  /**
+   * @brief Register that a request was sent. In the half-open state, this is the probe request.
+   */
+  void record_request();
+
+  /**
+   * @brief Register that the collector accepted or rejected a request.
+   */
+  void record_success();
+
+  /**
+   * @brief Register a request that failed and will be retried.
+   *
+   * @param now Current time
+   */
+  void record_failure(steady_clock::time_point now);
+
+  /**
+   * @brief Register a request that was cancelled before the collector responded, a cancelled probe lets another one through.
+   */
+  void record_cancelled();
+
+  State get_state() const { return m_state; }
+
+  /**
+   * @brief Get the time when an open circuit lets a probe request through.
+   */
+  steady_clock::time_point get_open_until() const { return m_open_until; }
+
+private:
+  int m_failure_threshold;
+  milliseconds m_open_duration;
+  int m_consecutive_failures;
+  std::atomic<State> m_state;
+  steady_clock::time_point m_open_until;
+  bool m_probe_in_flight;
+};
+} // namespace snowplow
+
+#endif
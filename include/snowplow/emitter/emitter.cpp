@@ -12,6 +12,7 @@ See the Apache License Version 2.0 for the specific language governing permissio
 */
 
 #include "emitter.hpp"
+#include "../detail/utils/allocation_probe.hpp"
 
 using namespace snowplow;
 using std::invalid_argument;
@@ -25,6 +26,7 @@ using std::to_string;
 using std::transform;
 using std::equal;
 using std::future;
+using std::chrono::steady_clock;
 
 const int post_wrapper_bytes = 88; // "schema":"iglu:com.snowplowanalytics.snowplow/payload_data/jsonschema/1-0-4","data":[]
 const int post_stm_bytes = 22;     // "stm":"1443452851000"
@@ -60,8 +62,38 @@ Emitter::Emitter(NetworkConfiguration &network_config, const EmitterConfiguratio
   ) {
   m_callback = emitter_config.get_request_callback();
   m_callback_emit_status = emitter_config.get_request_callback_emit_status();
+  m_callback_dispatcher.set_max_queue_size(emitter_config.get_request_callback_queue_size());
+  m_callback_dispatcher.set_coalescing_window(std::chrono::milliseconds(emitter_config.get_request_callback_coalescing_window_ms()));
+  m_callback_dispatcher.set_max_queued_event_ids(emitter_config.get_request_callback_max_queued_event_ids());
   m_custom_retry_for_status_codes = emitter_config.get_custom_retry_for_status_codes();
   m_flush_timeout_ms = emitter_config.get_flush_timeout_ms();
+  m_max_requests_in_flight = emitter_config.get_max_requests_in_flight();
+  m_max_attempts = emitter_config.get_max_attempts();
+  m_max_queue_events = emitter_config.get_max_queue_events();
+  m_max_queue_bytes = emitter_config.get_max_queue_bytes();
+  m_queue_overflow_policy = emitter_config.get_queue_overflow_policy();
+  m_queue_block_timeout_ms = emitter_config.get_queue_block_timeout_ms();
+  if (!emitter_config.get_deduplication_fields().empty()) {
+    m_deduplicator = unique_ptr<EventDeduplicator>(new EventDeduplicator(
+        emitter_config.get_deduplication_fields(),
+        milliseconds(emitter_config.get_deduplication_window_ms()),
+        emitter_config.get_deduplication_capacity(),
+        emitter_config.get_deduplication_false_positive_rate()));
+  }
+  m_load_balancing = network_config.get_load_balancing();
+  m_endpoints.clear();
+  for (auto const &endpoint : network_config.get_collector_endpoints()) {
+    CrackedUrl url(get_collector_url(endpoint.hostname, endpoint.protocol, network_config.get_method()));
+    if (!url.get_is_valid()) {
+      throw invalid_argument("FATAL: Emitter URL is not valid - " + url.to_string());
+    }
+    m_endpoints.push_back(Endpoint(url, endpoint.weight));
+    m_endpoints.back().circuit_breaker->set_failure_threshold(emitter_config.get_circuit_breaker_failure_threshold());
+    m_endpoints.back().circuit_breaker->set_open_duration(milliseconds(emitter_config.get_circuit_breaker_open_duration_ms()));
+  }
+  m_http_client->set_connect_timeout_ms(network_config.get_connect_timeout_ms());
+  m_http_client->set_request_timeout_ms(network_config.get_request_timeout_ms());
+  m_http_client->set_low_speed_limit(network_config.get_low_speed_limit(), network_config.get_low_speed_timeout_ms());
 }
 
 Emitter::Emitter(shared_ptr<EventStore> event_store, const string &uri, Method method, Protocol protocol, int batch_size,
@@ -91,6 +123,15 @@ Emitter::Emitter(shared_ptr<EventStore> event_store, const string &uri, Method m
   this->m_batch_size = batch_size;
   this->m_byte_limit_post = byte_limit_post;
   this->m_byte_limit_get = byte_limit_get;
+  this->m_max_requests_in_flight = SNOWPLOW_EMITTER_DEFAULT_MAX_REQUESTS_IN_FLIGHT;
+  this->m_max_attempts = 0;
+  this->m_max_queue_events = 0;
+  this->m_max_queue_bytes = 0;
+  this->m_queue_overflow_policy = DROP_NEWEST;
+  this->m_queue_block_timeout_ms = 1000;
+  this->m_queue_sample_random.seed(std::random_device()());
+  this->m_load_balancing = ROUND_ROBIN;
+  this->m_endpoints.push_back(Endpoint(this->m_url, 1));
   this->m_event_store = std::move(event_store);
   if (http_client) {
     this->m_http_client = std::move(http_client);
@@ -99,6 +140,23 @@ Emitter::Emitter(shared_ptr<EventStore> event_store, const string &uri, Method m
   }
 }
 
+Emitter::Emitter(const CrackedUrl &url) : m_url(url) {
+  this->m_running = false;
+  this->m_flush_timeout_ms = 0;
+  this->m_method = POST;
+  this->m_batch_size = 0;
+  this->m_byte_limit_post = 0;
+  this->m_byte_limit_get = 0;
+  this->m_max_requests_in_flight = 0;
+  this->m_max_attempts = 0;
+  this->m_max_queue_events = 0;
+  this->m_max_queue_bytes = 0;
+  this->m_queue_overflow_policy = DROP_NEWEST;
+  this->m_queue_block_timeout_ms = 0;
+  this->m_load_balancing = ROUND_ROBIN;
+  this->m_endpoints.push_back(Endpoint(this->m_url, 1));
+}
+
 Emitter::~Emitter() {
   this->stop();
 }
@@ -113,6 +171,10 @@ void Emitter::start() {
   this->m_stop_requested = false;
   this->m_flush_done = false;
   this->m_running = true;
+  this->m_http_client->resume_requests();
+  if (m_callback) {
+    this->m_callback_dispatcher.start(m_callback);
+  }
   this->m_daemon_thread = thread(&Emitter::run, this);
 }
 
@@ -128,15 +190,116 @@ void Emitter::stop() {
     // receive the notify) or will see m_stop_requested=true at its next pre-check.
     { unique_lock<mutex> db_locker(this->m_db_select); }
     this->m_check_db.notify_all();
+
+    // Abort in-flight requests so that join() doesn't wait for a hung collector.
+    // Their events stay in the event store and are sent after the next start().
+    this->m_http_client->cancel_requests();
     this->m_daemon_thread.join();
 
+    // Deliver callbacks for the last requests before returning
+    this->m_callback_dispatcher.stop();
+
     // Unblock flush() if it is waiting on m_check_fin (e.g. stop() called externally)
     this->m_check_fin.notify_all();
   }
 }
 
 void Emitter::add(Payload payload) {
-  m_event_store->add_event(payload);
+  enqueue(payload, nullptr);
+}
+
+void Emitter::add_serialized(const Payload &payload, const string &serialized_payload) {
+  enqueue(payload, &serialized_payload);
+}
+
+void Emitter::add_batch(list<Payload> payloads) {
+  if (m_deduplicator && !has_queue_limits()) {
+    remove_duplicates(&payloads, nullptr);
+  }
+  store_batch(payloads, nullptr);
+}
+
+void Emitter::add_serialized_batch(const list<Payload> &payloads, const list<string> &serialized_payloads) {
+  if (m_deduplicator && !has_queue_limits()) {
+    // duplicates are removed from copies as the batch is shared with other emitters
+    list<Payload> unique_payloads = payloads;
+    list<string> unique_serialized_payloads = serialized_payloads;
+    remove_duplicates(&unique_payloads, &unique_serialized_payloads);
+    store_batch(unique_payloads, &unique_serialized_payloads);
+  } else {
+    store_batch(payloads, &serialized_payloads);
+  }
+}
+
+// serialized_payloads is null or holds the serialized payloads in the same order
+void Emitter::remove_duplicates(list<Payload> *payloads, list<string> *serialized_payloads) {
+  auto serialized_payload = serialized_payloads ? serialized_payloads->begin() : list<string>::iterator();
+  for (auto payload = payloads->begin(); payload != payloads->end();) {
+    bool duplicate = m_deduplicator->is_duplicate(*payload);
+    payload = duplicate ? payloads->erase(payload) : std::next(payload);
+    if (serialized_payloads) {
+      serialized_payload = duplicate ? serialized_payloads->erase(serialized_payload) : std::next(serialized_payload);
+    }
+  }
+}
+
+void Emitter::store_batch(const list<Payload> &payloads, const list<string> *serialized_payloads) {
+  SNOWPLOW_ALLOCATION_PROBE("emitter.add_batch");
+  if (has_queue_limits()) {
+    // queue size limits (and deduplication) are applied to each event
+    auto serialized_payload = serialized_payloads ? serialized_payloads->begin() : list<string>::const_iterator();
+    for (auto const &payload : payloads) {
+      enqueue(payload, serialized_payloads ? &*serialized_payload++ : nullptr);
+    }
+    return;
+  }
+
+  if (payloads.empty()) {
+    return;
+  }
+  if (serialized_payloads) {
+    m_event_store->add_serialized_events(payloads, *serialized_payloads);
+  } else {
+    m_event_store->add_events(payloads);
+  }
+  m_added_events += (unsigned long)payloads.size();
+  this->m_check_db.notify_all();
+}
+
+void Emitter::enqueue(const Payload &payload, const string *serialized_payload) {
+  SNOWPLOW_ALLOCATION_PROBE("emitter.add");
+  if (m_deduplicator && m_deduplicator->is_duplicate(payload)) {
+    return;
+  }
+
+  string serialized;
+  if (!serialized_payload && m_max_queue_bytes > 0) {
+    // serialize once for both the byte limit and the event store
+    serialized = Utils::serialize_payload(payload);
+    serialized_payload = &serialized;
+  }
+  auto store_event = [&]() {
+    if (serialized_payload) {
+      m_event_store->add_serialized_event(payload, *serialized_payload);
+    } else {
+      m_event_store->add_event(payload);
+    }
+  };
+
+  if (has_queue_limits()) {
+    unsigned long long event_bytes = m_max_queue_bytes > 0 ? serialized_payload->length() : 0;
+
+    // hold the lock until the event is stored so that concurrent adds can't overshoot the limits
+    lock_guard<mutex> guard(m_queue_access);
+    if (!make_room_in_queue(event_bytes)) {
+      m_dropped_events++;
+      return;
+    }
+    store_event();
+  } else {
+    store_event();
+  }
+  m_added_events++;
   this->m_check_db.notify_all();
 }
 
@@ -168,173 +331,476 @@ void Emitter::flush() {
 // --- Private
 
 void Emitter::run() {
-  do {
-    list<EventRow> event_rows;
-    m_event_store->get_event_rows_batch(&event_rows, m_batch_size);
-
-    if (event_rows.size() > 0) {
-      // emit the events
-      list<HttpRequestResult> results;
-      do_send(event_rows, &results);
-
-      // classify results into successful and failed
-      list<int> success_row_ids;
-      list<int> failed_will_retry_row_ids;
-      list<int> failed_wont_retry_row_ids;
-      for (auto const &result : results) {
-        auto res_row_ids = result.get_row_ids();
-        if (result.is_success()) {
-          success_row_ids.splice(success_row_ids.end(), res_row_ids);
-        } else if (result.should_retry(m_custom_retry_for_status_codes)) {
-          failed_will_retry_row_ids.splice(failed_will_retry_row_ids.end(), res_row_ids);
-        } else {
-          failed_wont_retry_row_ids.splice(failed_wont_retry_row_ids.end(), res_row_ids);
+  map<unsigned long, InFlightRequest> in_flight;
+  unsigned long next_request_id = 0;
+  auto next_send_time = steady_clock::now();
+  bool maintenance_due = true; // once at start and after each drained backlog, at most once per interval
+  auto next_maintenance_time = steady_clock::time_point();
+
+  while (true) {
+    // process requests that completed since the last iteration
+    list<pair<unsigned long, HttpRequestResult>> completed_requests;
+    {
+      lock_guard<mutex> guard(m_db_select);
+      completed_requests.swap(m_completed_requests);
+    }
+    for (auto const &completed : completed_requests) {
+      maintenance_due = true;
+      auto request = in_flight.find(completed.first);
+      request->second.done.wait();
+      {
+        lock_guard<mutex> guard(m_in_flight_access);
+        for (int row_id : completed.second.get_row_ids()) {
+          m_in_flight_row_ids.erase(row_id);
         }
       }
 
-      // trigger callbacks if enabled
-      trigger_callbacks(success_row_ids, failed_will_retry_row_ids, failed_wont_retry_row_ids, event_rows);
+      // skip the endpoint for its back-off period after a retryable failure
+      auto now = steady_clock::now();
+      const HttpRequestResult &result = completed.second;
+      bool failed = !result.is_success() && result.should_retry(m_custom_retry_for_status_codes);
+      Endpoint &endpoint = m_endpoints[request->second.endpoint];
+      endpoint.outstanding_requests--;
+      if (result.is_cancelled()) {
+        // stop() aborted the request, so its events keep their attempts and the endpoint isn't blamed
+        endpoint.circuit_breaker->record_cancelled();
+        in_flight.erase(request);
+        continue;
+      }
+      if (failed) {
+        // the collector's Retry-After hint keeps the endpoint out of rotation even when its events fail over
+        milliseconds retry_after(std::min(result.get_retry_after_ms(), (long long) SNOWPLOW_EMITTER_MAX_RETRY_AFTER_MS));
+        endpoint.retry_delay.will_retry_emit(retry_after);
+        endpoint.unhealthy_until = now + std::max(endpoint.retry_delay.get(), retry_after);
+      } else {
+        endpoint.retry_delay.wont_retry_emit();
+        endpoint.unhealthy_until = steady_clock::time_point();
+      }
 
-      // delete rows with successfully sent events and failed events that should not be retried
-      list<int> delete_row_ids;
-      delete_row_ids.splice(delete_row_ids.end(), success_row_ids);
-      delete_row_ids.splice(delete_row_ids.end(), failed_wont_retry_row_ids);
-      m_event_store->delete_event_rows_with_ids(delete_row_ids);
+      // events of a failed request are retried right away if another endpoint is healthy
+      bool failover = failed && has_healthy_endpoint(now);
 
-      // update retry delay calculation based on whether the requests will be retried
-      if (!failed_will_retry_row_ids.empty()) {
-        m_retry_delay.will_retry_emit();
+      // update retry delay and the endpoint's circuit breaker based on whether the request will be retried,
+      // other endpoints keep their circuits closed
+      if (process_result(result, request->second.events, failover)) {
+        if (!failover) {
+          m_retry_delay.will_retry_emit(milliseconds(result.get_retry_after_ms()));
+          next_send_time = now + m_retry_delay.get();
+        }
+        endpoint.circuit_breaker->record_failure(now);
+        next_send_time = std::max(next_send_time, get_circuits_open_until());
       } else {
         m_retry_delay.wont_retry_emit();
+        endpoint.circuit_breaker->record_success();
+      }
+      in_flight.erase(request);
+    }
+
+    bool running = is_running();
+    if (!running && in_flight.empty()) {
+      break;
+    }
+
+    // top up the window of requests in flight unless waiting for the retry delay or an open circuit
+    auto now = steady_clock::now();
+    auto next_row_time = steady_clock::time_point::max();
+    bool probe = false;
+    if (running && in_flight.size() < m_max_requests_in_flight && now >= next_send_time && allows_requests(now, &probe)) {
+      unsigned long added_events = m_added_events.load();
+      list<EventRow> event_rows;
+      {
+        // the overflow policies can't remove the selected rows before their requests are in flight
+        lock_guard<mutex> guard(m_in_flight_access);
+        m_event_store->get_event_rows_batch_excluding(&event_rows, probe ? 1 : m_batch_size, m_in_flight_row_ids);
+        if (!event_rows.empty()) {
+          send_requests(event_rows, probe ? 1 : m_max_requests_in_flight - in_flight.size(), &next_request_id, &in_flight);
+        }
+      }
+      if (!event_rows.empty()) {
+        continue;
       }
 
-      // sleep for the retry delay if there is one — interruptible by stop()
-      auto retry_delay = m_retry_delay.get();
-      if (retry_delay.count() > 0) {
-        unique_lock<mutex> retry_locker(m_db_select);
-        if (!m_stop_requested.load()) {
-          m_check_db.wait_for(retry_locker, retry_delay);
+      // no rows to send now, check for rows waiting for their next attempt
+      unsigned long long next_attempt_at_ms = m_event_store->get_next_attempt_at_ms();
+      unsigned long long now_ms = Utils::get_unix_epoch_ms();
+      if (next_attempt_at_ms > now_ms) {
+        next_row_time = now + milliseconds(next_attempt_at_ms - now_ms);
+      } else if (next_attempt_at_ms > 0 && in_flight.empty()) {
+        continue; // a row became eligible since the selection
+      } else if (in_flight.empty()) {
+        if (m_added_events.load() != added_events) {
+          continue; // events added since the selection
         }
+        if (maintenance_due && now >= next_maintenance_time) {
+          // reclaim the space of the removed events while idle, then check for events added meanwhile
+          maintenance_due = false;
+          next_maintenance_time = now + milliseconds(SNOWPLOW_EMITTER_MAINTENANCE_INTERVAL_MS);
+          m_event_store->perform_maintenance();
+          continue;
+        }
+        if (maintenance_due) {
+          next_row_time = next_maintenance_time; // wake up for the maintenance skipped within the interval
+        }
+        // Queue is empty: signal flush() waiters
+        m_flush_done = true;
+        m_check_fin.notify_all();
       }
-    } else {
-      // Queue is empty: signal flush() waiters
-      m_flush_done = true;
-      m_check_fin.notify_all();
-
-      // Idle sleep — pre-check m_stop_requested so stop() calling notify_all between
-      // here and wait_for is guaranteed visible via the m_db_select lock-handshake in stop()
-      unique_lock<mutex> locker(m_db_select);
-      if (!m_stop_requested.load()) {
-        m_check_db.wait_for(locker, std::chrono::seconds(5));
+    }
+
+    unique_lock<mutex> locker(m_db_select);
+    if (!m_completed_requests.empty()) {
+      continue;
+    }
+    if (!running) {
+      // stop() cancelled the requests in flight, wait for them to return
+      m_check_db.wait(locker, [this] { return !m_completed_requests.empty(); });
+    } else if (!m_stop_requested.load()) {
+      // Wait for a request to complete, new events or the end of the retry delay – pre-check
+      // m_stop_requested so stop() calling notify_all between here and the wait is guaranteed
+      // visible via the m_db_select lock-handshake in stop()
+      if (steady_clock::now() < next_send_time) {
+        m_check_db.wait_until(locker, next_send_time);
+      } else {
+        m_check_db.wait_until(locker, std::min(next_row_time, steady_clock::now() + std::chrono::seconds(5)));
       }
     }
-  } while (is_running());
+  }
 }
 
-void Emitter::do_send(const list<EventRow> &event_rows, list<HttpRequestResult> *results) {
-  list<future<HttpRequestResult>> request_futures;
+void Emitter::send_requests(const list<EventRow> &event_rows, size_t max_requests, unsigned long *next_request_id,
+                            map<unsigned long, InFlightRequest> *in_flight) {
+  SNOWPLOW_ALLOCATION_PROBE("emitter.send_requests");
+  size_t issued = 0;
+  auto in_flight_event = [this](const EventRow &row) {
+    return InFlightEvent{row.id, row.attempts, m_callback ? row.event.get_value(SNOWPLOW_EID) : string()};
+  };
 
-  // Send each request in its own thread
   if (this->m_method == GET) {
     for (auto const &row : event_rows) {
+      if (issued == max_requests) {
+        return;
+      }
       Payload event_payload = row.event;
-      event_payload.add(SNOWPLOW_SENT_TIMESTAMP, to_string(Utils::get_unix_epoch_ms()));
+      event_payload.add(SNOWPLOW_SENT_TIMESTAMP, Utils::uint_to_string(Utils::get_unix_epoch_ms()));
       string query_string = Utils::map_to_query_string(event_payload.get());
-      list<int> row_id = {row.id};
 
-      request_futures.push_back(async(&HttpClient::http_get, this->m_http_client.get(), this->m_url, query_string, row_id, (query_string.size() > this->m_byte_limit_get)));
+      issue_request((*next_request_id)++, query_string, {row.id}, (query_string.size() > this->m_byte_limit_get), {in_flight_event(row)}, in_flight);
+      issued++;
     }
   } else {
     list<int> row_ids;
     list<Payload> payloads;
+    list<InFlightEvent> events;
     int total_byte_size = 0;
 
     for (auto const &row : event_rows) {
+      if (issued == max_requests) {
+        return;
+      }
       unsigned int byte_size = unsigned(Utils::serialize_payload(row.event).size() + post_stm_bytes);
 
       if ((byte_size + post_wrapper_bytes) > this->m_byte_limit_post) {
         // A single payload has exceeded the Byte Limit
-        list<int> single_row_id = {row.id};
-        list<Payload> single_payload = {row.event};
-        request_futures.push_back(async(&HttpClient::http_post, this->m_http_client.get(), this->m_url, this->build_post_data_json(single_payload), single_row_id, true));
-
-        single_row_id.clear();
-        single_payload.clear();
+        issue_request((*next_request_id)++, this->build_post_data_json({row.event}), {row.id}, true, {in_flight_event(row)}, in_flight);
+        issued++;
       } else if ((total_byte_size + byte_size + post_wrapper_bytes + (payloads.size() - 1)) > this->m_byte_limit_post) {
         // Byte limit reached
-        request_futures.push_back(async(&HttpClient::http_post, this->m_http_client.get(), this->m_url, this->build_post_data_json(payloads), row_ids, false));
+        issue_request((*next_request_id)++, this->build_post_data_json(payloads), row_ids, false, std::move(events), in_flight);
+        issued++;
 
         // Reset accumulators
-        row_ids.clear();
         row_ids = {row.id};
-        payloads.clear();
         payloads = {row.event};
+        events = {in_flight_event(row)};
         total_byte_size = byte_size;
       } else {
         row_ids.push_back(row.id);
         payloads.push_back(row.event);
+        events.push_back(in_flight_event(row));
         total_byte_size += byte_size;
       }
     }
 
-    if (payloads.size() > 0) {
-      request_futures.push_back(async(&HttpClient::http_post, this->m_http_client.get(), this->m_url, this->build_post_data_json(payloads), row_ids, false));
+    if (payloads.size() > 0 && issued < max_requests) {
+      issue_request((*next_request_id)++, this->build_post_data_json(payloads), row_ids, false, std::move(events), in_flight);
     }
   }
+}
+
+void Emitter::issue_request(unsigned long request_id, const string &data, const list<int> &row_ids, bool oversize, list<InFlightEvent> events,
+                            map<unsigned long, InFlightRequest> *in_flight) {
+  m_in_flight_row_ids.insert(row_ids.begin(), row_ids.end()); // the caller holds m_in_flight_access
+
+  // Send each request in its own thread
+  InFlightRequest &request = (*in_flight)[request_id];
+  request.events = std::move(events);
+  request.endpoint = select_endpoint(steady_clock::now());
+  m_endpoints[request.endpoint].outstanding_requests++;
+  m_endpoints[request.endpoint].circuit_breaker->record_request();
+  request.done = async(std::launch::async, &Emitter::send_request, this, request_id, m_endpoints[request.endpoint].url, data, row_ids, oversize);
+}
 
-  // Grab all the request results and return
-  for (auto it = request_futures.begin(); it != request_futures.end(); ++it) {
-    results->push_back(it->get());
+void Emitter::send_request(unsigned long request_id, CrackedUrl url, const string &data, const list<int> &row_ids, bool oversize) {
+  HttpRequestResult result = (this->m_method == GET) ?
+    this->m_http_client->http_get(url, data, row_ids, oversize) :
+    this->m_http_client->http_post(url, data, row_ids, oversize);
+
+  // hand the result over to the daemon thread
+  {
+    lock_guard<mutex> guard(m_db_select);
+    m_completed_requests.push_back({request_id, result});
   }
-  request_futures.clear();
+  m_check_db.notify_all();
 }
 
-void Emitter::trigger_callbacks(const list<int> &success_row_ids, const list<int> &failed_will_retry_row_ids, const list<int> &failed_wont_retry_row_ids, const list<EventRow> &event_rows) const {
-  if (!m_callback) {
-    return;
+// --- Collector endpoints
+
+size_t Emitter::select_endpoint(steady_clock::time_point now) {
+  if (m_endpoints.size() == 1) {
+    return 0;
   }
 
-  // create a mapping table and function between row IDs and event IDs
-  map<int, string> event_ids_for_row_ids;
-  for (auto const &row : event_rows) {
-    auto payload = row.event.get();
-    auto it = payload.find(SNOWPLOW_EID);
-    if (it != payload.end()) {
-      event_ids_for_row_ids.insert({row.id, it->second});
+  // endpoints with a closed circuit take all requests, half-open ones only the probe once no circuit is closed
+  bool probe = false;
+  allows_requests(now, &probe);
+  auto is_candidate = [&](Endpoint &endpoint) {
+    return endpoint.circuit_breaker->allows_requests(now) &&
+           (endpoint.circuit_breaker->get_state() == CircuitBreaker::HALF_OPEN) == probe;
+  };
+
+  size_t selected = m_endpoints.size();
+  int total_weight = 0;
+  for (size_t i = 0; i < m_endpoints.size(); i++) {
+    Endpoint &endpoint = m_endpoints[i];
+    if (endpoint.unhealthy_until > now || !is_candidate(endpoint)) {
+      continue;
+    }
+    if (m_load_balancing == LEAST_OUTSTANDING_REQUESTS) {
+      // compares outstanding requests per weight without dividing
+      if (selected == m_endpoints.size() ||
+          endpoint.outstanding_requests * m_endpoints[selected].weight < m_endpoints[selected].outstanding_requests * endpoint.weight) {
+        selected = i;
+      }
+    } else {
+      // smooth weighted round-robin spreads the requests of heavier endpoints instead of sending them in a row
+      endpoint.current_weight += endpoint.weight;
+      total_weight += endpoint.weight;
+      if (selected == m_endpoints.size() || endpoint.current_weight > m_endpoints[selected].current_weight) {
+        selected = i;
+      }
     }
   }
-  auto transform_row_ids_to_event_ids = [&](const list<int> &row_ids) {
-    list<string> event_ids;
-    for (auto const &row_id : row_ids) {
-      auto it = event_ids_for_row_ids.find(row_id);
-      if (it != event_ids_for_row_ids.end()) {
-        event_ids.push_back(it->second);
+
+  if (selected == m_endpoints.size()) {
+    // no endpoint is healthy, use the one whose back-off ends first
+    for (size_t i = 0; i < m_endpoints.size(); i++) {
+      if (is_candidate(m_endpoints[i]) &&
+          (selected == m_endpoints.size() || m_endpoints[i].unhealthy_until < m_endpoints[selected].unhealthy_until)) {
+        selected = i;
+      }
+    }
+    if (selected == m_endpoints.size()) {
+      selected = 0; // not reached as requests are only sent while a circuit allows them
+    }
+  } else if (m_load_balancing == ROUND_ROBIN) {
+    m_endpoints[selected].current_weight -= total_weight;
+  }
+  return selected;
+}
+
+bool Emitter::has_healthy_endpoint(steady_clock::time_point now) const {
+  for (auto const &endpoint : m_endpoints) {
+    if (endpoint.unhealthy_until <= now && endpoint.circuit_breaker->get_state() != CircuitBreaker::OPEN) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// a half-open circuit lets a single probe request with one event through, unless another endpoint's circuit is closed
+bool Emitter::allows_requests(steady_clock::time_point now, bool *probe) {
+  bool allowed = false;
+  *probe = true;
+  for (auto &endpoint : m_endpoints) {
+    if (endpoint.circuit_breaker->allows_requests(now)) {
+      allowed = true;
+      if (endpoint.circuit_breaker->get_state() == CircuitBreaker::CLOSED) {
+        *probe = false;
       }
     }
-    return event_ids;
+  }
+  if (!allowed) {
+    *probe = false;
+  }
+  return allowed;
+}
+
+// time when the first circuit lets a probe through if all circuits are open, otherwise the epoch of the clock
+steady_clock::time_point Emitter::get_circuits_open_until() const {
+  steady_clock::time_point open_until = steady_clock::time_point::max();
+  for (auto const &endpoint : m_endpoints) {
+    if (endpoint.circuit_breaker->get_state() != CircuitBreaker::OPEN) {
+      return steady_clock::time_point();
+    }
+    open_until = std::min(open_until, endpoint.circuit_breaker->get_open_until());
+  }
+  return open_until;
+}
+
+CircuitBreaker::State Emitter::get_circuit_breaker_state() const {
+  CircuitBreaker::State state = CircuitBreaker::OPEN;
+  for (auto const &endpoint : m_endpoints) {
+    CircuitBreaker::State endpoint_state = endpoint.circuit_breaker->get_state();
+    if (endpoint_state == CircuitBreaker::CLOSED) {
+      return CircuitBreaker::CLOSED;
+    }
+    if (endpoint_state == CircuitBreaker::HALF_OPEN) {
+      state = CircuitBreaker::HALF_OPEN;
+    }
+  }
+  return state;
+}
+
+vector<CrackedUrl> Emitter::get_collector_urls() const {
+  vector<CrackedUrl> urls;
+  for (auto const &endpoint : m_endpoints) {
+    urls.push_back(endpoint.url);
+  }
+  return urls;
+}
+
+// --- Queue size limits
+
+bool Emitter::is_queue_full(unsigned long long event_bytes, unsigned long long *event_count) {
+  unsigned long long byte_size = 0;
+  if (!m_event_store->get_event_queue_size(event_count, &byte_size)) {
+    return false; // limits are not enforced if the event store doesn't know its size
+  }
+  return (m_max_queue_events > 0 && *event_count >= m_max_queue_events) ||
+         (m_max_queue_bytes > 0 && byte_size + event_bytes > m_max_queue_bytes);
+}
+
+// called with m_queue_access locked, returns false if the new event should be dropped
+bool Emitter::make_room_in_queue(unsigned long long event_bytes) {
+  unsigned long long event_count = 0;
+  if (!is_queue_full(event_bytes, &event_count)) {
+    m_queue_overflow_seen = 0;
+    return true;
+  }
+
+  // rows of requests in flight are kept, a new event could otherwise take over a removed row's ID and be removed in its place
+  // once the request succeeds, so room can only be made while other events are queued
+  auto drop_queued_events = [&](bool random) {
+    lock_guard<mutex> guard(m_in_flight_access);
+    bool full = true;
+    while (full && event_count > 0) {
+      unsigned long long queued_event_count = event_count;
+      if (random) {
+        m_event_store->delete_random_event_row(m_in_flight_row_ids);
+      } else {
+        m_event_store->delete_oldest_event_rows(1, m_in_flight_row_ids);
+      }
+      full = is_queue_full(event_bytes, &event_count);
+      if (event_count == queued_event_count) {
+        break;
+      }
+      m_dropped_events++;
+    }
+    return !full;
   };
 
-  // execute callback for successful events
-  if ((m_callback_emit_status & SUCCESS) && !success_row_ids.empty()) {
-    list<string> success_event_ids = transform_row_ids_to_event_ids(success_row_ids);
-    execute_callback(success_event_ids, SUCCESS);
+  switch (m_queue_overflow_policy) {
+  case DROP_OLDEST:
+    return drop_queued_events(false);
+
+  case SAMPLE: {
+    // reservoir sampling: the n-th event since the queue became full replaces a random queued event with probability
+    // capacity / n, so the queue holds a uniform sample of all the events tracked meanwhile
+    m_queue_overflow_seen++;
+    std::uniform_int_distribution<unsigned long long> distribution(1, event_count + m_queue_overflow_seen);
+    if (event_count == 0 || distribution(m_queue_sample_random) > event_count) {
+      return false;
+    }
+    return drop_queued_events(true);
   }
 
-  // execute callback for failed events that will be retried
-  if ((m_callback_emit_status & FAILED_WILL_RETRY) && !failed_will_retry_row_ids.empty()) {
-    list<string> failed_will_retry_event_ids = transform_row_ids_to_event_ids(failed_will_retry_row_ids);
-    execute_callback(failed_will_retry_event_ids, FAILED_WILL_RETRY);
+  case BLOCK: {
+    unique_lock<mutex> locker(m_queue_access, std::adopt_lock);
+    bool has_room = m_queue_space.wait_for(locker, milliseconds(m_queue_block_timeout_ms),
+        [&] { return !is_queue_full(event_bytes, &event_count); });
+    locker.release(); // the caller keeps owning the lock
+    return has_room;
   }
 
-  // execute callback for failed events that won't be retried
-  if ((m_callback_emit_status & FAILED_WONT_RETRY) && !failed_wont_retry_row_ids.empty()) {
-    list<string> failed_wont_retry_event_ids = transform_row_ids_to_event_ids(failed_wont_retry_row_ids);
-    execute_callback(failed_wont_retry_event_ids, FAILED_WONT_RETRY);
+  case DROP_NEWEST:
+  default:
+    return false;
   }
 }
 
-void Emitter::execute_callback(const list<string> &event_ids, EmitStatus emit_status) const {
-  thread(m_callback, event_ids, emit_status).detach();
+void Emitter::notify_queue_space() {
+  // acquire the lock so that a track() call can't miss the notification between checking the queue and waiting
+  { lock_guard<mutex> guard(m_queue_access); }
+  m_queue_space.notify_all();
+}
+
+bool Emitter::process_result(const HttpRequestResult &result, const list<InFlightEvent> &events, bool failover) {
+  SNOWPLOW_ALLOCATION_PROBE("emitter.process_result");
+  auto dispatch_callback = [this](const list<string> &event_ids, EmitStatus emit_status) {
+    if (m_callback && (m_callback_emit_status & emit_status) && !event_ids.empty()) {
+      m_callback_dispatcher.dispatch(event_ids, emit_status);
+    }
+  };
+  auto add_event_id = [](list<string> *event_ids, const InFlightEvent &event) {
+    if (!event.event_id.empty()) {
+      event_ids->push_back(event.event_id);
+    }
+  };
+
+  if (result.is_success() || !result.should_retry(m_custom_retry_for_status_codes)) {
+    // delete rows with successfully sent events and failed events that should not be retried
+    list<string> event_ids;
+    for (auto const &event : events) {
+      add_event_id(&event_ids, event);
+    }
+    dispatch_callback(event_ids, result.is_success() ? SUCCESS : FAILED_WONT_RETRY);
+    m_event_store->delete_event_rows_with_ids(result.get_row_ids());
+    notify_queue_space();
+    return false;
+  }
+
+  // schedule the next attempt for each event, or give up on events that exhausted their attempts
+  map<int, list<int>> retry_row_ids_by_attempts;
+  list<string> retry_event_ids;
+  list<int> dead_letter_row_ids;
+  list<string> dead_letter_event_ids;
+  for (auto const &event : events) {
+    int attempts = event.attempts + 1;
+    if (m_max_attempts > 0 && attempts >= int(m_max_attempts)) {
+      dead_letter_row_ids.push_back(event.row_id);
+      add_event_id(&dead_letter_event_ids, event);
+    } else {
+      retry_row_ids_by_attempts[attempts].push_back(event.row_id);
+      add_event_id(&retry_event_ids, event);
+    }
+  }
+
+  dispatch_callback(retry_event_ids, FAILED_WILL_RETRY);
+  dispatch_callback(dead_letter_event_ids, FAILED_WONT_RETRY);
+
+  // failed over events are due right away, others wait for their back-off or the collector's Retry-After if longer
+  unsigned long long now_ms = Utils::get_unix_epoch_ms();
+  unsigned long long retry_after_ms = (unsigned long long) std::min(result.get_retry_after_ms(), (long long) SNOWPLOW_EMITTER_MAX_RETRY_AFTER_MS);
+  for (auto const &row_ids : retry_row_ids_by_attempts) {
+    unsigned long long delay_ms = std::max((unsigned long long) m_retry_delay.get_for_attempts(row_ids.first).count(), retry_after_ms);
+    unsigned long long next_attempt_at_ms = failover ? now_ms : now_ms + delay_ms;
+    m_event_store->record_failed_attempt(row_ids.second, next_attempt_at_ms);
+  }
+  if (!dead_letter_row_ids.empty()) {
+    m_event_store->move_event_rows_to_dead_letter(dead_letter_row_ids);
+    notify_queue_space();
+  }
+  return true;
 }
 
 // --- Helpers
@@ -343,7 +809,7 @@ string Emitter::build_post_data_json(list<Payload> payload_list) {
   json data_array = json::array();
 
   // Add 'stm' to each payload
-  string stm = to_string(Utils::get_unix_epoch_ms());
+  string stm = Utils::uint_to_string(Utils::get_unix_epoch_ms());
   for (list<Payload>::iterator it = payload_list.begin(); it != payload_list.end(); ++it) {
     it->add(SNOWPLOW_SENT_TIMESTAMP, stm);
     data_array.push_back(it->get());
@@ -21,6 +21,10 @@ See the Apache License Version 2.0 for the specific language governing permissio
 #include <future>
 #include <thread>
 #include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+#include <random>
 #include "../constants.hpp"
 #include "../detail/utils/utils.hpp"
 #include "../storage/event_store.hpp"
@@ -33,6 +37,10 @@ See the Apache License Version 2.0 for the specific language governing permissio
 #include "../configuration/emitter_configuration.hpp"
 #include "../emitter/emit_status.hpp"
 #include "retry_delay.hpp"
+#include "callback_dispatcher.hpp"
+#include "circuit_breaker.hpp"
+#include "event_deduplicator.hpp"
+#include "queue_overflow_policy.hpp"
 #include "../http/http_enums.hpp"
 
 namespace snowplow {
@@ -44,6 +52,10 @@ using std::mutex;
 using std::unique_ptr;
 using std::list;
 using std::shared_ptr;
+using std::set;
+using std::pair;
+using std::future;
+using std::vector;
 
 /**
  * @brief Emitter is responsible for sending events to a Snowplow Collector.
@@ -107,6 +119,35 @@ public:
    */
   virtual void add(Payload payload);
 
+  /**
+   * @brief Adds an event that was already serialized to the database for sending.
+   *
+   * Used to add the same event to several emitters without serializing it for each of them (see `FanOutEmitter`).
+   *
+   * @param payload Event payload
+   * @param serialized_payload The payload serialized using `Utils::serialize_payload`
+   */
+  virtual void add_serialized(const Payload &payload, const string &serialized_payload);
+
+  /**
+   * @brief Adds several events to the database for sending at once. Triggered by tracker when thread buffers are enabled.
+   *
+   * Unless queue size limits are set, the events are inserted into the event store in a single batch.
+   *
+   * @param payloads Event payloads
+   */
+  virtual void add_batch(list<Payload> payloads);
+
+  /**
+   * @brief Adds several events that were already serialized to the database for sending at once.
+   *
+   * Used to add the same batch to several emitters without serializing it for each of them (see `FanOutEmitter`).
+   *
+   * @param payloads Event payloads
+   * @param serialized_payloads The payloads serialized using `Utils::serialize_payload`, in the same order
+   */
+  virtual void add_serialized_batch(const list<Payload> &payloads, const list<string> &serialized_payloads);
+
   /**
    * @brief Force send queued events.
    */
@@ -119,6 +160,13 @@ public:
    */
   CrackedUrl get_cracked_url() const { return m_url; }
 
+  /**
+   * @brief Get the URLs of all collector endpoints that requests are spread across.
+   *
+   * @return vector<CrackedUrl> Collector URLs, starting with the one returned by `get_cracked_url()`
+   */
+  vector<CrackedUrl> get_collector_urls() const;
+
   /**
    * @brief Get the HTTP method.
    * 
@@ -147,6 +195,76 @@ public:
    */
   unsigned int get_byte_limit_post() const { return m_byte_limit_post; }
 
+  /**
+   * @brief Get the maximum number of requests in flight.
+   *
+   * @return unsigned int The maximum number of concurrent requests to the collector
+   */
+  unsigned int get_max_requests_in_flight() const { return m_max_requests_in_flight; }
+
+  /**
+   * @brief Get the maximum number of attempts to send an event.
+   *
+   * @return unsigned int Maximum attempts before the event is moved to the dead-letter queue (0 = unlimited)
+   */
+  unsigned int get_max_attempts() const { return m_max_attempts; }
+
+  /**
+   * @brief Get the overall state of the circuit breakers (always closed unless enabled in `EmitterConfiguration`).
+   *
+   * Each collector endpoint has its own circuit breaker. Requests are sent as long as one of them is closed.
+   *
+   * @return CircuitBreaker::State Closed if any endpoint's circuit is closed, half-open if any is probing, otherwise open
+   */
+  CircuitBreaker::State get_circuit_breaker_state() const;
+
+  /**
+   * @brief Get the state of the circuit breaker of a collector endpoint.
+   *
+   * @param endpoint Index of the endpoint in `get_collector_urls()`
+   * @return CircuitBreaker::State Whether requests are sent to the endpoint (closed), paused (open) or probing (half-open)
+   */
+  CircuitBreaker::State get_circuit_breaker_state(size_t endpoint) const { return m_endpoints.at(endpoint).circuit_breaker->get_state(); }
+
+  /**
+   * @brief Get the number of events dropped because the event queue was full.
+   *
+   * Includes new events rejected by the queue overflow policy as well as queued events it removed.
+   *
+   * @return unsigned long long Number of dropped events since the Emitter was created
+   */
+  unsigned long long get_dropped_event_count() const { return m_dropped_events.load(); }
+
+  /**
+   * @brief Get the number of event IDs not passed to the request callback because too many were waiting for it.
+   *
+   * The events themselves are processed as usual, only their callback is skipped.
+   *
+   * @return unsigned long long Number of event IDs dropped from the request callback since the Emitter was created
+   */
+  unsigned long long get_callback_dropped_event_count() const { return m_callback_dispatcher.get_dropped_event_id_count(); }
+
+  /**
+   * @brief Get the number of events dropped as duplicates (always 0 unless deduplication is enabled in `EmitterConfiguration`).
+   *
+   * @return unsigned long long Number of events dropped by the deduplication since the Emitter was created
+   */
+  unsigned long long get_deduplication_hit_count() const { return m_deduplicator ? m_deduplicator->get_hit_count() : 0; }
+
+  /**
+   * @brief Get the number of events that passed the deduplication.
+   *
+   * @return unsigned long long Number of events not found in the deduplication window since the Emitter was created
+   */
+  unsigned long long get_deduplication_miss_count() const { return m_deduplicator ? m_deduplicator->get_miss_count() : 0; }
+
+  /**
+   * @brief Get the estimated probability that a unique event is currently dropped as a duplicate.
+   *
+   * @return double Estimated false positive rate of the deduplication (0 if disabled)
+   */
+  double get_deduplication_false_positive_rate() const { return m_deduplicator ? m_deduplicator->get_false_positive_rate() : 0; }
+
   /**
    * @brief Check if the Emitter is started.
    * 
@@ -160,7 +278,7 @@ public:
    * To subscribe to multiple emit statuses, use binary operations such as `EmitStatus::FAILED_WILL_RETRY | EmitStatus::FAILED_WONT_RETRY`.
    * Calling this function overwrites any previously set callbacks.
    * The callback can't be changed when the Emitter is running.
-   * The callback will be fired in a new thread.
+   * The callback will be called on a dispatcher thread owned by the Emitter, in the order the requests completed.
    * 
    * @param callback Callback function
    * @param emit_status Emit status to trigger the callback for
@@ -178,6 +296,14 @@ public:
    */
   void set_custom_retry_for_status_code(int http_status_code, bool retry);
 
+protected:
+  /**
+   * @brief Construct an Emitter that doesn't send events itself but passes them on to other emitters.
+   *
+   * @param url Collector URL returned by `get_cracked_url()`
+   */
+  explicit Emitter(const CrackedUrl &url);
+
 private:
   CrackedUrl m_url;
   Method m_method;
@@ -186,6 +312,12 @@ private:
   unsigned int m_batch_size;
   unsigned int m_byte_limit_get;
   unsigned int m_byte_limit_post;
+  unsigned int m_max_requests_in_flight;
+  unsigned int m_max_attempts;
+  unsigned long long m_max_queue_events;
+  unsigned long long m_max_queue_bytes;
+  QueueOverflowPolicy m_queue_overflow_policy;
+  int m_queue_block_timeout_ms;
 
   thread m_daemon_thread;
   condition_variable m_check_db;
@@ -196,18 +328,76 @@ private:
   bool m_running;
   std::atomic<bool> m_stop_requested{false};
   std::atomic<bool> m_flush_done{false};
+  std::atomic<unsigned long> m_added_events{0};
+  std::atomic<unsigned long long> m_dropped_events{0};
   int m_flush_timeout_ms;
   EmitterCallback m_callback;
   EmitStatus m_callback_emit_status;
+  CallbackDispatcher m_callback_dispatcher;
   map<int, bool> m_custom_retry_for_status_codes;
   RetryDelay m_retry_delay;
+  unique_ptr<EventDeduplicator> m_deduplicator;
+
+  // Collector endpoints that requests are spread across, only accessed by the daemon thread once running
+  struct Endpoint {
+    Endpoint(const CrackedUrl &url, int weight) : url(url), weight(weight), circuit_breaker(new CircuitBreaker()) {}
+
+    CrackedUrl url;
+    int weight;
+    int current_weight = 0; // smooth weighted round-robin state
+    unsigned int outstanding_requests = 0;
+    RetryDelay retry_delay;
+    steady_clock::time_point unhealthy_until;
+    unique_ptr<CircuitBreaker> circuit_breaker; // held by pointer as endpoints are moved into the vector
+  };
+  vector<Endpoint> m_endpoints;
+  LoadBalancing m_load_balancing;
+
+  // Serializes adding events when queue size limits are set, m_queue_space is notified when events are removed
+  mutex m_queue_access;
+  condition_variable m_queue_space;
+  unsigned long long m_queue_overflow_seen = 0;
+  std::mt19937 m_queue_sample_random;
+
+  // Results of finished requests waiting to be processed by the daemon thread, guarded by m_db_select
+  list<pair<unsigned long, HttpRequestResult>> m_completed_requests;
+
+  // Rows of requests in flight, changed by the daemon thread and skipped by the queue overflow policies, guarded by m_in_flight_access
+  set<int> m_in_flight_row_ids;
+  mutex m_in_flight_access;
+
+  struct InFlightEvent {
+    int row_id;
+    int attempts;
+    string event_id;
+  };
+
+  struct InFlightRequest {
+    future<void> done;
+    size_t endpoint;
+    list<InFlightEvent> events;
+  };
 
   void run();
-  void do_send(const list<EventRow> &event_rows, list<HttpRequestResult> *results);
+  void send_requests(const list<EventRow> &event_rows, size_t max_requests, unsigned long *next_request_id,
+    map<unsigned long, InFlightRequest> *in_flight);
+  void issue_request(unsigned long request_id, const string &data, const list<int> &row_ids, bool oversize, list<InFlightEvent> events,
+    map<unsigned long, InFlightRequest> *in_flight);
+  void send_request(unsigned long request_id, CrackedUrl url, const string &data, const list<int> &row_ids, bool oversize);
+  size_t select_endpoint(steady_clock::time_point now);
+  bool has_healthy_endpoint(steady_clock::time_point now) const;
+  bool allows_requests(steady_clock::time_point now, bool *probe);
+  steady_clock::time_point get_circuits_open_until() const;
+  void enqueue(const Payload &payload, const string *serialized_payload);
+  void remove_duplicates(list<Payload> *payloads, list<string> *serialized_payloads);
+  void store_batch(const list<Payload> &payloads, const list<string> *serialized_payloads);
+  bool has_queue_limits() const { return m_max_queue_events > 0 || m_max_queue_bytes > 0; }
+  bool make_room_in_queue(unsigned long long event_bytes);
+  bool is_queue_full(unsigned long long event_bytes, unsigned long long *event_count);
+  void notify_queue_space();
+  bool process_result(const HttpRequestResult &result, const list<InFlightEvent> &events, bool failover);
   string build_post_data_json(list<Payload> payload_list);
   string get_collector_url(const string &uri, Protocol protocol, Method method) const;
-  void trigger_callbacks(const list<int> &success_row_ids, const list<int> &failed_will_retry_row_ids, const list<int> &failed_wont_retry_row_ids, const list<EventRow> &event_rows) const;
-  void execute_callback(const list<string> &event_ids, EmitStatus emit_status) const;
 };
 } // namespace snowplow
 
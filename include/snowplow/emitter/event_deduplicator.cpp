@@ -0,0 +1,143 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "event_deduplicator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace snowplow;
+using std::invalid_argument;
+using std::lock_guard;
+
+namespace {
+const unsigned long long fnv_offset_basis = 14695981039346656037ULL;
+const unsigned long long fnv_prime = 1099511628211ULL;
+
+void fnv1a(unsigned long long &hash, const string &value) {
+  for (unsigned char c : value) {
+    hash ^= c;
+    hash *= fnv_prime;
+  }
+  // separate consecutive fields so that ("ab", "c") and ("a", "bc") hash differently
+  hash ^= 0xff;
+  hash *= fnv_prime;
+}
+
+unsigned long long mix(unsigned long long hash) {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+} // namespace
+
+EventDeduplicator::EventDeduplicator(const vector<string> &fields, milliseconds window, unsigned long long capacity, double false_positive_rate) :
+  m_fields(fields), m_window(window), m_capacity(capacity) {
+  if (fields.empty()) {
+    throw invalid_argument("Deduplication requires at least one payload field");
+  }
+  if (window.count() <= 0) {
+    throw invalid_argument("Deduplication window must be greater than 0");
+  }
+  if (capacity == 0) {
+    throw invalid_argument("Deduplication capacity must be greater than 0");
+  }
+  if (false_positive_rate <= 0 || false_positive_rate >= 1) {
+    throw invalid_argument("Deduplication false positive rate must be between 0 and 1");
+  }
+
+  // optimal Bloom filter size and number of hash functions for the capacity and false positive rate
+  double ln2 = std::log(2.0);
+  double bits = std::ceil(-(double)capacity * std::log(false_positive_rate) / (ln2 * ln2));
+  m_filter_bits = ((unsigned long long)bits + 63) / 64 * 64;
+  m_hash_count = std::max(1u, (unsigned int)std::lround((double)m_filter_bits / capacity * ln2));
+
+  m_current.words.assign(m_filter_bits / 64, 0);
+  m_previous.words.assign(m_filter_bits / 64, 0);
+  m_current.started_at = steady_clock::now();
+}
+
+bool EventDeduplicator::is_duplicate(const Payload &payload, steady_clock::time_point now) {
+  unsigned long long hash = fnv_offset_basis;
+  bool has_field = false;
+  for (auto const &field : m_fields) {
+    string value = payload.get_value(field);
+    has_field = has_field || !value.empty();
+    fnv1a(hash, value);
+  }
+  if (!has_field) {
+    m_misses++;
+    return false;
+  }
+  // derive the bit positions from two independent hashes (Kirsch-Mitzenmacher double hashing)
+  unsigned long long h1 = mix(hash);
+  unsigned long long h2 = mix(h1 ^ hash) | 1;
+
+  lock_guard<mutex> guard(m_access);
+  if (m_current.event_count >= m_capacity || now - m_current.started_at >= m_window) {
+    std::swap(m_previous, m_current);
+    std::fill(m_current.words.begin(), m_current.words.end(), 0);
+    m_current.event_count = 0;
+    // after an idle gap of two windows, the events of the previous filter are outside the window as well
+    if (now - m_previous.started_at >= 2 * m_window) {
+      std::fill(m_previous.words.begin(), m_previous.words.end(), 0);
+      m_previous.event_count = 0;
+    }
+    m_current.started_at = now;
+  }
+
+  if (contains(m_current, h1, h2) || contains(m_previous, h1, h2)) {
+    m_hits++;
+    return true;
+  }
+  insert(m_current, h1, h2);
+  m_misses++;
+  return false;
+}
+
+double EventDeduplicator::get_false_positive_rate() {
+  lock_guard<mutex> guard(m_access);
+  double current = estimate_false_positive_rate(m_current);
+  double previous = estimate_false_positive_rate(m_previous);
+  return 1 - (1 - current) * (1 - previous);
+}
+
+bool EventDeduplicator::contains(const BloomFilter &filter, unsigned long long h1, unsigned long long h2) const {
+  if (filter.event_count == 0) {
+    return false;
+  }
+  for (unsigned int i = 0; i < m_hash_count; i++) {
+    unsigned long long bit = (h1 + i * h2) % m_filter_bits;
+    if (!(filter.words[bit / 64] & (1ULL << (bit % 64)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void EventDeduplicator::insert(BloomFilter &filter, unsigned long long h1, unsigned long long h2) {
+  for (unsigned int i = 0; i < m_hash_count; i++) {
+    unsigned long long bit = (h1 + i * h2) % m_filter_bits;
+    filter.words[bit / 64] |= 1ULL << (bit % 64);
+  }
+  filter.event_count++;
+}
+
+double EventDeduplicator::estimate_false_positive_rate(const BloomFilter &filter) const {
+  // (1 - e^(-kn/m))^k
+  double exponent = -(double)m_hash_count * filter.event_count / m_filter_bits;
+  return std::pow(1 - std::exp(exponent), m_hash_count);
+}
@@ -0,0 +1,118 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#ifndef EVENT_DEDUPLICATOR_H
+#define EVENT_DEDUPLICATOR_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../payload/payload.hpp"
+
+namespace snowplow {
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::mutex;
+using std::string;
+using std::vector;
+
+/**
+ * @brief Drops events whose configured payload fields repeat an event seen within the deduplication window.
+ *
+ * The fingerprints of seen events are kept in a rotating pair of Bloom filters sized for `capacity` events
+ * at the target false positive rate. New fingerprints go into the current filter which replaces the previous one
+ * once it is full or older than the window, so an event is remembered for between one and two windows
+ * (or `capacity` and 2 * `capacity` later events). Memory use is fixed at roughly
+ * 2 * 1.44 * log2(1 / false_positive_rate) bits per event of capacity.
+ *
+ * Like any Bloom filter, it may report an event that wasn't seen before as a duplicate (a false positive)
+ * but never misses a duplicate within the window.
+ */
+class EventDeduplicator {
+public:
+  /**
+   * @brief Construct a new Event Deduplicator
+   *
+   * @param fields Payload fields that identify a logical event (e.g., "e", "se_ca", "se_ac", "uid")
+   * @param window Minimum time for which seen events are remembered
+   * @param capacity Number of events remembered per window
+   * @param false_positive_rate Target probability of dropping an event that is not a duplicate when a filter is full
+   */
+  EventDeduplicator(const vector<string> &fields, milliseconds window, unsigned long long capacity, double false_positive_rate);
+
+  /**
+   * @brief Check whether the event was seen within the window and remember it.
+   *
+   * Events that have none of the configured fields are never reported as duplicates.
+   *
+   * @param payload Event payload
+   * @param now Current time
+   * @return bool True if the event is a duplicate and should be dropped
+   */
+  bool is_duplicate(const Payload &payload, steady_clock::time_point now = steady_clock::now());
+
+  /**
+   * @return unsigned long long Number of events reported as duplicates
+   */
+  unsigned long long get_hit_count() const { return m_hits.load(); }
+
+  /**
+   * @return unsigned long long Number of events that were not duplicates
+   */
+  unsigned long long get_miss_count() const { return m_misses.load(); }
+
+  /**
+   * @brief Estimate the probability that a new event is currently reported as a duplicate.
+   *
+   * @return double Estimated false positive rate based on the number of events in both filters
+   */
+  double get_false_positive_rate();
+
+  /**
+   * @return unsigned long long Number of bits in each of the two Bloom filters
+   */
+  unsigned long long get_filter_bits() const { return m_filter_bits; }
+
+  /**
+   * @return unsigned int Number of bits set for each event
+   */
+  unsigned int get_hash_count() const { return m_hash_count; }
+
+private:
+  struct BloomFilter {
+    vector<unsigned long long> words;
+    unsigned long long event_count = 0;
+    steady_clock::time_point started_at;
+  };
+
+  vector<string> m_fields;
+  milliseconds m_window;
+  unsigned long long m_capacity;
+  unsigned long long m_filter_bits;
+  unsigned int m_hash_count;
+  BloomFilter m_current;
+  BloomFilter m_previous;
+  mutex m_access;
+  std::atomic<unsigned long long> m_hits{0};
+  std::atomic<unsigned long long> m_misses{0};
+
+  bool contains(const BloomFilter &filter, unsigned long long h1, unsigned long long h2) const;
+  void insert(BloomFilter &filter, unsigned long long h1, unsigned long long h2);
+  double estimate_false_positive_rate(const BloomFilter &filter) const;
+};
+} // namespace snowplow
+
+#endif
@@ -0,0 +1,85 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "fan_out_emitter.hpp"
+
+using namespace snowplow;
+using std::async;
+using std::future;
+using std::invalid_argument;
+
+FanOutEmitter::FanOutEmitter(const vector<shared_ptr<Emitter>> &destinations) :
+  Emitter(get_first_destination_url(destinations)), m_destinations(destinations) {}
+
+CrackedUrl FanOutEmitter::get_first_destination_url(const vector<shared_ptr<Emitter>> &destinations) {
+  if (destinations.empty()) {
+    throw invalid_argument("FanOutEmitter requires at least one destination emitter");
+  }
+  for (auto const &destination : destinations) {
+    if (!destination) {
+      throw invalid_argument("FanOutEmitter destination emitter can't be null");
+    }
+  }
+  return destinations.front()->get_cracked_url();
+}
+
+void FanOutEmitter::start() {
+  for (auto const &destination : m_destinations) {
+    destination->start();
+  }
+}
+
+void FanOutEmitter::stop() {
+  for (auto const &destination : m_destinations) {
+    destination->stop();
+  }
+}
+
+void FanOutEmitter::add(Payload payload) {
+  add_serialized(payload, Utils::serialize_payload(payload));
+}
+
+void FanOutEmitter::add_batch(list<Payload> payloads) {
+  list<string> serialized_payloads;
+  for (auto const &payload : payloads) {
+    serialized_payloads.push_back(Utils::serialize_payload(payload));
+  }
+  add_serialized_batch(payloads, serialized_payloads);
+}
+
+void FanOutEmitter::add_serialized_batch(const list<Payload> &payloads, const list<string> &serialized_payloads) {
+  for (auto const &destination : m_destinations) {
+    destination->add_serialized_batch(payloads, serialized_payloads);
+  }
+}
+
+void FanOutEmitter::add_serialized(const Payload &payload, const string &serialized_payload) {
+  for (auto const &destination : m_destinations) {
+    destination->add_serialized(payload, serialized_payload);
+  }
+}
+
+void FanOutEmitter::flush() {
+  // flush the destinations concurrently so that their flush timeouts don't add up
+  list<future<void>> flushes;
+  for (auto const &destination : m_destinations) {
+    flushes.push_back(async(std::launch::async, &Emitter::flush, destination.get()));
+  }
+  // wait for all destinations before rethrowing the first exception
+  for (auto &flush : flushes) {
+    flush.wait();
+  }
+  for (auto &flush : flushes) {
+    flush.get();
+  }
+}
@@ -0,0 +1,104 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#ifndef FAN_OUT_EMITTER_H
+#define FAN_OUT_EMITTER_H
+
+#include <memory>
+#include <vector>
+#include "emitter.hpp"
+
+namespace snowplow {
+
+using std::shared_ptr;
+using std::vector;
+
+/**
+ * @brief Emitter that delivers each tracked event to several destination emitters.
+ *
+ * The event is serialized once and the bytes are shared by all destinations. Each destination keeps
+ * its own event store, batching, retries and queue size limits, so a slow or failing destination doesn't
+ * hold back the others. Use it instead of multiple trackers to mirror events to several collectors
+ * with the same event IDs and session.
+ */
+class FanOutEmitter : public Emitter {
+public:
+  /**
+   * @brief Construct a new FanOutEmitter
+   *
+   * @param destinations Emitters to deliver the events to, each with its own event store
+   */
+  FanOutEmitter(const vector<shared_ptr<Emitter>> &destinations);
+
+  /**
+   * @brief Starts all destination emitters.
+   */
+  void start();
+
+  /**
+   * @brief Stops all destination emitters.
+   */
+  void stop();
+
+  /**
+   * @brief Adds the event to all destination emitters.
+   *
+   * @param payload Event payload
+   */
+  void add(Payload payload);
+
+  /**
+   * @brief Adds the already serialized event to all destination emitters.
+   *
+   * @param payload Event payload
+   * @param serialized_payload The payload serialized using `Utils::serialize_payload`
+   */
+  void add_serialized(const Payload &payload, const string &serialized_payload);
+
+  /**
+   * @brief Adds the events to all destination emitters, each of them stores the batch at once.
+   *
+   * @param payloads Event payloads
+   */
+  void add_batch(list<Payload> payloads);
+
+  /**
+   * @brief Adds the already serialized events to all destination emitters, each of them stores the batch at once.
+   *
+   * @param payloads Event payloads
+   * @param serialized_payloads The payloads serialized using `Utils::serialize_payload`, in the same order
+   */
+  void add_serialized_batch(const list<Payload> &payloads, const list<string> &serialized_payloads);
+
+  /**
+   * @brief Flushes all destination emitters concurrently.
+   *
+   * Waits for all destinations, then rethrows the first exception thrown by a destination's flush.
+   */
+  void flush();
+
+  /**
+   * @brief Get the destination emitters.
+   *
+   * @return vector<shared_ptr<Emitter>> Emitters that the events are delivered to
+   */
+  vector<shared_ptr<Emitter>> get_destinations() const { return m_destinations; }
+
+private:
+  vector<shared_ptr<Emitter>> m_destinations;
+
+  static CrackedUrl get_first_destination_url(const vector<shared_ptr<Emitter>> &destinations);
+};
+} // namespace snowplow
+
+#endif
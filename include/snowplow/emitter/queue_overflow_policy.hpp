@@ -0,0 +1,31 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#ifndef QUEUE_OVERFLOW_POLICY_H
+#define QUEUE_OVERFLOW_POLICY_H
+
+namespace snowplow {
+
+/**
+ * @brief What the Emitter does with new events when the event queue reached its size limit.
+ */
+enum QueueOverflowPolicy {
+  DROP_NEWEST, // drop the new event
+  DROP_OLDEST, // drop the oldest queued events to make room for the new event
+  SAMPLE,      // keep a uniform random sample of the events tracked since the queue became full
+  BLOCK        // wait for the Emitter to send queued events, drop the new event after a timeout
+};
+
+} // namespace snowplow
+
+#endif
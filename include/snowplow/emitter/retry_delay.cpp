@@ -12,10 +12,14 @@ See the Apache License Version 2.0 for the specific language governing permissio
 */
 
 #include "retry_delay.hpp"
+#include "../constants.hpp"
+#include <algorithm>
+#include <cmath>
 #include <random>
 
 using namespace snowplow;
 using std::min;
+using std::max;
 
 RetryDelay::RetryDelay(double base, double factor, int retry_count_cap, double jitter) {
   m_base = base;
@@ -23,28 +27,32 @@ RetryDelay::RetryDelay(double base, double factor, int retry_count_cap, double j
   m_retry_count_cap = retry_count_cap;
   m_jitter = jitter;
   m_retry_count = 0;
+  m_delay = milliseconds(0);
+
+  // seed the per-instance generator once, jitter doesn't need a cryptographic source on each retry
+  std::random_device rd;
+  m_random_state = (uint64_t(rd()) << 32) ^ rd() ^ uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+  if (m_random_state == 0) {
+    m_random_state = 0x9E3779B97F4A7C15ULL;
+  }
 }
 
-void RetryDelay::will_retry_emit() {
+void RetryDelay::will_retry_emit(milliseconds retry_after) {
   m_retry_count++;
-}
 
-void RetryDelay::wont_retry_emit() {
-  m_retry_count = 0;
+  milliseconds requested_delay = min(retry_after, milliseconds(SNOWPLOW_EMITTER_MAX_RETRY_AFTER_MS));
+  m_delay = max(get_for_attempts(m_retry_count), requested_delay);
 }
 
-milliseconds RetryDelay::get() const {
-  if (m_retry_count == 0) {
+milliseconds RetryDelay::get_for_attempts(int attempts) {
+  if (attempts <= 0) {
     return milliseconds(0);
   }
 
-  double delay_ms = m_base * pow(m_factor, min(m_retry_count, m_retry_count_cap) - 1);
+  double delay_ms = m_base * pow(m_factor, min(attempts, m_retry_count_cap) - 1);
 
   if (m_jitter != 0) {
-    std::random_device rd;
-    std::mt19937 mt(rd());
-    std::uniform_real_distribution<double> dist(0.0, 1.0);
-    double seed = dist(mt);
+    double seed = next_random();
     double deviation = floor(seed * m_jitter * delay_ms);
 
     if (round(seed) == 1) {
@@ -56,3 +64,16 @@ milliseconds RetryDelay::get() const {
 
   return milliseconds((unsigned long) delay_ms);
 }
+
+void RetryDelay::wont_retry_emit() {
+  m_retry_count = 0;
+  m_delay = milliseconds(0);
+}
+
+// xorshift64* generator, returns a number in [0, 1)
+double RetryDelay::next_random() {
+  m_random_state ^= m_random_state >> 12;
+  m_random_state ^= m_random_state << 25;
+  m_random_state ^= m_random_state >> 27;
+  return double((m_random_state * 0x2545F4914F6CDD1DULL) >> 11) / double(1ULL << 53);
+}
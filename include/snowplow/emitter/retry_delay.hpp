@@ -15,6 +15,7 @@ See the Apache License Version 2.0 for the specific language governing permissio
 #define RETRY_DELAY_H
 
 #include <chrono>
+#include <cstdint>
 
 namespace snowplow {
 
@@ -37,15 +38,25 @@ public:
 
   /**
    * @brief Update retry delay considering that a new retry is planned.
+   *
+   * @param retry_after Minimum delay requested by the collector using the Retry-After header (capped to `SNOWPLOW_EMITTER_MAX_RETRY_AFTER_MS`)
    */
-  void will_retry_emit();
+  void will_retry_emit(milliseconds retry_after = milliseconds(0));
 
   /**
    * @brief Update retry delay considering that no more retries are planned.
    */
   void wont_retry_emit();
 
-  milliseconds get() const;
+  milliseconds get() const { return m_delay; }
+
+  /**
+   * @brief Calculate the delay before retrying an event that failed the given number of times.
+   *
+   * @param attempts Number of failed attempts
+   * @return milliseconds Exponential delay with jitter
+   */
+  milliseconds get_for_attempts(int attempts);
 
 private:
   int m_retry_count;
@@ -53,6 +64,10 @@ private:
   double m_factor;
   int m_retry_count_cap;
   double m_jitter;
+  milliseconds m_delay;
+  uint64_t m_random_state;
+
+  double next_random();
 };
 } // namespace snowplow
 
@@ -0,0 +1,122 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "thread_event_buffers.hpp"
+#include <map>
+#include <stdexcept>
+
+using namespace snowplow;
+using std::invalid_argument;
+using std::lock_guard;
+using std::make_shared;
+using std::map;
+
+ThreadEventBuffers::ThreadEventBuffers(int max_events, unsigned long long max_age_ms) : m_max_events(max_events), m_max_age_ms(max_age_ms) {
+  if (max_events < 1) {
+    throw invalid_argument("Thread buffer size must be greater than 0");
+  }
+
+  // instances are told apart by an ID rather than their address which may be reused by a later instance
+  static std::atomic<unsigned long long> next_id{0};
+  m_id = next_id++;
+}
+
+ThreadEventBuffers::~ThreadEventBuffers() {
+  // threads release their references to the buffers the next time they register a buffer
+  lock_guard<mutex> guard(m_registry_access);
+  for (auto const &buffer : m_buffers) {
+    buffer->closed = true;
+  }
+}
+
+bool ThreadEventBuffers::add(Payload payload, unsigned long long now_ms, list<Payload> *batch) {
+  Buffer &buffer = *get_thread_buffer();
+  lock_guard<mutex> guard(buffer.access);
+  if (buffer.payloads.empty()) {
+    buffer.first_added_at_ms = now_ms;
+  }
+  buffer.payloads.push_back(std::move(payload));
+
+  bool full = buffer.payloads.size() >= (size_t)m_max_events;
+  bool expired = m_max_age_ms > 0 && now_ms >= buffer.first_added_at_ms + m_max_age_ms;
+  if (!full && !expired) {
+    return false;
+  }
+  batch->splice(batch->end(), buffer.payloads);
+  return true;
+}
+
+list<Payload> ThreadEventBuffers::take_all() {
+  return take(false, 0, nullptr);
+}
+
+list<Payload> ThreadEventBuffers::take_expired(unsigned long long now_ms, unsigned long long *next_expiry_ms) {
+  *next_expiry_ms = 0;
+  if (m_max_age_ms == 0) {
+    return list<Payload>();
+  }
+  return take(true, now_ms, next_expiry_ms);
+}
+
+list<Payload> ThreadEventBuffers::take(bool expired_only, unsigned long long now_ms, unsigned long long *next_expiry_ms) {
+  list<Payload> payloads;
+  lock_guard<mutex> registry_guard(m_registry_access);
+  for (auto it = m_buffers.begin(); it != m_buffers.end();) {
+    {
+      lock_guard<mutex> guard((*it)->access);
+      unsigned long long expiry_ms = (*it)->first_added_at_ms + m_max_age_ms;
+      if (!expired_only || now_ms >= expiry_ms) {
+        payloads.splice(payloads.end(), (*it)->payloads);
+      } else if (!(*it)->payloads.empty() && (*next_expiry_ms == 0 || expiry_ms < *next_expiry_ms)) {
+        *next_expiry_ms = expiry_ms;
+      }
+    }
+
+    // the registry holds the last reference to buffers of threads that exited
+    if (it->use_count() == 1) {
+      it = m_buffers.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return payloads;
+}
+
+size_t ThreadEventBuffers::get_buffer_count() const {
+  lock_guard<mutex> guard(m_registry_access);
+  return m_buffers.size();
+}
+
+shared_ptr<ThreadEventBuffers::Buffer> &ThreadEventBuffers::get_thread_buffer() {
+  static thread_local map<unsigned long long, shared_ptr<Buffer>> thread_buffers;
+  auto it = thread_buffers.find(m_id);
+  if (it != thread_buffers.end()) {
+    return it->second;
+  }
+
+  // drop buffers of destroyed instances before registering a new one
+  for (auto buffer = thread_buffers.begin(); buffer != thread_buffers.end();) {
+    if (buffer->second->closed) {
+      buffer = thread_buffers.erase(buffer);
+    } else {
+      ++buffer;
+    }
+  }
+
+  auto buffer = make_shared<Buffer>();
+  {
+    lock_guard<mutex> guard(m_registry_access);
+    m_buffers.push_back(buffer);
+  }
+  return thread_buffers[m_id] = buffer;
+}
@@ -0,0 +1,112 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#ifndef THREAD_EVENT_BUFFERS_H
+#define THREAD_EVENT_BUFFERS_H
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "../payload/payload.hpp"
+
+namespace snowplow {
+
+using std::list;
+using std::mutex;
+using std::shared_ptr;
+using std::vector;
+
+/**
+ * @brief Per-thread buffers that collect tracked event payloads and hand them over to the Emitter in batches.
+ *
+ * Each thread adding payloads gets its own buffer so that tracking from many threads doesn't contend on the
+ * Emitter and its event store for every event. A buffer is handed over once it holds the maximum number of
+ * events or its oldest event is older than the maximum age. The buffers are also kept in a registry so that
+ * the events of idle threads (including threads that exited) can be taken when the tracker is flushed or destroyed.
+ */
+class ThreadEventBuffers {
+public:
+  /**
+   * @brief Construct new buffers.
+   *
+   * @param max_events Number of events after which a buffer is handed over (must be greater than 0).
+   * @param max_age_ms Age of the oldest event after which a buffer is handed over by its thread (0 to hand over only full buffers).
+   */
+  ThreadEventBuffers(int max_events, unsigned long long max_age_ms);
+  ~ThreadEventBuffers();
+
+  ThreadEventBuffers(const ThreadEventBuffers &) = delete;
+  ThreadEventBuffers &operator=(const ThreadEventBuffers &) = delete;
+
+  /**
+   * @brief Add the payload to the buffer of the calling thread.
+   *
+   * @param payload Event payload
+   * @param now_ms Current Unix timestamp in milliseconds
+   * @param batch Output list that receives the buffered payloads if the buffer is full or too old
+   * @return true if the buffered payloads were moved to the batch and should be passed to the Emitter
+   */
+  bool add(Payload payload, unsigned long long now_ms, list<Payload> *batch);
+
+  /**
+   * @brief Take the payloads from the buffers of all threads.
+   *
+   * Buffers of threads that exited are removed from the registry.
+   *
+   * @return list<Payload> Buffered payloads
+   */
+  list<Payload> take_all();
+
+  /**
+   * @brief Take the payloads from the buffers whose oldest event is older than the maximum age.
+   *
+   * Used to pass on the buffers of threads that stopped tracking events.
+   *
+   * @param now_ms Current Unix timestamp in milliseconds
+   * @param next_expiry_ms Output Unix timestamp at which the next of the remaining buffers expires (0 if all are empty)
+   * @return list<Payload> Buffered payloads
+   */
+  list<Payload> take_expired(unsigned long long now_ms, unsigned long long *next_expiry_ms);
+
+  /**
+   * @return unsigned long long Maximum age of buffered events in milliseconds (0 if buffers are passed on only when full).
+   */
+  unsigned long long get_max_age() const { return m_max_age_ms; }
+
+  /**
+   * @return size_t Number of registered thread buffers.
+   */
+  size_t get_buffer_count() const;
+
+private:
+  struct Buffer {
+    mutex access; // only contended while the buffers are taken by another thread
+    list<Payload> payloads;
+    unsigned long long first_added_at_ms = 0;
+    std::atomic<bool> closed{false}; // set once the owning ThreadEventBuffers is destroyed
+  };
+
+  unsigned long long m_id;
+  int m_max_events;
+  unsigned long long m_max_age_ms;
+  mutable mutex m_registry_access;
+  vector<shared_ptr<Buffer>> m_buffers;
+
+  shared_ptr<Buffer> &get_thread_buffer();
+  list<Payload> take(bool expired_only, unsigned long long now_ms, unsigned long long *next_expiry_ms);
+};
+} // namespace snowplow
+
+#endif
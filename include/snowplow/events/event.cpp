@@ -13,28 +13,31 @@ See the Apache License Version 2.0 for the specific language governing permissio
 
 #include "event.hpp"
 #include "../detail/utils/utils.hpp"
+#include "../payload/json_writer.hpp"
 
 using namespace snowplow;
-using std::to_string;
 using std::invalid_argument;
 
 Event::Event() {
   this->m_true_timestamp = NULL;
+  this->m_priority = 0;
 }
 
 // --- Getters
 
-EventPayload Event::get_payload(bool use_base64) const {
+EventPayload Event::get_payload(bool use_base64, EventIdVersion event_id_version) const {
+  EventPayload::EventIdVersionScope id_version_scope(event_id_version);
   EventPayload p = get_custom_event_payload(use_base64);
 
-  if (!p.get().count(SNOWPLOW_EVENT)) {
+  if (!p.get_pairs().count(SNOWPLOW_EVENT)) {
     throw invalid_argument("Missing event type");
   }
 
   auto *true_timestamp = get_true_timestamp();
   if (true_timestamp != NULL) {
-    p.add(SNOWPLOW_TRUE_TIMESTAMP, to_string(*true_timestamp));
+    p.add(SNOWPLOW_TRUE_TIMESTAMP, Utils::uint_to_string(*true_timestamp));
   }
+  p.set_priority(m_priority);
 
   return p;
 }
@@ -43,13 +46,27 @@ EventPayload Event::get_self_describing_event_payload(const SelfDescribingJson &
   EventPayload p;
   p.add(SNOWPLOW_EVENT, SNOWPLOW_EVENT_SELF_DESCRIBING);
 
-  SelfDescribingJson sdj(SNOWPLOW_SCHEMA_UNSTRUCT_EVENT, event.get());
-  p.add_json(sdj.get(), use_base64, SNOWPLOW_UNSTRUCTURED_ENCODED, SNOWPLOW_UNSTRUCTURED);
+  // serialize the unstruct_event wrapper directly instead of copying the event JSON into a new tree
+  JsonWriter writer;
+  writer.begin_object()
+      .key(SNOWPLOW_DATA)
+      .value(event.get())
+      .field(SNOWPLOW_SCHEMA, SNOWPLOW_SCHEMA_UNSTRUCT_EVENT)
+      .end_object();
+  p.add_serialized_json(writer.str(), use_base64, SNOWPLOW_UNSTRUCTURED_ENCODED, SNOWPLOW_UNSTRUCTURED);
 
   return p;
 }
 
-vector<SelfDescribingJson> Event::get_context() const {
+EventPayload Event::get_serialized_self_describing_event_payload(const string &unstruct_event_json, bool use_base64) const {
+  EventPayload p;
+  p.add(SNOWPLOW_EVENT, SNOWPLOW_EVENT_SELF_DESCRIBING);
+  p.add_serialized_json(unstruct_event_json, use_base64, SNOWPLOW_UNSTRUCTURED_ENCODED, SNOWPLOW_UNSTRUCTURED);
+
+  return p;
+}
+
+const vector<SelfDescribingJson> &Event::get_context() const {
   return m_context;
 }
 
@@ -57,6 +74,18 @@ unsigned long long *Event::get_true_timestamp() const {
   return m_true_timestamp;
 }
 
+string Event::get_event_type() const {
+  return SNOWPLOW_EVENT_SELF_DESCRIBING;
+}
+
+string Event::get_schema() const {
+  return string();
+}
+
+int Event::get_priority() const {
+  return m_priority;
+}
+
 shared_ptr<Subject> Event::get_subject() const {
   return m_subject;
 }
@@ -74,3 +103,10 @@ void Event::set_context(const vector<SelfDescribingJson> &context) {
 void Event::set_subject(shared_ptr<Subject> subject) {
   m_subject = std::move(subject);
 }
+
+void Event::set_priority(int priority) {
+  if (priority < 0) {
+    throw invalid_argument("Event priority can't be negative");
+  }
+  m_priority = priority;
+}
@@ -37,9 +37,9 @@ public:
   Event();
 
   /**
-   * @return vector<SelfDescribingJson> Custom event context
+   * @return const vector<SelfDescribingJson>& Custom event context
    */
-  vector<SelfDescribingJson> get_context() const;
+  const vector<SelfDescribingJson> &get_context() const;
 
   /**
    * @return unsigned long long* Pointer to user-defined Unix timestamp or NULL if not set
@@ -48,6 +48,20 @@ public:
    */
   unsigned long long *get_true_timestamp() const;
 
+  /**
+   * @return string Event type as sent in the `e` property ("se" for structured events, "ue" for self-describing events)
+   *
+   * Used by event filters before the event payload is built.
+   */
+  virtual string get_event_type() const;
+
+  /**
+   * @return string Iglu schema of a self-describing event, empty for other event types
+   *
+   * Used by event filters before the event payload is built.
+   */
+  virtual string get_schema() const;
+
   /**
    * @brief Replace the custom context of the event with a new vector of self-describing JSONs.
    * 
@@ -71,6 +85,21 @@ public:
    */
   void set_subject(shared_ptr<Subject> subject);
 
+  /**
+   * @brief Set the priority lane of the event in the event queue.
+   *
+   * Events in higher lanes are sent first. Lower lanes still get a share of each batch
+   * (proportional to priority + 1) so that they are not starved during a long drain.
+   *
+   * @param priority Priority lane, 0 or greater (default: 0)
+   */
+  void set_priority(int priority);
+
+  /**
+   * @return int Priority lane of the event in the event queue
+   */
+  int get_priority() const;
+
 protected:
   /**
    * @brief This function is overriden by concrete event classes and returns payload with properties for the event types.
@@ -89,13 +118,23 @@ protected:
    */
   EventPayload get_self_describing_event_payload(const SelfDescribingJson &event, bool use_base64) const;
 
+  /**
+   * @brief Helper function to construct payload for a self-describing event given the serialized unstruct event envelope.
+   *
+   * @param unstruct_event_json Serialized unstruct event self-describing JSON wrapping the event schema and data
+   * @param use_base64 Whether to enable base 64 encoding for self-describing event body
+   * @return EventPayload Event payload
+   */
+  EventPayload get_serialized_self_describing_event_payload(const string &unstruct_event_json, bool use_base64) const;
+
 private:
-  EventPayload get_payload(bool use_base64) const;
+  EventPayload get_payload(bool use_base64, EventIdVersion event_id_version) const;
   shared_ptr<Subject> get_subject() const;
 
   unsigned long long *m_true_timestamp;
   vector<SelfDescribingJson> m_context;
   shared_ptr<Subject> m_subject;
+  int m_priority;
 
   friend class Tracker;
 };
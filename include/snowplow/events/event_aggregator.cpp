@@ -0,0 +1,135 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "event_aggregator.hpp"
+#include "../thirdparty/json.hpp"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+using namespace snowplow;
+using json = nlohmann::json;
+using std::invalid_argument;
+using std::lock_guard;
+
+string EventAggregate::get_property() const {
+  json property;
+  property["count"] = count;
+  if (value_count > 0) {
+    property["min"] = min;
+    property["max"] = max;
+  }
+  return property.dump();
+}
+
+EventAggregator::EventAggregator(const vector<pair<string, string>> &keys, unsigned long long window_ms, int capacity) :
+  m_keys(keys.begin(), keys.end()), m_window_ms(window_ms), m_capacity(capacity), m_occupied_slots(0), m_window_started_at(0) {
+  if (window_ms == 0) {
+    throw invalid_argument("Aggregation window must be greater than 0 ms");
+  }
+  if (capacity < 1) {
+    throw invalid_argument("Aggregation capacity must be at least 1");
+  }
+
+  // keep the load factor at or below 0.5 so that linear probing stays short
+  size_t slot_count = 1;
+  while (slot_count < (size_t)capacity * 2) {
+    slot_count <<= 1;
+  }
+  m_slots.resize(slot_count);
+}
+
+bool EventAggregator::aggregate(const Event &event, unsigned long long now_ms, const shared_ptr<Subject> &event_subject) {
+  auto structured_event = dynamic_cast<const StructuredEvent *>(&event);
+  if (!structured_event || m_keys.find({structured_event->category, structured_event->action}) == m_keys.end()) {
+    return false;
+  }
+
+  std::hash<string> hasher;
+  size_t hash = hasher(structured_event->category);
+  hash = hash * 31 + hasher(structured_event->action);
+  if (structured_event->label) {
+    hash = hash * 31 + hasher(*structured_event->label);
+  }
+
+  lock_guard<mutex> guard(m_access);
+  Slot *slot = find_slot(hash, structured_event->category, structured_event->action, structured_event->label);
+  if (!slot) {
+    return false;
+  }
+
+  EventAggregate &aggregate = slot->aggregate;
+  if (!slot->occupied) {
+    if (m_occupied_slots == 0) {
+      m_window_started_at = now_ms;
+    }
+    slot->occupied = true;
+    slot->hash = hash;
+    aggregate.category = structured_event->category;
+    aggregate.action = structured_event->action;
+    aggregate.has_label = structured_event->label != nullptr;
+    aggregate.label = aggregate.has_label ? *structured_event->label : string();
+    aggregate.context = event.get_context();
+    aggregate.subject = event_subject;
+    m_occupied_slots++;
+  }
+
+  aggregate.count++;
+  if (structured_event->value) {
+    double value = *structured_event->value;
+    aggregate.min = aggregate.value_count == 0 ? value : std::min(aggregate.min, value);
+    aggregate.max = aggregate.value_count == 0 ? value : std::max(aggregate.max, value);
+    aggregate.sum += value;
+    aggregate.value_count++;
+  }
+  return true;
+}
+
+vector<EventAggregate> EventAggregator::take_aggregates(unsigned long long now_ms, bool force) {
+  vector<EventAggregate> aggregates;
+  lock_guard<mutex> guard(m_access);
+  if (m_occupied_slots == 0 || (!force && now_ms < m_window_started_at + m_window_ms)) {
+    return aggregates;
+  }
+
+  aggregates.reserve(m_occupied_slots);
+  for (auto &slot : m_slots) {
+    if (slot.occupied) {
+      aggregates.push_back(std::move(slot.aggregate));
+      slot = Slot();
+    }
+  }
+  m_occupied_slots = 0;
+  return aggregates;
+}
+
+unsigned long long EventAggregator::get_window_end_ms() {
+  lock_guard<mutex> guard(m_access);
+  return m_occupied_slots == 0 ? 0 : m_window_started_at + m_window_ms;
+}
+
+EventAggregator::Slot *EventAggregator::find_slot(size_t hash, const string &category, const string &action, const string *label) {
+  size_t mask = m_slots.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    Slot &slot = m_slots[i];
+    if (!slot.occupied) {
+      // the key is not in the table, only insert it if there is capacity left
+      return m_occupied_slots < m_capacity ? &slot : nullptr;
+    }
+    const EventAggregate &aggregate = slot.aggregate;
+    if (slot.hash == hash && aggregate.category == category && aggregate.action == action &&
+        aggregate.has_label == (label != nullptr) && (!label || aggregate.label == *label)) {
+      return &slot;
+    }
+  }
+}
@@ -0,0 +1,128 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#ifndef EVENT_AGGREGATOR_H
+#define EVENT_AGGREGATOR_H
+
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "structured_event.hpp"
+
+namespace snowplow {
+
+using std::mutex;
+using std::pair;
+using std::set;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+/**
+ * @brief Summary of structured events with the same category, action and label tracked within a time window.
+ */
+struct EventAggregate {
+  string category;
+  string action;
+  string label;
+  bool has_label = false;
+  unsigned long long count = 0; // Number of aggregated events
+  unsigned long long value_count = 0; // Number of aggregated events that had a value
+  double sum = 0; // Sum of the event values
+  double min = 0; // Minimum of the event values
+  double max = 0; // Maximum of the event values
+  vector<SelfDescribingJson> context; // Context entities of the first aggregated event
+  shared_ptr<Subject> subject; // Event subject of the first aggregated event
+
+  /**
+   * @brief Build the property of the summary structured event.
+   *
+   * @return string JSON object with the count and the min and max of values (e.g., `{"count":3,"max":5.0,"min":1.0}`)
+   */
+  string get_property() const;
+};
+
+/**
+ * @brief Rolls up high-frequency structured events into one summary per category, action and label and time window.
+ *
+ * Only structured events with one of the configured category and action pairs are aggregated. The aggregates are kept
+ * in an open-addressing hash table with a fixed capacity allocated up front, so memory use is bounded regardless of
+ * the number of distinct labels. Events that don't fit into a full table are not aggregated.
+ */
+class EventAggregator {
+public:
+  /**
+   * @brief Construct a new Event Aggregator
+   *
+   * @param keys Category and action pairs of the structured events to aggregate
+   * @param window_ms Length of the aggregation window in milliseconds
+   * @param capacity Maximum number of distinct category, action and label combinations aggregated within a window
+   */
+  EventAggregator(const vector<pair<string, string>> &keys, unsigned long long window_ms, int capacity);
+
+  /**
+   * @brief Add the event to the current aggregation window if it is configured to be aggregated.
+   *
+   * @param event Tracked event
+   * @param now_ms Current Unix timestamp in milliseconds
+   * @param event_subject Subject set on the event, kept for the summary if it is the first event of its aggregate
+   * @return bool True if the event was aggregated, false if it should be tracked on its own
+   */
+  bool aggregate(const Event &event, unsigned long long now_ms, const shared_ptr<Subject> &event_subject = nullptr);
+
+  /**
+   * @brief Take the aggregates of the current window if it is over and start a new window.
+   *
+   * @param now_ms Current Unix timestamp in milliseconds
+   * @param force Take the aggregates even if the window isn't over yet (e.g., when flushing the tracker)
+   * @return vector<EventAggregate> Aggregates to track as summary events (empty if the window isn't over)
+   */
+  vector<EventAggregate> take_aggregates(unsigned long long now_ms, bool force = false);
+
+  /**
+   * @return unsigned long long Unix timestamp in milliseconds at which the current window is over (0 if no events are aggregated)
+   */
+  unsigned long long get_window_end_ms();
+
+  /**
+   * @return int Maximum number of distinct category, action and label combinations aggregated within a window
+   */
+  int get_capacity() const { return m_capacity; }
+
+  /**
+   * @return unsigned long long Length of the aggregation window in milliseconds
+   */
+  unsigned long long get_window_ms() const { return m_window_ms; }
+
+private:
+  struct Slot {
+    bool occupied = false;
+    size_t hash = 0;
+    EventAggregate aggregate;
+  };
+
+  set<pair<string, string>> m_keys;
+  unsigned long long m_window_ms;
+  int m_capacity;
+  vector<Slot> m_slots;
+  int m_occupied_slots;
+  unsigned long long m_window_started_at;
+  mutex m_access;
+
+  Slot *find_slot(size_t hash, const string &category, const string &action, const string *label);
+};
+} // namespace snowplow
+
+#endif
@@ -0,0 +1,119 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "event_filter.hpp"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+
+using namespace snowplow;
+using std::chrono::steady_clock;
+using std::invalid_argument;
+using std::lock_guard;
+using std::make_shared;
+using std::map;
+using std::mt19937_64;
+using std::mutex;
+using std::random_device;
+
+namespace {
+struct TokenBucket {
+  double tokens;
+  steady_clock::time_point refilled_at;
+};
+
+struct RateLimiterState {
+  mutex access;
+  map<string, TokenBucket> buckets;
+};
+
+double random_unit_interval() {
+  static thread_local mt19937_64 generator{random_device{}()};
+  return (generator() >> 11) * (1.0 / 9007199254740992.0);
+}
+} // namespace
+
+EventFilter EventFilters::sample(double rate, const string &event_type_or_schema) {
+  if (rate < 0 || rate > 1) {
+    throw invalid_argument("Sampling rate must be between 0 and 1");
+  }
+  return [rate, event_type_or_schema](const EventFilterInput &input) {
+    if (!matches(input, event_type_or_schema)) {
+      return true;
+    }
+    const string &user_id = input.user_id.empty() ? input.anonymous_user_id : input.user_id;
+    if (user_id.empty()) {
+      return random_unit_interval() < rate;
+    }
+    // the filter pattern is part of the key so that filters for different events sample independent user cohorts
+    return hash_to_unit_interval(user_id + '\x1f' + event_type_or_schema) < rate;
+  };
+}
+
+EventFilter EventFilters::rate_limit(double events_per_second, int burst, const string &event_type_or_schema) {
+  if (events_per_second <= 0) {
+    throw invalid_argument("Rate limit must be greater than 0 events per second");
+  }
+  if (burst < 1) {
+    throw invalid_argument("Rate limit burst must be at least 1 event");
+  }
+  auto state = make_shared<RateLimiterState>();
+  return [state, events_per_second, burst, event_type_or_schema](const EventFilterInput &input) {
+    if (!matches(input, event_type_or_schema)) {
+      return true;
+    }
+    const string &key = input.schema.empty() ? input.event_type : input.schema;
+    auto now = steady_clock::now();
+
+    lock_guard<mutex> guard(state->access);
+    auto it = state->buckets.find(key);
+    if (it == state->buckets.end()) {
+      it = state->buckets.insert({key, TokenBucket{(double)burst, now}}).first;
+    }
+    TokenBucket &bucket = it->second;
+    double elapsed_seconds = std::chrono::duration<double>(now - bucket.refilled_at).count();
+    bucket.tokens = std::min((double)burst, bucket.tokens + elapsed_seconds * events_per_second);
+    bucket.refilled_at = now;
+    if (bucket.tokens < 1) {
+      return false;
+    }
+    bucket.tokens -= 1;
+    return true;
+  };
+}
+
+bool EventFilters::matches(const EventFilterInput &input, const string &event_type_or_schema) {
+  if (event_type_or_schema.empty() || input.event_type == event_type_or_schema) {
+    return true;
+  }
+  return !input.schema.empty() && input.schema.compare(0, event_type_or_schema.size(), event_type_or_schema) == 0;
+}
+
+double EventFilters::hash_to_unit_interval(const string &key) {
+  // 64-bit FNV-1a followed by a splitmix64 finalizer to spread short keys over the whole range
+  unsigned long long hash = 14695981039346656037ULL;
+  for (unsigned char c : key) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  hash ^= hash >> 30;
+  hash *= 0xbf58476d1ce4e5b9ULL;
+  hash ^= hash >> 27;
+  hash *= 0x94d049bb133111ebULL;
+  hash ^= hash >> 31;
+  return (hash >> 11) * (1.0 / 9007199254740992.0);
+}
@@ -0,0 +1,97 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#ifndef EVENT_FILTER_H
+#define EVENT_FILTER_H
+
+#include <functional>
+#include <string>
+#include "event.hpp"
+
+namespace snowplow {
+
+using std::function;
+using std::string;
+
+/**
+ * @brief Cheap event properties that event filters are evaluated on before the event is serialized.
+ */
+struct EventFilterInput {
+  const Event &event; // The tracked event
+  string event_type; // Event type as sent in the `e` property (e.g., "se" or "ue")
+  string schema; // Iglu schema of self-describing events, empty for other event types
+  string user_id; // User ID from the event subject or tracker subject, empty if not set
+  string anonymous_user_id; // Persistent user ID of the client session, empty if client sessions are not enabled
+};
+
+/**
+ * @brief Predicate deciding whether a tracked event is kept (returns true) or dropped (returns false).
+ *
+ * Filters are called from the thread that tracks the event and must be thread-safe.
+ */
+typedef function<bool(const EventFilterInput &)> EventFilter;
+
+/**
+ * @brief Factory functions for the built-in event filters.
+ *
+ * The filters can be restricted to a subset of events using an event type (e.g., "se") or an Iglu schema prefix
+ * (e.g., "iglu:com.acme/" or "iglu:com.acme/click/jsonschema/1-0-0"). Events that don't match pass through the filter.
+ * An empty string matches all events.
+ */
+class EventFilters {
+public:
+  /**
+   * @brief Keep a fraction of the matching events.
+   *
+   * The sampling is deterministic for events with a user ID – all matching events of a user are either kept or dropped
+   * which keeps user journeys complete. Events without a user ID are sampled by the anonymous user ID of the client
+   * session instead, and only events without either are sampled randomly.
+   *
+   * @param rate Fraction of matching events to keep between 0 and 1
+   * @param event_type_or_schema Event type or Iglu schema prefix the filter applies to (all events if empty)
+   * @return EventFilter The sampling filter
+   */
+  static EventFilter sample(double rate, const string &event_type_or_schema = "");
+
+  /**
+   * @brief Limit the rate of matching events using a token bucket.
+   *
+   * Each event type and self-describing event schema is limited separately. Events over the limit are dropped.
+   *
+   * @param events_per_second Rate at which the bucket is refilled
+   * @param burst Maximum number of events that can be tracked at once (the bucket capacity)
+   * @param event_type_or_schema Event type or Iglu schema prefix the filter applies to (all events if empty)
+   * @return EventFilter The rate limiting filter
+   */
+  static EventFilter rate_limit(double events_per_second, int burst, const string &event_type_or_schema = "");
+
+  /**
+   * @brief Check whether the event matches the event type or Iglu schema prefix.
+   *
+   * @param input Event properties
+   * @param event_type_or_schema Event type or Iglu schema prefix (matches all events if empty)
+   * @return bool Whether the event matches
+   */
+  static bool matches(const EventFilterInput &input, const string &event_type_or_schema);
+
+  /**
+   * @brief Map a string to a uniformly distributed number between 0 (inclusive) and 1 (exclusive).
+   *
+   * @param key String to hash
+   * @return double Number between 0 and 1 that is always the same for the same key
+   */
+  static double hash_to_unit_interval(const string &key);
+};
+} // namespace snowplow
+
+#endif
@@ -21,6 +21,10 @@ ScreenViewEvent::ScreenViewEvent() {
   this->name = NULL;
 }
 
+string ScreenViewEvent::get_schema() const {
+  return SNOWPLOW_SCHEMA_SCREEN_VIEW;
+}
+
 EventPayload ScreenViewEvent::get_custom_event_payload(bool use_base64) const {
   if (name == NULL && id == NULL) {
     throw invalid_argument("Either name or id field must be set");
@@ -42,6 +42,8 @@ public:
    */
   string *id;
 
+  string get_schema() const override;
+
 protected:
   EventPayload get_custom_event_payload(bool use_base64) const override;
 };
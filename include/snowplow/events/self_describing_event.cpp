@@ -18,6 +18,10 @@ using namespace snowplow;
 SelfDescribingEvent::SelfDescribingEvent(const SelfDescribingJson &event) : event(event) {
 }
 
+string SelfDescribingEvent::get_schema() const {
+  return event.get_schema();
+}
+
 EventPayload SelfDescribingEvent::get_custom_event_payload(bool use_base64) const {
   return get_self_describing_event_payload(event, use_base64);
 }
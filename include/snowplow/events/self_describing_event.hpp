@@ -44,6 +44,8 @@ public:
    */
   SelfDescribingJson event; // required
 
+  string get_schema() const override;
+
 protected:
   EventPayload get_custom_event_payload(bool use_base64) const override;
 };
@@ -25,6 +25,10 @@ StructuredEvent::StructuredEvent(const string &category, const string &action) {
   this->value = NULL;
 }
 
+string StructuredEvent::get_event_type() const {
+  return SNOWPLOW_EVENT_STRUCTURED;
+}
+
 EventPayload StructuredEvent::get_custom_event_payload(bool use_base64) const {
   if (action == "") {
     throw invalid_argument("Action is required");
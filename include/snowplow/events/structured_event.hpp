@@ -63,6 +63,8 @@ public:
    */
   double *value;
 
+  string get_event_type() const override;
+
 protected:
   EventPayload get_custom_event_payload(bool use_base64) const override;
 };
@@ -23,6 +23,10 @@ TimingEvent::TimingEvent(const string &category, const string &variable, unsigne
   this->label = NULL;
 }
 
+string TimingEvent::get_schema() const {
+  return SNOWPLOW_SCHEMA_USER_TIMINGS;
+}
+
 EventPayload TimingEvent::get_custom_event_payload(bool use_base64) const {
   if (category == "") {
     throw invalid_argument("Category is required");
@@ -56,6 +56,8 @@ public:
    */
   string *label;
 
+  string get_schema() const override;
+
 protected:
   EventPayload get_custom_event_payload(bool use_base64) const override;
 };
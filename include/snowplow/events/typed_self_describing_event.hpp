@@ -0,0 +1,80 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#ifndef TYPED_SELF_DESCRIBING_EVENT_H
+#define TYPED_SELF_DESCRIBING_EVENT_H
+
+#include "event.hpp"
+#include "../payload/json_writer.hpp"
+
+namespace snowplow {
+/**
+ * @brief Self-describing event with a schema and fields declared at compile time.
+ *
+ * The event data type T declares its Iglu schema and serializes its own fields:
+ *
+ * ```cpp
+ * struct SaveGame {
+ *   static const char *schema() { return "iglu:com.example_company/save-game/jsonschema/1-0-2"; }
+ *
+ *   int level;
+ *   string save_id;
+ *   bool hard_mode;
+ *
+ *   void write(JsonWriter &writer) const {
+ *     writer.field("level", level).field("saveId", save_id).field("hardMode", hard_mode);
+ *   }
+ * };
+ * ```
+ *
+ * Unlike SelfDescribingEvent, the event body is written straight into the serialized `ue_pr`/`ue_px` value
+ * without building and copying an intermediate JSON tree.
+ *
+ * @tparam T Event data type with a static `schema()` and a `write(JsonWriter &) const` member function
+ */
+template <typename T>
+class TypedSelfDescribingEvent : public Event {
+public:
+  /**
+   * @brief Construct a new Typed Self Describing Event object
+   *
+   * @param data Properties of the event
+   */
+  TypedSelfDescribingEvent(const T &data) : data(data) {}
+
+  /**
+   * @brief Properties of the event
+   */
+  T data; // required
+
+  string get_schema() const override { return T::schema(); }
+
+protected:
+  EventPayload get_custom_event_payload(bool use_base64) const override {
+    JsonWriter writer;
+    writer.begin_object()
+        .field(SNOWPLOW_SCHEMA, SNOWPLOW_SCHEMA_UNSTRUCT_EVENT)
+        .key(SNOWPLOW_DATA)
+        .begin_object()
+        .field(SNOWPLOW_SCHEMA, T::schema())
+        .key(SNOWPLOW_DATA)
+        .begin_object();
+    data.write(writer);
+    writer.end_object().end_object().end_object();
+
+    return get_serialized_self_describing_event_payload(writer.str(), use_base64);
+  }
+};
+} // namespace snowplow
+
+#endif
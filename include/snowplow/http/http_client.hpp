@@ -14,7 +14,10 @@ See the Apache License Version 2.0 for the specific language governing permissio
 #ifndef HTTP_CLIENT_H
 #define HTTP_CLIENT_H
 
+#include <atomic>
+#include <chrono>
 #include <string>
+#include "../constants.hpp"
 #include "../cracked_url.hpp"
 #include "http_request_result.hpp"
 
@@ -25,22 +28,100 @@ using std::list;
 
 /**
  * @brief Abstract base class for HTTP client for making requests to Snowplow Collector. It is used by Emitter.
+ *
+ * Implementations should respect the configured timeouts and abort in-flight requests once `is_cancelled()` returns true.
+ * A timeout of 0 disables it.
  */
 class HttpClient {
 public:
   enum RequestMethod { POST, GET };
 
+  HttpClient() : m_connect_timeout_ms(SNOWPLOW_NETWORK_DEFAULT_CONNECT_TIMEOUT_MS),
+                 m_request_timeout_ms(SNOWPLOW_NETWORK_DEFAULT_REQUEST_TIMEOUT_MS),
+                 m_low_speed_limit(0),
+                 m_low_speed_timeout_ms(0),
+                 m_cancelled(false) {}
+
   virtual ~HttpClient() {}
 
+  /**
+   * @brief Set the maximum time to establish a connection to the collector.
+   *
+   * @param connect_timeout_ms Connect timeout in milliseconds (0 for no timeout)
+   */
+  void set_connect_timeout_ms(int connect_timeout_ms) { m_connect_timeout_ms = connect_timeout_ms; }
+
+  /**
+   * @brief Set the maximum total time of a request including connecting and reading the response.
+   *
+   * @param request_timeout_ms Request timeout in milliseconds (0 for no timeout)
+   */
+  void set_request_timeout_ms(int request_timeout_ms) { m_request_timeout_ms = request_timeout_ms; }
+
+  /**
+   * @brief Abort requests that transfer less than the given number of bytes per second for the given time.
+   *
+   * @param low_speed_limit Minimum transfer speed in bytes per second (0 to disable)
+   * @param low_speed_timeout_ms Time the transfer may stay below the limit in milliseconds
+   */
+  void set_low_speed_limit(int low_speed_limit, int low_speed_timeout_ms) {
+    m_low_speed_limit = low_speed_limit;
+    m_low_speed_timeout_ms = low_speed_timeout_ms;
+  }
+
+  int get_connect_timeout_ms() const { return m_connect_timeout_ms; }
+  int get_request_timeout_ms() const { return m_request_timeout_ms; }
+  int get_low_speed_limit() const { return m_low_speed_limit; }
+  int get_low_speed_timeout_ms() const { return m_low_speed_timeout_ms; }
+
+  /**
+   * @brief Abort in-flight requests and fail new ones until `resume_requests()` is called. Used by the Emitter when stopping.
+   */
+  virtual void cancel_requests() { m_cancelled = true; }
+
+  /**
+   * @brief Allow requests again after they were cancelled.
+   */
+  void resume_requests() { m_cancelled = false; }
+
+  bool is_cancelled() const { return m_cancelled; }
+
   HttpRequestResult http_post(const CrackedUrl url, const string &post_data, list<int> row_ids, bool oversize) {
-    return http_request(POST, url, "", post_data, row_ids, oversize);
+    return mark_cancelled(http_request(POST, url, "", post_data, row_ids, oversize));
   }
   HttpRequestResult http_get(const CrackedUrl url, const string &query_string, list<int> row_ids, bool oversize) {
-    return http_request(GET, url, query_string, "", row_ids, oversize);
+    return mark_cancelled(http_request(GET, url, query_string, "", row_ids, oversize));
   }
 
 protected:
+  /**
+   * @brief Deadline for a request starting now according to the request timeout.
+   *
+   * @return std::chrono::steady_clock::time_point Deadline or time_point::max() if there is no request timeout
+   */
+  std::chrono::steady_clock::time_point get_request_deadline() const {
+    if (m_request_timeout_ms <= 0) {
+      return std::chrono::steady_clock::time_point::max();
+    }
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds(m_request_timeout_ms);
+  }
+
   virtual HttpRequestResult http_request(const RequestMethod method, const CrackedUrl url, const string & query_string, const string & post_data, list<int> row_ids, bool oversize) = 0;
+
+private:
+  // requests that failed once cancelled were aborted (or never sent) rather than rejected by the collector
+  HttpRequestResult mark_cancelled(HttpRequestResult result) const {
+    if (!result.is_success() && is_cancelled()) {
+      result.set_cancelled();
+    }
+    return result;
+  }
+
+  int m_connect_timeout_ms;
+  int m_request_timeout_ms;
+  int m_low_speed_limit;
+  int m_low_speed_timeout_ms;
+  std::atomic<bool> m_cancelled;
 };
 }
 
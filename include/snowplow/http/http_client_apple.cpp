@@ -23,13 +23,26 @@ HttpRequestResult HttpClientApple::http_request(const RequestMethod method, Crac
     final_url += "?" + query_string;
   }
 
+  if (is_cancelled()) {
+    return HttpRequestResult(1, 0, row_ids, oversize);
+  }
+
+  string retry_after;
   int status_code = make_request(
     method == POST,
     final_url,
-    post_data
+    post_data,
+    get_connect_timeout_ms(),
+    get_request_timeout_ms(),
+    [this]() { return is_cancelled(); },
+    &retry_after
   );
 
-  return HttpRequestResult(0, status_code, row_ids, oversize);
+  HttpRequestResult result(0, status_code, row_ids, oversize);
+  if (!retry_after.empty()) {
+    result.set_retry_after(retry_after);
+  }
+  return result;
 }
 
 #endif
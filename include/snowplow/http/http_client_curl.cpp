@@ -35,7 +35,31 @@ static size_t write_data(void *data, size_t byte_size, size_t n_bytes, std::stri
   return byte_size * n_bytes;
 }
 
+// collects the value of the Retry-After response header
+static size_t read_retry_after_header(char *buffer, size_t byte_size, size_t n_items, std::string *retry_after) {
+  size_t length = byte_size * n_items;
+  static const char header_name[] = "retry-after:";
+  size_t name_length = sizeof(header_name) - 1;
+  if (length > name_length) {
+    bool matches = true;
+    for (size_t i = 0; i < name_length && matches; i++) {
+      matches = ::tolower(buffer[i]) == header_name[i];
+    }
+    if (matches) {
+      retry_after->assign(buffer + name_length, length - name_length);
+    }
+  }
+  return length;
+}
+
+// called periodically by curl during the transfer, returning non-zero aborts it
+static int abort_if_cancelled(void *client, curl_off_t /*dltotal*/, curl_off_t /*dlnow*/, curl_off_t /*ultotal*/, curl_off_t /*ulnow*/) {
+  return static_cast<HttpClientCurl *>(client)->is_cancelled() ? 1 : 0;
+}
+
 HttpRequestResult HttpClientCurl::http_request(const RequestMethod method, CrackedUrl url, const string &query_string, const string &post_data, list<int> row_ids, bool oversize) {
+  if (is_cancelled()) { return HttpRequestResult(CURLE_ABORTED_BY_CALLBACK, -1, row_ids, oversize); }
+
   CURL *curl = curl_easy_init();
   if (!curl) { return HttpRequestResult(1, -1, row_ids, oversize); }
 
@@ -70,9 +94,32 @@ HttpRequestResult HttpClientCurl::http_request(const RequestMethod method, Crack
     curl_easy_setopt(curl, CURLOPT_COOKIEJAR, m_cookie_file.c_str());
   }
 
+  // timeouts (signals can't be used to interrupt DNS lookups in a multi-threaded program)
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  if (get_connect_timeout_ms() > 0) {
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, long(get_connect_timeout_ms()));
+  }
+  if (get_request_timeout_ms() > 0) {
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, long(get_request_timeout_ms()));
+  }
+  if (get_low_speed_limit() > 0 && get_low_speed_timeout_ms() > 0) {
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, long(get_low_speed_limit()));
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, long((get_low_speed_timeout_ms() + 999) / 1000));
+  }
+
+  // Retry-After header
+  std::string retry_after;
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, read_retry_after_header);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, &retry_after);
+
+  // cancellation
+  curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, abort_if_cancelled);
+  curl_easy_setopt(curl, CURLOPT_XFERINFODATA, this);
+  curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+
   // send the request
   CURLcode res = curl_easy_perform(curl);
-  long status_code;
+  long status_code = -1;
   if (res == CURLE_OK) {
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status_code);
   }
@@ -81,7 +128,11 @@ HttpRequestResult HttpClientCurl::http_request(const RequestMethod method, Crack
   curl_easy_cleanup(curl);
   curl_slist_free_all(headers);
 
-  return HttpRequestResult(0, int(status_code), row_ids, oversize);
+  HttpRequestResult result(int(res), int(status_code), row_ids, oversize);
+  if (!retry_after.empty()) {
+    result.set_retry_after(retry_after);
+  }
+  return result;
 }
 
 #endif
@@ -20,6 +20,38 @@ using std::endl;
 
 const string HttpClientWindows::TRACKER_AGENT = string("Snowplow C++ Tracker (Win32)");
 
+void HttpClientWindows::cancel_requests() {
+  HttpClient::cancel_requests();
+
+  // closing a request handle makes blocking calls on it return with an error
+  std::lock_guard<std::mutex> guard(m_requests_mutex);
+  for (HINTERNET h_request : m_requests) {
+    InternetCloseHandle(h_request);
+  }
+  m_requests.clear();
+}
+
+bool HttpClientWindows::register_request(HINTERNET h_request) {
+  std::lock_guard<std::mutex> guard(m_requests_mutex);
+  if (is_cancelled()) {
+    return false;
+  }
+  m_requests.insert(h_request);
+  return true;
+}
+
+bool HttpClientWindows::unregister_request(HINTERNET h_request) {
+  std::lock_guard<std::mutex> guard(m_requests_mutex);
+  return m_requests.erase(h_request) > 0; // false if the handle was already closed by cancel_requests()
+}
+
+static void set_timeout_option(HINTERNET h_internet, DWORD option, int timeout_ms) {
+  if (timeout_ms > 0) {
+    DWORD timeout = DWORD(timeout_ms);
+    InternetSetOptionA(h_internet, option, &timeout, sizeof(timeout));
+  }
+}
+
 HttpRequestResult HttpClientWindows::http_request(const RequestMethod method, CrackedUrl url, const string &query_string, const string &post_data, list<int> row_ids, bool oversize) {
 
   HINTERNET h_internet = InternetOpenA(
@@ -33,6 +65,11 @@ HttpRequestResult HttpClientWindows::http_request(const RequestMethod method, Cr
     return HttpRequestResult(GetLastError(), 0, row_ids, oversize);
   }
 
+  // WinINet has no total request deadline, the send and receive timeouts apply to each blocking call
+  set_timeout_option(h_internet, INTERNET_OPTION_CONNECT_TIMEOUT, get_connect_timeout_ms());
+  set_timeout_option(h_internet, INTERNET_OPTION_SEND_TIMEOUT, get_request_timeout_ms());
+  set_timeout_option(h_internet, INTERNET_OPTION_RECEIVE_TIMEOUT, get_request_timeout_ms());
+
   unsigned int use_port = url.get_port();
   if (url.get_use_default_port()) {
     if (url.get_is_https()) {
@@ -93,14 +130,24 @@ HttpRequestResult HttpClientWindows::http_request(const RequestMethod method, Cr
     return HttpRequestResult(GetLastError(), 0, row_ids, oversize);
   }
 
+  if (!register_request(h_request)) {
+    InternetCloseHandle(h_request);
+    InternetCloseHandle(h_connect);
+    InternetCloseHandle(h_internet);
+    return HttpRequestResult(ERROR_INTERNET_OPERATION_CANCELLED, 0, row_ids, oversize);
+  }
+
   LPCSTR hdrs = "Content-Type: application/json; charset=utf-8";
   BOOL is_sent = HttpSendRequestA(h_request, hdrs, DWORD(strlen(hdrs)), post_buf, DWORD(post_buf_len));
 
   if (!is_sent) {
-    InternetCloseHandle(h_internet);
+    DWORD error = GetLastError();
+    if (unregister_request(h_request)) {
+      InternetCloseHandle(h_request);
+    }
     InternetCloseHandle(h_connect);
-    InternetCloseHandle(h_request);
-    return HttpRequestResult(GetLastError(), 0, row_ids, oversize);
+    InternetCloseHandle(h_internet);
+    return HttpRequestResult(error, 0, row_ids, oversize);
   }
 
   string response;
@@ -112,9 +159,19 @@ HttpRequestResult HttpClientWindows::http_request(const RequestMethod method, Cr
 
   while (is_more && bytes_read != 0) {
     is_more = InternetReadFile(h_request, buff, buf_len, &bytes_read);
+    if (!is_more) {
+      bytes_read = 0;
+    }
     response.append(buff, bytes_read);
   }
 
+  if (!unregister_request(h_request)) {
+    // cancelled while reading the response
+    InternetCloseHandle(h_connect);
+    InternetCloseHandle(h_internet);
+    return HttpRequestResult(ERROR_INTERNET_OPERATION_CANCELLED, 0, row_ids, oversize);
+  }
+
   DWORD http_status_code = 0;
   DWORD length = sizeof(DWORD);
   HttpQueryInfo(
@@ -124,11 +181,24 @@ HttpRequestResult HttpClientWindows::http_request(const RequestMethod method, Cr
       &length,
       NULL);
 
+  char retry_after[128] = {0};
+  DWORD retry_after_length = sizeof(retry_after) - 1;
+  BOOL has_retry_after = HttpQueryInfoA(
+      h_request,
+      HTTP_QUERY_RETRY_AFTER,
+      retry_after,
+      &retry_after_length,
+      NULL);
+
   InternetCloseHandle(h_request);
   InternetCloseHandle(h_connect);
   InternetCloseHandle(h_internet);
 
-  return HttpRequestResult(0, http_status_code, row_ids, oversize);
+  HttpRequestResult result(0, http_status_code, row_ids, oversize);
+  if (has_retry_after) {
+    result.set_retry_after(string(retry_after, retry_after_length));
+  }
+  return result;
 }
 
 #endif
@@ -15,6 +15,8 @@ See the Apache License Version 2.0 for the specific language governing permissio
 #define HTTP_CLIENT_WINDOWS_H
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
 
+#include <mutex>
+#include <set>
 #include <string>
 #include "http_client.hpp"
 
@@ -38,8 +40,20 @@ class HttpClientWindows : public HttpClient {
 public:
   static const string TRACKER_AGENT;
 
+  /**
+   * @brief Abort in-flight requests by closing their handles.
+   */
+  void cancel_requests();
+
 protected:
   HttpRequestResult http_request(const RequestMethod method, const CrackedUrl url, const string & query_string, const string & post_data, list<int> row_ids, bool oversize);
+
+private:
+  bool register_request(HINTERNET h_request);
+  bool unregister_request(HINTERNET h_request);
+
+  std::mutex m_requests_mutex;
+  std::set<HINTERNET> m_requests;
 };
 }
 
@@ -30,6 +30,14 @@ enum Protocol {
   HTTP,
   HTTPS
 };
+
+/**
+ * @brief Strategy for spreading requests across multiple Snowplow Collector endpoints.
+ */
+enum LoadBalancing {
+  ROUND_ROBIN,               // weighted round-robin
+  LEAST_OUTSTANDING_REQUESTS // endpoint with the fewest requests in flight relative to its weight
+};
 } // namespace snowplow
 
 #endif
@@ -13,6 +13,9 @@ See the Apache License Version 2.0 for the specific language governing permissio
 
 #include "http_request_result.hpp"
 #include "../constants.hpp"
+#include "../detail/utils/utils.hpp"
+#include <cstdio>
+#include <cstring>
 
 using namespace snowplow;
 
@@ -21,6 +24,8 @@ HttpRequestResult::HttpRequestResult() {
   m_internal_error_code = 0; // not an error
   m_http_response_code = 0; // not success, should retry
   m_row_ids = {};
+  m_retry_after_ms = 0;
+  m_is_cancelled = false;
 }
 
 HttpRequestResult::HttpRequestResult(int internal_error_code, int http_response_code, list<int> row_ids, bool oversize) {
@@ -28,6 +33,8 @@ HttpRequestResult::HttpRequestResult(int internal_error_code, int http_response_
   m_internal_error_code = internal_error_code;
   m_http_response_code = internal_error_code != 0 ? -1 : http_response_code;
   m_row_ids = row_ids;
+  m_retry_after_ms = 0;
+  m_is_cancelled = false;
 }
 
 int HttpRequestResult::get_http_response_code() const {
@@ -74,3 +81,54 @@ bool HttpRequestResult::should_retry(const map<int, bool> &custom_retry_for_stat
   // retry if status code is not in the list of no-retry status codes
   return SNOWPLOW_FAIL_NO_RETRY_HTTP_STATUS_CODES.find(get_http_response_code()) == SNOWPLOW_FAIL_NO_RETRY_HTTP_STATUS_CODES.end();
 }
+
+void HttpRequestResult::set_retry_after(const string &header_value) {
+  set_retry_after_ms(parse_retry_after_ms(header_value, Utils::get_unix_epoch_ms()));
+}
+
+// days since 1970-01-01 for the given date in the proleptic Gregorian calendar
+static long long days_from_civil(int year, int month, int day) {
+  year -= month <= 2;
+  int era = (year >= 0 ? year : year - 399) / 400;
+  int year_of_era = year - era * 400;
+  int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+  return (long long) era * 146097 + day_of_era - 719468;
+}
+
+long long HttpRequestResult::parse_retry_after_ms(const string &header_value, unsigned long long now_ms) {
+  size_t start = header_value.find_first_not_of(" \t");
+  if (start == string::npos) {
+    return 0;
+  }
+  string value = header_value.substr(start, header_value.find_last_not_of(" \t\r\n") - start + 1);
+
+  // delay-seconds
+  if (value.find_first_not_of("0123456789") == string::npos) {
+    if (value.size() > 9) {
+      return 0;
+    }
+    return std::stoll(value) * 1000;
+  }
+
+  // HTTP-date in the IMF-fixdate format, e.g. "Wed, 21 Oct 2015 07:28:00 GMT"
+  static const char *months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+  int day, year, hour, minute, second;
+  char month_name[4] = {0};
+  if (sscanf(value.c_str(), "%*3s, %2d %3s %4d %2d:%2d:%2d GMT", &day, month_name, &year, &hour, &minute, &second) != 6) {
+    return 0;
+  }
+  int month = 0;
+  for (int i = 0; i < 12; i++) {
+    if (strcmp(month_name, months[i]) == 0) {
+      month = i + 1;
+      break;
+    }
+  }
+  if (month == 0 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+    return 0;
+  }
+
+  long long date_ms = ((days_from_civil(year, month, day) * 24 + hour) * 60 + minute) * 60000LL + second * 1000LL;
+  return date_ms > (long long) now_ms ? date_ms - (long long) now_ms : 0;
+}
@@ -17,11 +17,13 @@ See the Apache License Version 2.0 for the specific language governing permissio
 #include <iostream>
 #include <list>
 #include <map>
+#include <string>
 
 namespace snowplow {
 
 using std::list;
 using std::map;
+using std::string;
 
 /**
  * @brief Response from HTTP requests to collector. To be used internally within tracker only.
@@ -35,6 +37,38 @@ public:
   bool is_success() const;
   bool should_retry(const map<int, bool> &custom_retry_for_status_codes) const;
 
+  /**
+   * @brief Set the time to wait before retrying as requested by the collector.
+   *
+   * @param retry_after_ms Delay in milliseconds (0 if not requested)
+   */
+  void set_retry_after_ms(long long retry_after_ms) { m_retry_after_ms = retry_after_ms > 0 ? retry_after_ms : 0; }
+
+  /**
+   * @brief Set the time to wait before retrying from the value of the Retry-After response header.
+   *
+   * @param header_value Either a number of seconds or an HTTP date
+   */
+  void set_retry_after(const string &header_value);
+
+  long long get_retry_after_ms() const { return m_retry_after_ms; }
+
+  /**
+   * @brief Mark the request as aborted by `HttpClient::cancel_requests()` before the collector responded.
+   */
+  void set_cancelled() { m_is_cancelled = true; }
+
+  bool is_cancelled() const { return m_is_cancelled; }
+
+  /**
+   * @brief Parse the value of a Retry-After header.
+   *
+   * @param header_value Either a number of seconds or an HTTP date (e.g., "Wed, 21 Oct 2015 07:28:00 GMT")
+   * @param now_ms Current time as Unix timestamp in milliseconds
+   * @return long long Delay in milliseconds, 0 if the value is invalid or in the past
+   */
+  static long long parse_retry_after_ms(const string &header_value, unsigned long long now_ms);
+
 private:
   bool is_internal_error() const;
 
@@ -42,6 +76,8 @@ private:
   int m_internal_error_code;
   list<int> m_row_ids;
   bool m_is_oversize;
+  long long m_retry_after_ms;
+  bool m_is_cancelled;
 };
 } // namespace snowplow
 
@@ -15,13 +15,17 @@ See the Apache License Version 2.0 for the specific language governing permissio
 #include "../detail/utils/utils.hpp"
 
 using namespace snowplow;
-using std::to_string;
 
-EventPayload::EventPayload() {
-  this->m_event_id = Utils::get_uuid4();
+// Event ID version of payloads constructed while an EventIdVersionScope is active on the thread
+static thread_local EventIdVersion scoped_event_id_version = UUID_V4;
+
+EventPayload::EventPayload() : EventPayload(scoped_event_id_version) {}
+
+EventPayload::EventPayload(EventIdVersion event_id_version) {
+  this->m_event_id = event_id_version == UUID_V7 ? Utils::get_uuid7() : Utils::get_uuid4();
   this->m_timestamp = Utils::get_unix_epoch_ms();
 
-  add(SNOWPLOW_TIMESTAMP, to_string(m_timestamp));
+  add(SNOWPLOW_TIMESTAMP, Utils::uint_to_string(m_timestamp));
   add(SNOWPLOW_EID, m_event_id);
 }
 
@@ -32,3 +36,11 @@ string EventPayload::get_event_id() const {
 unsigned long long EventPayload::get_timestamp() const {
   return m_timestamp;
 }
+
+EventPayload::EventIdVersionScope::EventIdVersionScope(EventIdVersion event_id_version) : m_previous(scoped_event_id_version) {
+  scoped_event_id_version = event_id_version;
+}
+
+EventPayload::EventIdVersionScope::~EventIdVersionScope() {
+  scoped_event_id_version = m_previous;
+}
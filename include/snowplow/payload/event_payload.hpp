@@ -21,6 +21,14 @@ namespace snowplow {
 
 using std::string;
 
+/**
+ * @brief Version of the UUIDs generated as event IDs.
+ */
+enum EventIdVersion {
+  UUID_V4, // Random UUID (default)
+  UUID_V7 // Time-ordered UUID prefixed with the Unix timestamp in milliseconds
+};
+
 /**
  * @brief Payload with event properties that is created for tracked events.
  * 
@@ -30,9 +38,18 @@ class EventPayload : public Payload {
 public:
   /**
    * @brief Construct a new Event Payload and initializes the event ID and device timestamp.
+   *
+   * The event ID uses the version configured in the tracker that is building the payload (UUID_V4 otherwise).
    */
   EventPayload();
 
+  /**
+   * @brief Construct a new Event Payload and initializes the event ID of the given version and device timestamp.
+   *
+   * @param event_id_version UUID version of the event ID
+   */
+  explicit EventPayload(EventIdVersion event_id_version);
+
   /**
    * @brief Get the event ID
    * 
@@ -48,8 +65,22 @@ public:
   unsigned long long get_timestamp() const;
 
 private:
+  /**
+   * @brief Sets the event ID version of payloads default-constructed on the current thread while in scope.
+   */
+  class EventIdVersionScope {
+  public:
+    explicit EventIdVersionScope(EventIdVersion event_id_version);
+    ~EventIdVersionScope();
+
+  private:
+    EventIdVersion m_previous;
+  };
+
   unsigned long long m_timestamp;
   string m_event_id;
+
+  friend class Event;
 };
 } // namespace snowplow
 
@@ -0,0 +1,207 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "json_writer.hpp"
+#include "../detail/utils/utils.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace snowplow;
+
+JsonWriter::JsonWriter(size_t reserve) : m_needs_comma(false) {
+  m_buffer.reserve(reserve);
+}
+
+void JsonWriter::write_separator() {
+  if (m_needs_comma) {
+    m_buffer += ',';
+  }
+}
+
+JsonWriter &JsonWriter::begin_object() {
+  write_separator();
+  m_buffer += '{';
+  m_needs_comma = false;
+  return *this;
+}
+
+JsonWriter &JsonWriter::end_object() {
+  m_buffer += '}';
+  m_needs_comma = true;
+  return *this;
+}
+
+JsonWriter &JsonWriter::begin_array() {
+  write_separator();
+  m_buffer += '[';
+  m_needs_comma = false;
+  return *this;
+}
+
+JsonWriter &JsonWriter::end_array() {
+  m_buffer += ']';
+  m_needs_comma = true;
+  return *this;
+}
+
+JsonWriter &JsonWriter::key(const string &name) {
+  write_separator();
+  write_string(name.data(), name.size());
+  m_buffer += ':';
+  m_needs_comma = false;
+  return *this;
+}
+
+JsonWriter &JsonWriter::value(const string &value) {
+  write_separator();
+  write_string(value.data(), value.size());
+  m_needs_comma = true;
+  return *this;
+}
+
+JsonWriter &JsonWriter::value(const char *value) {
+  if (value == NULL) {
+    return this->value(nullptr);
+  }
+  write_separator();
+  write_string(value, strlen(value));
+  m_needs_comma = true;
+  return *this;
+}
+
+JsonWriter &JsonWriter::value(bool value) {
+  write_separator();
+  m_buffer += value ? "true" : "false";
+  m_needs_comma = true;
+  return *this;
+}
+
+JsonWriter &JsonWriter::value(int value) {
+  return this->value((long long)value);
+}
+
+JsonWriter &JsonWriter::value(long value) {
+  return this->value((long long)value);
+}
+
+JsonWriter &JsonWriter::value(long long value) {
+  write_separator();
+  if (value < 0) {
+    m_buffer += '-';
+    m_buffer += Utils::uint_to_string(0ULL - (unsigned long long)value);
+  } else {
+    m_buffer += Utils::uint_to_string((unsigned long long)value);
+  }
+  m_needs_comma = true;
+  return *this;
+}
+
+JsonWriter &JsonWriter::value(unsigned int value) {
+  return this->value((unsigned long long)value);
+}
+
+JsonWriter &JsonWriter::value(unsigned long value) {
+  return this->value((unsigned long long)value);
+}
+
+JsonWriter &JsonWriter::value(unsigned long long value) {
+  write_separator();
+  m_buffer += Utils::uint_to_string(value);
+  m_needs_comma = true;
+  return *this;
+}
+
+JsonWriter &JsonWriter::value(double value) {
+  // like json::dump(), non-finite numbers are written as null
+  if (!std::isfinite(value)) {
+    return this->value(nullptr);
+  }
+  write_separator();
+
+  // use the shortest of the two precisions that reads back to the same value
+  char buffer[32];
+  int length = snprintf(buffer, sizeof(buffer), "%.15g", value);
+  if (strtod(buffer, NULL) != value) {
+    length = snprintf(buffer, sizeof(buffer), "%.17g", value);
+  }
+
+  bool has_fraction_or_exponent = false;
+  for (int i = 0; i < length; i++) {
+    if (buffer[i] == ',') {
+      buffer[i] = '.'; // locales with a decimal comma
+    }
+    if (buffer[i] == '.' || buffer[i] == 'e') {
+      has_fraction_or_exponent = true;
+    }
+  }
+  m_buffer.append(buffer, size_t(length));
+  if (!has_fraction_or_exponent) {
+    m_buffer += ".0";
+  }
+  m_needs_comma = true;
+  return *this;
+}
+
+JsonWriter &JsonWriter::value(std::nullptr_t) {
+  write_separator();
+  m_buffer += "null";
+  m_needs_comma = true;
+  return *this;
+}
+
+JsonWriter &JsonWriter::value(const json &value) {
+  write_separator();
+  m_buffer += value.dump();
+  m_needs_comma = true;
+  return *this;
+}
+
+JsonWriter &JsonWriter::raw_value(const string &serialized_json) {
+  write_separator();
+  m_buffer += serialized_json;
+  m_needs_comma = true;
+  return *this;
+}
+
+void JsonWriter::write_string(const char *data, size_t length) {
+  static const char hex_digits[] = "0123456789abcdef";
+
+  m_buffer += '"';
+  size_t run_start = 0;
+  for (size_t i = 0; i < length; i++) {
+    unsigned char c = (unsigned char)data[i];
+    if (c >= 0x20 && c != '"' && c != '\\') {
+      continue;
+    }
+
+    m_buffer.append(data + run_start, i - run_start);
+    run_start = i + 1;
+    switch (c) {
+    case '"': m_buffer += "\\\""; break;
+    case '\\': m_buffer += "\\\\"; break;
+    case '\b': m_buffer += "\\b"; break;
+    case '\f': m_buffer += "\\f"; break;
+    case '\n': m_buffer += "\\n"; break;
+    case '\r': m_buffer += "\\r"; break;
+    case '\t': m_buffer += "\\t"; break;
+    default: {
+      char escaped[6] = {'\\', 'u', '0', '0', hex_digits[c >> 4], hex_digits[c & 0x0f]};
+      m_buffer.append(escaped, 6);
+    }
+    }
+  }
+  m_buffer.append(data + run_start, length - run_start);
+  m_buffer += '"';
+}
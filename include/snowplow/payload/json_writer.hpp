@@ -0,0 +1,154 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include "../thirdparty/json.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace snowplow {
+
+using std::string;
+using std::vector;
+using json = nlohmann::json;
+
+/**
+ * @brief Streaming JSON writer that appends serialized JSON directly into a string buffer.
+ *
+ * Used to serialize typed self-describing events without building an intermediate JSON tree.
+ * Commas between members are inserted automatically, the caller is responsible for balancing objects and arrays.
+ * Output is compact and matches the formatting of `json::dump()`.
+ */
+class JsonWriter {
+public:
+  /**
+   * @brief Construct a new JSON writer
+   *
+   * @param reserve Number of bytes to reserve in the output buffer upfront
+   */
+  JsonWriter(size_t reserve = 256);
+
+  JsonWriter &begin_object();
+  JsonWriter &end_object();
+  JsonWriter &begin_array();
+  JsonWriter &end_array();
+
+  /**
+   * @brief Write the key of the next object member.
+   *
+   * @param name Member name
+   */
+  JsonWriter &key(const string &name);
+
+  JsonWriter &value(const string &value);
+  JsonWriter &value(const char *value);
+  JsonWriter &value(bool value);
+  JsonWriter &value(int value);
+  JsonWriter &value(long value);
+  JsonWriter &value(long long value);
+  JsonWriter &value(unsigned int value);
+  JsonWriter &value(unsigned long value);
+  JsonWriter &value(unsigned long long value);
+  JsonWriter &value(double value);
+  JsonWriter &value(std::nullptr_t);
+
+  /**
+   * @brief Write a JSON tree as the next value (for nested data without a typed representation).
+   *
+   * @param value JSON value
+   */
+  JsonWriter &value(const json &value);
+
+  /**
+   * @brief Write already serialized JSON as the next value without parsing or escaping it.
+   *
+   * @param serialized_json Valid serialized JSON value
+   */
+  JsonWriter &raw_value(const string &serialized_json);
+
+  /**
+   * @brief Write an object member.
+   *
+   * @param name Member name
+   * @param value Member value
+   */
+  template <typename T>
+  JsonWriter &field(const string &name, const T &value) {
+    key(name);
+    return this->value(value);
+  }
+
+  /**
+   * @brief Write an optional object member, the member is skipped if the pointer is NULL.
+   *
+   * @param name Member name
+   * @param value Pointer to the member value or NULL
+   */
+  template <typename T>
+  JsonWriter &field(const string &name, T *value) {
+    if (value != NULL) {
+      key(name);
+      this->value(*value);
+    }
+    return *this;
+  }
+
+  JsonWriter &field(const string &name, const char *value) {
+    key(name);
+    return this->value(value);
+  }
+
+  /**
+   * @brief Write an object member holding an array of values.
+   *
+   * @param name Member name
+   * @param values Array items
+   */
+  template <typename T>
+  JsonWriter &field(const string &name, const vector<T> &values) {
+    key(name);
+    begin_array();
+    for (const T &item : values) {
+      this->value(item);
+    }
+    return end_array();
+  }
+
+  /**
+   * @return string Serialized JSON written so far
+   */
+  const string &str() const { return m_buffer; }
+
+  /**
+   * @brief Move the serialized JSON out of the writer, leaving it empty.
+   *
+   * @return string Serialized JSON written so far
+   */
+  string release() {
+    m_needs_comma = false;
+    return std::move(m_buffer);
+  }
+
+private:
+  void write_separator();
+  void write_string(const char *data, size_t length);
+
+  string m_buffer;
+  bool m_needs_comma;
+};
+} // namespace snowplow
+
+#endif
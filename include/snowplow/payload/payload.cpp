@@ -17,36 +17,45 @@ See the Apache License Version 2.0 for the specific language governing permissio
 using namespace snowplow;
 using std::to_string;
 
-Payload::~Payload() {
-  this->m_pairs.clear();
-}
-
 void Payload::add(const string &key, const string &value) {
   if (!key.empty() && !value.empty()) {
     this->m_pairs[key] = value;
   }
 }
 
-void Payload::add_map(map<string, string> pairs) {
-  map<string, string>::iterator it;
-  for (it = pairs.begin(); it != pairs.end(); it++) {
-    this->add(it->first, it->second);
+void Payload::add(const string &key, string &&value) {
+  if (!key.empty() && !value.empty()) {
+    this->m_pairs[key] = std::move(value);
+  }
+}
+
+void Payload::add_map(const map<string, string> &pairs) {
+  for (auto const &pair : pairs) {
+    this->add(pair.first, pair.second);
   }
 }
 
 void Payload::add_payload(const Payload &p) {
-  this->add_map(p.get());
+  this->add_map(p.m_pairs);
+}
+
+void Payload::add_json(const json &j, bool base64Encode, const string &encoded, const string &not_encoded, bool url_safe) {
+  this->add_serialized_json(j.dump(), base64Encode, encoded, not_encoded, url_safe);
 }
 
-void Payload::add_json(const json &j, bool base64Encode, const string &encoded, const string &not_encoded) {
+void Payload::add_serialized_json(const string &json_str, bool base64Encode, const string &encoded, const string &not_encoded, bool url_safe) {
   if (base64Encode) {
-    string json_str = j.dump();
-    this->add(encoded, base64_encode((const unsigned char *)json_str.c_str(), unsigned(json_str.length())));
+    this->add(encoded, base64_encode((const unsigned char *)json_str.c_str(), unsigned(json_str.length()), url_safe));
   } else {
-    this->add(not_encoded, j.dump());
+    this->add(not_encoded, json_str);
   }
 }
 
 map<string, string> Payload::get() const {
   return m_pairs;
 }
+
+string Payload::get_value(const string &key) const {
+  auto it = m_pairs.find(key);
+  return it == m_pairs.end() ? string() : it->second;
+}
@@ -31,9 +31,9 @@ using json = nlohmann::json;
 class Payload {
 private:
   map<string, string> m_pairs;
+  int m_priority = 0;
 
 public:
-  ~Payload();
 
   /**
    * @brief Add a property to the payload.
@@ -43,12 +43,20 @@ public:
    */
   void add(const string &key, const string &value);
 
+  /**
+   * @brief Add a property to the payload, moving the value into it.
+   *
+   * @param key Property key
+   * @param value Property value
+   */
+  void add(const string &key, string &&value);
+
   /**
    * @brief Add a map of properties to the payload.
    *
    * @param pairs Key-value pairs
    */
-  void add_map(map<string, string> pairs);
+  void add_map(const map<string, string> &pairs);
 
   /**
    * @brief Add properties from another payload.
@@ -64,8 +72,20 @@ public:
    * @param base64Encode Should the data be base64 encoded
    * @param encoded Key for encoded data
    * @param not_encoded Key for not-encoded data
+   * @param url_safe Use the URL-safe base64 alphabet without padding
    */
-  void add_json(const json &j, bool base64Encode, const string &encoded, const string &not_encoded);
+  void add_json(const json &j, bool base64Encode, const string &encoded, const string &not_encoded, bool url_safe = false);
+
+  /**
+   * @brief Add already serialized self-describing JSON data to the payload.
+   *
+   * @param json_str Serialized self-describing JSON
+   * @param base64Encode Should the data be base64 encoded
+   * @param encoded Key for encoded data
+   * @param not_encoded Key for not-encoded data
+   * @param url_safe Use the URL-safe base64 alphabet without padding
+   */
+  void add_serialized_json(const string &json_str, bool base64Encode, const string &encoded, const string &not_encoded, bool url_safe = false);
 
   /**
    * @brief Get the payload key-value pairs.
@@ -73,6 +93,35 @@ public:
    * @return Payload as key-value pairs
    */
   map<string, string> get() const;
+
+  /**
+   * @brief Get the payload key-value pairs without copying them.
+   *
+   * @return const map<string, string>& Payload as key-value pairs, valid as long as the payload
+   */
+  const map<string, string> &get_pairs() const { return m_pairs; }
+
+  /**
+   * @brief Get the value of a single property without copying the payload.
+   *
+   * @param key Property key
+   * @return string Property value or empty string if not set
+   */
+  string get_value(const string &key) const;
+
+  /**
+   * @brief Set the priority lane of the event in the event queue. Not sent to the collector.
+   *
+   * @param priority Priority lane, higher lanes are sent first (default: 0)
+   */
+  void set_priority(int priority) { m_priority = priority; }
+
+  /**
+   * @brief Get the priority lane of the event in the event queue.
+   *
+   * @return int Priority lane
+   */
+  int get_priority() const { return m_priority; }
 };
 } // namespace snowplow
 
@@ -16,20 +16,23 @@ See the Apache License Version 2.0 for the specific language governing permissio
 using namespace snowplow;
 
 SelfDescribingJson::SelfDescribingJson(const string &schema, const json &data) {
-  json sdj;
-  sdj[SNOWPLOW_SCHEMA] = schema;
-  sdj[SNOWPLOW_DATA] = data;
-  this->m_json = sdj;
+  this->m_json[SNOWPLOW_SCHEMA] = schema;
+  this->m_json[SNOWPLOW_DATA] = data;
 }
 
-SelfDescribingJson::~SelfDescribingJson() {
-  this->m_json.clear();
+SelfDescribingJson::SelfDescribingJson(const string &schema, json &&data) {
+  this->m_json[SNOWPLOW_SCHEMA] = schema;
+  this->m_json[SNOWPLOW_DATA] = std::move(data);
 }
 
-json SelfDescribingJson::get() const {
+const json &SelfDescribingJson::get() const {
   return this->m_json;
 }
 
+string SelfDescribingJson::get_schema() const {
+  return this->m_json[SNOWPLOW_SCHEMA].get<string>();
+}
+
 string SelfDescribingJson::to_string() const {
   return this->m_json.dump();
 }
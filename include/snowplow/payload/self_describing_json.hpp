@@ -40,16 +40,26 @@ public:
   SelfDescribingJson(const string &schema, const json &data);
 
   /**
-   * @brief Destroy the Self Describing Json object
+   * @brief Construct a new Self Describing Json object, moving the data into it
+   *
+   * @param schema Iglu schema (e.g., "iglu:com.snowplowanalytics.snowplow/timing/jsonschema/1-0-0")
+   * @param data Data payload with unstructured set of properties
    */
-  ~SelfDescribingJson();
+  SelfDescribingJson(const string &schema, json &&data);
 
   /**
    * @brief Return the content of the self-describing JSON.
    * 
-   * @return json Content as a JSON object
+   * @return const json& Content as a JSON object
+   */
+  const json &get() const;
+
+  /**
+   * @brief Return the Iglu schema of the self-describing JSON.
+   *
+   * @return string Iglu schema URI
    */
-  json get() const;
+  string get_schema() const;
 
   /**
    * @brief Return the content of the self-describing JSON as string.
@@ -24,12 +24,14 @@ See the Apache License Version 2.0 for the specific language governing permissio
 
 // emitter
 #include "emitter/emitter.hpp"
+#include "emitter/fan_out_emitter.hpp"
 
 // storage
 #include "storage/event_row.hpp"
 #include "storage/event_store.hpp"
 #include "storage/session_store.hpp"
 #include "storage/sqlite_storage.hpp"
+#include "storage/sharded_sqlite_storage.hpp"
 
 // http
 #include "http/http_enums.hpp"
@@ -39,15 +41,19 @@ See the Apache License Version 2.0 for the specific language governing permissio
 #include "http/http_client_windows.hpp"
 
 // payload
+#include "payload/json_writer.hpp"
 #include "payload/payload.hpp"
 #include "payload/self_describing_json.hpp"
 
 // events
 #include "events/event.hpp"
+#include "events/event_aggregator.hpp"
+#include "events/event_filter.hpp"
 #include "events/screen_view_event.hpp"
 #include "events/self_describing_event.hpp"
 #include "events/structured_event.hpp"
 #include "events/timing_event.hpp"
+#include "events/typed_self_describing_event.hpp"
 
 // configuration
 #include "configuration/tracker_configuration.hpp"
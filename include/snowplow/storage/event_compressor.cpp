@@ -0,0 +1,256 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "event_compressor.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef SNOWPLOW_USE_ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif
+
+using namespace snowplow;
+using std::lock_guard;
+using std::runtime_error;
+
+// first byte of compressed payloads, binary encoded payloads start with 1 and JSON payloads with '{'
+static const unsigned char compressed_payload_version = 2;
+
+#ifdef SNOWPLOW_USE_ZSTD
+static const int compression_level = ZSTD_CLEVEL_DEFAULT;
+#endif
+
+EventCompressor::EventCompressor() : m_dictionary_id(0) {}
+
+EventCompressor::~EventCompressor() {
+#ifdef SNOWPLOW_USE_ZSTD
+  for (ZSTD_CCtx *context : this->m_compression_contexts) {
+    ZSTD_freeCCtx(context);
+  }
+  for (ZSTD_DCtx *context : this->m_decompression_contexts) {
+    ZSTD_freeDCtx(context);
+  }
+#endif
+}
+
+bool EventCompressor::is_available() {
+#ifdef SNOWPLOW_USE_ZSTD
+  return true;
+#else
+  return false;
+#endif
+}
+
+string EventCompressor::train_dictionary(const vector<string> &samples, size_t max_size) {
+#ifdef SNOWPLOW_USE_ZSTD
+  if (samples.empty() || max_size == 0) {
+    return "";
+  }
+
+  string samples_buffer;
+  vector<size_t> sample_sizes;
+  sample_sizes.reserve(samples.size());
+  for (auto const &sample : samples) {
+    samples_buffer.append(sample);
+    sample_sizes.push_back(sample.size());
+  }
+
+  string dictionary(max_size, '\0');
+  size_t size = ZDICT_trainFromBuffer(&dictionary[0], max_size, samples_buffer.data(), sample_sizes.data(), unsigned(sample_sizes.size()));
+  if (!ZDICT_isError(size)) {
+    dictionary.resize(size);
+    return dictionary;
+  }
+
+  // zstd treats content without the dictionary magic number as raw content to reference, the end of it is referenced most cheaply
+  size_t raw_size = std::min(max_size, samples_buffer.size());
+  return samples_buffer.substr(samples_buffer.size() - raw_size);
+#else
+  (void)samples;
+  (void)max_size;
+  return "";
+#endif
+}
+
+bool EventCompressor::is_compressed(const char *data, size_t length) {
+  return length > 0 && (unsigned char)data[0] == compressed_payload_version;
+}
+
+int EventCompressor::get_dictionary_id(const char *data, size_t length) {
+  if (!is_compressed(data, length)) {
+    return -1;
+  }
+  int dictionary_id = 0;
+  for (size_t i = 1, shift = 0; i < length && shift < 28; i++, shift += 7) {
+    unsigned char byte = (unsigned char)data[i];
+    dictionary_id |= int(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return dictionary_id;
+    }
+  }
+  return -1;
+}
+
+string EventCompressor::get_header(int dictionary_id) {
+  string header(1, char(compressed_payload_version));
+  unsigned int value = (unsigned int)dictionary_id;
+  while (value >= 0x80) {
+    header.push_back(char((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  header.push_back(char(value));
+  return header;
+}
+
+void EventCompressor::set_compression_dictionary(int dictionary_id, const string &dictionary) {
+#ifdef SNOWPLOW_USE_ZSTD
+  shared_ptr<ZSTD_CDict> compression_dictionary(ZSTD_createCDict(dictionary.data(), dictionary.size(), compression_level), ZSTD_freeCDict);
+  if (!compression_dictionary) {
+    throw runtime_error("Failed to load compression dictionary " + std::to_string(dictionary_id));
+  }
+  add_decompression_dictionary(dictionary_id, dictionary);
+
+  lock_guard<mutex> guard(this->m_access);
+  this->m_dictionary_id = dictionary_id;
+  this->m_compression_dictionary = compression_dictionary;
+#else
+  (void)dictionary_id;
+  (void)dictionary;
+  throw runtime_error("Event compression requires the tracker to be built with SNOWPLOW_USE_ZSTD");
+#endif
+}
+
+void EventCompressor::add_decompression_dictionary(int dictionary_id, const string &dictionary) {
+#ifdef SNOWPLOW_USE_ZSTD
+  shared_ptr<ZSTD_DDict> decompression_dictionary(ZSTD_createDDict(dictionary.data(), dictionary.size()), ZSTD_freeDDict);
+  if (!decompression_dictionary) {
+    throw runtime_error("Failed to load decompression dictionary " + std::to_string(dictionary_id));
+  }
+
+  lock_guard<mutex> guard(this->m_access);
+  this->m_decompression_dictionaries[dictionary_id] = decompression_dictionary;
+#else
+  (void)dictionary_id;
+  (void)dictionary;
+#endif
+}
+
+void EventCompressor::remove_decompression_dictionary(int dictionary_id) {
+  lock_guard<mutex> guard(this->m_access);
+  this->m_decompression_dictionaries.erase(dictionary_id);
+}
+
+bool EventCompressor::has_decompression_dictionary(int dictionary_id) const {
+  lock_guard<mutex> guard(this->m_access);
+  return this->m_decompression_dictionaries.count(dictionary_id) > 0;
+}
+
+int EventCompressor::get_compression_dictionary_id() const {
+  lock_guard<mutex> guard(this->m_access);
+  return this->m_dictionary_id;
+}
+
+string EventCompressor::compress(const string &payload) const {
+#ifdef SNOWPLOW_USE_ZSTD
+  int dictionary_id;
+  shared_ptr<ZSTD_CDict> dictionary;
+  ZSTD_CCtx *context = NULL;
+  {
+    lock_guard<mutex> guard(this->m_access);
+    dictionary_id = this->m_dictionary_id;
+    dictionary = this->m_compression_dictionary;
+    if (dictionary && !this->m_compression_contexts.empty()) {
+      context = this->m_compression_contexts.back();
+      this->m_compression_contexts.pop_back();
+    }
+  }
+  if (!dictionary) {
+    return payload;
+  }
+  if (!context && !(context = ZSTD_createCCtx())) {
+    throw runtime_error("Failed to create compression context");
+  }
+
+  // the dictionary ID is part of our header so it is left out of the frame
+  string compressed = get_header(dictionary_id);
+  size_t header_size = compressed.size();
+  compressed.resize(header_size + ZSTD_compressBound(payload.size()));
+  ZSTD_CCtx_reset(context, ZSTD_reset_session_and_parameters);
+  ZSTD_CCtx_setParameter(context, ZSTD_c_dictIDFlag, 0);
+  ZSTD_CCtx_refCDict(context, dictionary.get());
+  size_t size = ZSTD_compress2(context, &compressed[header_size], compressed.size() - header_size, payload.data(), payload.size());
+  ZSTD_CCtx_refCDict(context, NULL);
+  {
+    lock_guard<mutex> guard(this->m_access);
+    this->m_compression_contexts.push_back(context);
+  }
+  if (ZSTD_isError(size)) {
+    throw runtime_error(string("Failed to compress payload: ") + ZSTD_getErrorName(size));
+  }
+  compressed.resize(header_size + size);
+  return compressed;
+#else
+  return payload;
+#endif
+}
+
+string EventCompressor::decompress(const char *data, size_t length) const {
+  int dictionary_id = get_dictionary_id(data, length);
+  if (dictionary_id < 0) {
+    throw runtime_error("Invalid compressed payload");
+  }
+#ifdef SNOWPLOW_USE_ZSTD
+  size_t header_size = get_header(dictionary_id).size();
+  const char *frame = data + header_size;
+  size_t frame_size = length - header_size;
+
+  unsigned long long content_size = ZSTD_getFrameContentSize(frame, frame_size);
+  if (content_size == ZSTD_CONTENTSIZE_ERROR || content_size == ZSTD_CONTENTSIZE_UNKNOWN) {
+    throw runtime_error("Invalid compressed payload");
+  }
+
+  shared_ptr<ZSTD_DDict> dictionary;
+  ZSTD_DCtx *context = NULL;
+  {
+    lock_guard<mutex> guard(this->m_access);
+    auto it = this->m_decompression_dictionaries.find(dictionary_id);
+    if (it == this->m_decompression_dictionaries.end()) {
+      throw runtime_error("Missing dictionary " + std::to_string(dictionary_id) + " for compressed payload");
+    }
+    dictionary = it->second;
+    if (!this->m_decompression_contexts.empty()) {
+      context = this->m_decompression_contexts.back();
+      this->m_decompression_contexts.pop_back();
+    }
+  }
+  if (!context && !(context = ZSTD_createDCtx())) {
+    throw runtime_error("Failed to create decompression context");
+  }
+
+  string payload(size_t(content_size), '\0');
+  size_t size = ZSTD_decompress_usingDDict(context, &payload[0], payload.size(), frame, frame_size, dictionary.get());
+  {
+    lock_guard<mutex> guard(this->m_access);
+    this->m_decompression_contexts.push_back(context);
+  }
+  if (ZSTD_isError(size)) {
+    throw runtime_error(string("Failed to decompress payload: ") + ZSTD_getErrorName(size));
+  }
+  payload.resize(size);
+  return payload;
+#else
+  throw runtime_error("Reading compressed events requires the tracker to be built with SNOWPLOW_USE_ZSTD");
+#endif
+}
@@ -0,0 +1,139 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#ifndef EVENT_COMPRESSOR_H
+#define EVENT_COMPRESSOR_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+extern "C" {
+typedef struct ZSTD_CCtx_s ZSTD_CCtx;
+typedef struct ZSTD_DCtx_s ZSTD_DCtx;
+typedef struct ZSTD_CDict_s ZSTD_CDict;
+typedef struct ZSTD_DDict_s ZSTD_DDict;
+}
+
+namespace snowplow {
+
+using std::map;
+using std::mutex;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+/**
+ * @brief Compresses stored event payloads with a zstd dictionary trained on previously stored events.
+ *
+ * Compressed payloads start with a version byte that distinguishes them from JSON and binary encoded payloads,
+ * followed by the ID of the dictionary (as a varint) and a zstd frame. Several dictionaries may be registered
+ * for decompression so that payloads compressed before a dictionary was retrained remain readable.
+ * Compression is only available if the tracker is built with the SNOWPLOW_USE_ZSTD CMake option.
+ */
+class EventCompressor {
+public:
+  EventCompressor();
+  ~EventCompressor();
+
+  EventCompressor(const EventCompressor &) = delete;
+  EventCompressor &operator=(const EventCompressor &) = delete;
+
+  /**
+   * @return true if the tracker was built with zstd support.
+   */
+  static bool is_available();
+
+  /**
+   * @brief Train a dictionary from sample payloads.
+   *
+   * Falls back to a raw content dictionary made of the latest samples if zstd training fails (e.g., too few samples).
+   *
+   * @param samples Sample payloads, most recent last
+   * @param max_size Maximum size of the dictionary in bytes
+   * @return string Dictionary content, empty if zstd is not available or there are no samples
+   */
+  static string train_dictionary(const vector<string> &samples, size_t max_size);
+
+  /**
+   * @brief Check whether the payload was compressed by an EventCompressor.
+   */
+  static bool is_compressed(const char *data, size_t length);
+
+  /**
+   * @brief Read the ID of the dictionary used to compress the payload.
+   *
+   * @return int Dictionary ID, -1 if the payload is not compressed or its header is truncated
+   */
+  static int get_dictionary_id(const char *data, size_t length);
+
+  /**
+   * @brief Prefix that compressed payloads using the dictionary start with.
+   */
+  static string get_header(int dictionary_id);
+
+  /**
+   * @brief Use the dictionary to compress new payloads and register it for decompression.
+   *
+   * @param dictionary_id ID of the dictionary (greater than 0), stored in the header of compressed payloads
+   * @param dictionary Dictionary content
+   */
+  void set_compression_dictionary(int dictionary_id, const string &dictionary);
+
+  /**
+   * @brief Register a dictionary used to decompress payloads.
+   */
+  void add_decompression_dictionary(int dictionary_id, const string &dictionary);
+
+  /**
+   * @brief Forget a dictionary that no stored payloads refer to.
+   */
+  void remove_decompression_dictionary(int dictionary_id);
+
+  bool has_decompression_dictionary(int dictionary_id) const;
+
+  /**
+   * @return int ID of the dictionary used for compression, 0 if none is set.
+   */
+  int get_compression_dictionary_id() const;
+
+  /**
+   * @brief Compress the payload using the current dictionary.
+   *
+   * @param payload Serialized event payload
+   * @return string Compressed payload, or the given payload unchanged if no dictionary is set
+   */
+  string compress(const string &payload) const;
+
+  /**
+   * @brief Decompress a payload returned by compress().
+   *
+   * Throws runtime_error if the payload is corrupted or its dictionary is not registered.
+   *
+   * @return string Serialized event payload
+   */
+  string decompress(const char *data, size_t length) const;
+
+private:
+  mutable mutex m_access; // guards the dictionaries and the idle contexts, not the (de)compression itself
+  int m_dictionary_id;
+  shared_ptr<ZSTD_CDict> m_compression_dictionary;
+  map<int, shared_ptr<ZSTD_DDict>> m_decompression_dictionaries;
+  mutable vector<ZSTD_CCtx *> m_compression_contexts; // idle contexts reused across calls
+  mutable vector<ZSTD_DCtx *> m_decompression_contexts;
+};
+} // namespace snowplow
+
+#endif
@@ -20,6 +20,8 @@ namespace snowplow {
 struct EventRow {
   int id;
   Payload event;
+  int attempts = 0; // number of failed attempts to send the event
+  int priority = 0; // priority lane of the event
 };
 } // namespace snowplow
 
@@ -16,10 +16,14 @@ See the Apache License Version 2.0 for the specific language governing permissio
 
 #include "event_row.hpp"
 #include <list>
+#include <set>
+#include <string>
 
 namespace snowplow {
 
 using std::list;
+using std::set;
+using std::string;
 
 /**
  * @brief Storage interface used by the Emitter to store and access events.
@@ -34,6 +38,42 @@ struct EventStore {
    */
   virtual void add_event(const Payload &payload) = 0;
 
+  /**
+   * @brief Insert event payload that was already serialized into event queue.
+   *
+   * Lets emitters that add the same event to several event stores serialize it only once.
+   * The default implementation ignores the serialized payload and calls `add_event`.
+   *
+   * @param payload Event payload to store
+   * @param serialized_payload The payload serialized using `Utils::serialize_payload`
+   */
+  virtual void add_serialized_event(const Payload &payload, const string & /*serialized_payload*/) { add_event(payload); }
+
+  /**
+   * @brief Insert several event payloads into event queue.
+   *
+   * Stores may insert the payloads in a single transaction.
+   * The default implementation calls `add_event` for each payload.
+   *
+   * @param payloads Event payloads to store
+   */
+  virtual void add_events(const list<Payload> &payloads) {
+    for (auto const &payload : payloads) {
+      add_event(payload);
+    }
+  }
+
+  /**
+   * @brief Insert several event payloads that were already serialized into event queue.
+   *
+   * Lets emitters that add the same batch to several event stores serialize it only once.
+   * The default implementation ignores the serialized payloads and calls `add_events`.
+   *
+   * @param payloads Event payloads to store
+   * @param serialized_payloads The payloads serialized using `Utils::serialize_payload`, in the same order
+   */
+  virtual void add_serialized_events(const list<Payload> &payloads, const list<string> & /*serialized_payloads*/) { add_events(payloads); }
+
   /**
    * @brief Retrieve event rows from event queue up to the given limit.
    * 
@@ -42,6 +82,122 @@ struct EventStore {
    */
   virtual void get_event_rows_batch(list<EventRow> *event_list, int number_to_get) = 0;
 
+  /**
+   * @brief Register a failed attempt to send the event rows with the given IDs.
+   *
+   * Stores supporting retry scheduling increment the attempt count of the rows and skip them in
+   * `get_event_rows_batch` until the given time. The default implementation does nothing, in which case
+   * the rows are retried as soon as the Emitter retry delay allows and the max attempts setting has no effect.
+   *
+   * @param id_list List of event row IDs
+   * @param next_attempt_at_ms Unix timestamp in milliseconds before which the rows should not be sent again
+   */
+  virtual void record_failed_attempt(const list<int> & /*id_list*/, unsigned long long /*next_attempt_at_ms*/) {}
+
+  /**
+   * @brief Get the earliest next attempt time set by `record_failed_attempt` among the stored rows.
+   *
+   * @return unsigned long long Unix timestamp in milliseconds, 0 if no rows had failed attempts
+   */
+  virtual unsigned long long get_next_attempt_at_ms() { return 0; }
+
+  /**
+   * @brief Remove event rows that exhausted their attempts from the queue.
+   *
+   * The default implementation deletes the rows, stores may keep them in a dead-letter queue instead.
+   *
+   * @param id_list List of event row IDs
+   */
+  virtual void move_event_rows_to_dead_letter(const list<int> &id_list) {
+    delete_event_rows_with_ids(id_list);
+  }
+
+  /**
+   * @brief Get the number of events in the queue and their total size.
+   *
+   * Used by the Emitter to enforce queue size limits, so it should be cheap to call (e.g., maintained counters).
+   * The default implementation returns false, in which case queue size limits are not enforced.
+   *
+   * @param event_count Output number of stored events
+   * @param byte_size Output total size of the stored event payloads in bytes
+   * @return true if the queue size is known
+   */
+  virtual bool get_event_queue_size(unsigned long long * /*event_count*/, unsigned long long * /*byte_size*/) { return false; }
+
+  /**
+   * @brief Get the disk space taken by the store.
+   *
+   * Unlike the queue size, this includes space that removed events leave behind until `perform_maintenance` reclaims it.
+   * The default implementation returns false.
+   *
+   * @param file_byte_size Output size of the database file(s) in bytes
+   * @param wal_byte_size Output size of the write-ahead log file(s) in bytes (0 if the store doesn't use one)
+   * @return true if the sizes are known
+   */
+  virtual bool get_storage_size(unsigned long long * /*file_byte_size*/, unsigned long long * /*wal_byte_size*/) { return false; }
+
+  /**
+   * @brief Reclaim disk space left behind by removed events.
+   *
+   * Called by the Emitter on its sending thread after the queue drains, at most once per minute.
+   * Implementations should return quickly when there is little space to reclaim.
+   * The default implementation does nothing.
+   */
+  virtual void perform_maintenance() {}
+
+  /**
+   * @brief Remove the given number of oldest event rows from the queue, skipping rows with the given IDs.
+   *
+   * The Emitter excludes rows of requests in flight, as a new event could otherwise take over the ID of a removed row
+   * and be removed in its place once the request succeeds.
+   *
+   * @param number_to_delete Number of event rows to remove
+   * @param excluded_ids IDs of event rows to keep
+   */
+  virtual void delete_oldest_event_rows(int number_to_delete, const set<int> &excluded_ids) {
+    list<EventRow> rows;
+    get_event_rows_batch_excluding(&rows, number_to_delete, excluded_ids);
+    list<int> id_list;
+    for (auto const &row : rows) {
+      id_list.push_back(row.id);
+    }
+    delete_event_rows_with_ids(id_list);
+  }
+
+  /**
+   * @brief Remove a randomly chosen event row from the queue, skipping rows with the given IDs.
+   *
+   * The default implementation removes the oldest event row.
+   *
+   * @param excluded_ids IDs of event rows to keep
+   */
+  virtual void delete_random_event_row(const set<int> &excluded_ids) {
+    delete_oldest_event_rows(1, excluded_ids);
+  }
+
+  /**
+   * @brief Retrieve event rows from event queue up to the given limit, skipping rows with the given IDs.
+   *
+   * Used by the Emitter to select events that are not part of a request in flight.
+   * The default implementation filters the result of `get_event_rows_batch`.
+   *
+   * @param event_list Output event list to add event rows to
+   * @param number_to_get Maximum number of events to retrieve
+   * @param excluded_ids IDs of event rows to skip
+   */
+  virtual void get_event_rows_batch_excluding(list<EventRow> *event_list, int number_to_get, const set<int> &excluded_ids) {
+    list<EventRow> rows;
+    get_event_rows_batch(&rows, number_to_get + int(excluded_ids.size()));
+    for (auto &row : rows) {
+      if (int(event_list->size()) >= number_to_get) {
+        break;
+      }
+      if (excluded_ids.find(row.id) == excluded_ids.end()) {
+        event_list->push_back(std::move(row));
+      }
+    }
+  }
+
   /**
    * @brief Remove event rows with the given IDs.
    * 
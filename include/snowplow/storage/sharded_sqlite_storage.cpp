@@ -0,0 +1,365 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "sharded_sqlite_storage.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace snowplow;
+using std::invalid_argument;
+using std::lock_guard;
+using std::to_string;
+
+ShardedSqliteStorage::ShardedSqliteStorage(const string &db_name, int shard_count, ShardSelection shard_selection, EventEncoding event_encoding) :
+  m_shard_selection(shard_selection), m_random(std::random_device()()) {
+  if (shard_count < 1) {
+    throw invalid_argument("Number of shards must be greater than 0");
+  }
+  for (int shard = 0; shard < shard_count; shard++) {
+    m_shards.push_back(unique_ptr<SqliteStorage>(new SqliteStorage(get_shard_db_name(db_name, shard), event_encoding)));
+  }
+}
+
+string ShardedSqliteStorage::get_shard_db_name(const string &db_name, int shard) {
+  size_t extension = db_name.find_last_of('.');
+  size_t directory = db_name.find_last_of("/\\");
+  if (extension == string::npos || (directory != string::npos && extension < directory)) {
+    return db_name + "-" + to_string(shard);
+  }
+  return db_name.substr(0, extension) + "-" + to_string(shard) + db_name.substr(extension);
+}
+
+// --- INSERT
+
+void ShardedSqliteStorage::add_event(const Payload &payload) {
+  m_shards[get_insert_shard()]->add_event(payload);
+}
+
+void ShardedSqliteStorage::add_serialized_event(const Payload &payload, const string &serialized_payload) {
+  m_shards[get_insert_shard()]->add_serialized_event(payload, serialized_payload);
+}
+
+void ShardedSqliteStorage::add_events(const list<Payload> &payloads) {
+  // the batch goes to a single shard to keep it in one transaction
+  m_shards[get_insert_shard()]->add_events(payloads);
+}
+
+void ShardedSqliteStorage::add_serialized_events(const list<Payload> &payloads, const list<string> &serialized_payloads) {
+  m_shards[get_insert_shard()]->add_serialized_events(payloads, serialized_payloads);
+}
+
+void ShardedSqliteStorage::set_session(const json &session_data) {
+  m_shards.front()->set_session(session_data);
+}
+
+// --- SELECT
+
+void ShardedSqliteStorage::get_all_event_rows(list<EventRow> *event_list) {
+  for (int shard = 0; shard < get_shard_count(); shard++) {
+    list<EventRow> rows;
+    m_shards[shard]->get_all_event_rows(&rows);
+    add_shard_rows(shard, &rows, event_list);
+  }
+}
+
+void ShardedSqliteStorage::get_event_rows_batch(list<EventRow> *event_list, int number_to_get) {
+  get_event_rows_batch_excluding(event_list, number_to_get, set<int>());
+}
+
+void ShardedSqliteStorage::get_event_rows_batch_excluding(list<EventRow> *event_list, int number_to_get, const set<int> &excluded_ids) {
+  vector<set<int>> shard_excluded_ids = split_excluded_ids(excluded_ids);
+
+  // only the keys of each shard's batch are read, rows are decoded once the merged batch is known
+  vector<list<EventRow>> shard_rows(m_shards.size());
+  for (int shard = 0; shard < get_shard_count(); shard++) {
+    m_shards[shard]->get_event_row_keys_batch(&shard_rows[shard], number_to_get, shard_excluded_ids[shard]);
+  }
+  list<int> merged_ids = merge_shard_rows(shard_rows, number_to_get);
+
+  vector<list<int>> shard_id_lists = split_row_ids(merged_ids);
+  map<int, EventRow> rows_by_id;
+  for (int shard = 0; shard < get_shard_count(); shard++) {
+    list<EventRow> rows;
+    m_shards[shard]->get_event_rows_with_ids(shard_id_lists[shard], &rows);
+    for (auto &row : rows) {
+      row.id = encode_row_id(shard, row.id);
+      rows_by_id[row.id] = std::move(row);
+    }
+  }
+  for (int row_id : merged_ids) {
+    auto row = rows_by_id.find(row_id);
+    if (row != rows_by_id.end()) {
+      event_list->push_back(std::move(row->second));
+    }
+  }
+}
+
+unsigned long long ShardedSqliteStorage::get_next_attempt_at_ms() {
+  unsigned long long next_attempt_at_ms = 0;
+  for (auto const &shard : m_shards) {
+    unsigned long long shard_next_attempt_at_ms = shard->get_next_attempt_at_ms();
+    if (shard_next_attempt_at_ms > 0 && (next_attempt_at_ms == 0 || shard_next_attempt_at_ms < next_attempt_at_ms)) {
+      next_attempt_at_ms = shard_next_attempt_at_ms;
+    }
+  }
+  return next_attempt_at_ms;
+}
+
+bool ShardedSqliteStorage::get_event_queue_size(unsigned long long *event_count, unsigned long long *byte_size) {
+  *event_count = 0;
+  *byte_size = 0;
+  for (auto const &shard : m_shards) {
+    unsigned long long shard_event_count = 0;
+    unsigned long long shard_byte_size = 0;
+    shard->get_event_queue_size(&shard_event_count, &shard_byte_size);
+    *event_count += shard_event_count;
+    *byte_size += shard_byte_size;
+  }
+  return true;
+}
+
+bool ShardedSqliteStorage::get_storage_size(unsigned long long *file_byte_size, unsigned long long *wal_byte_size) {
+  *file_byte_size = 0;
+  *wal_byte_size = 0;
+  for (auto const &shard : m_shards) {
+    unsigned long long shard_file_byte_size = 0;
+    unsigned long long shard_wal_byte_size = 0;
+    if (!shard->get_storage_size(&shard_file_byte_size, &shard_wal_byte_size)) {
+      return false;
+    }
+    *file_byte_size += shard_file_byte_size;
+    *wal_byte_size += shard_wal_byte_size;
+  }
+  return true;
+}
+
+void ShardedSqliteStorage::perform_maintenance() {
+  for (auto const &shard : m_shards) {
+    shard->perform_maintenance();
+  }
+}
+
+void ShardedSqliteStorage::get_all_dead_letter_event_rows(list<EventRow> *event_list) {
+  for (int shard = 0; shard < get_shard_count(); shard++) {
+    list<EventRow> rows;
+    m_shards[shard]->get_all_dead_letter_event_rows(&rows);
+    add_shard_rows(shard, &rows, event_list);
+  }
+}
+
+unique_ptr<json> ShardedSqliteStorage::get_session() {
+  return m_shards.front()->get_session();
+}
+
+// --- UPDATE
+
+void ShardedSqliteStorage::record_failed_attempt(const list<int> &id_list, unsigned long long next_attempt_at_ms) {
+  vector<list<int>> shard_id_lists = split_row_ids(id_list);
+  for (int shard = 0; shard < get_shard_count(); shard++) {
+    if (!shard_id_lists[shard].empty()) {
+      m_shards[shard]->record_failed_attempt(shard_id_lists[shard], next_attempt_at_ms);
+    }
+  }
+}
+
+void ShardedSqliteStorage::move_event_rows_to_dead_letter(const list<int> &id_list) {
+  vector<list<int>> shard_id_lists = split_row_ids(id_list);
+  for (int shard = 0; shard < get_shard_count(); shard++) {
+    if (!shard_id_lists[shard].empty()) {
+      m_shards[shard]->move_event_rows_to_dead_letter(shard_id_lists[shard]);
+    }
+  }
+}
+
+// --- DELETE
+
+void ShardedSqliteStorage::delete_all_event_rows() {
+  for (auto const &shard : m_shards) {
+    shard->delete_all_event_rows();
+  }
+}
+
+void ShardedSqliteStorage::delete_event_rows_with_ids(const list<int> &id_list) {
+  vector<list<int>> shard_id_lists = split_row_ids(id_list);
+  for (int shard = 0; shard < get_shard_count(); shard++) {
+    if (!shard_id_lists[shard].empty()) {
+      m_shards[shard]->delete_event_rows_with_ids(shard_id_lists[shard]);
+    }
+  }
+}
+
+void ShardedSqliteStorage::delete_oldest_event_rows(int number_to_delete, const set<int> &excluded_ids) {
+  // there is no order of rows across shards, so the rows are taken from the largest shards to keep them balanced
+  vector<set<int>> shard_excluded_ids = split_excluded_ids(excluded_ids);
+  vector<unsigned long long> event_counts = get_deletable_event_counts(shard_excluded_ids);
+
+  vector<int> numbers_to_delete(m_shards.size());
+  for (int i = 0; i < number_to_delete; i++) {
+    int largest = int(std::max_element(event_counts.begin(), event_counts.end()) - event_counts.begin());
+    if (event_counts[largest] == 0) {
+      break;
+    }
+    event_counts[largest]--;
+    numbers_to_delete[largest]++;
+  }
+
+  for (int shard = 0; shard < get_shard_count(); shard++) {
+    if (numbers_to_delete[shard] > 0) {
+      m_shards[shard]->delete_oldest_event_rows(numbers_to_delete[shard], shard_excluded_ids[shard]);
+    }
+  }
+}
+
+void ShardedSqliteStorage::delete_random_event_row(const set<int> &excluded_ids) {
+  // the shard is chosen in proportion to its deletable rows so that each row is equally likely to be removed
+  vector<set<int>> shard_excluded_ids = split_excluded_ids(excluded_ids);
+  vector<unsigned long long> event_counts = get_deletable_event_counts(shard_excluded_ids);
+  unsigned long long total_event_count = 0;
+  for (unsigned long long event_count : event_counts) {
+    total_event_count += event_count;
+  }
+  if (total_event_count == 0) {
+    return;
+  }
+
+  unsigned long long row;
+  {
+    lock_guard<mutex> guard(m_random_access);
+    row = std::uniform_int_distribution<unsigned long long>(0, total_event_count - 1)(m_random);
+  }
+  for (int shard = 0; shard < get_shard_count(); shard++) {
+    if (row < event_counts[shard]) {
+      m_shards[shard]->delete_random_event_row(shard_excluded_ids[shard]);
+      return;
+    }
+    row -= event_counts[shard];
+  }
+}
+
+void ShardedSqliteStorage::delete_all_dead_letter_event_rows() {
+  for (auto const &shard : m_shards) {
+    shard->delete_all_dead_letter_event_rows();
+  }
+}
+
+void ShardedSqliteStorage::delete_session() {
+  m_shards.front()->delete_session();
+}
+
+// --- Private
+
+int ShardedSqliteStorage::get_insert_shard() {
+  if (m_shard_selection == SHARD_ROUND_ROBIN) {
+    return int(m_next_shard++ % m_shards.size());
+  }
+
+  // threads are numbered in the order they first insert so that concurrent threads use different shards
+  static std::atomic<unsigned int> next_thread_index{0};
+  static thread_local unsigned int thread_index = next_thread_index++;
+  return int(thread_index % m_shards.size());
+}
+
+int ShardedSqliteStorage::encode_row_id(int shard, int row_id) const {
+  return row_id * get_shard_count() + shard;
+}
+
+int ShardedSqliteStorage::get_row_shard(int row_id) const {
+  return row_id % get_shard_count();
+}
+
+int ShardedSqliteStorage::get_shard_row_id(int row_id) const {
+  return row_id / get_shard_count();
+}
+
+vector<list<int>> ShardedSqliteStorage::split_row_ids(const list<int> &id_list) const {
+  vector<list<int>> shard_id_lists(m_shards.size());
+  for (int row_id : id_list) {
+    shard_id_lists[get_row_shard(row_id)].push_back(get_shard_row_id(row_id));
+  }
+  return shard_id_lists;
+}
+
+vector<set<int>> ShardedSqliteStorage::split_excluded_ids(const set<int> &excluded_ids) const {
+  vector<set<int>> shard_excluded_ids(m_shards.size());
+  for (int row_id : excluded_ids) {
+    shard_excluded_ids[get_row_shard(row_id)].insert(get_shard_row_id(row_id));
+  }
+  return shard_excluded_ids;
+}
+
+// number of rows in each shard that are not excluded (excluded rows are expected to be stored)
+vector<unsigned long long> ShardedSqliteStorage::get_deletable_event_counts(const vector<set<int>> &shard_excluded_ids) const {
+  vector<unsigned long long> event_counts(m_shards.size());
+  for (int shard = 0; shard < get_shard_count(); shard++) {
+    unsigned long long byte_size = 0;
+    m_shards[shard]->get_event_queue_size(&event_counts[shard], &byte_size);
+    event_counts[shard] -= std::min(event_counts[shard], (unsigned long long) shard_excluded_ids[shard].size());
+  }
+  return event_counts;
+}
+
+void ShardedSqliteStorage::add_shard_rows(int shard, list<EventRow> *rows, list<EventRow> *event_list) const {
+  for (auto &row : *rows) {
+    row.id = encode_row_id(shard, row.id);
+  }
+  event_list->splice(event_list->end(), *rows);
+}
+
+// selects the batch with the same weighted-fair lane shares as a single SqliteStorage, taking the shards in turns
+// within a lane so that the batch includes the oldest rows of each shard
+list<int> ShardedSqliteStorage::merge_shard_rows(const vector<list<EventRow>> &shard_rows, int number_to_get) const {
+  // row IDs of each lane in each shard, in the order the shard selected them
+  map<int, vector<list<int>>> lane_shard_ids;
+  for (int shard = 0; shard < get_shard_count(); shard++) {
+    for (auto const &row : shard_rows[shard]) {
+      vector<list<int>> &shard_ids = lane_shard_ids[row.priority];
+      shard_ids.resize(m_shards.size());
+      shard_ids[shard].push_back(row.id);
+    }
+  }
+  int total_weight = 0;
+  for (auto const &lane : lane_shard_ids) {
+    total_weight += std::max(lane.first, 0) + 1;
+  }
+
+  list<int> merged_ids;
+  auto take_in_turns = [&](vector<list<int>> &shard_ids, int count) {
+    int taken = 0;
+    bool found = true;
+    while (taken < count && found) {
+      found = false;
+      for (int shard = 0; shard < get_shard_count() && taken < count; shard++) {
+        if (shard_ids[shard].empty()) {
+          continue;
+        }
+        merged_ids.push_back(encode_row_id(shard, shard_ids[shard].front()));
+        shard_ids[shard].pop_front();
+        taken++;
+        found = true;
+      }
+    }
+    return taken;
+  };
+
+  int remaining = number_to_get;
+  for (auto lane = lane_shard_ids.rbegin(); lane != lane_shard_ids.rend() && remaining > 0; ++lane) {
+    int share = std::min(remaining, std::max(1, number_to_get * (std::max(lane->first, 0) + 1) / total_weight));
+    remaining -= take_in_turns(lane->second, share);
+  }
+
+  // slots left by lanes with fewer eligible events go to the highest lanes
+  for (auto lane = lane_shard_ids.rbegin(); lane != lane_shard_ids.rend() && remaining > 0; ++lane) {
+    remaining -= take_in_turns(lane->second, remaining);
+  }
+  return merged_ids;
+}
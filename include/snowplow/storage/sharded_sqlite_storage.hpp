@@ -0,0 +1,124 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#ifndef SHARDED_SQLITE_STORAGE_H
+#define SHARDED_SQLITE_STORAGE_H
+
+#include "sqlite_storage.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace snowplow {
+
+using std::mutex;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+/**
+ * @brief How the ShardedSqliteStorage chooses the shard to insert events into.
+ */
+enum ShardSelection {
+  SHARD_BY_THREAD, // Each thread inserts into the same shard (default)
+  SHARD_ROUND_ROBIN // Events are spread evenly across the shards
+};
+
+/**
+ * @brief Event store that spreads the event queue across several SQLite database files.
+ *
+ * Each shard is a `SqliteStorage` with its own database file and connection, so inserts into different shards
+ * don't wait for each other. Event row IDs returned by the store encode the shard of the row. Rows retrieved
+ * in a batch are interleaved across the shards and priority lanes are served within each shard.
+ *
+ * Sessions are stored in the first shard.
+ */
+class ShardedSqliteStorage : public EventStore, public SessionStore {
+public:
+  /**
+   * @brief Construct a new Sharded Sqlite Storage object
+   *
+   * @param db_name Relative path to the SQLite database, shard database files are named by adding the shard number before its extension (e.g., "events-0.db")
+   * @param shard_count Number of shards (must be greater than 0)
+   * @param shard_selection How to choose the shard to insert events into
+   * @param event_encoding Format of newly stored event payloads (defaults to JSON)
+   */
+  ShardedSqliteStorage(const string &db_name, int shard_count, ShardSelection shard_selection = SHARD_BY_THREAD, EventEncoding event_encoding = JSON_ENCODING);
+
+  void add_event(const Payload &payload);
+  void add_serialized_event(const Payload &payload, const string &serialized_payload);
+  void add_events(const list<Payload> &payloads);
+  void add_serialized_events(const list<Payload> &payloads, const list<string> &serialized_payloads);
+  void get_all_event_rows(list<EventRow> *event_list);
+  void get_event_rows_batch(list<EventRow> *event_list, int number_to_get);
+  void get_event_rows_batch_excluding(list<EventRow> *event_list, int number_to_get, const set<int> &excluded_ids);
+  void delete_all_event_rows();
+  void delete_event_rows_with_ids(const list<int> &id_list);
+  void record_failed_attempt(const list<int> &id_list, unsigned long long next_attempt_at_ms);
+  unsigned long long get_next_attempt_at_ms();
+  void move_event_rows_to_dead_letter(const list<int> &id_list);
+  bool get_event_queue_size(unsigned long long *event_count, unsigned long long *byte_size);
+  bool get_storage_size(unsigned long long *file_byte_size, unsigned long long *wal_byte_size);
+  void perform_maintenance();
+  void delete_oldest_event_rows(int number_to_delete, const set<int> &excluded_ids);
+  void delete_random_event_row(const set<int> &excluded_ids);
+
+  /**
+   * @brief Retrieve events that were not sent within the maximum number of attempts from all shards.
+   *
+   * @param event_list Output event list to add dead-letter event rows to
+   */
+  void get_all_dead_letter_event_rows(list<EventRow> *event_list);
+  void delete_all_dead_letter_event_rows();
+
+  void set_session(const json &session_data);
+  unique_ptr<json> get_session();
+  void delete_session();
+
+  /**
+   * @return int Number of shards.
+   */
+  int get_shard_count() const { return int(m_shards.size()); }
+
+  /**
+   * @brief Get the path to the database file of a shard.
+   *
+   * @param db_name Relative path to the SQLite database passed to the constructor
+   * @param shard Shard number
+   * @return string Relative path to the shard database
+   */
+  static string get_shard_db_name(const string &db_name, int shard);
+
+private:
+  vector<unique_ptr<SqliteStorage>> m_shards;
+  ShardSelection m_shard_selection;
+  std::atomic<unsigned int> m_next_shard{0};
+  mutex m_random_access;
+  std::mt19937 m_random;
+
+  int get_insert_shard();
+  int encode_row_id(int shard, int row_id) const;
+  int get_row_shard(int row_id) const;
+  int get_shard_row_id(int row_id) const;
+  vector<list<int>> split_row_ids(const list<int> &id_list) const;
+  vector<set<int>> split_excluded_ids(const set<int> &excluded_ids) const;
+  vector<unsigned long long> get_deletable_event_counts(const vector<set<int>> &shard_excluded_ids) const;
+  void add_shard_rows(int shard, list<EventRow> *rows, list<EventRow> *event_list) const;
+  list<int> merge_shard_rows(const vector<list<EventRow>> &shard_rows, int number_to_get) const;
+};
+} // namespace snowplow
+
+#endif
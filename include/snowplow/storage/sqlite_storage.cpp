@@ -12,22 +12,52 @@ See the Apache License Version 2.0 for the specific language governing permissio
 */
 
 #include "sqlite_storage.hpp"
+#include "../detail/utils/allocation_probe.hpp"
 
 #include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <vector>
 #include "../detail/utils/utils.hpp"
 #include "../thirdparty/sqlite3.hpp"
 
 using namespace snowplow;
 using std::cerr;
 using std::endl;
+using std::invalid_argument;
 using std::lock_guard;
 using std::mutex;
 using std::runtime_error;
 using std::string;
+using std::unique_lock;
+using std::vector;
 
 const string db_table_events = "events";
 const string db_column_events_id = "id";
 const string db_column_events_data = "data";
+const string db_column_events_attempts = "attempts";
+const string db_column_events_next_attempt_at = "next_attempt_at";
+const string db_column_events_priority = "priority";
+
+const string db_table_dead_letter_events = "dead_letter_events";
+const string db_column_dead_letter_events_event_row_id = "event_row_id";
+const string db_column_dead_letter_events_failed_at = "failed_at";
+
+const string db_table_dictionaries = "dictionaries";
+const string db_column_dictionaries_id = "id";
+const string db_column_dictionaries_data = "data";
+const string db_column_dictionaries_trained_at = "trained_at";
+
+// number of recent events sampled to train a compression dictionary and the maximum size of the dictionary
+const int dictionary_sample_count = 1000;
+const size_t dictionary_max_size = 16 * 1024;
+
+// dictionaries are retrained daily, or when the compression ratio of a sample drops below this share of the first sample
+const unsigned long long dictionary_retrain_interval_ms = 24 * 60 * 60 * 1000ULL;
+const double dictionary_min_ratio_share = 0.8;
+
+// free pages and write-ahead log size below which maintenance isn't worth rewriting the database
+const unsigned long long maintenance_min_reclaimable_bytes = 1024 * 1024;
 
 const string db_table_session = "sessions";
 const string db_column_session_id = "id";
@@ -35,7 +65,12 @@ const string db_column_session_data = "data";
 
 // --- Constructor & Destructor
 
-SqliteStorage::SqliteStorage(const string &db_name) {
+SqliteStorage::SqliteStorage(const string &db_name, EventEncoding event_encoding) :
+    m_event_encoding(event_encoding), m_dictionary_trained_at_ms(0), m_dictionary_ratio(0), m_sample_event_count(0), m_sample_input_bytes(0), m_sample_output_bytes(0) {
+  if (event_encoding == COMPRESSED_ENCODING && !EventCompressor::is_available()) {
+    throw invalid_argument("COMPRESSED_ENCODING requires the tracker to be built with SNOWPLOW_USE_ZSTD");
+  }
+
   sqlite3 *db;
   char *err_msg = 0;
   int rc;
@@ -48,6 +83,11 @@ SqliteStorage::SqliteStorage(const string &db_name) {
   this->m_db_name = db_name;
   this->m_db = db;
 
+  // Let removed events' pages be returned to the file system. This only takes effect before the first table is created,
+  // so failures (e.g., another connection locking an existing database) are ignored and perform_maintenance() converts the database
+  string auto_vacuum_query = "PRAGMA auto_vacuum=INCREMENTAL;";
+  sqlite3_exec(this->m_db, (const char *)auto_vacuum_query.c_str(), NULL, NULL, NULL);
+
   // WAL query
   string wal_query = "PRAGMA journal_mode=WAL;";
   rc = sqlite3_exec(this->m_db, (const char *)wal_query.c_str(), NULL, NULL, &err_msg);
@@ -61,7 +101,10 @@ SqliteStorage::SqliteStorage(const string &db_name) {
   string create_events_query =
       "CREATE TABLE IF NOT EXISTS " + db_table_events + "(" +
       db_column_events_id + " INTEGER PRIMARY KEY, " +
-      db_column_events_data + " STRING" +
+      db_column_events_data + " STRING, " +
+      db_column_events_attempts + " INTEGER NOT NULL DEFAULT 0, " +
+      db_column_events_next_attempt_at + " INTEGER NOT NULL DEFAULT 0, " +
+      db_column_events_priority + " INTEGER NOT NULL DEFAULT 0" +
       ");";
 
   // Make new events table
@@ -73,6 +116,75 @@ SqliteStorage::SqliteStorage(const string &db_name) {
     throw runtime_error(err);
   }
 
+  // Add retry columns to events tables created by previous versions
+  add_events_column_if_missing(db_column_events_attempts, "INTEGER NOT NULL DEFAULT 0");
+  add_events_column_if_missing(db_column_events_next_attempt_at, "INTEGER NOT NULL DEFAULT 0");
+  add_events_column_if_missing(db_column_events_priority, "INTEGER NOT NULL DEFAULT 0");
+
+  // Index to select the oldest events of a priority lane
+  string create_priority_index_query =
+      "CREATE INDEX IF NOT EXISTS " + db_table_events + "_" + db_column_events_priority + " ON " + db_table_events + "(" +
+      db_column_events_priority + ", " + db_column_events_id + ");";
+  rc = sqlite3_exec(this->m_db, (const char *)create_priority_index_query.c_str(), NULL, NULL, &err_msg);
+  if (rc != SQLITE_OK) {
+    string err = "FATAL: Cannot create events priority index: " + string(err_msg);
+    sqlite3_free(err_msg);
+    throw runtime_error(err);
+  }
+
+  // Create dead-letter events table query, rows get their own ID as event row IDs are reused once the queue drains
+  string create_dead_letter_events_query =
+      "CREATE TABLE IF NOT EXISTS " + db_table_dead_letter_events + "(" +
+      db_column_events_id + " INTEGER PRIMARY KEY AUTOINCREMENT, " +
+      db_column_dead_letter_events_event_row_id + " INTEGER NOT NULL DEFAULT 0, " +
+      db_column_events_data + " STRING, " +
+      db_column_events_attempts + " INTEGER NOT NULL DEFAULT 0, " +
+      db_column_dead_letter_events_failed_at + " INTEGER NOT NULL DEFAULT 0" +
+      ");";
+
+  // Tables created before dead-letter rows had their own ID are copied to a new table, keeping the event row IDs
+  bool migrate_dead_letter_events = has_column(db_table_dead_letter_events, db_column_events_id) &&
+                                    !has_column(db_table_dead_letter_events, db_column_dead_letter_events_event_row_id);
+  string dead_letter_columns = db_column_events_data + ", " + db_column_events_attempts + ", " + db_column_dead_letter_events_failed_at;
+  if (migrate_dead_letter_events) {
+    create_dead_letter_events_query =
+        "BEGIN; "
+        "ALTER TABLE " + db_table_dead_letter_events + " RENAME TO " + db_table_dead_letter_events + "_old; " +
+        create_dead_letter_events_query + " " +
+        "INSERT INTO " + db_table_dead_letter_events + "(" + db_column_dead_letter_events_event_row_id + ", " + dead_letter_columns + ") " +
+        "SELECT " + db_column_events_id + ", " + dead_letter_columns + " FROM " + db_table_dead_letter_events + "_old " +
+        "ORDER BY " + db_column_events_id + "; " +
+        "DROP TABLE " + db_table_dead_letter_events + "_old; " +
+        "COMMIT;";
+  }
+
+  // Make new dead-letter events table
+  rc = sqlite3_exec(this->m_db, (const char *)create_dead_letter_events_query.c_str(), NULL, NULL, &err_msg);
+  if (rc != SQLITE_OK) {
+    string err = "FATAL: Cannot create dead-letter events table: " + string(err_msg);
+    sqlite3_free(err_msg);
+    if (migrate_dead_letter_events) {
+      sqlite3_exec(this->m_db, "ROLLBACK;", NULL, NULL, NULL);
+    }
+    throw runtime_error(err);
+  }
+
+  // Create compression dictionaries table query, the ID is stored in the header of the compressed events
+  string create_dictionaries_query =
+      "CREATE TABLE IF NOT EXISTS " + db_table_dictionaries + "(" +
+      db_column_dictionaries_id + " INTEGER PRIMARY KEY, " +
+      db_column_dictionaries_data + " BLOB NOT NULL, " +
+      db_column_dictionaries_trained_at + " INTEGER NOT NULL DEFAULT 0" +
+      ");";
+
+  // Make new compression dictionaries table
+  rc = sqlite3_exec(this->m_db, (const char *)create_dictionaries_query.c_str(), NULL, NULL, &err_msg);
+  if (rc != SQLITE_OK) {
+    string err = "FATAL: Cannot create dictionaries table: " + string(err_msg);
+    sqlite3_free(err_msg);
+    throw runtime_error(err);
+  }
+
   // Create session table query
   string create_sessions_query =
       "CREATE TABLE IF NOT EXISTS " + db_table_session + "(" +
@@ -89,44 +201,285 @@ SqliteStorage::SqliteStorage(const string &db_name) {
     throw runtime_error(err);
   }
 
+  // Initialize the queue size counters, they are maintained on insert and delete
+  this->m_event_count = 0;
+  this->m_event_byte_size = 0;
+  select_event_queue_size("1", &this->m_lane_event_counts, &this->m_event_byte_size);
+  for (auto const &lane : this->m_lane_event_counts) {
+    this->m_event_count += lane.second;
+  }
+
+  // Continue compressing with the latest dictionary, older ones are loaded when events compressed with them are read
+  this->m_uncompressed_event_count = this->m_event_count;
+  if (event_encoding == COMPRESSED_ENCODING) {
+    sqlite3_stmt *stmt;
+    string select_latest_dictionary_query =
+        "SELECT " + db_column_dictionaries_id + ", " + db_column_dictionaries_data + ", " + db_column_dictionaries_trained_at + " " +
+        "FROM " + db_table_dictionaries + " ORDER BY " + db_column_dictionaries_id + " DESC LIMIT 1;";
+    if (sqlite3_prepare_v2(this->m_db, select_latest_dictionary_query.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+      throw runtime_error((string) "FATAL: Cannot read dictionaries table: " + sqlite3_errmsg(this->m_db));
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+      const char *data = (const char *)sqlite3_column_blob(stmt, 1);
+      string dictionary(data ? data : "", size_t(sqlite3_column_bytes(stmt, 1)));
+      this->m_compressor.set_compression_dictionary(sqlite3_column_int(stmt, 0), dictionary);
+      this->m_dictionary_trained_at_ms = (unsigned long long)sqlite3_column_int64(stmt, 2);
+      this->m_uncompressed_event_count = 0;
+    }
+    sqlite3_finalize(stmt);
+  }
+
   // Insert query
   string insert_query =
       "INSERT INTO " + db_table_events + "(" +
-      db_column_events_data +
-      ") values(?1);";
+      db_column_events_data + ", " + db_column_events_priority +
+      ") values(?1, ?2);";
 
   // Prepare insert statement
   rc = sqlite3_prepare_v2(this->m_db, (const char *)insert_query.c_str(), -1, &this->m_add_stmt, NULL);
   if (rc != SQLITE_OK) {
     throw runtime_error("FATAL: Cannot prepare event insert statement: " + std::to_string(rc));
   }
+
+  // Open a separate read connection so that the emitter selecting events doesn't block inserts (WAL allows concurrent readers),
+  // in-memory databases are private to their connection so they are read through the write connection
+  if (db_name.empty() || db_name == ":memory:") {
+    this->m_read_db = this->m_db;
+  } else {
+    rc = sqlite3_open_v2((const char *)db_name.c_str(), &db, SQLITE_OPEN_READONLY, NULL);
+    if (rc) {
+      string err = (string) "FATAL: Cannot open database for reading: " + sqlite3_errmsg(db);
+      sqlite3_close(db);
+      sqlite3_finalize(this->m_add_stmt);
+      sqlite3_close(this->m_db);
+      throw runtime_error(err);
+    }
+    this->m_read_db = db;
+  }
+}
+
+bool SqliteStorage::has_column(const string &table, const string &column) {
+  sqlite3_stmt *stmt;
+  string table_info_query = "PRAGMA table_info(" + table + ");";
+  if (sqlite3_prepare_v2(this->m_db, table_info_query.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+    throw runtime_error((string) "FATAL: Cannot read " + table + " table info: " + sqlite3_errmsg(this->m_db));
+  }
+  bool exists = false;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    const char *name = (const char *)sqlite3_column_text(stmt, 1);
+    if (name && column == name) {
+      exists = true;
+      break;
+    }
+  }
+  sqlite3_finalize(stmt);
+  return exists;
+}
+
+void SqliteStorage::add_events_column_if_missing(const string &column, const string &definition) {
+  if (has_column(db_table_events, column)) {
+    return;
+  }
+
+  char *err_msg = 0;
+  string alter_query = "ALTER TABLE " + db_table_events + " ADD COLUMN " + column + " " + definition + ";";
+  if (sqlite3_exec(this->m_db, alter_query.c_str(), NULL, NULL, &err_msg) != SQLITE_OK) {
+    string err = "FATAL: Cannot add " + column + " column to events table: " + string(err_msg);
+    sqlite3_free(err_msg);
+    throw runtime_error(err);
+  }
+}
+
+void SqliteStorage::select_event_queue_size(const string &where_clause, map<int, unsigned long long> *lane_event_counts, unsigned long long *byte_size) {
+  sqlite3_stmt *stmt;
+  string select_size_query =
+      "SELECT " + db_column_events_priority + ", COUNT(*), COALESCE(SUM(LENGTH(CAST(" + db_column_events_data + " AS BLOB))), 0) " +
+      "FROM " + db_table_events + " WHERE " + where_clause + " GROUP BY " + db_column_events_priority + ";";
+
+  if (sqlite3_prepare_v2(this->m_db, select_size_query.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+    cerr << "ERROR: Failed to prepare select_size_query: " << sqlite3_errmsg(this->m_db) << endl;
+    return;
+  }
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    (*lane_event_counts)[sqlite3_column_int(stmt, 0)] += (unsigned long long)sqlite3_column_int64(stmt, 1);
+    *byte_size += (unsigned long long)sqlite3_column_int64(stmt, 2);
+  }
+  sqlite3_finalize(stmt);
+}
+
+// called with m_db_access locked before deleting the matching rows
+void SqliteStorage::subtract_from_event_queue_size(const string &where_clause) {
+  map<int, unsigned long long> lane_event_counts;
+  unsigned long long byte_size = 0;
+  select_event_queue_size(where_clause, &lane_event_counts, &byte_size);
+  subtract_from_event_queue_size(lane_event_counts, byte_size);
+}
+
+void SqliteStorage::subtract_from_event_queue_size(const map<int, unsigned long long> &lane_event_counts, unsigned long long byte_size) {
+  for (auto const &lane : lane_event_counts) {
+    unsigned long long &lane_count = this->m_lane_event_counts[lane.first];
+    lane_count -= std::min(lane.second, lane_count);
+    this->m_event_count -= std::min(lane.second, this->m_event_count);
+  }
+  this->m_event_byte_size -= std::min(byte_size, this->m_event_byte_size);
 }
 
 SqliteStorage::~SqliteStorage() {
   sqlite3_finalize(this->m_add_stmt);
+  if (this->m_read_db != this->m_db) {
+    sqlite3_close(this->m_read_db);
+  }
   sqlite3_close(this->m_db);
 }
 
 // --- INSERT
 
 void SqliteStorage::add_event(const Payload &payload) {
+  SNOWPLOW_ALLOCATION_PROBE("sqlite.add_event");
+  string payload_str = encode_event(payload);
   lock_guard<mutex> guard(this->m_db_access);
+  reencode_if_dictionary_changed(payload, &payload_str);
+  insert_event_row(payload, payload_str);
+}
 
+void SqliteStorage::add_serialized_event(const Payload &payload, const string &payload_str) {
+  if (this->m_event_encoding != JSON_ENCODING) {
+    add_event(payload);
+    return;
+  }
+
+  SNOWPLOW_ALLOCATION_PROBE("sqlite.add_event");
+  lock_guard<mutex> guard(this->m_db_access);
+  insert_event_row(payload, payload_str);
+}
+
+void SqliteStorage::add_events(const list<Payload> &payloads) {
+  SNOWPLOW_ALLOCATION_PROBE("sqlite.add_events");
+  if (payloads.empty()) {
+    return;
+  }
+
+  // serialize before taking the lock so that concurrent reads and deletes wait only for the inserts
+  list<string> payload_strs;
+  for (auto const &payload : payloads) {
+    payload_strs.push_back(encode_event(payload));
+  }
+
+  lock_guard<mutex> guard(this->m_db_access);
+  auto payload_str = payload_strs.begin();
+  for (auto const &payload : payloads) {
+    reencode_if_dictionary_changed(payload, &*payload_str++);
+  }
+  insert_event_rows(payloads, payload_strs);
+}
+
+void SqliteStorage::add_serialized_events(const list<Payload> &payloads, const list<string> &serialized_payloads) {
+  if (this->m_event_encoding != JSON_ENCODING) {
+    add_events(payloads);
+    return;
+  }
+
+  SNOWPLOW_ALLOCATION_PROBE("sqlite.add_events");
+  if (payloads.empty()) {
+    return;
+  }
+  lock_guard<mutex> guard(this->m_db_access);
+  insert_event_rows(payloads, serialized_payloads);
+}
+
+// called with m_db_access locked
+void SqliteStorage::insert_event_rows(const list<Payload> &payloads, const list<string> &payload_strs) {
   int rc;
+  char *err_msg = 0;
+
+  // a single transaction avoids a journal sync per event
+  rc = sqlite3_exec(this->m_db, "BEGIN;", NULL, NULL, &err_msg);
+  if (rc != SQLITE_OK) {
+    cerr << "ERROR: Failed to begin transaction for add_events: " << rc << "; " << err_msg << endl;
+    sqlite3_free(err_msg);
+    return;
+  }
+
+  // queue size counters to restore if the transaction is rolled back
+  unsigned long long event_count = this->m_event_count;
+  unsigned long long event_byte_size = this->m_event_byte_size;
+  map<int, unsigned long long> lane_event_counts = this->m_lane_event_counts;
 
-  string payload_str = Utils::serialize_payload(payload);
+  auto payload_str = payload_strs.begin();
+  for (auto const &payload : payloads) {
+    insert_event_row(payload, *payload_str++);
+  }
 
-  rc = sqlite3_bind_text(this->m_add_stmt, 1, payload_str.c_str(), int(payload_str.length()), SQLITE_STATIC);
+  rc = sqlite3_exec(this->m_db, "COMMIT;", NULL, NULL, &err_msg);
+  if (rc != SQLITE_OK) {
+    cerr << "ERROR: Failed to commit transaction for add_events: " << rc << "; " << err_msg << endl;
+    sqlite3_free(err_msg);
+    sqlite3_exec(this->m_db, "ROLLBACK;", NULL, NULL, NULL);
+
+    this->m_event_count = event_count;
+    this->m_event_byte_size = event_byte_size;
+    this->m_lane_event_counts = lane_event_counts;
+    return;
+  }
+}
+
+string SqliteStorage::encode_event(const Payload &payload) {
+  if (this->m_event_encoding == COMPRESSED_ENCODING) {
+    string binary_payload = Utils::serialize_payload_binary(payload);
+    string payload_str = this->m_compressor.compress(binary_payload);
+    if (EventCompressor::is_compressed(payload_str.data(), payload_str.length())) {
+      // sample of the compression ratio to detect when the dictionary no longer fits the events
+      this->m_sample_event_count++;
+      this->m_sample_input_bytes += binary_payload.length();
+      this->m_sample_output_bytes += payload_str.length();
+    }
+    return payload_str;
+  }
+  if (this->m_event_encoding == BINARY_ENCODING) {
+    return Utils::serialize_payload_binary(payload);
+  }
+  return Utils::serialize_payload(payload);
+}
+
+// called with m_db_access locked, payloads are compressed without the lock while a new dictionary may replace
+// (and delete) the one they used, so those are compressed again with the current dictionary
+void SqliteStorage::reencode_if_dictionary_changed(const Payload &payload, string *payload_str) {
+  if (EventCompressor::is_compressed(payload_str->data(), payload_str->length()) &&
+      EventCompressor::get_dictionary_id(payload_str->data(), payload_str->length()) != this->m_compressor.get_compression_dictionary_id()) {
+    *payload_str = encode_event(payload);
+  }
+}
+
+void SqliteStorage::insert_event_row(const Payload &payload, const string &payload_str) {
+  int rc;
+
+  if (this->m_event_encoding != JSON_ENCODING) {
+    rc = sqlite3_bind_blob(this->m_add_stmt, 1, payload_str.data(), int(payload_str.length()), SQLITE_STATIC);
+  } else {
+    rc = sqlite3_bind_text(this->m_add_stmt, 1, payload_str.c_str(), int(payload_str.length()), SQLITE_STATIC);
+  }
   if (rc != SQLITE_OK) {
     cerr << "ERROR: Failed to bind payload to statement: " << rc << endl;
     return;
   }
+  rc = sqlite3_bind_int(this->m_add_stmt, 2, payload.get_priority());
+  if (rc != SQLITE_OK) {
+    cerr << "ERROR: Failed to bind priority to statement: " << rc << endl;
+    return;
+  }
 
   rc = sqlite3_step(this->m_add_stmt);
   if (rc != SQLITE_DONE) {
     cerr << "ERROR: Failed to execute add_stmt: " << rc << endl;
+    sqlite3_reset(this->m_add_stmt);
     return;
   }
+  this->m_event_count++;
+  this->m_event_byte_size += payload_str.length();
+  this->m_lane_event_counts[payload.get_priority()]++;
+  if (!EventCompressor::is_compressed(payload_str.data(), payload_str.length())) {
+    this->m_uncompressed_event_count++;
+  }
 
   rc = sqlite3_reset(this->m_add_stmt);
   if (rc != SQLITE_OK) {
@@ -180,59 +533,417 @@ void SqliteStorage::set_session(const json &session_data) {
   sqlite3_finalize(insert_stmt);
 }
 
-// --- SELECT
+// --- Compression dictionaries
+
+bool SqliteStorage::train_dictionary() {
+  if (this->m_event_encoding != COMPRESSED_ENCODING) {
+    return false;
+  }
+  lock_guard<mutex> training_guard(this->m_training_access);
+  return train_dictionary_from_recent_events();
+}
 
-static int select_event_callback(void *data, int argc, char **argv, char **az_col_name) {
-  int i, id = 0;
-  list<EventRow> *data_list = (list<EventRow> *)data;
-  Payload event;
+// called without locks after reading events, so that the (slow) training doesn't hold up threads storing events
+void SqliteStorage::train_dictionary_if_due() {
+  if (this->m_event_encoding != COMPRESSED_ENCODING || !is_dictionary_training_due()) {
+    return;
+  }
+  unique_lock<mutex> training_locker(this->m_training_access, std::try_to_lock);
+  if (!training_locker.owns_lock()) {
+    return; // another thread is training
+  }
+  if (!train_dictionary_from_recent_events()) {
+    // try again once another sample of events is stored
+    lock_guard<mutex> guard(this->m_db_access);
+    this->m_uncompressed_event_count = 0;
+    reset_compression_sample();
+  }
+}
 
-  for (i = 0; i < argc; i++) {
-    if (az_col_name[i] == db_column_events_id) {
-      id = std::stoi(argv[i] ? argv[i] : "-1");
-    } else if (az_col_name[i] == db_column_events_data) {
-      event = Utils::deserialize_json_str(argv[i] ? argv[i] : "");
-    }
+bool SqliteStorage::is_dictionary_training_due() {
+  lock_guard<mutex> guard(this->m_db_access);
+  if (this->m_compressor.get_compression_dictionary_id() == 0) {
+    return this->m_uncompressed_event_count >= (unsigned long long)dictionary_sample_count;
+  }
+  if (this->m_sample_event_count.load() < (unsigned long long)dictionary_sample_count) {
+    return false;
   }
 
-  EventRow event_row;
-  event_row.id = id;
-  event_row.event = event;
-  data_list->push_back(event_row);
-  return 0;
+  // the first sample after training sets the ratio that later samples are compared to
+  double ratio = double(this->m_sample_input_bytes.load()) / double(std::max(this->m_sample_output_bytes.load(), 1ULL));
+  reset_compression_sample();
+  if (this->m_dictionary_ratio == 0) {
+    this->m_dictionary_ratio = ratio;
+  }
+  return ratio < this->m_dictionary_ratio * dictionary_min_ratio_share ||
+         Utils::get_unix_epoch_ms() >= this->m_dictionary_trained_at_ms + dictionary_retrain_interval_ms;
 }
 
-void SqliteStorage::get_all_event_rows(list<EventRow> *event_list) {
+// called with m_db_access locked
+void SqliteStorage::reset_compression_sample() {
+  this->m_sample_event_count = 0;
+  this->m_sample_input_bytes = 0;
+  this->m_sample_output_bytes = 0;
+}
+
+// called with m_training_access locked, only storing the trained dictionary takes m_db_access
+bool SqliteStorage::train_dictionary_from_recent_events() {
+  list<EventRow> event_rows;
+  {
+    lock_guard<mutex> read_guard(this->m_read_access);
+    string select_recent_query =
+        "SELECT " + db_column_events_id + ", " + db_column_events_data + " FROM " + db_table_events + " " +
+        "ORDER BY " + db_column_events_id + " DESC LIMIT " + std::to_string(dictionary_sample_count) + ";";
+    select_event_rows_with_query(this->m_read_db, select_recent_query, "select_recent_query", &event_rows);
+  }
+
+  // samples are in the format that is compressed, most recent last
+  vector<string> samples;
+  samples.reserve(event_rows.size());
+  for (auto event_row = event_rows.rbegin(); event_row != event_rows.rend(); ++event_row) {
+    samples.push_back(Utils::serialize_payload_binary(event_row->event));
+  }
+  string dictionary = EventCompressor::train_dictionary(samples, dictionary_max_size);
+  if (dictionary.empty()) {
+    return false;
+  }
+
   lock_guard<mutex> guard(this->m_db_access);
+  sqlite3_stmt *stmt;
+  string insert_dictionary_query =
+      "INSERT INTO " + db_table_dictionaries + "(" +
+      db_column_dictionaries_data + ", " + db_column_dictionaries_trained_at +
+      ") values(?1, ?2);";
+  if (sqlite3_prepare_v2(this->m_db, insert_dictionary_query.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+    cerr << "ERROR: Failed to prepare insert_dictionary_query: " << sqlite3_errmsg(this->m_db) << endl;
+    return false;
+  }
+  sqlite3_bind_blob(stmt, 1, dictionary.data(), int(dictionary.size()), SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 2, (sqlite3_int64)Utils::get_unix_epoch_ms());
+  int rc = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+  if (rc != SQLITE_DONE) {
+    cerr << "ERROR: Failed to execute insert_dictionary_query: " << rc << endl;
+    return false;
+  }
 
-  int rc;
-  char *err_msg = 0;
+  try {
+    this->m_compressor.set_compression_dictionary(int(sqlite3_last_insert_rowid(this->m_db)), dictionary);
+  } catch (const runtime_error &e) {
+    cerr << "ERROR: " << e.what() << endl;
+    return false;
+  }
+  this->m_dictionary_trained_at_ms = Utils::get_unix_epoch_ms();
+  this->m_dictionary_ratio = 0;
+  this->m_uncompressed_event_count = 0;
+  reset_compression_sample();
+  delete_unused_dictionaries();
+  return true;
+}
 
-  string select_all_query =
-      "SELECT * FROM " + db_table_events + ";";
+// called with m_db_access locked, a dictionary is used by the events that start with its header
+void SqliteStorage::delete_unused_dictionaries() {
+  int current_dictionary_id = this->m_compressor.get_compression_dictionary_id();
+  list<int> dictionary_ids;
+  sqlite3_stmt *stmt;
+  string select_dictionary_ids_query =
+      "SELECT " + db_column_dictionaries_id + " FROM " + db_table_dictionaries + " " +
+      "WHERE " + db_column_dictionaries_id + " != " + std::to_string(current_dictionary_id) + ";";
+  if (sqlite3_prepare_v2(this->m_db, select_dictionary_ids_query.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+    cerr << "ERROR: Failed to prepare select_dictionary_ids_query: " << sqlite3_errmsg(this->m_db) << endl;
+    return;
+  }
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    dictionary_ids.push_back(sqlite3_column_int(stmt, 0));
+  }
+  sqlite3_finalize(stmt);
 
-  rc = sqlite3_exec(this->m_db, (const char *)select_all_query.c_str(), select_event_callback, (void *)event_list, &err_msg);
-  if (rc != SQLITE_OK) {
-    cerr << "ERROR: Failed to execute select_all_query: " << rc << "; " << err_msg << endl;
+  string select_dictionary_used_query =
+      "SELECT EXISTS(SELECT 1 FROM " + db_table_events + " WHERE SUBSTR(" + db_column_events_data + ", 1, ?1) = ?2) " +
+      "OR EXISTS(SELECT 1 FROM " + db_table_dead_letter_events + " WHERE SUBSTR(" + db_column_events_data + ", 1, ?1) = ?2);";
+  if (sqlite3_prepare_v2(this->m_db, select_dictionary_used_query.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+    cerr << "ERROR: Failed to prepare select_dictionary_used_query: " << sqlite3_errmsg(this->m_db) << endl;
+    return;
+  }
+  list<int> unused_dictionary_ids;
+  for (int dictionary_id : dictionary_ids) {
+    string header = EventCompressor::get_header(dictionary_id);
+    sqlite3_bind_int(stmt, 1, int(header.size()));
+    sqlite3_bind_blob(stmt, 2, header.data(), int(header.size()), SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) == 0) {
+      unused_dictionary_ids.push_back(dictionary_id);
+    }
+    sqlite3_reset(stmt);
+  }
+  sqlite3_finalize(stmt);
+  if (unused_dictionary_ids.empty()) {
+    return;
+  }
+
+  char *err_msg = 0;
+  string delete_dictionaries_query =
+      "DELETE FROM " + db_table_dictionaries + " WHERE " + db_column_dictionaries_id + " IN (" + Utils::int_list_to_string(unused_dictionary_ids, ",") + ");";
+  if (sqlite3_exec(this->m_db, delete_dictionaries_query.c_str(), NULL, NULL, &err_msg) != SQLITE_OK) {
+    cerr << "ERROR: Failed to execute delete_dictionaries_query: " << err_msg << endl;
     sqlite3_free(err_msg);
+    return;
+  }
+  for (int dictionary_id : unused_dictionary_ids) {
+    this->m_compressor.remove_decompression_dictionary(dictionary_id);
+  }
+}
+
+// dictionaries of compressed events are loaded on first use through the connection reading the events
+void SqliteStorage::load_dictionary(sqlite3 *db, int dictionary_id) {
+  sqlite3_stmt *stmt;
+  string select_dictionary_query =
+      "SELECT " + db_column_dictionaries_data + " FROM " + db_table_dictionaries + " " +
+      "WHERE " + db_column_dictionaries_id + " = " + std::to_string(dictionary_id) + ";";
+  if (sqlite3_prepare_v2(db, select_dictionary_query.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+    cerr << "ERROR: Failed to prepare select_dictionary_query: " << sqlite3_errmsg(db) << endl;
+    return;
   }
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    const char *data = (const char *)sqlite3_column_blob(stmt, 0);
+    this->m_compressor.add_decompression_dictionary(dictionary_id, string(data ? data : "", size_t(sqlite3_column_bytes(stmt, 0))));
+  }
+  sqlite3_finalize(stmt);
+}
+
+Payload SqliteStorage::decode_event(sqlite3 *db, const char *data, size_t length) {
+  if (!EventCompressor::is_compressed(data, length)) {
+    return Utils::deserialize_payload(data, length);
+  }
+  int dictionary_id = EventCompressor::get_dictionary_id(data, length);
+  if (dictionary_id > 0 && !this->m_compressor.has_decompression_dictionary(dictionary_id)) {
+    load_dictionary(db, dictionary_id);
+  }
+  string payload = this->m_compressor.decompress(data, length);
+  return Utils::deserialize_payload(payload.data(), payload.size());
+}
+
+// --- SELECT
+
+// rows are read with a prepared statement rather than sqlite3_exec as binary encoded payloads may contain zero bytes,
+// rows that can't be decoded are skipped and their IDs added to undecodable_ids (if given)
+void SqliteStorage::select_event_rows_with_query(sqlite3 *db, const string &query, const string &query_name, list<EventRow> *event_list,
+                                                 list<int> *undecodable_ids) {
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+    cerr << "ERROR: Failed to prepare " << query_name << ": " << sqlite3_errmsg(db) << endl;
+    return;
+  }
+
+  int id_column = -1, data_column = -1, attempts_column = -1, priority_column = -1;
+  for (int i = 0; i < sqlite3_column_count(stmt); i++) {
+    string column = sqlite3_column_name(stmt, i);
+    if (column == db_column_events_id) {
+      id_column = i;
+    } else if (column == db_column_events_data) {
+      data_column = i;
+    } else if (column == db_column_events_attempts) {
+      attempts_column = i;
+    } else if (column == db_column_events_priority) {
+      priority_column = i;
+    }
+  }
+
+  int rc;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    EventRow event_row;
+    event_row.id = id_column >= 0 ? sqlite3_column_int(stmt, id_column) : -1;
+    if (data_column >= 0) {
+      const char *data = (const char *)sqlite3_column_blob(stmt, data_column);
+      try {
+        event_row.event = decode_event(db, data ? data : "", size_t(sqlite3_column_bytes(stmt, data_column)));
+      } catch (const std::exception &e) {
+        cerr << "ERROR: Failed to decode event row " << event_row.id << ": " << e.what() << endl;
+        if (undecodable_ids && event_row.id >= 0) {
+          undecodable_ids->push_back(event_row.id);
+        }
+        continue;
+      }
+    }
+    if (attempts_column >= 0) {
+      event_row.attempts = sqlite3_column_int(stmt, attempts_column);
+    }
+    if (priority_column >= 0) {
+      event_row.priority = sqlite3_column_int(stmt, priority_column);
+    }
+    event_list->push_back(std::move(event_row));
+  }
+  if (rc != SQLITE_DONE) {
+    cerr << "ERROR: Failed to execute " << query_name << ": " << rc << "; " << sqlite3_errmsg(db) << endl;
+  }
+  sqlite3_finalize(stmt);
+}
+
+void SqliteStorage::get_all_event_rows(list<EventRow> *event_list) {
+  list<int> undecodable_ids;
+  {
+    lock_guard<mutex> guard(this->m_read_access);
+
+    string select_all_query =
+        "SELECT * FROM " + db_table_events + ";";
+
+    select_event_rows_with_query(this->m_read_db, select_all_query, "select_all_query", event_list, &undecodable_ids);
+  }
+  // rows that can't be decoded would be read again and again, they are kept for inspection instead
+  move_event_rows_to_dead_letter(undecodable_ids);
 }
 
 void SqliteStorage::get_event_rows_batch(list<EventRow> *event_list, int number_to_get) {
+  read_event_rows_batch(event_list, number_to_get, set<int>(), "*");
+}
+
+void SqliteStorage::get_event_rows_batch_excluding(list<EventRow> *event_list, int number_to_get, const set<int> &excluded_ids) {
+  read_event_rows_batch(event_list, number_to_get, excluded_ids, "*");
+}
+
+void SqliteStorage::get_event_row_keys_batch(list<EventRow> *event_list, int number_to_get, const set<int> &excluded_ids) {
+  read_event_rows_batch(event_list, number_to_get, excluded_ids,
+      db_column_events_id + ", " + db_column_events_attempts + ", " + db_column_events_priority);
+}
+
+void SqliteStorage::get_event_rows_with_ids(const list<int> &id_list, list<EventRow> *event_list) {
+  if (id_list.empty()) {
+    return;
+  }
+
+  list<EventRow> rows;
+  list<int> undecodable_ids;
+  {
+    lock_guard<mutex> guard(this->m_read_access);
+    select_event_rows(&rows, db_column_events_id + " IN (" + Utils::int_list_to_string(id_list, ",") + ")",
+        db_column_events_id + " ASC", int(id_list.size()), "*", &undecodable_ids);
+  }
+  move_event_rows_to_dead_letter(undecodable_ids);
+
+  map<int, list<EventRow>::iterator> rows_by_id;
+  for (auto row = rows.begin(); row != rows.end(); ++row) {
+    rows_by_id[row->id] = row;
+  }
+  for (int row_id : id_list) {
+    auto row = rows_by_id.find(row_id);
+    if (row != rows_by_id.end()) {
+      event_list->splice(event_list->end(), rows, row->second);
+    }
+  }
+}
+
+// condition appended to a where clause to skip the given rows
+static string excluded_ids_condition(const set<int> &excluded_ids) {
+  if (excluded_ids.empty()) {
+    return "";
+  }
+  list<int> excluded_id_list(excluded_ids.begin(), excluded_ids.end());
+  return " AND " + db_column_events_id + " NOT IN (" + Utils::int_list_to_string(excluded_id_list, ",") + ")";
+}
+
+void SqliteStorage::read_event_rows_batch(list<EventRow> *event_list, int number_to_get, const set<int> &excluded_ids, const string &columns) {
+  map<int, unsigned long long> lane_event_counts = get_lane_event_counts();
+  list<int> undecodable_ids;
+  {
+    lock_guard<mutex> guard(this->m_read_access);
+
+    string where_clause = db_column_events_next_attempt_at + " <= " + Utils::uint_to_string(Utils::get_unix_epoch_ms()) +
+        excluded_ids_condition(excluded_ids);
+    select_event_rows_batch(event_list, number_to_get, where_clause, lane_event_counts, columns, &undecodable_ids);
+  }
+  move_event_rows_to_dead_letter(undecodable_ids);
+  train_dictionary_if_due();
+}
+
+map<int, unsigned long long> SqliteStorage::get_lane_event_counts() {
   lock_guard<mutex> guard(this->m_db_access);
+  return this->m_lane_event_counts;
+}
 
-  int rc;
-  char *err_msg = 0;
+// called with m_read_access locked
+void SqliteStorage::select_event_rows_batch(list<EventRow> *event_list, int number_to_get, const string &where_clause, const map<int, unsigned long long> &lane_event_counts,
+                                            const string &columns, list<int> *undecodable_ids) {
+  vector<int> lanes;
+  int total_weight = 0;
+  for (auto lane = lane_event_counts.rbegin(); lane != lane_event_counts.rend(); ++lane) {
+    if (lane->second > 0) {
+      lanes.push_back(lane->first);
+      total_weight += std::max(lane->first, 0) + 1;
+    }
+  }
+  if (lanes.size() <= 1) {
+    select_event_rows(event_list, where_clause, db_column_events_id + " ASC", number_to_get, columns, undecodable_ids);
+    return;
+  }
+
+  // weighted-fair share of the batch: each lane gets slots in proportion to its priority + 1,
+  // at least one, so that a backlog in higher lanes doesn't starve the lower ones
+  list<EventRow> lane_rows;
+  int remaining = number_to_get;
+  for (int lane : lanes) {
+    if (remaining <= 0) {
+      break;
+    }
+    int share = std::min(remaining, std::max(1, number_to_get * (std::max(lane, 0) + 1) / total_weight));
+    size_t size_before = lane_rows.size();
+    select_event_rows(&lane_rows, where_clause + " AND " + db_column_events_priority + " = " + std::to_string(lane),
+        db_column_events_id + " ASC", share, columns, undecodable_ids);
+    remaining -= int(lane_rows.size() - size_before);
+  }
 
+  // slots left by lanes with fewer eligible events go to the highest lanes
+  if (remaining > 0 && !lane_rows.empty()) {
+    list<int> selected_ids;
+    for (auto const &row : lane_rows) {
+      selected_ids.push_back(row.id);
+    }
+    if (undecodable_ids) {
+      selected_ids.insert(selected_ids.end(), undecodable_ids->begin(), undecodable_ids->end());
+    }
+    select_event_rows(&lane_rows, where_clause + " AND " + db_column_events_id + " NOT IN (" + Utils::int_list_to_string(selected_ids, ",") + ")",
+        db_column_events_priority + " DESC, " + db_column_events_id + " ASC", remaining, columns, undecodable_ids);
+  }
+  event_list->splice(event_list->end(), lane_rows);
+}
+
+// called with m_read_access locked
+void SqliteStorage::select_event_rows(list<EventRow> *event_list, const string &where_clause, const string &order_by, int limit, const string &columns,
+                                      list<int> *undecodable_ids) {
+  SNOWPLOW_ALLOCATION_PROBE("sqlite.select_event_rows");
   string select_range_query =
-      "SELECT * FROM " + db_table_events + " " +
-      "ORDER BY " + db_column_events_id + " ASC LIMIT " + std::to_string(number_to_get) + ";";
+      "SELECT " + columns + " FROM " + db_table_events + " " +
+      "WHERE " + where_clause + " " +
+      "ORDER BY " + order_by + " LIMIT " + std::to_string(limit) + ";";
 
-  rc = sqlite3_exec(this->m_db, (const char *)select_range_query.c_str(), select_event_callback, (void *)event_list, &err_msg);
-  if (rc != SQLITE_OK) {
-    cerr << "ERROR: Failed to execute select_range_query: " << rc << "; " << err_msg << endl;
-    sqlite3_free(err_msg);
+  select_event_rows_with_query(this->m_read_db, select_range_query, "select_range_query", event_list, undecodable_ids);
+}
+
+unsigned long long SqliteStorage::get_next_attempt_at_ms() {
+  lock_guard<mutex> guard(this->m_read_access);
+
+  sqlite3_stmt *stmt;
+  string select_next_attempt_query =
+      "SELECT MIN(" + db_column_events_next_attempt_at + ") FROM " + db_table_events + " " +
+      "WHERE " + db_column_events_next_attempt_at + " > 0;";
+
+  if (sqlite3_prepare_v2(this->m_read_db, select_next_attempt_query.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+    cerr << "ERROR: Failed to prepare select_next_attempt_query: " << sqlite3_errmsg(this->m_read_db) << endl;
+    return 0;
+  }
+  unsigned long long next_attempt_at_ms = 0;
+  if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+    next_attempt_at_ms = (unsigned long long)sqlite3_column_int64(stmt, 0);
   }
+  sqlite3_finalize(stmt);
+  return next_attempt_at_ms;
+}
+
+void SqliteStorage::get_all_dead_letter_event_rows(list<EventRow> *event_list) {
+  lock_guard<mutex> guard(this->m_read_access);
+
+  string select_all_query =
+      "SELECT * FROM " + db_table_dead_letter_events + " ORDER BY " + db_column_events_id + " ASC;";
+
+  select_event_rows_with_query(this->m_read_db, select_all_query, "select_all_query", event_list);
 }
 
 static int select_session_callback(void *data, int argc, char **argv, char **az_col_name) {
@@ -287,18 +998,25 @@ void SqliteStorage::delete_all_event_rows() {
   if (rc != SQLITE_OK) {
     cerr << "ERROR: Failed to execute delete_all_query: " << rc << "; " << err_msg << endl;
     sqlite3_free(err_msg);
+    return;
   }
+  this->m_event_count = 0;
+  this->m_event_byte_size = 0;
+  this->m_lane_event_counts.clear();
 }
 
 void SqliteStorage::delete_event_rows_with_ids(const list<int> &id_list) {
+  SNOWPLOW_ALLOCATION_PROBE("sqlite.delete_event_rows");
   lock_guard<mutex> guard(this->m_db_access);
 
   int rc;
   char *err_msg = 0;
 
+  string where_clause = db_column_events_id + " in (" + Utils::int_list_to_string(id_list, ",") + ")";
+  subtract_from_event_queue_size(where_clause);
+
   string delete_range_query =
-      "DELETE FROM " + db_table_events + " " +
-      "WHERE " + db_column_events_id + " in (" + Utils::int_list_to_string(id_list, ",") + ");";
+      "DELETE FROM " + db_table_events + " WHERE " + where_clause + ";";
 
   rc = sqlite3_exec(this->m_db, (const char *)delete_range_query.c_str(), NULL, NULL, &err_msg);
   if (rc != SQLITE_OK) {
@@ -307,6 +1025,173 @@ void SqliteStorage::delete_event_rows_with_ids(const list<int> &id_list) {
   }
 }
 
+void SqliteStorage::delete_oldest_event_rows(int number_to_delete, const set<int> &excluded_ids) {
+  lock_guard<mutex> guard(this->m_db_access);
+
+  int rc;
+  char *err_msg = 0;
+
+  // oldest events of the lowest priority lane first
+  string where_clause =
+      db_column_events_id + " IN (SELECT " + db_column_events_id + " FROM " + db_table_events + " " +
+      "WHERE 1" + excluded_ids_condition(excluded_ids) + " " +
+      "ORDER BY " + db_column_events_priority + " ASC, " + db_column_events_id + " ASC LIMIT " + std::to_string(number_to_delete) + ")";
+  subtract_from_event_queue_size(where_clause);
+
+  string delete_oldest_query =
+      "DELETE FROM " + db_table_events + " WHERE " + where_clause + ";";
+
+  rc = sqlite3_exec(this->m_db, (const char *)delete_oldest_query.c_str(), NULL, NULL, &err_msg);
+  if (rc != SQLITE_OK) {
+    cerr << "ERROR: Failed to execute delete_oldest_query: " << rc << "; " << err_msg << endl;
+    sqlite3_free(err_msg);
+  }
+}
+
+void SqliteStorage::delete_random_event_row(const set<int> &excluded_ids) {
+  lock_guard<mutex> guard(this->m_db_access);
+
+  int rc;
+  char *err_msg = 0;
+
+  // the first row at or after a random ID between the lowest and highest ID, found using the primary key index,
+  // or the first row if all rows after the random ID are excluded
+  string random_id_condition =
+      db_column_events_id + " >= (" +
+      "SELECT MIN(" + db_column_events_id + ") + ABS(RANDOM()) % (MAX(" + db_column_events_id + ") - MIN(" + db_column_events_id + ") + 1) " +
+      "FROM " + db_table_events + ")";
+  string id;
+  for (const string &condition : {random_id_condition, string("1")}) {
+    sqlite3_stmt *stmt;
+    string select_random_query =
+        "SELECT " + db_column_events_id + " FROM " + db_table_events + " " +
+        "WHERE " + condition + excluded_ids_condition(excluded_ids) + " " +
+        "ORDER BY " + db_column_events_id + " ASC LIMIT 1;";
+    if (sqlite3_prepare_v2(this->m_db, select_random_query.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+      cerr << "ERROR: Failed to prepare select_random_query: " << sqlite3_errmsg(this->m_db) << endl;
+      return;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+      id = std::to_string(sqlite3_column_int64(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    if (!id.empty() || excluded_ids.empty()) {
+      break;
+    }
+  }
+  if (id.empty()) {
+    return;
+  }
+
+  subtract_from_event_queue_size(db_column_events_id + " = " + id);
+  string delete_random_query = "DELETE FROM " + db_table_events + " WHERE " + db_column_events_id + " = " + id + ";";
+  rc = sqlite3_exec(this->m_db, (const char *)delete_random_query.c_str(), NULL, NULL, &err_msg);
+  if (rc != SQLITE_OK) {
+    cerr << "ERROR: Failed to execute delete_random_query: " << rc << "; " << err_msg << endl;
+    sqlite3_free(err_msg);
+  }
+}
+
+bool SqliteStorage::get_event_queue_size(unsigned long long *event_count, unsigned long long *byte_size) {
+  lock_guard<mutex> guard(this->m_db_access);
+  *event_count = this->m_event_count;
+  *byte_size = this->m_event_byte_size;
+  return true;
+}
+
+static unsigned long long get_file_size(const string &path) {
+  std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+  if (!file) {
+    return 0;
+  }
+  return (unsigned long long)file.tellg();
+}
+
+bool SqliteStorage::get_storage_size(unsigned long long *file_byte_size, unsigned long long *wal_byte_size) {
+  if (this->m_db_name.empty() || this->m_db_name == ":memory:") {
+    return false;
+  }
+  *file_byte_size = get_file_size(this->m_db_name);
+  *wal_byte_size = get_file_size(this->m_db_name + "-wal");
+  return true;
+}
+
+void SqliteStorage::delete_all_dead_letter_event_rows() {
+  lock_guard<mutex> guard(this->m_db_access);
+
+  int rc;
+  char *err_msg = 0;
+
+  string delete_all_query =
+      "DELETE FROM " + db_table_dead_letter_events + ";";
+
+  rc = sqlite3_exec(this->m_db, (const char *)delete_all_query.c_str(), NULL, NULL, &err_msg);
+  if (rc != SQLITE_OK) {
+    cerr << "ERROR: Failed to execute delete_all_query: " << rc << "; " << err_msg << endl;
+    sqlite3_free(err_msg);
+  }
+}
+
+// --- UPDATE
+
+void SqliteStorage::record_failed_attempt(const list<int> &id_list, unsigned long long next_attempt_at_ms) {
+  if (id_list.empty()) {
+    return;
+  }
+  lock_guard<mutex> guard(this->m_db_access);
+
+  int rc;
+  char *err_msg = 0;
+
+  string update_attempts_query =
+      "UPDATE " + db_table_events + " " +
+      "SET " + db_column_events_attempts + " = " + db_column_events_attempts + " + 1, " +
+      db_column_events_next_attempt_at + " = " + Utils::uint_to_string(next_attempt_at_ms) + " " +
+      "WHERE " + db_column_events_id + " IN (" + Utils::int_list_to_string(id_list, ",") + ");";
+
+  rc = sqlite3_exec(this->m_db, (const char *)update_attempts_query.c_str(), NULL, NULL, &err_msg);
+  if (rc != SQLITE_OK) {
+    cerr << "ERROR: Failed to execute update_attempts_query: " << rc << "; " << err_msg << endl;
+    sqlite3_free(err_msg);
+  }
+}
+
+void SqliteStorage::move_event_rows_to_dead_letter(const list<int> &id_list) {
+  if (id_list.empty()) {
+    return;
+  }
+  lock_guard<mutex> guard(this->m_db_access);
+
+  int rc;
+  char *err_msg = 0;
+
+  // the final failed attempt is included in the attempt count of the dead-letter row
+  string ids = Utils::int_list_to_string(id_list, ",");
+  string where_clause = db_column_events_id + " IN (" + ids + ")";
+  map<int, unsigned long long> lane_event_counts;
+  unsigned long long byte_size = 0;
+  select_event_queue_size(where_clause, &lane_event_counts, &byte_size);
+  string move_query =
+      "BEGIN; "
+      "INSERT INTO " + db_table_dead_letter_events + "(" +
+      db_column_dead_letter_events_event_row_id + "," + db_column_events_data + "," + db_column_events_attempts + "," + db_column_dead_letter_events_failed_at + ") " +
+      "SELECT " + db_column_events_id + "," + db_column_events_data + "," + db_column_events_attempts + " + 1," + Utils::uint_to_string(Utils::get_unix_epoch_ms()) + " " +
+      "FROM " + db_table_events + " WHERE " + where_clause + " ORDER BY " + db_column_events_id + "; " +
+      "DELETE FROM " + db_table_events + " WHERE " + where_clause + "; " +
+      "COMMIT;";
+
+  rc = sqlite3_exec(this->m_db, (const char *)move_query.c_str(), NULL, NULL, &err_msg);
+  if (rc != SQLITE_OK) {
+    cerr << "ERROR: Failed to execute move_query: " << rc << "; " << err_msg << endl;
+    sqlite3_free(err_msg);
+    sqlite3_exec(this->m_db, "ROLLBACK;", NULL, NULL, NULL);
+    return;
+  }
+
+  // the queue size only changes once the rows are moved
+  subtract_from_event_queue_size(lane_event_counts, byte_size);
+}
+
 void SqliteStorage::delete_session() {
   lock_guard<mutex> guard(this->m_db_access);
 
@@ -323,6 +1208,74 @@ void SqliteStorage::delete_session() {
   }
 }
 
+// --- Maintenance
+
+// called with m_db_access locked
+long long SqliteStorage::get_pragma_value(const string &pragma) {
+  string pragma_query = "PRAGMA " + pragma + ";";
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(this->m_db, (const char *)pragma_query.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+    cerr << "ERROR: Failed to prepare pragma_query: " << sqlite3_errmsg(this->m_db) << endl;
+    return -1;
+  }
+  long long value = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
+  sqlite3_finalize(stmt);
+  return value;
+}
+
+bool SqliteStorage::is_maintenance_due() {
+  unsigned long long wal_byte_size = 0;
+  if (!this->m_db_name.empty() && this->m_db_name != ":memory:") {
+    wal_byte_size = get_file_size(this->m_db_name + "-wal");
+  }
+  if (wal_byte_size >= maintenance_min_reclaimable_bytes) {
+    return true;
+  }
+
+  lock_guard<mutex> guard(this->m_db_access);
+  long long free_pages = get_pragma_value("freelist_count");
+  long long page_size = get_pragma_value("page_size");
+  return free_pages > 0 && page_size > 0 && (unsigned long long)(free_pages * page_size) >= maintenance_min_reclaimable_bytes;
+}
+
+void SqliteStorage::perform_maintenance() {
+  // skip small amounts of space left behind by events trickling through, only a drained backlog is worth the rewrite
+  if (!is_maintenance_due()) {
+    return;
+  }
+
+  // the checkpoint can only truncate the WAL while the read connection isn't reading
+  std::lock(this->m_read_access, this->m_db_access);
+  lock_guard<mutex> read_guard(this->m_read_access, std::adopt_lock);
+  lock_guard<mutex> guard(this->m_db_access, std::adopt_lock);
+
+  int rc;
+  char *err_msg = 0;
+
+  // 2 is INCREMENTAL, switching an existing database to it requires rebuilding the file which is cheap once the queue is empty
+  string vacuum_query;
+  long long auto_vacuum = get_pragma_value("auto_vacuum");
+  if (auto_vacuum == 2) {
+    vacuum_query = "PRAGMA incremental_vacuum;";
+  } else if (auto_vacuum >= 0 && this->m_event_count == 0) {
+    vacuum_query = "PRAGMA auto_vacuum=INCREMENTAL; VACUUM;";
+  }
+  if (!vacuum_query.empty()) {
+    rc = sqlite3_exec(this->m_db, (const char *)vacuum_query.c_str(), NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+      cerr << "ERROR: Failed to execute vacuum_query: " << rc << "; " << err_msg << endl;
+      sqlite3_free(err_msg);
+    }
+  }
+
+  string checkpoint_query = "PRAGMA wal_checkpoint(TRUNCATE);";
+  rc = sqlite3_exec(this->m_db, (const char *)checkpoint_query.c_str(), NULL, NULL, &err_msg);
+  if (rc != SQLITE_OK) {
+    cerr << "ERROR: Failed to execute checkpoint_query: " << rc << "; " << err_msg << endl;
+    sqlite3_free(err_msg);
+  }
+}
+
 // --- Getters
 
 string SqliteStorage::get_db_name() {
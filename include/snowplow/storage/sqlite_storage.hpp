@@ -16,8 +16,11 @@ See the Apache License Version 2.0 for the specific language governing permissio
 
 #include "event_store.hpp"
 #include "session_store.hpp"
+#include "event_compressor.hpp"
+#include <atomic>
 #include <string>
 #include <list>
+#include <map>
 #include <mutex>
 #include "../thirdparty/json.hpp"
 
@@ -31,11 +34,23 @@ namespace snowplow {
 using std::mutex;
 using std::string;
 using std::list;
+using std::map;
 using json = nlohmann::json;
 
+/**
+ * @brief Format in which the SqliteStorage stores event payloads.
+ */
+enum EventEncoding {
+  JSON_ENCODING, // JSON object with the payload pairs (default)
+  BINARY_ENCODING, // Version byte followed by length-prefixed pairs with common payload keys replaced by numeric IDs
+  COMPRESSED_ENCODING // Binary encoding compressed with a zstd dictionary trained on stored events (requires SNOWPLOW_USE_ZSTD)
+};
+
 /**
  * @brief Tracker SQLite storage for events and session information.
  *
+ * Events are inserted and removed through one database connection and selected through a second, read-only one,
+ * so that the Emitter selecting a batch of events doesn't block tracking threads adding events.
  */
 class SqliteStorage : public EventStore, public SessionStore {
 public:
@@ -43,27 +58,139 @@ public:
    * @brief Construct a new Sqlite Storage object
    * 
    * @param db_name Relative path to the SQLite database
+   * @param event_encoding Format of newly stored event payloads, events stored in any format can be read (defaults to JSON)
+   * @throws invalid_argument if COMPRESSED_ENCODING is requested but the tracker was built without SNOWPLOW_USE_ZSTD
    */
-  SqliteStorage(const string &db_name);
+  SqliteStorage(const string &db_name, EventEncoding event_encoding = JSON_ENCODING);
   ~SqliteStorage();
 
   void add_event(const Payload &payload);
+  void add_serialized_event(const Payload &payload, const string &serialized_payload);
+  void add_events(const list<Payload> &payloads);
+  void add_serialized_events(const list<Payload> &payloads, const list<string> &serialized_payloads);
   void get_all_event_rows(list<EventRow> *event_list);
   void get_event_rows_batch(list<EventRow> *event_list, int number_to_get);
+  void get_event_rows_batch_excluding(list<EventRow> *event_list, int number_to_get, const set<int> &excluded_ids);
+
+  /**
+   * @brief Select the rows that get_event_rows_batch_excluding() would return without reading their payloads.
+   *
+   * The rows hold the ID, attempts and priority but an empty event, so that a caller merging batches
+   * from several stores only decodes the rows it sends (see get_event_rows_with_ids()).
+   *
+   * @param event_list Output event list to add the rows to
+   * @param number_to_get Maximum number of rows
+   * @param excluded_ids Row IDs to skip
+   */
+  void get_event_row_keys_batch(list<EventRow> *event_list, int number_to_get, const set<int> &excluded_ids);
+
+  /**
+   * @brief Retrieve the rows with the given IDs, in the order of the IDs.
+   *
+   * Rows that no longer exist are skipped.
+   *
+   * @param id_list Row IDs
+   * @param event_list Output event list to add the rows to
+   */
+  void get_event_rows_with_ids(const list<int> &id_list, list<EventRow> *event_list);
   void delete_all_event_rows();
   void delete_event_rows_with_ids(const list<int> &id_list);
+  void record_failed_attempt(const list<int> &id_list, unsigned long long next_attempt_at_ms);
+  unsigned long long get_next_attempt_at_ms();
+  void move_event_rows_to_dead_letter(const list<int> &id_list);
+  bool get_event_queue_size(unsigned long long *event_count, unsigned long long *byte_size);
+  bool get_storage_size(unsigned long long *file_byte_size, unsigned long long *wal_byte_size);
+
+  /**
+   * @brief Return free pages to the file system and truncate the write-ahead log.
+   *
+   * Runs an incremental vacuum and a truncating WAL checkpoint. Databases created before incremental auto-vacuum
+   * was enabled are converted with a full VACUUM the first time this is called while the event queue is empty.
+   * Does nothing unless the free pages or the write-ahead log take at least 1 MB.
+   */
+  void perform_maintenance();
+  void delete_oldest_event_rows(int number_to_delete, const set<int> &excluded_ids);
+  void delete_random_event_row(const set<int> &excluded_ids);
+
+  /**
+   * @brief Retrieve events that were not sent within the maximum number of attempts.
+   *
+   * Dead-letter rows have their own IDs, in the order the events were moved to the dead-letter table.
+   *
+   * @param event_list Output event list to add dead-letter event rows to
+   */
+  void get_all_dead_letter_event_rows(list<EventRow> *event_list);
+  void delete_all_dead_letter_event_rows();
 
   void set_session(const json &session_data);
   unique_ptr<json> get_session();
   void delete_session();
 
+  /**
+   * @brief Train a new compression dictionary from the most recently stored events.
+   *
+   * With COMPRESSED_ENCODING, a dictionary is trained automatically once enough events are stored, and retrained daily
+   * or when the compression ratio of newly stored events drops (e.g., after an application update changes the tracked events).
+   * Automatic training happens on the thread reading event batches (the Emitter thread) without blocking inserts.
+   * Events compressed with previous dictionaries remain readable, dictionaries that no stored events refer to are deleted.
+   *
+   * @return true if a new dictionary is used to compress newly stored events
+   */
+  bool train_dictionary();
+
+  /**
+   * @return int ID of the dictionary used to compress newly stored events, 0 if none has been trained yet.
+   */
+  int get_dictionary_id() const { return this->m_compressor.get_compression_dictionary_id(); }
+
   string get_db_name();
 
 private:
   string m_db_name;
-  mutex m_db_access;
+  EventEncoding m_event_encoding;
+  mutex m_db_access; // guards the write connection and the queue size counters
+  mutex m_read_access; // guards the read connection used to select events
   sqlite3 *m_db;
+  sqlite3 *m_read_db;
   sqlite3_stmt *m_add_stmt;
+  unsigned long long m_event_count;
+  unsigned long long m_event_byte_size;
+  map<int, unsigned long long> m_lane_event_counts; // number of stored events in each priority lane
+  EventCompressor m_compressor;
+  unsigned long long m_uncompressed_event_count; // events stored without a dictionary, a dictionary is trained once there are enough samples
+  mutex m_training_access; // one dictionary training at a time, events are sampled and trained without m_db_access
+  unsigned long long m_dictionary_trained_at_ms;
+  double m_dictionary_ratio; // compression ratio of the first sample of events compressed with the dictionary, 0 until measured
+  std::atomic<unsigned long long> m_sample_event_count; // events compressed since the ratio was last checked
+  std::atomic<unsigned long long> m_sample_input_bytes;
+  std::atomic<unsigned long long> m_sample_output_bytes;
+
+  string encode_event(const Payload &payload);
+  void reencode_if_dictionary_changed(const Payload &payload, string *payload_str);
+  void insert_event_row(const Payload &payload, const string &payload_str);
+  void insert_event_rows(const list<Payload> &payloads, const list<string> &payload_strs);
+  Payload decode_event(sqlite3 *db, const char *data, size_t length);
+  void load_dictionary(sqlite3 *db, int dictionary_id);
+  void train_dictionary_if_due();
+  bool is_dictionary_training_due();
+  void reset_compression_sample();
+  bool train_dictionary_from_recent_events();
+  void delete_unused_dictionaries();
+  bool has_column(const string &table, const string &column);
+  void add_events_column_if_missing(const string &column, const string &definition);
+  long long get_pragma_value(const string &pragma);
+  bool is_maintenance_due();
+  void select_event_queue_size(const string &where_clause, map<int, unsigned long long> *lane_event_counts, unsigned long long *byte_size);
+  void subtract_from_event_queue_size(const string &where_clause);
+  void subtract_from_event_queue_size(const map<int, unsigned long long> &lane_event_counts, unsigned long long byte_size);
+  map<int, unsigned long long> get_lane_event_counts();
+  void read_event_rows_batch(list<EventRow> *event_list, int number_to_get, const set<int> &excluded_ids, const string &columns);
+  void select_event_rows_batch(list<EventRow> *event_list, int number_to_get, const string &where_clause, const map<int, unsigned long long> &lane_event_counts,
+                               const string &columns, list<int> *undecodable_ids);
+  void select_event_rows(list<EventRow> *event_list, const string &where_clause, const string &order_by, int limit, const string &columns,
+                         list<int> *undecodable_ids);
+  void select_event_rows_with_query(sqlite3 *db, const string &query, const string &query_name, list<EventRow> *event_list,
+                                    list<int> *undecodable_ids = nullptr);
 };
 } // namespace snowplow
 
@@ -52,3 +52,7 @@ void Subject::set_ip_address(const string &ip_address) {
 map<string, string> Subject::get_map() {
   return this->m_payload.get();
 }
+
+string Subject::get_user_id() const {
+  return this->m_payload.get_value(SNOWPLOW_UID);
+}
@@ -96,6 +96,20 @@ public:
    * @return map<string, string> Subject properties to be added to events
    */
   map<string, string> get_map();
+
+  /**
+   * @brief Get the user ID without copying the subject properties
+   *
+   * @return string User ID or empty string if not set
+   */
+  string get_user_id() const;
+
+  /**
+   * @brief Get the subject properties without copying them
+   *
+   * @return const Payload& Payload with the subject properties
+   */
+  const Payload &get_payload() const { return m_payload; }
 };
 } // namespace snowplow
 
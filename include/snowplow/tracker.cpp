@@ -12,9 +12,17 @@ See the Apache License Version 2.0 for the specific language governing permissio
 */
 
 #include "tracker.hpp"
+#include "payload/json_writer.hpp"
+#include "detail/utils/allocation_probe.hpp"
+
+#include <algorithm>
+#include <limits>
 
 using namespace snowplow;
+using std::make_shared;
+using std::lock_guard;
 using std::to_string;
+using std::unique_lock;
 
 // --- Constructor & Destructor
 
@@ -29,6 +37,19 @@ Tracker::Tracker(const TrackerConfiguration &tracker_config, shared_ptr<Emitter>
     tracker_config.get_use_base64(),
     tracker_config.get_desktop_context()
   ) {
+  this->m_event_id_version = tracker_config.get_event_id_version();
+  this->m_clock_source = tracker_config.get_clock_source();
+  this->m_event_filters = tracker_config.get_event_filters();
+  if (!tracker_config.get_aggregated_events().empty()) {
+    this->m_event_aggregator = make_shared<EventAggregator>(tracker_config.get_aggregated_events(), tracker_config.get_aggregation_window(), tracker_config.get_aggregation_capacity());
+  }
+  if (tracker_config.get_thread_buffer_size() > 0) {
+    this->m_thread_buffers = make_shared<ThreadEventBuffers>(tracker_config.get_thread_buffer_size(), tracker_config.get_thread_buffer_max_age());
+  }
+  if (this->m_clock_source == CACHED_CLOCK) {
+    CachedClock::acquire();
+  }
+  this->start_ticker();
 }
 
 Tracker::Tracker(shared_ptr<Emitter> emitter, shared_ptr<Subject> subject, shared_ptr<ClientSession> client_session, const string &platform, const string &app_id,
@@ -41,13 +62,26 @@ Tracker::Tracker(shared_ptr<Emitter> emitter, shared_ptr<Subject> subject, share
   this->m_namespace = name_space;
   this->m_use_base64 = use_base64;
   this->m_desktop_context = desktop_context;
+  if (desktop_context) {
+    // the desktop context doesn't change so it is serialized only once
+    this->m_desktop_context_json = Utils::get_desktop_context().to_string();
+  }
+  this->m_event_id_version = UUID_V4;
+  this->m_clock_source = SYSTEM_CLOCK;
+  this->m_ticker_stop_requested = false;
 
   // Start daemon threads
   this->start();
 }
 
 Tracker::~Tracker() {
+  this->stop_ticker();
+  this->track_aggregates(true);
+  this->flush_thread_buffers();
   this->stop();
+  if (this->m_clock_source == CACHED_CLOCK) {
+    CachedClock::release();
+  }
 }
 
 // --- Controls
@@ -57,10 +91,13 @@ void Tracker::start() {
 }
 
 void Tracker::stop() {
+  this->flush_thread_buffers();
   this->m_emitter->stop();
 }
 
 void Tracker::flush() {
+  this->track_aggregates(true);
+  this->flush_thread_buffers();
   this->m_emitter->flush();
 }
 
@@ -73,9 +110,26 @@ void Tracker::set_subject(shared_ptr<Subject> subject) {
 // --- Event Tracking
 
 string Tracker::track(const Event &event) {
-  EventPayload payload = event.get_payload(m_use_base64);
-  vector<SelfDescribingJson> context = event.get_context();
+  SNOWPLOW_ALLOCATION_PROBE("tracker.track");
   auto event_subject = event.get_subject();
+  if (is_filtered_out(event, event_subject)) {
+    return string();
+  }
+
+  if (this->m_event_aggregator) {
+    this->track_aggregates(false);
+    if (this->m_event_aggregator->aggregate(event, Utils::get_unix_epoch_ms(), event_subject)) {
+      return string();
+    }
+  }
+
+  return track_event(event, event_subject);
+}
+
+string Tracker::track_event(const Event &event, const shared_ptr<Subject> &event_subject) {
+  SNOWPLOW_ALLOCATION_PROBE("tracker.track_event");
+  EventPayload payload = get_event_payload(event);
+  const vector<SelfDescribingJson> &context = event.get_context();
 
   // Add standard KV Pairs
   payload.add(SNOWPLOW_TRACKER_VERSION, SNOWPLOW_TRACKER_VERSION_LABEL);
@@ -85,36 +139,169 @@ string Tracker::track(const Event &event) {
 
   // Add Subject KV Pairs
   if (this->m_subject) {
-    payload.add_map(this->m_subject->get_map());
+    payload.add_payload(this->m_subject->get_payload());
   }
 
   // Add event subject pairs
   if (event_subject) {
-    payload.add_map(event_subject->get_map());
+    payload.add_payload(event_subject->get_payload());
+  }
+
+  // Build the final context and add it to the payload
+  // (written directly into the serialized contexts wrapper, same output as the JSON tree it replaces)
+  if (!context.empty() || this->m_client_session || this->m_desktop_context) {
+    SNOWPLOW_ALLOCATION_PROBE("tracker.context");
+    JsonWriter writer;
+    writer.begin_object().key(SNOWPLOW_DATA).begin_array();
+    for (auto const &entity : context) {
+      writer.value(entity.get());
+    }
+
+    // Add Client Session if available
+    if (this->m_client_session) {
+      writer.value(this->m_client_session->update_and_get_session_context(payload.get_event_id(), payload.get_timestamp()).get());
+    }
+
+    // Add Desktop Context if available
+    if (this->m_desktop_context) {
+      writer.raw_value(this->m_desktop_context_json);
+    }
+
+    writer.end_array().field(SNOWPLOW_SCHEMA, SNOWPLOW_SCHEMA_CONTEXTS).end_object();
+    payload.add_serialized_json(writer.str(), m_use_base64, SNOWPLOW_CONTEXT_ENCODED, SNOWPLOW_CONTEXT);
+  }
+
+  // Move the event to the Emitter, the event ID is copied first as the payload is left empty
+  string event_id = payload.get_event_id();
+  if (this->m_thread_buffers) {
+    list<Payload> batch;
+    if (this->m_thread_buffers->add(std::move(payload), Utils::get_unix_epoch_ms(), &batch)) {
+      this->m_emitter->add_batch(std::move(batch));
+    }
+  } else {
+    this->m_emitter->add(std::move(payload));
+  }
+
+  return event_id;
+}
+
+EventPayload Tracker::get_event_payload(const Event &event) const {
+  SNOWPLOW_ALLOCATION_PROBE("tracker.event_payload");
+  return event.get_payload(m_use_base64, m_event_id_version);
+}
+
+bool Tracker::is_filtered_out(const Event &event, const shared_ptr<Subject> &event_subject) const {
+  if (this->m_event_filters.empty()) {
+    return false;
   }
 
-  // Add Client Session if available
+  // event subject properties override the tracker subject, same as in the payload
+  string user_id;
+  if (event_subject) {
+    user_id = event_subject->get_user_id();
+  }
+  if (user_id.empty() && this->m_subject) {
+    user_id = this->m_subject->get_user_id();
+  }
+  string anonymous_user_id;
   if (this->m_client_session) {
-    context.push_back(this->m_client_session->update_and_get_session_context(payload.get_event_id(), payload.get_timestamp()));
+    anonymous_user_id = this->m_client_session->get_user_id();
+  }
+  EventFilterInput input{event, event.get_event_type(), event.get_schema(), user_id, anonymous_user_id};
+
+  for (auto const &filter : this->m_event_filters) {
+    if (!filter(input)) {
+      return true;
+    }
   }
+  return false;
+}
 
-  // Add Desktop Context if available
-  if (this->m_desktop_context) {
-    context.push_back(Utils::get_desktop_context());
+void Tracker::track_aggregates(bool force) {
+  if (!this->m_event_aggregator) {
+    return;
   }
 
-  // Build the final context and add it to the payload
-  if (context.size() > 0) {
-    json context_data_array;
-    for (int i = 0; i < context.size(); ++i) {
-      context_data_array.push_back(context[i].get());
+  for (auto const &aggregate : this->m_event_aggregator->take_aggregates(Utils::get_unix_epoch_ms(), force)) {
+    StructuredEvent summary(aggregate.category, aggregate.action);
+    string label = aggregate.label;
+    string property = aggregate.get_property();
+    double value = aggregate.sum;
+    if (aggregate.has_label) {
+      summary.label = &label;
     }
-    SelfDescribingJson context_json(SNOWPLOW_SCHEMA_CONTEXTS, context_data_array);
-    payload.add_json(context_json.get(), m_use_base64, SNOWPLOW_CONTEXT_ENCODED, SNOWPLOW_CONTEXT);
+    summary.property = &property;
+    if (aggregate.value_count > 0) {
+      summary.value = &value;
+    }
+    summary.set_context(aggregate.context);
+    summary.set_subject(aggregate.subject);
+    track_event(summary, aggregate.subject);
+  }
+}
+
+void Tracker::flush_thread_buffers() {
+  if (!this->m_thread_buffers) {
+    return;
+  }
+
+  list<Payload> payloads = this->m_thread_buffers->take_all();
+  if (!payloads.empty()) {
+    this->m_emitter->add_batch(std::move(payloads));
+  }
+}
+
+// --- Ticker
+
+void Tracker::start_ticker() {
+  if (this->m_event_aggregator || (this->m_thread_buffers && this->m_thread_buffers->get_max_age() > 0)) {
+    this->m_ticker = std::thread(&Tracker::run_ticker, this);
   }
+}
 
-  // Add the event to the Emitter
-  this->m_emitter->add(payload);
+void Tracker::stop_ticker() {
+  if (!this->m_ticker.joinable()) {
+    return;
+  }
+  {
+    lock_guard<mutex> guard(this->m_ticker_access);
+    this->m_ticker_stop_requested = true;
+  }
+  this->m_ticker_wakeup.notify_all();
+  this->m_ticker.join();
+}
 
-  return payload.get_event_id();
+void Tracker::run_ticker() {
+  unique_lock<mutex> locker(this->m_ticker_access);
+  while (!this->m_ticker_stop_requested) {
+    locker.unlock();
+    unsigned long long wait_ms = tick();
+    locker.lock();
+    this->m_ticker_wakeup.wait_for(locker, std::chrono::milliseconds(wait_ms), [this] { return this->m_ticker_stop_requested; });
+  }
+}
+
+// tracks summaries of aggregation windows that are over and passes on the buffers of threads that didn't track events
+// within the maximum age, returns the time until the next check
+unsigned long long Tracker::tick() {
+  unsigned long long wait_ms = std::numeric_limits<unsigned long long>::max();
+
+  // a window or buffer started after this check is over no earlier than its full length from now
+  if (this->m_event_aggregator) {
+    this->track_aggregates(false);
+    unsigned long long now_ms = Utils::get_unix_epoch_ms();
+    unsigned long long window_end_ms = this->m_event_aggregator->get_window_end_ms();
+    wait_ms = window_end_ms > now_ms ? window_end_ms - now_ms : this->m_event_aggregator->get_window_ms();
+  }
+
+  if (this->m_thread_buffers && this->m_thread_buffers->get_max_age() > 0) {
+    unsigned long long now_ms = Utils::get_unix_epoch_ms();
+    unsigned long long next_expiry_ms = 0;
+    list<Payload> payloads = this->m_thread_buffers->take_expired(now_ms, &next_expiry_ms);
+    if (!payloads.empty()) {
+      this->m_emitter->add_batch(std::move(payloads));
+    }
+    wait_ms = std::min(wait_ms, next_expiry_ms > now_ms ? next_expiry_ms - now_ms : this->m_thread_buffers->get_max_age());
+  }
+  return wait_ms;
 }
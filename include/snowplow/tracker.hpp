@@ -16,17 +16,24 @@ See the Apache License Version 2.0 for the specific language governing permissio
 
 #include <string>
 #include <map>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "emitter/emitter.hpp"
 #include "subject.hpp"
 #include "client_session.hpp"
 #include "events/event.hpp"
+#include "events/event_aggregator.hpp"
+#include "emitter/thread_event_buffers.hpp"
 #include "configuration/tracker_configuration.hpp"
+#include "detail/utils/cached_clock.hpp"
 
 namespace snowplow {
 
 using std::string;
 using std::map;
 using std::shared_ptr;
+using std::mutex;
 
 /**
  * @brief Instance of the Snowplow tracker that provides an interface to track Snowplow events.
@@ -69,6 +76,8 @@ public:
 
   /**
    * @brief Stop sending events by the Emitter.
+   *
+   * Events in thread buffers are passed to the Emitter first so that they are kept in the event store.
    */
   void stop();
 
@@ -92,9 +101,13 @@ public:
    * A Payload object will be created from the event.
    * This is passed to the configured Emitter.
    * The payload's event ID string (a UUID) is returned.
+   * Events dropped by one of the configured event filters are not passed to the Emitter.
+   * Events rolled up by the event aggregator are passed to the Emitter as summary events once the aggregation window is over
+   * (by a background thread of the tracker), with the event subject and context entities of the first aggregated event.
+   * If thread buffers are enabled, the payload is passed to the Emitter together with other events tracked by the same thread.
    * 
    * @param event The event to track
-   * @return Tracked event ID
+   * @return Tracked event ID (empty string if the event was dropped by an event filter or aggregated)
    */
   string track(const Event &event);
 
@@ -121,6 +134,26 @@ private:
   string m_platform;
   bool m_use_base64;
   bool m_desktop_context;
+  string m_desktop_context_json;
+  EventIdVersion m_event_id_version;
+  ClockSource m_clock_source;
+  vector<EventFilter> m_event_filters;
+  shared_ptr<EventAggregator> m_event_aggregator;
+  shared_ptr<ThreadEventBuffers> m_thread_buffers;
+  std::thread m_ticker; // passes on buffers of idle threads
+  mutex m_ticker_access;
+  std::condition_variable m_ticker_wakeup;
+  bool m_ticker_stop_requested;
+
+  bool is_filtered_out(const Event &event, const shared_ptr<Subject> &event_subject) const;
+  string track_event(const Event &event, const shared_ptr<Subject> &event_subject);
+  EventPayload get_event_payload(const Event &event) const;
+  void track_aggregates(bool force);
+  void flush_thread_buffers();
+  void start_ticker();
+  void stop_ticker();
+  void run_ticker();
+  unsigned long long tick();
 };
 } // namespace snowplow
 
@@ -12,11 +12,15 @@ See the Apache License Version 2.0 for the specific language governing permissio
 */
 
 #include <fstream>
+#include <map>
 #include <string>
 
 #include "../include/snowplow/snowplow.hpp"
+#include "../include/snowplow/detail/utils/allocation_probe.hpp"
 #include "run.hpp"
 
+using snowplow::AllocationProbe;
+using snowplow::AllocationStats;
 using snowplow::SelfDescribingJson;
 using snowplow::SNOWPLOW_TRACKER_VERSION_LABEL;
 using snowplow::Utils;
@@ -33,6 +37,12 @@ int main(int argc, char **argv) {
   double mocked_emitter_and_real_session = run_mocked_emitter_and_real_session(db_name);
   double mute_emitter_and_mocked_session = run_mute_emitter_and_mocked_session(db_name);
   double mute_emitter_and_real_session = run_mute_emitter_and_real_session(db_name);
+  double system_uuid4_generation = run_system_uuid4_generation();
+  double uuid4_generation = run_uuid4_generation();
+  double uuid7_generation = run_uuid7_generation();
+  double query_string_encoding = run_query_string_encoding();
+  double allocations_per_tracked_event = run_allocations_per_tracked_event();
+  double allocations_per_stored_event = run_allocations_per_stored_event(db_name);
 
   // print results
   cout << endl
@@ -42,6 +52,33 @@ int main(int argc, char **argv) {
   cout << "Mocked emitter and real session: " << mocked_emitter_and_real_session << " seconds" << endl;
   cout << "Mute emitter and mocked session: " << mute_emitter_and_mocked_session << " seconds" << endl;
   cout << "Mute emitter and real session: " << mute_emitter_and_real_session << " seconds" << endl;
+  cout << endl
+       << "UUID GENERATION (" << NUM_UUIDS << " UUIDs)" << endl
+       << endl;
+  cout << "System UUIDv4: " << system_uuid4_generation << " seconds" << endl;
+  cout << "Tracker UUIDv4: " << uuid4_generation << " seconds" << endl;
+  cout << "Tracker UUIDv7: " << uuid7_generation << " seconds" << endl;
+  cout << endl
+       << "GET QUERY STRINGS (" << NUM_QUERY_STRINGS << " payloads)" << endl
+       << endl;
+  cout << "Query string encoding: " << query_string_encoding << " seconds" << endl;
+  cout << endl
+       << "HEAP ALLOCATIONS PER EVENT (" << NUM_ALLOCATION_EVENTS * 3 << " events)" << endl
+       << endl;
+  cout << "Tracker (mocked emitter): " << allocations_per_tracked_event << endl;
+  cout << "Tracker and event store (mute emitter): " << allocations_per_stored_event << endl;
+
+  // allocations per stage are only counted in builds with the SNOWPLOW_COUNT_ALLOCATIONS option
+  std::map<string, AllocationStats> allocation_stats = AllocationProbe::get_stats();
+  if (!allocation_stats.empty()) {
+    cout << endl
+         << "HEAP ALLOCATIONS PER STAGE (allocations and bytes per call, all runs above)" << endl
+         << endl;
+    for (auto const &stage : allocation_stats) {
+      cout << stage.first << ": " << (double)stage.second.allocations / stage.second.calls << " allocations, "
+           << (double)stage.second.bytes / stage.second.calls << " bytes (" << stage.second.calls << " calls)" << endl;
+    }
+  }
 
   // store results in logs as JSON
   json results;
@@ -51,6 +88,22 @@ int main(int argc, char **argv) {
   results["mocked_emitter_and_real_session"] = mocked_emitter_and_real_session;
   results["mute_emitter_and_mocked_session"] = mute_emitter_and_mocked_session;
   results["mute_emitter_and_real_session"] = mute_emitter_and_real_session;
+  results["num_uuids"] = NUM_UUIDS;
+  results["system_uuid4_generation"] = system_uuid4_generation;
+  results["uuid4_generation"] = uuid4_generation;
+  results["uuid7_generation"] = uuid7_generation;
+  results["num_query_strings"] = NUM_QUERY_STRINGS;
+  results["query_string_encoding"] = query_string_encoding;
+  results["num_allocation_events"] = NUM_ALLOCATION_EVENTS * 3;
+  results["allocations_per_tracked_event"] = allocations_per_tracked_event;
+  results["allocations_per_stored_event"] = allocations_per_stored_event;
+  for (auto const &stage : allocation_stats) {
+    json stage_results;
+    stage_results["calls"] = stage.second.calls;
+    stage_results["allocations"] = stage.second.allocations;
+    stage_results["bytes"] = stage.second.bytes;
+    results["allocation_stages"][stage.first] = stage_results;
+  }
 
   SelfDescribingJson desktop_context = Utils::get_desktop_context();
   json desktop_context_json = desktop_context.get();
@@ -16,20 +16,43 @@ See the Apache License Version 2.0 for the specific language governing permissio
 
 #include "../include/snowplow/snowplow.hpp"
 
+using snowplow::CrackedUrl;
 using snowplow::Emitter;
 using snowplow::EventStore;
+using snowplow::HttpClient;
+using snowplow::HttpRequestResult;
 using snowplow::Method;
 using snowplow::Protocol;
+using std::list;
 using std::string;
 using std::shared_ptr;
 using std::move;
+using std::unique_ptr;
+
+// HTTP client that doesn't make requests but reports them as successful
+class MuteHttpClient : public HttpClient {
+protected:
+  HttpRequestResult http_request(const RequestMethod method, const CrackedUrl url, const string &query_string, const string &post_data, list<int> row_ids, bool oversize) {
+    return HttpRequestResult(0, 200, row_ids, oversize);
+  }
+};
 
+// Emitter running its daemon thread that selects, "sends" and removes events from the event store while events are tracked
+// (unless sending is disabled, in which case events are only stored)
 class MuteEmitter : public Emitter {
 public:
-   MuteEmitter(shared_ptr<EventStore> event_store) : Emitter(move(event_store), "127.0.0.1:9090", Method::POST, Protocol::HTTP, 500, 52000, 52000) {}
-
-   void start() {}
-   void stop() {}
+   MuteEmitter(shared_ptr<EventStore> event_store, bool send_events = true) :
+     Emitter(move(event_store), "127.0.0.1:9090", Method::POST, Protocol::HTTP, 500, 52000, 52000, unique_ptr<HttpClient>(new MuteHttpClient())),
+     m_send_events(send_events) {}
+
+   void start() {
+     if (m_send_events) {
+       Emitter::start();
+     }
+   }
+
+private:
+   bool m_send_events;
 };
 
 #endif
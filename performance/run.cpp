@@ -11,15 +11,28 @@ software distributed under the Apache License Version 2.0 is distributed on an
 See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
 */
 
+#include <algorithm>
 #include <chrono>
+#include <map>
 #include <string>
 
 #include "../include/snowplow/snowplow.hpp"
+#include "../include/snowplow/detail/utils/allocation_probe.hpp"
 #include "mock_client_session.hpp"
 #include "mock_emitter.hpp"
 #include "mute_emitter.hpp"
 #include "run.hpp"
 
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
+#include <rpc.h>
+#pragma comment (lib, "Rpcrt4.lib")
+#elif defined(__APPLE__)
+#include <CoreFoundation/CoreFoundation.h>
+#else
+#include <uuid/uuid.h>
+#endif
+
+using snowplow::AllocationProbe;
 using snowplow::ClientSession;
 using snowplow::Emitter;
 using snowplow::Subject;
@@ -28,6 +41,7 @@ using snowplow::ScreenViewEvent;
 using snowplow::StructuredEvent;
 using snowplow::TimingEvent;
 using snowplow::SqliteStorage;
+using snowplow::Utils;
 using std::vector;
 using std::chrono::duration;
 using std::chrono::high_resolution_clock;
@@ -36,23 +50,27 @@ using std::thread;
 
 void clear_storage(shared_ptr<SqliteStorage> &db_name);
 
-void track_events(shared_ptr<Tracker> tracker) {
-  for (int i = 0; i < NUM_OPERATIONS; i++) {
-    TimingEvent te("timing-cat", "timing-var", 123);
+void track_events_once(Tracker &tracker) {
+  TimingEvent te("timing-cat", "timing-var", 123);
 
-    ScreenViewEvent sve;
-    string name = "Screen ID - 5asd56";
-    sve.name = &name;
+  ScreenViewEvent sve;
+  string name = "Screen ID - 5asd56";
+  sve.name = &name;
 
-    StructuredEvent se("shop", "add-to-basket");
-    string property = "pcs";
-    double value = 25.6;
-    se.property = &property;
-    se.value = &value;
+  StructuredEvent se("shop", "add-to-basket");
+  string property = "pcs";
+  double value = 25.6;
+  se.property = &property;
+  se.value = &value;
 
-    tracker->track(te);
-    tracker->track(sve);
-    tracker->track(se);
+  tracker.track(te);
+  tracker.track(sve);
+  tracker.track(se);
+}
+
+void track_events(shared_ptr<Tracker> tracker) {
+  for (int i = 0; i < NUM_OPERATIONS; i++) {
+    track_events_once(*tracker);
   }
 }
 
@@ -117,6 +135,120 @@ double run_mute_emitter_and_real_session(const string &db_name) {
   return time;
 }
 
+// UUID generation using the system APIs that the tracker used before buffering random bytes per thread
+string get_system_uuid4() {
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
+  UUID uuid = {0};
+  string uid;
+  ::UuidCreate(&uuid);
+  RPC_CSTR szUuid = NULL;
+  if (::UuidToStringA(&uuid, &szUuid) == RPC_S_OK) {
+    uid = (char *)szUuid;
+    ::RpcStringFreeA(&szUuid);
+  }
+  return uid;
+#elif defined(__APPLE__)
+  CFUUIDRef cf_uuid_ref = CFUUIDCreate(kCFAllocatorDefault);
+  CFStringRef cf_uuid_str_ref = CFUUIDCreateString(kCFAllocatorDefault, cf_uuid_ref);
+  string uuid(CFStringGetCStringPtr(cf_uuid_str_ref, kCFStringEncodingUTF8));
+  std::transform(uuid.begin(), uuid.end(), uuid.begin(), ::tolower);
+  CFRelease(cf_uuid_ref);
+  CFRelease(cf_uuid_str_ref);
+  return uuid;
+#else
+  uuid_t uuid;
+  char str[200];
+  uuid_generate_random(uuid);
+  uuid_unparse(uuid, str);
+  return string(str);
+#endif
+}
+
+double run_uuid_generation(string (*generate)()) {
+  size_t total_length = 0;
+
+  high_resolution_clock::time_point t0 = high_resolution_clock::now();
+  for (int i = 0; i < NUM_UUIDS; i++) {
+    total_length += generate().size();
+  }
+  high_resolution_clock::time_point t1 = high_resolution_clock::now();
+
+  if (total_length != size_t(NUM_UUIDS) * 36) {
+    throw std::runtime_error("Unexpected UUID length");
+  }
+  duration<double> diff = t1 - t0;
+  return diff.count();
+}
+
+double run_system_uuid4_generation() {
+  return run_uuid_generation(get_system_uuid4);
+}
+
+double run_uuid4_generation() {
+  return run_uuid_generation(Utils::get_uuid4);
+}
+
+double run_uuid7_generation() {
+  return run_uuid_generation(Utils::get_uuid7);
+}
+
+double run_query_string_encoding() {
+  // payload of a structured event with base64 encoded contexts as sent by GET emitters
+  std::map<string, string> payload = {
+      {"e", "se"}, {"se_ca", "shop"}, {"se_ac", "add-to-basket"}, {"se_pr", "pcs"}, {"se_va", "25.6"},
+      {"eid", Utils::get_uuid4()}, {"dtm", "1653042535123"}, {"stm", "1653042535456"},
+      {"tv", snowplow::SNOWPLOW_TRACKER_VERSION_LABEL}, {"p", "srv"}, {"tna", "sp-perf"}, {"aid", "app-id"},
+      {"uid", "user@example.com"}, {"url", "https://example.com/page?query=some value&other=1"},
+      {"cx", "eyJzY2hlbWEiOiJpZ2x1OmNvbS5zbm93cGxvd2FuYWx5dGljcy5zbm93cGxvdy9jb250ZXh0cy9qc29uc2NoZW1hLzEtMC0wIiwiZGF0YSI6W119"}};
+  size_t total_length = 0;
+
+  high_resolution_clock::time_point t0 = high_resolution_clock::now();
+  for (int i = 0; i < NUM_QUERY_STRINGS; i++) {
+    total_length += Utils::map_to_query_string(payload).size();
+  }
+  high_resolution_clock::time_point t1 = high_resolution_clock::now();
+
+  if (total_length == 0) {
+    throw std::runtime_error("Unexpected empty query string");
+  }
+  duration<double> diff = t1 - t0;
+  return diff.count();
+}
+
+// average number of heap allocations per track() call for a mix of structured, screen view and timing events
+double measure_allocations_per_event(shared_ptr<Emitter> emitter) {
+  auto subject = make_shared<Subject>();
+  subject->set_user_id("a-user-id");
+  subject->set_screen_resolution(1920, 1080);
+  subject->set_language("EN");
+  Tracker tracker(emitter, subject, nullptr, "mob", "app-id", "namespace", false, true);
+
+  // warm up caches that are filled on the first tracked event (e.g., the desktop context)
+  track_events_once(tracker);
+
+  unsigned long long allocations_before = AllocationProbe::get_allocation_count();
+  for (int i = 0; i < NUM_ALLOCATION_EVENTS; i++) {
+    track_events_once(tracker);
+  }
+  unsigned long long allocations = AllocationProbe::get_allocation_count() - allocations_before;
+  return (double)allocations / (NUM_ALLOCATION_EVENTS * 3);
+}
+
+double run_allocations_per_tracked_event() {
+  // the mocked emitter discards the events so only the allocations in the tracker are counted
+  auto storage = make_shared<SqliteStorage>("performance-allocations.db");
+  return measure_allocations_per_event(make_shared<MockEmitter>(storage));
+}
+
+double run_allocations_per_stored_event(const string &db_name) {
+  auto storage = make_shared<SqliteStorage>(db_name);
+  clear_storage(storage);
+  // events are only stored so that allocations made by the emitter thread sending them are not counted
+  double allocations = measure_allocations_per_event(make_shared<MuteEmitter>(storage, false));
+  clear_storage(storage);
+  return allocations;
+}
+
 void clear_storage(shared_ptr<SqliteStorage> &storage) {
   storage->delete_all_event_rows();
   storage->delete_session();
@@ -20,10 +20,19 @@ using std::string;
 
 const int NUM_OPERATIONS = 10000;
 const int NUM_THREADS = 5;
+const int NUM_UUIDS = 1000000;
+const int NUM_QUERY_STRINGS = 100000;
+const int NUM_ALLOCATION_EVENTS = 10000;
 
 double run_mocked_emitter_and_mocked_session(const string & db_name);
 double run_mocked_emitter_and_real_session(const string & db_name);
 double run_mute_emitter_and_mocked_session(const string & db_name);
 double run_mute_emitter_and_real_session(const string & db_name);
+double run_system_uuid4_generation();
+double run_uuid4_generation();
+double run_uuid7_generation();
+double run_query_string_encoding();
+double run_allocations_per_tracked_event();
+double run_allocations_per_stored_event(const string & db_name);
 
 #endif
@@ -13,9 +13,9 @@
 
 import json
 
-def to_cell(text, width=10):
+def to_cell(text, width=10, unit='s'):
     if isinstance(text, float):
-        text = str(round(text * 100) / 100) + 's'
+        text = str(round(text * 100) / 100) + unit
     return ' ' + text.ljust(width - 2) + '|'
 
 filename = 'performance/logs.txt'
@@ -26,7 +26,16 @@ metrics = [
   'mocked_emitter_and_mocked_session',
   'mocked_emitter_and_real_session',
   'mute_emitter_and_mocked_session',
-  'mute_emitter_and_real_session'
+  'mute_emitter_and_real_session',
+  'system_uuid4_generation',
+  'uuid4_generation',
+  'uuid7_generation',
+  'query_string_encoding'
+]
+
+allocation_metrics = [
+  'allocations_per_tracked_event',
+  'allocations_per_stored_event'
 ]
 
 groups = {
@@ -48,14 +57,17 @@ for device_model, num_threads, num_operations in groups:
     print(''.join([to_cell('Metric', 40), to_cell('Max'), to_cell('Min'), to_cell('Mean'), to_cell('Last')]))
     print(''.join(['-'] * 80))
 
-    for metric in metrics:
-        values = [m['results'][metric] for m in group_measurements]
+    for metric in metrics + allocation_metrics:
+        values = [m['results'][metric] for m in group_measurements if metric in m['results']]
+        if not values:
+            continue
+        unit = '' if metric in allocation_metrics else 's'
         print(''.join([
             to_cell(metric.replace('_', ' '), 40),
-            to_cell(max(values)),
-            to_cell(min(values)),
-            to_cell(sum(values) / len(values)),
-            to_cell(values[-1])
+            to_cell(max(values), unit=unit),
+            to_cell(min(values), unit=unit),
+            to_cell(sum(values) / len(values), unit=unit),
+            to_cell(values[-1], unit=unit)
         ]))
 
     print()
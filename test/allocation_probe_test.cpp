@@ -0,0 +1,62 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "../include/snowplow/detail/utils/allocation_probe.hpp"
+#include "catch.hpp"
+
+using namespace snowplow;
+
+TEST_CASE("allocation probe") {
+  AllocationProbe::reset_stats();
+
+  SECTION("attributes allocations within its scope to the stage") {
+    unsigned long long total_before = AllocationProbe::get_allocation_count();
+    for (int i = 0; i < 2; i++) {
+      AllocationProbe probe("test.stage");
+      AllocationProbe::record_allocation(100);
+      AllocationProbe::record_allocation(28);
+    }
+    AllocationProbe::record_allocation(1000);
+
+    auto stats = AllocationProbe::get_stats();
+    REQUIRE(stats.count("test.stage") == 1);
+    REQUIRE(2 == stats["test.stage"].calls);
+    REQUIRE(4 == stats["test.stage"].allocations);
+    REQUIRE(256 == stats["test.stage"].bytes);
+    REQUIRE(AllocationProbe::get_allocation_count() >= total_before + 5);
+  }
+
+  SECTION("nested probes count the allocations of inner probes but not their bookkeeping") {
+    {
+      AllocationProbe outer("test.outer");
+      AllocationProbe::record_allocation(10);
+      {
+        AllocationProbe inner("test.inner");
+        AllocationProbe::record_allocation(20);
+      }
+    }
+
+    auto stats = AllocationProbe::get_stats();
+    REQUIRE(1 == stats["test.inner"].allocations);
+    REQUIRE(20 == stats["test.inner"].bytes);
+    REQUIRE(2 == stats["test.outer"].allocations);
+    REQUIRE(30 == stats["test.outer"].bytes);
+  }
+
+  SECTION("reset clears the stages") {
+    { AllocationProbe probe("test.stage"); }
+    REQUIRE(!AllocationProbe::get_stats().empty());
+    AllocationProbe::reset_stats();
+    REQUIRE(AllocationProbe::get_stats().empty());
+  }
+}
@@ -0,0 +1,59 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "../include/snowplow/detail/base64/base64.hpp"
+#include "catch.hpp"
+#include <random>
+#include <string>
+
+using std::string;
+
+TEST_CASE("base64") {
+  SECTION("base64_encode should produce the RFC 4648 test vectors") {
+    const char *inputs[] = {"", "f", "fo", "foo", "foob", "fooba", "foobar"};
+    const char *outputs[] = {"", "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy"};
+    const char *url_safe_outputs[] = {"", "Zg", "Zm8", "Zm9v", "Zm9vYg", "Zm9vYmE", "Zm9vYmFy"};
+    for (int i = 0; i < 7; i++) {
+      string input(inputs[i]);
+      REQUIRE(outputs[i] == base64_encode((const unsigned char *)input.c_str(), unsigned(input.length())));
+      REQUIRE(url_safe_outputs[i] == base64_encode((const unsigned char *)input.c_str(), unsigned(input.length()), true));
+      REQUIRE(string(url_safe_outputs[i]).length() == base64_encoded_length(input.length(), true));
+    }
+  }
+
+  SECTION("base64_encode should use '-' and '_' in the URL-safe alphabet") {
+    const unsigned char bytes[] = {0xfb, 0xff, 0xfe};
+    REQUIRE("+//+" == base64_encode(bytes, 3));
+    REQUIRE("-__-" == base64_encode(bytes, 3, true));
+  }
+
+  SECTION("base64_encode should round trip inputs of every length through the vectorised and scalar paths") {
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    for (unsigned int length = 0; length < 200; length++) {
+      string input;
+      for (unsigned int i = 0; i < length; i++) {
+        input += char(byte(generator));
+      }
+
+      string encoded = base64_encode((const unsigned char *)input.data(), length);
+      REQUIRE(encoded.length() == base64_encoded_length(length));
+      REQUIRE(base64_decode(encoded) == input);
+
+      string url_safe = base64_encode((const unsigned char *)input.data(), length, true);
+      REQUIRE(url_safe.find_first_of("+/=") == string::npos);
+      REQUIRE(base64_decode(url_safe) == input);
+    }
+  }
+}
@@ -53,4 +53,87 @@ TEST_CASE("emitter configuration") {
     emitter_config.set_flush_timeout_ms(5000);
     REQUIRE(emitter_config.get_flush_timeout_ms() == 5000);
   }
+
+  SECTION("request callback queue size and coalescing window getters and setters") {
+    auto storage = std::make_shared<SqliteStorage>("test-emitter.db");
+    EmitterConfiguration emitter_config(storage);
+    REQUIRE(emitter_config.get_request_callback_queue_size() == 100);
+    REQUIRE(emitter_config.get_request_callback_max_queued_event_ids() == 25000);
+    REQUIRE(emitter_config.get_request_callback_coalescing_window_ms() == 0);
+    emitter_config.set_request_callback_queue_size(10);
+    emitter_config.set_request_callback_coalescing_window_ms(50);
+    REQUIRE(emitter_config.get_request_callback_queue_size() == 10);
+    REQUIRE(emitter_config.get_request_callback_coalescing_window_ms() == 50);
+    REQUIRE_THROWS_AS(emitter_config.set_request_callback_queue_size(0), invalid_argument);
+    REQUIRE_THROWS_AS(emitter_config.set_request_callback_coalescing_window_ms(-1), invalid_argument);
+
+    emitter_config.set_request_callback_max_queued_event_ids(500);
+    REQUIRE(emitter_config.get_request_callback_max_queued_event_ids() == 500);
+    REQUIRE_THROWS_AS(emitter_config.set_request_callback_max_queued_event_ids(0), invalid_argument);
+  }
+
+  SECTION("max requests in flight getter and setter") {
+    auto storage = std::make_shared<SqliteStorage>("test-emitter.db");
+    EmitterConfiguration emitter_config(storage);
+    REQUIRE(emitter_config.get_max_requests_in_flight() == 15);
+    emitter_config.set_max_requests_in_flight(2);
+    REQUIRE(emitter_config.get_max_requests_in_flight() == 2);
+    REQUIRE_THROWS_AS(emitter_config.set_max_requests_in_flight(0), invalid_argument);
+  }
+
+  SECTION("circuit breaker getters and setters") {
+    auto storage = std::make_shared<SqliteStorage>("test-emitter.db");
+    EmitterConfiguration emitter_config(storage);
+    REQUIRE(emitter_config.get_circuit_breaker_failure_threshold() == 0);
+    REQUIRE(emitter_config.get_circuit_breaker_open_duration_ms() == 30000);
+    emitter_config.set_circuit_breaker(5, 1000);
+    REQUIRE(emitter_config.get_circuit_breaker_failure_threshold() == 5);
+    REQUIRE(emitter_config.get_circuit_breaker_open_duration_ms() == 1000);
+    REQUIRE_THROWS_AS(emitter_config.set_circuit_breaker(-1), invalid_argument);
+    REQUIRE_THROWS_AS(emitter_config.set_circuit_breaker(5, 0), invalid_argument);
+  }
+
+  SECTION("max attempts getter and setter") {
+    auto storage = std::make_shared<SqliteStorage>("test-emitter.db");
+    EmitterConfiguration emitter_config(storage);
+    REQUIRE(emitter_config.get_max_attempts() == 0);
+    emitter_config.set_max_attempts(3);
+    REQUIRE(emitter_config.get_max_attempts() == 3);
+    REQUIRE_THROWS_AS(emitter_config.set_max_attempts(-1), invalid_argument);
+  }
+
+  SECTION("queue size limits and overflow policy getters and setters") {
+    auto storage = std::make_shared<SqliteStorage>("test-emitter.db");
+    EmitterConfiguration emitter_config(storage);
+    REQUIRE(emitter_config.get_max_queue_events() == 0);
+    REQUIRE(emitter_config.get_max_queue_bytes() == 0);
+    REQUIRE(emitter_config.get_queue_overflow_policy() == DROP_NEWEST);
+    emitter_config.set_max_queue_size(100, 1024);
+    emitter_config.set_queue_overflow_policy(BLOCK, 50);
+    REQUIRE(emitter_config.get_max_queue_events() == 100);
+    REQUIRE(emitter_config.get_max_queue_bytes() == 1024);
+    REQUIRE(emitter_config.get_queue_overflow_policy() == BLOCK);
+    REQUIRE(emitter_config.get_queue_block_timeout_ms() == 50);
+    REQUIRE_THROWS_AS(emitter_config.set_max_queue_size(-1), invalid_argument);
+    REQUIRE_THROWS_AS(emitter_config.set_max_queue_size(1, -1), invalid_argument);
+    REQUIRE_THROWS_AS(emitter_config.set_queue_overflow_policy(BLOCK, -1), invalid_argument);
+  }
+
+  SECTION("deduplication getters and setters") {
+    auto storage = std::make_shared<SqliteStorage>("test-emitter.db");
+    EmitterConfiguration emitter_config(storage);
+    REQUIRE(emitter_config.get_deduplication_fields().empty());
+    emitter_config.set_deduplication({"e", "se_ca"}, 5000);
+    REQUIRE(emitter_config.get_deduplication_fields() == vector<string>({"e", "se_ca"}));
+    REQUIRE(emitter_config.get_deduplication_window_ms() == 5000);
+    REQUIRE(emitter_config.get_deduplication_capacity() == 100000);
+    REQUIRE(emitter_config.get_deduplication_false_positive_rate() == 0.001);
+    emitter_config.set_deduplication({"uid"}, 100, 50, 0.01);
+    REQUIRE(emitter_config.get_deduplication_capacity() == 50);
+    REQUIRE(emitter_config.get_deduplication_false_positive_rate() == 0.01);
+    REQUIRE_THROWS_AS(emitter_config.set_deduplication({}, 100), invalid_argument);
+    REQUIRE_THROWS_AS(emitter_config.set_deduplication({"e"}, 0), invalid_argument);
+    REQUIRE_THROWS_AS(emitter_config.set_deduplication({"e"}, 100, 0), invalid_argument);
+    REQUIRE_THROWS_AS(emitter_config.set_deduplication({"e"}, 100, 10, 1), invalid_argument);
+  }
 }
@@ -50,6 +50,43 @@ TEST_CASE("network configuration") {
     REQUIRE(GET == config.get_method());
   }
 
+  SECTION("timeouts have defaults and can be configured") {
+    NetworkConfiguration config("com.acme.collector");
+    REQUIRE(10000 == config.get_connect_timeout_ms());
+    REQUIRE(30000 == config.get_request_timeout_ms());
+    REQUIRE(0 == config.get_low_speed_limit());
+
+    config.set_connect_timeout_ms(500);
+    config.set_request_timeout_ms(0);
+    config.set_low_speed_limit(100, 2000);
+    REQUIRE(500 == config.get_connect_timeout_ms());
+    REQUIRE(0 == config.get_request_timeout_ms());
+    REQUIRE(100 == config.get_low_speed_limit());
+    REQUIRE(2000 == config.get_low_speed_timeout_ms());
+
+    REQUIRE_THROWS_AS(config.set_connect_timeout_ms(-1), std::invalid_argument);
+    REQUIRE_THROWS_AS(config.set_request_timeout_ms(-1), std::invalid_argument);
+  }
+
+  SECTION("adds weighted collector endpoints") {
+    NetworkConfiguration config("https://a.collector");
+    config.add_collector_endpoint("http://b.collector", 3);
+    config.set_load_balancing(LEAST_OUTSTANDING_REQUESTS);
+
+    auto endpoints = config.get_collector_endpoints();
+    REQUIRE(2 == endpoints.size());
+    REQUIRE("a.collector" == endpoints[0].hostname);
+    REQUIRE(HTTPS == endpoints[0].protocol);
+    REQUIRE(1 == endpoints[0].weight);
+    REQUIRE("b.collector" == endpoints[1].hostname);
+    REQUIRE(HTTP == endpoints[1].protocol);
+    REQUIRE(3 == endpoints[1].weight);
+    REQUIRE(LEAST_OUTSTANDING_REQUESTS == config.get_load_balancing());
+
+    REQUIRE_THROWS_AS(config.add_collector_endpoint(""), std::invalid_argument);
+    REQUIRE_THROWS_AS(config.add_collector_endpoint("c.collector", 0), std::invalid_argument);
+  }
+
   SECTION("parses URL without protocol") {
     NetworkConfiguration config("com.acme.collector", GET);
 
@@ -0,0 +1,142 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "../../include/snowplow/emitter/callback_dispatcher.hpp"
+#include "../catch.hpp"
+#include <atomic>
+#include <tuple>
+#include <vector>
+
+using namespace snowplow;
+using std::chrono::milliseconds;
+using std::get;
+using std::make_tuple;
+using std::tuple;
+using std::vector;
+
+TEST_CASE("CallbackDispatcher") {
+  vector<tuple<list<string>, EmitStatus>> calls;
+  mutex calls_mutex;
+  EmitterCallback callback = [&](list<string> event_ids, EmitStatus emit_status) {
+    std::lock_guard<mutex> guard(calls_mutex);
+    calls.push_back(make_tuple(event_ids, emit_status));
+  };
+
+  SECTION("delivers each batch in order and drains the queue on stop") {
+    CallbackDispatcher dispatcher;
+    dispatcher.start(callback);
+    dispatcher.dispatch({"e1", "e2"}, FAILED_WILL_RETRY);
+    dispatcher.dispatch({"e1"}, SUCCESS);
+    dispatcher.dispatch({"e3"}, FAILED_WONT_RETRY);
+    dispatcher.stop();
+
+    REQUIRE(3 == calls.size());
+    REQUIRE(list<string>({"e1", "e2"}) == get<0>(calls[0]));
+    REQUIRE(FAILED_WILL_RETRY == get<1>(calls[0]));
+    REQUIRE(list<string>({"e1"}) == get<0>(calls[1]));
+    REQUIRE(SUCCESS == get<1>(calls[1]));
+    REQUIRE(FAILED_WONT_RETRY == get<1>(calls[2]));
+  }
+
+  SECTION("coalesces batches within the window into one call per status") {
+    CallbackDispatcher dispatcher(100, milliseconds(200));
+    dispatcher.start(callback);
+    dispatcher.dispatch({"e1"}, SUCCESS);
+    dispatcher.dispatch({"e2"}, FAILED_WILL_RETRY);
+    dispatcher.dispatch({"e3"}, SUCCESS);
+    dispatcher.stop();
+
+    REQUIRE(2 == calls.size());
+    REQUIRE(list<string>({"e1", "e3"}) == get<0>(calls[0]));
+    REQUIRE(SUCCESS == get<1>(calls[0]));
+    REQUIRE(list<string>({"e2"}) == get<0>(calls[1]));
+    REQUIRE(FAILED_WILL_RETRY == get<1>(calls[1]));
+  }
+
+  SECTION("merges event IDs into pending deliveries when the queue is full") {
+    CallbackDispatcher dispatcher(2);
+    // not started, so deliveries stay queued
+    dispatcher.dispatch({"e1"}, SUCCESS);
+    dispatcher.dispatch({"e2"}, FAILED_WILL_RETRY);
+    dispatcher.dispatch({"e3"}, SUCCESS);
+    dispatcher.start(callback);
+    dispatcher.stop();
+
+    REQUIRE(2 == calls.size());
+    REQUIRE(list<string>({"e1", "e3"}) == get<0>(calls[0]));
+    REQUIRE(list<string>({"e2"}) == get<0>(calls[1]));
+  }
+
+  SECTION("drops and counts event IDs beyond the maximum number of queued event IDs") {
+    CallbackDispatcher dispatcher(100, milliseconds(0), 3);
+    // not started, so deliveries stay queued
+    dispatcher.dispatch({"e1", "e2"}, SUCCESS);
+    dispatcher.dispatch({"e3", "e4"}, FAILED_WILL_RETRY);
+    dispatcher.dispatch({"e5"}, SUCCESS);
+    REQUIRE(2 == dispatcher.get_dropped_event_id_count());
+
+    dispatcher.start(callback);
+    dispatcher.stop();
+    REQUIRE(2 == calls.size());
+    REQUIRE(list<string>({"e1", "e2"}) == get<0>(calls[0]));
+    REQUIRE(list<string>({"e3"}) == get<0>(calls[1]));
+
+    // delivered event IDs make room again
+    dispatcher.dispatch({"e6"}, SUCCESS);
+    REQUIRE(2 == dispatcher.get_dropped_event_id_count());
+  }
+
+  SECTION("can be destroyed from within the callback") {
+    std::atomic<int> call_count(0);
+    CallbackDispatcher *dispatcher = new CallbackDispatcher();
+    dispatcher->start([&](list<string> event_ids, EmitStatus emit_status) {
+      if (call_count++ == 0) {
+        delete dispatcher;
+      }
+    });
+    dispatcher->dispatch({"e1"}, SUCCESS);
+    for (int i = 0; i < 100 && call_count < 1; i++) {
+      std::this_thread::sleep_for(milliseconds(10));
+    }
+    std::this_thread::sleep_for(milliseconds(50));
+    REQUIRE(1 == call_count);
+  }
+
+  SECTION("can be stopped from within the callback") {
+    CallbackDispatcher dispatcher;
+    std::atomic<int> call_count(0);
+    dispatcher.start([&](list<string> event_ids, EmitStatus emit_status) {
+      call_count++;
+      dispatcher.stop();
+    });
+    dispatcher.dispatch({"e1"}, SUCCESS);
+    dispatcher.dispatch({"e2"}, SUCCESS);
+    for (int i = 0; i < 100 && call_count < 2; i++) {
+      std::this_thread::sleep_for(milliseconds(10));
+    }
+    REQUIRE(2 == call_count);
+  }
+
+  SECTION("continues after a callback throws") {
+    CallbackDispatcher dispatcher;
+    int call_count = 0;
+    dispatcher.start([&](list<string> event_ids, EmitStatus emit_status) {
+      call_count++;
+      throw std::runtime_error("callback error");
+    });
+    dispatcher.dispatch({"e1"}, SUCCESS);
+    dispatcher.dispatch({"e2"}, SUCCESS);
+    dispatcher.stop();
+    REQUIRE(2 == call_count);
+  }
+}
@@ -0,0 +1,75 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "../../include/snowplow/emitter/circuit_breaker.hpp"
+#include "../catch.hpp"
+
+using namespace snowplow;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+TEST_CASE("CircuitBreaker") {
+  auto now = steady_clock::now();
+
+  SECTION("disabled circuit breaker stays closed") {
+    CircuitBreaker circuit_breaker;
+    for (int i = 0; i < 10; i++) {
+      circuit_breaker.record_failure(now);
+    }
+    REQUIRE(CircuitBreaker::CLOSED == circuit_breaker.get_state());
+    REQUIRE(circuit_breaker.allows_requests(now));
+  }
+
+  SECTION("opens after consecutive failures") {
+    CircuitBreaker circuit_breaker(3, milliseconds(1000));
+    circuit_breaker.record_failure(now);
+    circuit_breaker.record_failure(now);
+    circuit_breaker.record_success();
+    circuit_breaker.record_failure(now);
+    circuit_breaker.record_failure(now);
+    REQUIRE(CircuitBreaker::CLOSED == circuit_breaker.get_state());
+
+    circuit_breaker.record_failure(now);
+    REQUIRE(CircuitBreaker::OPEN == circuit_breaker.get_state());
+    REQUIRE(now + milliseconds(1000) == circuit_breaker.get_open_until());
+    REQUIRE_FALSE(circuit_breaker.allows_requests(now + milliseconds(999)));
+
+    // failures of requests sent before the circuit opened don't extend it
+    circuit_breaker.record_failure(now + milliseconds(500));
+    REQUIRE(now + milliseconds(1000) == circuit_breaker.get_open_until());
+  }
+
+  SECTION("lets a single probe through when half-open") {
+    CircuitBreaker circuit_breaker(1, milliseconds(1000));
+    circuit_breaker.record_failure(now);
+
+    auto later = now + milliseconds(1000);
+    REQUIRE(circuit_breaker.allows_requests(later));
+    REQUIRE(CircuitBreaker::HALF_OPEN == circuit_breaker.get_state());
+    circuit_breaker.record_request();
+    REQUIRE_FALSE(circuit_breaker.allows_requests(later));
+
+    SECTION("closes if the probe succeeds") {
+      circuit_breaker.record_success();
+      REQUIRE(CircuitBreaker::CLOSED == circuit_breaker.get_state());
+      REQUIRE(circuit_breaker.allows_requests(later));
+    }
+
+    SECTION("opens again if the probe fails") {
+      circuit_breaker.record_failure(later);
+      REQUIRE(CircuitBreaker::OPEN == circuit_breaker.get_state());
+      REQUIRE(later + milliseconds(1000) == circuit_breaker.get_open_until());
+      REQUIRE_FALSE(circuit_breaker.allows_requests(later));
+    }
+  }
+}
@@ -38,6 +38,7 @@ string track_sample_event(Emitter &emitter) {
 
 TEST_CASE("emitter") {
   auto storage = std::make_shared<SqliteStorage>("test-emitter.db");
+  storage->delete_all_event_rows(); // events left over from sections interrupted by stop() may wait for a retry
 
   SECTION("Correctly initialized using NetworkConfiguration and EmitterConfiguration") {
     NetworkConfiguration network_config("http://127.0.0.1:9090", GET);
@@ -439,4 +440,579 @@ TEST_CASE("emitter") {
     TestHttpClient::reset();
     remove("test-emitter-retrystop.db");
   }
+  SECTION("stop() aborts a hung request and keeps its events") {
+    auto test_storage = std::make_shared<SqliteStorage>("test-emitter-hungstop.db");
+    test_storage->delete_all_event_rows();
+    TestHttpClient::set_response_delay_ms(10000);
+
+    Emitter emitter(test_storage, "com.acme.collector", Method::POST, Protocol::HTTP, 500, 500, 500, unique_ptr<HttpClient>(new TestHttpClient()));
+    emitter.start();
+
+    Payload payload;
+    payload.add("e", "pv");
+    emitter.add(payload);
+
+    // Give the daemon time to pick up the event and block in the request
+    sleep_for(milliseconds(100));
+
+    auto t_start = std::chrono::high_resolution_clock::now();
+    emitter.stop();
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double elapsed_ms = std::chrono::duration<double, std::milli>(t_end - t_start).count();
+    REQUIRE(elapsed_ms < 2000);
+
+    list<EventRow> remaining;
+    test_storage->get_all_event_rows(&remaining);
+    REQUIRE(1 == remaining.size());
+
+    // the aborted request doesn't count as an attempt, so the event isn't given up on
+    REQUIRE(0 == remaining.front().attempts);
+    REQUIRE(0 == test_storage->get_next_attempt_at_ms());
+    NetworkConfiguration network_config("com.acme.collector", POST);
+    network_config.set_http_client(unique_ptr<HttpClient>(new TestHttpClient()));
+    EmitterConfiguration emitter_config(test_storage);
+    emitter_config.set_max_attempts(1);
+    emitter_config.set_circuit_breaker(1, 60000);
+    Emitter limited_emitter(network_config, emitter_config);
+    limited_emitter.start();
+    sleep_for(milliseconds(100));
+    limited_emitter.stop();
+    remaining.clear();
+    test_storage->get_all_event_rows(&remaining);
+    REQUIRE(1 == remaining.size());
+    REQUIRE(CircuitBreaker::CLOSED == limited_emitter.get_circuit_breaker_state());
+    list<EventRow> dead_letter_rows;
+    test_storage->get_all_dead_letter_event_rows(&dead_letter_rows);
+    REQUIRE(dead_letter_rows.empty());
+
+    TestHttpClient::reset();
+    remove("test-emitter-hungstop.db");
+  }
+
+  SECTION("request timeout aborts a slow request which is then retried") {
+    auto test_storage = std::make_shared<SqliteStorage>("test-emitter-reqtimeout.db");
+    test_storage->delete_all_event_rows();
+    TestHttpClient::set_response_delay_ms(10000);
+
+    auto client = unique_ptr<HttpClient>(new TestHttpClient());
+    client->set_request_timeout_ms(50);
+    Emitter emitter(test_storage, "com.acme.collector", Method::POST, Protocol::HTTP, 500, 500, 500, std::move(client));
+    emitter.start();
+
+    Payload payload;
+    payload.add("e", "pv");
+    emitter.add(payload);
+
+    sleep_for(milliseconds(300));
+    // no request got through but the event is kept for retry
+    REQUIRE(0 == TestHttpClient::get_requests_list().size());
+    list<EventRow> remaining;
+    test_storage->get_all_event_rows(&remaining);
+    REQUIRE(1 == remaining.size());
+
+    TestHttpClient::set_response_delay_ms(0);
+    emitter.flush();
+    REQUIRE(1 == TestHttpClient::get_requests_list().size());
+    remaining.clear();
+    test_storage->get_all_event_rows(&remaining);
+    REQUIRE(0 == remaining.size());
+
+    TestHttpClient::reset();
+    remove("test-emitter-reqtimeout.db");
+  }
+
+  SECTION("keeps at most the configured number of requests in flight") {
+    auto test_storage = std::make_shared<SqliteStorage>("test-emitter-window.db");
+    test_storage->delete_all_event_rows();
+    TestHttpClient::set_response_delay_ms(100);
+
+    NetworkConfiguration network_config("com.acme.collector", GET);
+    network_config.set_http_client(unique_ptr<HttpClient>(new TestHttpClient()));
+    EmitterConfiguration emitter_config(test_storage);
+    emitter_config.set_max_requests_in_flight(2);
+    Emitter emitter(network_config, emitter_config);
+    REQUIRE(2 == emitter.get_max_requests_in_flight());
+
+    Payload payload;
+    payload.add("e", "pv");
+    for (int i = 0; i < 6; i++) {
+      emitter.add(payload);
+    }
+
+    auto t_start = std::chrono::high_resolution_clock::now();
+    emitter.start();
+    emitter.flush();
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double elapsed_ms = std::chrono::duration<double, std::milli>(t_end - t_start).count();
+
+    // 6 requests, 2 at a time
+    REQUIRE(6 == TestHttpClient::get_requests_list().size());
+    REQUIRE(elapsed_ms >= 300);
+    list<EventRow> remaining;
+    test_storage->get_all_event_rows(&remaining);
+    REQUIRE(0 == remaining.size());
+
+    TestHttpClient::reset();
+    remove("test-emitter-window.db");
+  }
+
+  SECTION("waits for the delay requested in the Retry-After header") {
+    TestHttpClient::set_temporary_response_code(503);
+    TestHttpClient::set_retry_after("1");
+
+    Emitter emitter(storage, "com.acme.collector", Method::POST, Protocol::HTTP, 500, 500, 500, unique_ptr<HttpClient>(new TestHttpClient()));
+    auto t_start = std::chrono::high_resolution_clock::now();
+    track_sample_event(emitter);
+    auto t_end = std::chrono::high_resolution_clock::now();
+    double elapsed_ms = std::chrono::duration<double, std::milli>(t_end - t_start).count();
+
+    REQUIRE(2 == TestHttpClient::get_requests_list().size());
+    REQUIRE(elapsed_ms >= 1000);
+
+    TestHttpClient::reset();
+  }
+
+  SECTION("circuit breaker pauses requests to a failing collector and probes with a single event") {
+    auto test_storage = std::make_shared<SqliteStorage>("test-emitter-circuit.db");
+    test_storage->delete_all_event_rows();
+    TestHttpClient::set_http_response_code(503);
+
+    NetworkConfiguration network_config("com.acme.collector", POST);
+    network_config.set_http_client(unique_ptr<HttpClient>(new TestHttpClient()));
+    EmitterConfiguration emitter_config(test_storage);
+    emitter_config.set_circuit_breaker(2, 500);
+    Emitter emitter(network_config, emitter_config);
+
+    Payload payload;
+    payload.add("e", "pv");
+    for (int i = 0; i < 5; i++) {
+      emitter.add(payload);
+    }
+    emitter.start();
+
+    // two failed requests (100 ms retry delay in between) open the circuit
+    sleep_for(milliseconds(300));
+    REQUIRE(CircuitBreaker::OPEN == emitter.get_circuit_breaker_state());
+    REQUIRE(2 == TestHttpClient::get_requests_list().size());
+
+    // the probe request after the open duration contains a single event
+    TestHttpClient::set_http_response_code(200);
+    emitter.flush();
+    auto requests = TestHttpClient::get_requests_list();
+    REQUIRE(4 == requests.size());
+    REQUIRE(1 == (++(++requests.begin()))->row_ids.size());
+    REQUIRE(4 == requests.back().row_ids.size());
+    REQUIRE(CircuitBreaker::CLOSED == emitter.get_circuit_breaker_state());
+
+    list<EventRow> remaining;
+    test_storage->get_all_event_rows(&remaining);
+    REQUIRE(0 == remaining.size());
+
+    TestHttpClient::reset();
+    remove("test-emitter-circuit.db");
+  }
+
+  SECTION("opens the circuit of a failing endpoint while others keep theirs closed") {
+    auto test_storage = std::make_shared<SqliteStorage>("test-emitter-circuit.db");
+    test_storage->delete_all_event_rows();
+    TestHttpClient::set_http_response_code_for_host("b.collector", 503);
+    auto count_requests_to = [](const string &hostname) {
+      int count = 0;
+      for (auto const &request : TestHttpClient::get_requests_list()) {
+        count += request.hostname == hostname ? 1 : 0;
+      }
+      return count;
+    };
+
+    NetworkConfiguration network_config("http://a.collector", GET);
+    network_config.add_collector_endpoint("http://b.collector");
+    network_config.set_http_client(unique_ptr<HttpClient>(new TestHttpClient()));
+    EmitterConfiguration emitter_config(test_storage);
+    emitter_config.set_circuit_breaker(2, 60000);
+    Emitter emitter(network_config, emitter_config);
+
+    Payload payload;
+    payload.add("e", "pv");
+    for (int i = 0; i < 50 && emitter.get_circuit_breaker_state(1) != CircuitBreaker::OPEN; i++) {
+      emitter.add(payload);
+      emitter.add(payload);
+      emitter.start();
+      emitter.flush();
+      sleep_for(milliseconds(50));
+    }
+
+    // failed over events don't count against the healthy endpoint
+    REQUIRE(CircuitBreaker::OPEN == emitter.get_circuit_breaker_state(1));
+    REQUIRE(CircuitBreaker::CLOSED == emitter.get_circuit_breaker_state(0));
+    REQUIRE(CircuitBreaker::CLOSED == emitter.get_circuit_breaker_state());
+    REQUIRE(2 == count_requests_to("b.collector"));
+
+    // the open endpoint is skipped
+    for (int i = 0; i < 5; i++) {
+      emitter.add(payload);
+    }
+    emitter.start();
+    emitter.flush();
+    REQUIRE(2 == count_requests_to("b.collector"));
+    list<EventRow> rows;
+    test_storage->get_all_event_rows(&rows);
+    REQUIRE(rows.empty());
+
+    TestHttpClient::reset();
+    remove("test-emitter-circuit.db");
+  }
+
+  SECTION("moves events to the dead-letter table after max attempts without blocking other events") {
+    auto test_storage = std::make_shared<SqliteStorage>("test-emitter-deadletter.db");
+    test_storage->delete_all_event_rows();
+    test_storage->delete_all_dead_letter_event_rows();
+    TestHttpClient::set_http_response_code(500);
+
+    list<string> failed_event_ids;
+    NetworkConfiguration network_config("com.acme.collector", GET);
+    network_config.set_http_client(unique_ptr<HttpClient>(new TestHttpClient()));
+    EmitterConfiguration emitter_config(test_storage);
+    emitter_config.set_max_attempts(3);
+    emitter_config.set_request_callback([&](list<string> event_ids, EmitStatus status) {
+      failed_event_ids.splice(failed_event_ids.end(), event_ids);
+    }, FAILED_WONT_RETRY);
+    Emitter emitter(network_config, emitter_config);
+    REQUIRE(3 == emitter.get_max_attempts());
+
+    EventPayload payload;
+    payload.add("e", "pv");
+    emitter.add(payload);
+    emitter.start();
+    emitter.flush();
+
+    // 3 attempts, then the event is given up on
+    REQUIRE(3 == TestHttpClient::get_requests_list().size());
+    list<EventRow> rows;
+    test_storage->get_all_event_rows(&rows);
+    REQUIRE(0 == rows.size());
+    test_storage->get_all_dead_letter_event_rows(&rows);
+    REQUIRE(1 == rows.size());
+    REQUIRE(3 == rows.front().attempts);
+    REQUIRE(1 == failed_event_ids.size());
+    REQUIRE(payload.get_event_id() == failed_event_ids.front());
+
+    TestHttpClient::reset();
+    remove("test-emitter-deadletter.db");
+  }
+
+  SECTION("failing events wait for their next attempt while later events are sent") {
+    auto test_storage = std::make_shared<SqliteStorage>("test-emitter-nextattempt.db");
+    test_storage->delete_all_event_rows();
+
+    Emitter emitter(test_storage, "com.acme.collector", Method::GET, Protocol::HTTP, 500, 500, 500, unique_ptr<HttpClient>(new TestHttpClient()));
+    Payload payload;
+    payload.add("e", "pv");
+    emitter.add(payload);
+    list<EventRow> rows;
+    test_storage->get_all_event_rows(&rows);
+    test_storage->record_failed_attempt({rows.front().id}, Utils::get_unix_epoch_ms() + 60000);
+
+    emitter.start();
+    emitter.add(payload);
+    sleep_for(milliseconds(200));
+
+    // only the second event was sent
+    REQUIRE(1 == TestHttpClient::get_requests_list().size());
+    rows.clear();
+    test_storage->get_all_event_rows(&rows);
+    REQUIRE(1 == rows.size());
+    REQUIRE(1 == rows.front().attempts);
+
+    emitter.stop();
+    TestHttpClient::reset();
+    remove("test-emitter-nextattempt.db");
+  }
+
+  SECTION("applies the queue overflow policy when the event queue is full") {
+    auto test_storage = std::make_shared<SqliteStorage>("test-emitter-overflow.db");
+    auto emitter_for_policy = [&](QueueOverflowPolicy policy, int max_events, long long max_bytes) {
+      test_storage->delete_all_event_rows();
+      NetworkConfiguration network_config("com.acme.collector", GET);
+      network_config.set_http_client(unique_ptr<HttpClient>(new TestHttpClient()));
+      EmitterConfiguration emitter_config(test_storage);
+      emitter_config.set_max_queue_size(max_events, max_bytes);
+      emitter_config.set_queue_overflow_policy(policy, 50);
+      return unique_ptr<Emitter>(new Emitter(network_config, emitter_config));
+    };
+    auto add_events = [](Emitter &emitter, int count) {
+      for (int i = 0; i < count; i++) {
+        Payload payload;
+        payload.add("e", "pv");
+        payload.add("i", std::to_string(i));
+        emitter.add(payload);
+      }
+    };
+    list<EventRow> rows;
+
+    // the emitter isn't started so the queue only grows
+    auto emitter = emitter_for_policy(DROP_NEWEST, 3, 0);
+    add_events(*emitter, 5);
+    test_storage->get_all_event_rows(&rows);
+    REQUIRE(3 == rows.size());
+    REQUIRE("0" == rows.front().event.get_value("i"));
+    REQUIRE(2 == emitter->get_dropped_event_count());
+
+    emitter = emitter_for_policy(DROP_OLDEST, 3, 0);
+    add_events(*emitter, 5);
+    rows.clear();
+    test_storage->get_all_event_rows(&rows);
+    REQUIRE(3 == rows.size());
+    REQUIRE("2" == rows.front().event.get_value("i"));
+    REQUIRE("4" == rows.back().event.get_value("i"));
+    REQUIRE(2 == emitter->get_dropped_event_count());
+
+    emitter = emitter_for_policy(SAMPLE, 10, 0);
+    add_events(*emitter, 100);
+    rows.clear();
+    test_storage->get_all_event_rows(&rows);
+    REQUIRE(10 == rows.size());
+    REQUIRE(90 == emitter->get_dropped_event_count());
+
+    emitter = emitter_for_policy(BLOCK, 2, 0);
+    auto started = std::chrono::steady_clock::now();
+    add_events(*emitter, 3);
+    REQUIRE(std::chrono::steady_clock::now() - started >= milliseconds(50));
+    REQUIRE(1 == emitter->get_dropped_event_count());
+
+    // byte limit allows only as many events as fit
+    Payload sample;
+    sample.add("e", "pv");
+    sample.add("i", "0");
+    emitter = emitter_for_policy(DROP_NEWEST, 0, 2 * Utils::serialize_payload(sample).length());
+    add_events(*emitter, 3);
+    rows.clear();
+    test_storage->get_all_event_rows(&rows);
+    REQUIRE(2 == rows.size());
+    REQUIRE(1 == emitter->get_dropped_event_count());
+
+    // events in flight are kept, so the new event is dropped if all queued events are in flight
+    TestHttpClient::set_response_delay_ms(300);
+    emitter = emitter_for_policy(DROP_OLDEST, 2, 0);
+    add_events(*emitter, 2);
+    emitter->start();
+    sleep_for(milliseconds(100));
+    add_events(*emitter, 1);
+    REQUIRE(1 == emitter->get_dropped_event_count());
+    emitter->flush();
+    rows.clear();
+    test_storage->get_all_event_rows(&rows);
+    REQUIRE(rows.empty());
+    REQUIRE(2 == TestHttpClient::get_requests_list().size());
+
+    emitter.reset();
+    TestHttpClient::reset();
+    remove("test-emitter-overflow.db");
+  }
+
+  SECTION("blocked track call continues once sent events make room in the queue") {
+    auto test_storage = std::make_shared<SqliteStorage>("test-emitter-block.db");
+    test_storage->delete_all_event_rows();
+    TestHttpClient::set_response_delay_ms(100);
+    NetworkConfiguration network_config("com.acme.collector", GET);
+    network_config.set_http_client(unique_ptr<HttpClient>(new TestHttpClient()));
+    EmitterConfiguration emitter_config(test_storage);
+    emitter_config.set_max_queue_size(1);
+    emitter_config.set_queue_overflow_policy(BLOCK, 5000);
+    Emitter emitter(network_config, emitter_config);
+    emitter.start();
+
+    Payload payload;
+    payload.add("e", "pv");
+    emitter.add(payload);
+    emitter.add(payload);
+    emitter.flush();
+
+    REQUIRE(0 == emitter.get_dropped_event_count());
+    REQUIRE(2 == TestHttpClient::get_requests_list().size());
+
+    emitter.stop();
+    TestHttpClient::reset();
+    remove("test-emitter-block.db");
+  }
+
+  SECTION("spreads requests across weighted collector endpoints and fails over") {
+    auto test_storage = std::make_shared<SqliteStorage>("test-emitter-endpoints.db");
+    test_storage->delete_all_event_rows();
+    auto count_requests_to = [](const string &hostname) {
+      int count = 0;
+      for (auto const &request : TestHttpClient::get_requests_list()) {
+        count += request.hostname == hostname ? 1 : 0;
+      }
+      return count;
+    };
+    auto add_events = [](Emitter &emitter, int count) {
+      Payload payload;
+      payload.add("e", "pv");
+      for (int i = 0; i < count; i++) {
+        emitter.add(payload);
+      }
+    };
+
+    NetworkConfiguration network_config("http://a.collector", GET);
+    network_config.add_collector_endpoint("http://b.collector", 2);
+    network_config.set_http_client(unique_ptr<HttpClient>(new TestHttpClient()));
+    Emitter emitter(network_config, EmitterConfiguration(test_storage));
+    REQUIRE(2 == emitter.get_collector_urls().size());
+    REQUIRE("b.collector" == emitter.get_collector_urls()[1].get_hostname());
+
+    add_events(emitter, 6);
+    emitter.start();
+    emitter.flush();
+    REQUIRE(2 == count_requests_to("a.collector"));
+    REQUIRE(4 == count_requests_to("b.collector"));
+
+    // events of requests to the failing endpoint are sent to the healthy one
+    TestHttpClient::reset();
+    TestHttpClient::set_http_response_code_for_host("b.collector", 500);
+    add_events(emitter, 6);
+    emitter.start();
+    emitter.flush();
+    list<EventRow> rows;
+    test_storage->get_all_event_rows(&rows);
+    REQUIRE(0 == rows.size());
+    REQUIRE(6 == count_requests_to("a.collector"));
+    REQUIRE(count_requests_to("b.collector") >= 1);
+
+    TestHttpClient::reset();
+    remove("test-emitter-endpoints.db");
+  }
+
+  SECTION("skips a failed over endpoint for the delay requested in its Retry-After header") {
+    auto test_storage = std::make_shared<SqliteStorage>("test-emitter-endpoints.db");
+    test_storage->delete_all_event_rows();
+    TestHttpClient::set_http_response_code_for_host("b.collector", 503);
+    TestHttpClient::set_retry_after("2");
+    auto count_requests_to = [](const string &hostname) {
+      int count = 0;
+      for (auto const &request : TestHttpClient::get_requests_list()) {
+        count += request.hostname == hostname ? 1 : 0;
+      }
+      return count;
+    };
+
+    NetworkConfiguration network_config("http://a.collector", GET);
+    network_config.add_collector_endpoint("http://b.collector");
+    network_config.set_http_client(unique_ptr<HttpClient>(new TestHttpClient()));
+    Emitter emitter(network_config, EmitterConfiguration(test_storage));
+
+    Payload payload;
+    payload.add("e", "pv");
+    for (int i = 0; i < 4; i++) {
+      emitter.add(payload);
+    }
+    emitter.start();
+    emitter.flush();
+    int requests_to_b = count_requests_to("b.collector");
+    REQUIRE(requests_to_b >= 1);
+
+    // the failed endpoint stays out of rotation well beyond its back-off
+    sleep_for(milliseconds(500));
+    for (int i = 0; i < 4; i++) {
+      emitter.add(payload);
+    }
+    emitter.start();
+    emitter.flush();
+    list<EventRow> rows;
+    test_storage->get_all_event_rows(&rows);
+    REQUIRE(rows.empty());
+    REQUIRE(requests_to_b == count_requests_to("b.collector"));
+
+    TestHttpClient::reset();
+    remove("test-emitter-endpoints.db");
+  }
+
+  SECTION("drops events repeating the deduplication fields within the window") {
+    auto test_storage = std::make_shared<SqliteStorage>("test-emitter-dedup.db");
+    test_storage->delete_all_event_rows();
+    NetworkConfiguration network_config("com.acme.collector", GET);
+    network_config.set_http_client(unique_ptr<HttpClient>(new TestHttpClient()));
+    EmitterConfiguration emitter_config(test_storage);
+    emitter_config.set_deduplication({"se_ca", "se_ac"}, 60000);
+    Emitter emitter(network_config, emitter_config);
+
+    for (int i = 0; i < 3; i++) {
+      Payload payload;
+      payload.add("eid", std::to_string(i));
+      payload.add("se_ca", "category");
+      payload.add("se_ac", "action");
+      emitter.add(payload);
+    }
+    Payload other;
+    other.add("se_ca", "category");
+    other.add("se_ac", "other");
+    emitter.add(other);
+
+    list<EventRow> rows;
+    test_storage->get_all_event_rows(&rows);
+    REQUIRE(2 == rows.size());
+    REQUIRE("0" == rows.front().event.get_value("eid"));
+    REQUIRE(2 == emitter.get_deduplication_hit_count());
+    REQUIRE(2 == emitter.get_deduplication_miss_count());
+    REQUIRE(emitter.get_deduplication_false_positive_rate() < 0.001);
+
+    remove("test-emitter-dedup.db");
+  }
+
+  SECTION("adds a batch of events to the event store at once") {
+    auto test_storage = std::make_shared<SqliteStorage>("test-emitter-batch.db");
+    test_storage->delete_all_event_rows();
+    NetworkConfiguration network_config("com.acme.collector", GET);
+    network_config.set_http_client(unique_ptr<HttpClient>(new TestHttpClient()));
+    EmitterConfiguration emitter_config(test_storage);
+    emitter_config.set_deduplication({"eid"}, 60000);
+    Emitter emitter(network_config, emitter_config);
+
+    list<Payload> payloads;
+    for (int i = 0; i < 4; i++) {
+      Payload payload;
+      payload.add("eid", std::to_string(i % 3));
+      payloads.push_back(payload);
+    }
+    emitter.add_batch(payloads);
+
+    list<EventRow> rows;
+    test_storage->get_all_event_rows(&rows);
+    REQUIRE(3 == rows.size());
+    REQUIRE("2" == rows.back().event.get_value("eid"));
+    REQUIRE(1 == emitter.get_deduplication_hit_count());
+
+    remove("test-emitter-batch.db");
+  }
+
+  SECTION("reclaims storage space once the queue drains") {
+    remove("test-emitter-maintenance.db");
+    auto test_storage = std::make_shared<SqliteStorage>("test-emitter-maintenance.db");
+    Emitter emitter(test_storage, "com.acme.collector", Method::POST, Protocol::HTTPS, 500, 52000, 52000, unique_ptr<HttpClient>(new TestHttpClient()));
+
+    Payload payload;
+    payload.add("e", "pv");
+    payload.add("url", string(2000, 'x'));
+    for (int i = 0; i < 500; i++) {
+      emitter.add(payload);
+    }
+    unsigned long long file_byte_size = 0;
+    unsigned long long wal_byte_size = 0;
+    REQUIRE(test_storage->get_storage_size(&file_byte_size, &wal_byte_size));
+    REQUIRE(500 * 2000 < file_byte_size + wal_byte_size);
+
+    emitter.start();
+    emitter.flush();
+    emitter.stop();
+
+    list<EventRow> rows;
+    test_storage->get_all_event_rows(&rows);
+    REQUIRE(rows.empty());
+    REQUIRE(test_storage->get_storage_size(&file_byte_size, &wal_byte_size));
+    REQUIRE(0 == wal_byte_size);
+    REQUIRE(file_byte_size < 100 * 1024);
+
+    TestHttpClient::reset();
+    remove("test-emitter-maintenance.db");
+  }
 }
+
@@ -0,0 +1,110 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "../../include/snowplow/emitter/event_deduplicator.hpp"
+#include "../catch.hpp"
+
+using namespace snowplow;
+using std::invalid_argument;
+using std::to_string;
+
+namespace {
+Payload event_payload(const string &category, const string &action, const string &event_id) {
+  Payload payload;
+  payload.add("eid", event_id);
+  payload.add("se_ca", category);
+  payload.add("se_ac", action);
+  return payload;
+}
+} // namespace
+
+TEST_CASE("EventDeduplicator") {
+  auto now = steady_clock::now();
+  vector<string> fields = {"se_ca", "se_ac"};
+
+  SECTION("validates the configuration") {
+    REQUIRE_THROWS_AS(EventDeduplicator({}, milliseconds(100), 10, 0.01), invalid_argument);
+    REQUIRE_THROWS_AS(EventDeduplicator(fields, milliseconds(0), 10, 0.01), invalid_argument);
+    REQUIRE_THROWS_AS(EventDeduplicator(fields, milliseconds(100), 0, 0.01), invalid_argument);
+    REQUIRE_THROWS_AS(EventDeduplicator(fields, milliseconds(100), 10, 0), invalid_argument);
+  }
+
+  SECTION("sizes the Bloom filters for the capacity and false positive rate") {
+    EventDeduplicator deduplicator(fields, milliseconds(100), 1000, 0.01);
+    // 9.59 bits and 7 hashes per event for 1% false positives
+    REQUIRE(deduplicator.get_filter_bits() >= 9586);
+    REQUIRE(deduplicator.get_filter_bits() < 9586 + 64);
+    REQUIRE(7 == deduplicator.get_hash_count());
+    REQUIRE(0 == deduplicator.get_false_positive_rate());
+  }
+
+  SECTION("detects repeated fields regardless of other fields") {
+    EventDeduplicator deduplicator(fields, milliseconds(1000), 100, 0.001);
+    REQUIRE(!deduplicator.is_duplicate(event_payload("c", "a", "1"), now));
+    REQUIRE(deduplicator.is_duplicate(event_payload("c", "a", "2"), now));
+    REQUIRE(!deduplicator.is_duplicate(event_payload("c", "b", "3"), now));
+    // field boundaries are part of the hash
+    REQUIRE(!deduplicator.is_duplicate(event_payload("ca", "", "4"), now));
+    // events without any of the fields are kept
+    REQUIRE(!deduplicator.is_duplicate(Payload(), now));
+    REQUIRE(!deduplicator.is_duplicate(Payload(), now));
+
+    REQUIRE(1 == deduplicator.get_hit_count());
+    REQUIRE(5 == deduplicator.get_miss_count());
+  }
+
+  SECTION("forgets events after two windows") {
+    EventDeduplicator deduplicator(fields, milliseconds(100), 100, 0.001);
+    REQUIRE(!deduplicator.is_duplicate(event_payload("c", "a", "1"), now));
+    REQUIRE(deduplicator.is_duplicate(event_payload("c", "a", "2"), now + milliseconds(150)));
+    REQUIRE(!deduplicator.is_duplicate(event_payload("c", "a", "3"), now + milliseconds(250)));
+  }
+
+  SECTION("forgets events after an idle gap of more than two windows") {
+    EventDeduplicator deduplicator(fields, milliseconds(100), 100, 0.001);
+    REQUIRE(!deduplicator.is_duplicate(event_payload("c", "a", "1"), now));
+    REQUIRE(!deduplicator.is_duplicate(event_payload("c", "a", "2"), now + std::chrono::hours(1)));
+    REQUIRE(deduplicator.is_duplicate(event_payload("c", "a", "3"), now + std::chrono::hours(1) + milliseconds(50)));
+    REQUIRE(1 == deduplicator.get_hit_count());
+  }
+
+  SECTION("forgets events after two times the capacity") {
+    EventDeduplicator deduplicator(fields, milliseconds(60000), 10, 0.001);
+    REQUIRE(!deduplicator.is_duplicate(event_payload("c", "first", "1"), now));
+    for (int i = 0; i < 9; i++) {
+      deduplicator.is_duplicate(event_payload("c", to_string(i), "1"), now);
+    }
+    REQUIRE(deduplicator.is_duplicate(event_payload("c", "first", "2"), now));
+    for (int i = 10; i < 30; i++) {
+      deduplicator.is_duplicate(event_payload("c", to_string(i), "1"), now);
+    }
+    REQUIRE(!deduplicator.is_duplicate(event_payload("c", "first", "3"), now));
+  }
+
+  SECTION("false positive rate stays close to the target") {
+    EventDeduplicator deduplicator(fields, milliseconds(60000), 10000, 0.01);
+    for (int i = 0; i < 10000; i++) {
+      deduplicator.is_duplicate(event_payload("inserted", to_string(i), ""), now);
+    }
+    int false_positives = 0;
+    for (int i = 0; i < 10000; i++) {
+      if (deduplicator.is_duplicate(event_payload("new", to_string(i), ""), now + milliseconds(1))) {
+        false_positives++;
+      }
+    }
+    // the new events partly land in the next filter, so the observed rate is at most the target
+    REQUIRE(false_positives < 200);
+    REQUIRE(deduplicator.get_false_positive_rate() > 0.005);
+    REQUIRE(deduplicator.get_false_positive_rate() < 0.03);
+  }
+}
@@ -0,0 +1,139 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "../../include/snowplow/emitter/fan_out_emitter.hpp"
+#include "../../include/snowplow/payload/event_payload.hpp"
+#include "../../include/snowplow/storage/sqlite_storage.hpp"
+#include "../http/test_http_client.hpp"
+#include "../catch.hpp"
+
+using namespace snowplow;
+using std::invalid_argument;
+using std::make_shared;
+using std::runtime_error;
+using std::unique_ptr;
+
+namespace {
+// records the serialized batches passed to the store
+struct SerializedBatchStorage : public SqliteStorage {
+  SerializedBatchStorage(const string &db_name) : SqliteStorage(db_name) {}
+
+  void add_serialized_events(const list<Payload> &payloads, const list<string> &serialized_payloads) {
+    serialized_batches.push_back(serialized_payloads);
+    SqliteStorage::add_serialized_events(payloads, serialized_payloads);
+  }
+
+  list<list<string>> serialized_batches;
+};
+
+struct FailingFlushEmitter : public Emitter {
+  FailingFlushEmitter(NetworkConfiguration &network_config, const EmitterConfiguration &emitter_config) :
+    Emitter(network_config, emitter_config) {}
+
+  void flush() { throw runtime_error("flush failed"); }
+};
+} // namespace
+
+TEST_CASE("FanOutEmitter") {
+  auto storage_a = make_shared<SqliteStorage>("test-fan-out-a.db");
+  auto storage_b = make_shared<SqliteStorage>("test-fan-out-b.db");
+  storage_a->delete_all_event_rows();
+  storage_b->delete_all_event_rows();
+
+  auto create_destination = [](const string &collector_url, shared_ptr<EventStore> storage) {
+    NetworkConfiguration network_config(collector_url, POST);
+    network_config.set_http_client(unique_ptr<HttpClient>(new TestHttpClient()));
+    EmitterConfiguration emitter_config(storage);
+    emitter_config.set_flush_timeout_ms(300);
+    return make_shared<Emitter>(network_config, emitter_config);
+  };
+
+  SECTION("requires destination emitters") {
+    REQUIRE_THROWS_AS(FanOutEmitter({}), invalid_argument);
+    REQUIRE_THROWS_AS(FanOutEmitter({nullptr}), invalid_argument);
+  }
+
+  SECTION("adds the same serialized event to all destination stores") {
+    FanOutEmitter emitter({create_destination("http://a.collector", storage_a), create_destination("http://b.collector", storage_b)});
+    REQUIRE(2 == emitter.get_destinations().size());
+    REQUIRE("a.collector" == emitter.get_cracked_url().get_hostname());
+
+    EventPayload payload;
+    payload.add("e", "pv");
+    emitter.add(payload);
+
+    list<EventRow> rows_a;
+    list<EventRow> rows_b;
+    storage_a->get_all_event_rows(&rows_a);
+    storage_b->get_all_event_rows(&rows_b);
+    REQUIRE(1 == rows_a.size());
+    REQUIRE(1 == rows_b.size());
+    REQUIRE(payload.get_event_id() == rows_a.front().event.get_value("eid"));
+    REQUIRE(Utils::serialize_payload(rows_a.front().event) == Utils::serialize_payload(rows_b.front().event));
+  }
+
+  SECTION("adds a batch serialized once to all destination stores") {
+    auto recording_storage_a = make_shared<SerializedBatchStorage>("test-fan-out-a.db");
+    auto recording_storage_b = make_shared<SerializedBatchStorage>("test-fan-out-b.db");
+    FanOutEmitter emitter({create_destination("http://a.collector", recording_storage_a), create_destination("http://b.collector", recording_storage_b)});
+
+    list<Payload> payloads;
+    for (int i = 0; i < 3; i++) {
+      EventPayload payload;
+      payload.add("e", "pv");
+      payloads.push_back(payload);
+    }
+    emitter.add_batch(payloads);
+
+    REQUIRE(1 == recording_storage_a->serialized_batches.size());
+    REQUIRE(recording_storage_a->serialized_batches == recording_storage_b->serialized_batches);
+    REQUIRE(Utils::serialize_payload(payloads.front()) == recording_storage_a->serialized_batches.front().front());
+    list<EventRow> rows_a;
+    list<EventRow> rows_b;
+    recording_storage_a->get_all_event_rows(&rows_a);
+    recording_storage_b->get_all_event_rows(&rows_b);
+    REQUIRE(3 == rows_a.size());
+    REQUIRE(3 == rows_b.size());
+    REQUIRE(payloads.back().get_pairs() == rows_b.back().event.get_pairs());
+  }
+
+  SECTION("flush rethrows the exception of a destination") {
+    NetworkConfiguration network_config("http://b.collector", POST);
+    network_config.set_http_client(unique_ptr<HttpClient>(new TestHttpClient()));
+    auto failing_destination = make_shared<FailingFlushEmitter>(network_config, EmitterConfiguration(storage_b));
+    FanOutEmitter emitter({create_destination("http://a.collector", storage_a), failing_destination});
+    REQUIRE_THROWS_AS(emitter.flush(), runtime_error);
+  }
+
+  SECTION("a failing destination doesn't hold back the others") {
+    TestHttpClient::set_http_response_code_for_host("b.collector", 500);
+    FanOutEmitter emitter({create_destination("http://a.collector", storage_a), create_destination("http://b.collector", storage_b)});
+
+    EventPayload payload;
+    payload.add("e", "pv");
+    emitter.start();
+    emitter.add(payload);
+    emitter.add(payload);
+    emitter.flush();
+
+    list<EventRow> rows;
+    storage_a->get_all_event_rows(&rows);
+    REQUIRE(0 == rows.size());
+    storage_b->get_all_event_rows(&rows);
+    REQUIRE(2 == rows.size());
+  }
+
+  TestHttpClient::reset();
+  storage_a->delete_all_event_rows();
+  storage_b->delete_all_event_rows();
+}
@@ -45,10 +45,27 @@ TEST_CASE("RetryDelay") {
     for (int i = 0; i < 11; i++) {
       retry_delay.will_retry_emit();
     }
-    REQUIRE(retry_delay.get() != retry_delay.get());
+    auto delay1 = retry_delay.get();
+    retry_delay.will_retry_emit(); // retry count cap reached, only jitter differs
+    auto delay2 = retry_delay.get();
+    REQUIRE(delay1 != delay2);
     int expected = 102400;
-    REQUIRE(milliseconds(expected - expected / 10).count() < retry_delay.get().count());
-    REQUIRE(milliseconds(expected + expected / 10).count() > retry_delay.get().count());
+    REQUIRE(milliseconds(expected - expected / 10).count() < delay2.count());
+    REQUIRE(milliseconds(expected + expected / 10).count() > delay2.count());
+  }
+
+  SECTION("retry delay honors the delay requested by the collector") {
+    RetryDelay retry_delay(100, 2, 10, 0);
+    retry_delay.will_retry_emit(milliseconds(5000));
+    REQUIRE(milliseconds(5000) == retry_delay.get());
+
+    // exponential delay wins if longer
+    retry_delay.will_retry_emit(milliseconds(50));
+    REQUIRE(milliseconds(200) == retry_delay.get());
+
+    // requested delay is capped
+    retry_delay.will_retry_emit(milliseconds(24 * 60 * 60 * 1000));
+    REQUIRE(milliseconds(SNOWPLOW_EMITTER_MAX_RETRY_AFTER_MS) == retry_delay.get());
   }
 
   SECTION("retry delay resets if won't retry") {
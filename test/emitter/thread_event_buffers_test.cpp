@@ -0,0 +1,110 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "../../include/snowplow/emitter/thread_event_buffers.hpp"
+#include "../catch.hpp"
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace snowplow;
+using std::invalid_argument;
+using std::string;
+using std::thread;
+using std::to_string;
+
+namespace {
+Payload event_payload(int i) {
+  Payload payload;
+  payload.add("eid", to_string(i));
+  return payload;
+}
+} // namespace
+
+TEST_CASE("ThreadEventBuffers") {
+  SECTION("validates the configuration") {
+    REQUIRE_THROWS_AS(ThreadEventBuffers(0, 100), invalid_argument);
+  }
+
+  SECTION("hands over the buffer once it is full") {
+    ThreadEventBuffers buffers(3, 0);
+    list<Payload> batch;
+    REQUIRE(!buffers.add(event_payload(0), 1000, &batch));
+    REQUIRE(!buffers.add(event_payload(1), 1000, &batch));
+    REQUIRE(batch.empty());
+    REQUIRE(buffers.add(event_payload(2), 1000, &batch));
+    REQUIRE(3 == batch.size());
+    REQUIRE("0" == batch.front().get_pairs().at("eid"));
+    REQUIRE("2" == batch.back().get_pairs().at("eid"));
+    REQUIRE(buffers.take_all().empty());
+  }
+
+  SECTION("hands over the buffer once its oldest event is too old") {
+    ThreadEventBuffers buffers(100, 50);
+    list<Payload> batch;
+    REQUIRE(!buffers.add(event_payload(0), 1000, &batch));
+    REQUIRE(!buffers.add(event_payload(1), 1049, &batch));
+    REQUIRE(buffers.add(event_payload(2), 1050, &batch));
+    REQUIRE(3 == batch.size());
+
+    // the age is counted from the first event added after the hand over
+    batch.clear();
+    REQUIRE(!buffers.add(event_payload(3), 1060, &batch));
+    REQUIRE(!buffers.add(event_payload(4), 1100, &batch));
+    REQUIRE(batch.empty());
+  }
+
+  SECTION("keeps a buffer for each thread and takes them all") {
+    ThreadEventBuffers buffers(100, 0);
+    list<Payload> batch;
+    buffers.add(event_payload(0), 1000, &batch);
+
+    vector<thread> threads;
+    for (int i = 1; i <= 4; i++) {
+      threads.push_back(thread([&buffers, i] {
+        list<Payload> thread_batch;
+        buffers.add(event_payload(i), 1000, &thread_batch);
+        buffers.add(event_payload(i * 10), 1000, &thread_batch);
+      }));
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+    REQUIRE(5 == buffers.get_buffer_count());
+
+    // buffers of the exited threads are taken and removed from the registry
+    list<Payload> payloads = buffers.take_all();
+    REQUIRE(9 == payloads.size());
+    REQUIRE(1 == buffers.get_buffer_count());
+
+    buffers.add(event_payload(5), 1000, &batch);
+    REQUIRE(1 == buffers.take_all().size());
+  }
+
+  SECTION("keeps separate buffers for each instance") {
+    list<Payload> batch;
+    {
+      ThreadEventBuffers first(2, 0);
+      ThreadEventBuffers second(2, 0);
+      REQUIRE(!first.add(event_payload(0), 1000, &batch));
+      REQUIRE(!second.add(event_payload(1), 1000, &batch));
+      REQUIRE(1 == first.take_all().size());
+      REQUIRE(1 == second.take_all().size());
+    }
+
+    // a new instance doesn't see events buffered by destroyed ones
+    ThreadEventBuffers third(2, 0);
+    REQUIRE(!third.add(event_payload(2), 1000, &batch));
+    REQUIRE(1 == third.take_all().size());
+  }
+}
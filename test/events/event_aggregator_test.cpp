@@ -0,0 +1,123 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "../../include/snowplow/events/event_aggregator.hpp"
+#include "../../include/snowplow/events/screen_view_event.hpp"
+#include "../catch.hpp"
+
+using namespace snowplow;
+using std::invalid_argument;
+using std::to_string;
+
+TEST_CASE("event aggregator") {
+  vector<pair<string, string>> keys = {{"metrics", "latency"}};
+
+  SECTION("validates the configuration") {
+    REQUIRE_THROWS_AS(EventAggregator(keys, 0, 10), invalid_argument);
+    REQUIRE_THROWS_AS(EventAggregator(keys, 1000, 0), invalid_argument);
+  }
+
+  SECTION("only aggregates configured structured events") {
+    EventAggregator aggregator(keys, 1000, 10);
+    REQUIRE(!aggregator.aggregate(StructuredEvent("metrics", "other"), 0));
+    REQUIRE(!aggregator.aggregate(StructuredEvent("other", "latency"), 0));
+    REQUIRE(!aggregator.aggregate(ScreenViewEvent(), 0));
+    REQUIRE(aggregator.aggregate(StructuredEvent("metrics", "latency"), 0));
+  }
+
+  SECTION("rolls up count, sum, min and max per label within a window") {
+    EventAggregator aggregator(keys, 1000, 10);
+    string label_a = "a";
+    string label_b = "b";
+    double values[] = {3, 1, 5};
+    for (double &value : values) {
+      StructuredEvent event("metrics", "latency");
+      event.label = &label_a;
+      event.value = &value;
+      REQUIRE(aggregator.aggregate(event, 100));
+    }
+    StructuredEvent event_b("metrics", "latency");
+    event_b.label = &label_b;
+    REQUIRE(aggregator.aggregate(event_b, 200));
+    REQUIRE(aggregator.aggregate(StructuredEvent("metrics", "latency"), 300));
+
+    REQUIRE(aggregator.take_aggregates(1099).empty());
+    auto aggregates = aggregator.take_aggregates(1100);
+    REQUIRE(aggregates.size() == 3);
+    REQUIRE(aggregator.take_aggregates(5000, true).empty());
+
+    for (auto const &aggregate : aggregates) {
+      REQUIRE("metrics" == aggregate.category);
+      REQUIRE("latency" == aggregate.action);
+      if (!aggregate.has_label) {
+        REQUIRE(1 == aggregate.count);
+        REQUIRE(0 == aggregate.value_count);
+        REQUIRE("{\"count\":1}" == aggregate.get_property());
+      } else if (aggregate.label == "a") {
+        REQUIRE(3 == aggregate.count);
+        REQUIRE(3 == aggregate.value_count);
+        REQUIRE(9 == aggregate.sum);
+        REQUIRE(1 == aggregate.min);
+        REQUIRE(5 == aggregate.max);
+        REQUIRE("{\"count\":3,\"max\":5.0,\"min\":1.0}" == aggregate.get_property());
+      } else {
+        REQUIRE("b" == aggregate.label);
+        REQUIRE(1 == aggregate.count);
+      }
+    }
+  }
+
+  SECTION("new window starts with the first event after the aggregates are taken") {
+    EventAggregator aggregator(keys, 1000, 10);
+    REQUIRE(0 == aggregator.get_window_end_ms());
+    REQUIRE(aggregator.aggregate(StructuredEvent("metrics", "latency"), 0));
+    REQUIRE(aggregator.take_aggregates(1000).size() == 1);
+    REQUIRE(aggregator.aggregate(StructuredEvent("metrics", "latency"), 5000));
+    REQUIRE(6000 == aggregator.get_window_end_ms());
+    REQUIRE(aggregator.take_aggregates(5999).empty());
+    REQUIRE(aggregator.take_aggregates(100, true).size() == 1);
+  }
+
+  SECTION("keeps the subject and context of the first aggregated event") {
+    EventAggregator aggregator(keys, 1000, 10);
+    auto subject = std::make_shared<Subject>();
+    StructuredEvent first("metrics", "latency");
+    first.set_context({SelfDescribingJson("iglu:com.acme/host/jsonschema/1-0-0", "{\"name\":\"edge-1\"}"_json)});
+    REQUIRE(aggregator.aggregate(first, 0, subject));
+    REQUIRE(aggregator.aggregate(StructuredEvent("metrics", "latency"), 0));
+
+    vector<EventAggregate> aggregates = aggregator.take_aggregates(1000);
+    REQUIRE(aggregates.size() == 1);
+    REQUIRE(aggregates[0].subject == subject);
+    REQUIRE(aggregates[0].context.size() == 1);
+    REQUIRE(aggregates[0].context[0].get()["data"]["name"] == "edge-1");
+  }
+
+  SECTION("events over the capacity are not aggregated") {
+    EventAggregator aggregator(keys, 1000, 3);
+    vector<string> labels;
+    for (int i = 0; i < 10; i++) {
+      labels.push_back(to_string(i));
+    }
+    for (int i = 0; i < 10; i++) {
+      StructuredEvent event("metrics", "latency");
+      event.label = &labels[i];
+      REQUIRE(aggregator.aggregate(event, 0) == (i < 3));
+      // labels already in the table are still aggregated
+      StructuredEvent first("metrics", "latency");
+      first.label = &labels[0];
+      REQUIRE(aggregator.aggregate(first, 0));
+    }
+    REQUIRE(aggregator.take_aggregates(0, true).size() == 3);
+  }
+}
@@ -0,0 +1,139 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "../../include/snowplow/events/event_filter.hpp"
+#include "../../include/snowplow/events/structured_event.hpp"
+#include "../../include/snowplow/events/screen_view_event.hpp"
+#include "../../include/snowplow/events/self_describing_event.hpp"
+#include "../../include/snowplow/constants.hpp"
+#include "../catch.hpp"
+#include <chrono>
+#include <thread>
+
+using namespace snowplow;
+using std::invalid_argument;
+using std::to_string;
+
+TEST_CASE("event filters") {
+  StructuredEvent structured("category", "action");
+  ScreenViewEvent screen_view;
+  SelfDescribingEvent self_describing(SelfDescribingJson("iglu:com.acme/click/jsonschema/1-0-0", json::object()));
+
+  SECTION("events expose their type and schema") {
+    REQUIRE(SNOWPLOW_EVENT_STRUCTURED == structured.get_event_type());
+    REQUIRE("" == structured.get_schema());
+    REQUIRE(SNOWPLOW_EVENT_SELF_DESCRIBING == screen_view.get_event_type());
+    REQUIRE(SNOWPLOW_SCHEMA_SCREEN_VIEW == screen_view.get_schema());
+    REQUIRE("iglu:com.acme/click/jsonschema/1-0-0" == self_describing.get_schema());
+  }
+
+  SECTION("matches event types and schema prefixes") {
+    EventFilterInput se{structured, structured.get_event_type(), structured.get_schema(), "", ""};
+    EventFilterInput ue{self_describing, self_describing.get_event_type(), self_describing.get_schema(), "", ""};
+
+    REQUIRE(EventFilters::matches(se, ""));
+    REQUIRE(EventFilters::matches(se, "se"));
+    REQUIRE(!EventFilters::matches(se, "ue"));
+    REQUIRE(!EventFilters::matches(se, "iglu:com.acme/"));
+    REQUIRE(EventFilters::matches(ue, "ue"));
+    REQUIRE(EventFilters::matches(ue, "iglu:com.acme/"));
+    REQUIRE(EventFilters::matches(ue, "iglu:com.acme/click/jsonschema/1-0-0"));
+    REQUIRE(!EventFilters::matches(ue, "iglu:com.other/"));
+  }
+
+  SECTION("sampling rate must be between 0 and 1") {
+    REQUIRE_THROWS_AS(EventFilters::sample(-0.1), invalid_argument);
+    REQUIRE_THROWS_AS(EventFilters::sample(1.1), invalid_argument);
+  }
+
+  SECTION("sampling by user ID is deterministic") {
+    auto filter = EventFilters::sample(0.5);
+    int kept = 0;
+    for (int i = 0; i < 1000; i++) {
+      EventFilterInput input{structured, structured.get_event_type(), "", "user-" + to_string(i), ""};
+      bool keep = filter(input);
+      REQUIRE(keep == filter(input));
+      REQUIRE(keep == EventFilters::sample(0.5)(input));
+      if (keep) {
+        kept++;
+      }
+    }
+    REQUIRE(kept > 400);
+    REQUIRE(kept < 600);
+  }
+
+  SECTION("sampling without user ID is deterministic by the anonymous user ID") {
+    auto filter = EventFilters::sample(0.5);
+    int kept = 0;
+    for (int i = 0; i < 1000; i++) {
+      EventFilterInput input{structured, structured.get_event_type(), "", "", "anonymous-" + to_string(i)};
+      bool keep = filter(input);
+      REQUIRE(keep == filter(input));
+      REQUIRE(keep == EventFilters::sample(0.5)(input));
+      if (keep) {
+        kept++;
+      }
+    }
+    REQUIRE(kept > 400);
+    REQUIRE(kept < 600);
+
+    // the user ID takes precedence over the anonymous user ID
+    for (int i = 0; i < 100; i++) {
+      EventFilterInput identified{structured, structured.get_event_type(), "", "user-" + to_string(i), "anonymous-" + to_string(i)};
+      EventFilterInput user_only{structured, structured.get_event_type(), "", "user-" + to_string(i), ""};
+      REQUIRE(filter(identified) == filter(user_only));
+    }
+  }
+
+  SECTION("sampling without user ID keeps about the configured fraction") {
+    auto filter = EventFilters::sample(0.2, "se");
+    int kept = 0;
+    for (int i = 0; i < 10000; i++) {
+      if (filter(EventFilterInput{structured, "se", "", "", ""})) {
+        kept++;
+      }
+    }
+    REQUIRE(kept > 1600);
+    REQUIRE(kept < 2400);
+
+    // events not matching the filter are kept
+    auto none = EventFilters::sample(0, "se");
+    REQUIRE(!none(EventFilterInput{structured, "se", "", "", ""}));
+    REQUIRE(none(EventFilterInput{self_describing, "ue", self_describing.get_schema(), "", ""}));
+  }
+
+  SECTION("rate limiting drops events over the burst separately for each schema") {
+    REQUIRE_THROWS_AS(EventFilters::rate_limit(0, 1), invalid_argument);
+    REQUIRE_THROWS_AS(EventFilters::rate_limit(1, 0), invalid_argument);
+
+    auto filter = EventFilters::rate_limit(0.001, 3);
+    EventFilterInput se{structured, "se", "", "", ""};
+    EventFilterInput ue{self_describing, "ue", self_describing.get_schema(), "", ""};
+    EventFilterInput screen{screen_view, "ue", screen_view.get_schema(), "", ""};
+
+    for (int i = 0; i < 3; i++) {
+      REQUIRE(filter(se));
+    }
+    REQUIRE(!filter(se));
+    REQUIRE(filter(ue));
+    REQUIRE(filter(screen));
+  }
+
+  SECTION("rate limiting refills tokens over time") {
+    auto filter = EventFilters::rate_limit(1000, 1);
+    EventFilterInput se{structured, "se", "", "", ""};
+    REQUIRE(filter(se));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(filter(se));
+  }
+}
@@ -81,4 +81,21 @@ TEST_CASE("http_request_result") {
     REQUIRE(httpRequestResult.get_http_response_code() == 0);
     REQUIRE(httpRequestResult.is_success() == false);
   }
+
+  SECTION("parses Retry-After header values") {
+    unsigned long long now_ms = 1445412480000ULL; // Wed, 21 Oct 2015 07:28:00 GMT
+    REQUIRE(120000 == HttpRequestResult::parse_retry_after_ms("120", now_ms));
+    REQUIRE(5000 == HttpRequestResult::parse_retry_after_ms(" 5\r\n", now_ms));
+    REQUIRE(0 == HttpRequestResult::parse_retry_after_ms("0", now_ms));
+    REQUIRE(90000 == HttpRequestResult::parse_retry_after_ms("Wed, 21 Oct 2015 07:29:30 GMT", now_ms));
+    REQUIRE(0 == HttpRequestResult::parse_retry_after_ms("Wed, 21 Oct 2015 07:27:00 GMT", now_ms));
+    REQUIRE(0 == HttpRequestResult::parse_retry_after_ms("soon", now_ms));
+    REQUIRE(0 == HttpRequestResult::parse_retry_after_ms("-5", now_ms));
+    REQUIRE(0 == HttpRequestResult::parse_retry_after_ms("", now_ms));
+
+    HttpRequestResult result(0, 503, {1}, false);
+    REQUIRE(0 == result.get_retry_after_ms());
+    result.set_retry_after("2");
+    REQUIRE(2000 == result.get_retry_after_ms());
+  }
 }
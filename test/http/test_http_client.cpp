@@ -12,6 +12,8 @@ See the Apache License Version 2.0 for the specific language governing permissio
 */
 
 #include "test_http_client.hpp"
+#include <chrono>
+#include <thread>
 
 using namespace snowplow;
 using std::cerr;
@@ -23,14 +25,35 @@ const string TestHttpClient::TRACKER_AGENT = string("Snowplow C++ Tracker (Integ
 list<TestHttpClient::Request> TestHttpClient::requests_list;
 mutex TestHttpClient::log_read_write;
 int TestHttpClient::response_code = 200;
+map<string, int> TestHttpClient::host_response_codes;
 int TestHttpClient::temporary_response_code = -1;
 int TestHttpClient::temporary_response_code_remaining_attempts = 0;
+int TestHttpClient::response_delay_ms = 0;
+string TestHttpClient::retry_after = "";
 
 HttpRequestResult TestHttpClient::http_request(const RequestMethod method, CrackedUrl url, const string &query_string, const string &post_data, list<int> row_ids, bool oversize) {
+  // simulate a slow collector that respects the request deadline and cancellation
+  int delay_ms;
+  {
+    lock_guard<mutex> guard(log_read_write);
+    delay_ms = response_delay_ms;
+  }
+  if (delay_ms > 0) {
+    auto deadline = get_request_deadline();
+    auto response_time = std::chrono::steady_clock::now() + std::chrono::milliseconds(delay_ms);
+    while (std::chrono::steady_clock::now() < response_time) {
+      if (is_cancelled() || std::chrono::steady_clock::now() >= deadline) {
+        return HttpRequestResult(1, 0, row_ids, oversize);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  }
+
   lock_guard<mutex> guard(log_read_write);
 
   TestHttpClient::Request r;
   r.method = method;
+  r.hostname = url.get_hostname();
   r.query_string = query_string;
   r.post_data = post_data;
   r.row_ids = row_ids;
@@ -38,7 +61,11 @@ HttpRequestResult TestHttpClient::http_request(const RequestMethod method, Crack
   requests_list.push_back(r);
   m_requests_list.push_back(r);
 
-  return HttpRequestResult(0, fetch_response_code(), row_ids, oversize);
+  HttpRequestResult result(0, fetch_response_code(r.hostname), row_ids, oversize);
+  if (!retry_after.empty()) {
+    result.set_retry_after(retry_after);
+  }
+  return result;
 }
 
 void TestHttpClient::set_http_response_code(int http_response_code) {
@@ -46,18 +73,37 @@ void TestHttpClient::set_http_response_code(int http_response_code) {
   response_code = http_response_code;
 }
 
+void TestHttpClient::set_http_response_code_for_host(const string &hostname, int http_response_code) {
+  lock_guard<mutex> guard(log_read_write);
+  host_response_codes[hostname] = http_response_code;
+}
+
 void TestHttpClient::set_temporary_response_code(int http_response_code, int number_of_attempts) {
   lock_guard<mutex> guard(log_read_write);
   temporary_response_code = http_response_code;
   temporary_response_code_remaining_attempts = number_of_attempts;
 }
 
-int TestHttpClient::fetch_response_code() {
+void TestHttpClient::set_response_delay_ms(int delay_ms) {
+  lock_guard<mutex> guard(log_read_write);
+  response_delay_ms = delay_ms;
+}
+
+void TestHttpClient::set_retry_after(const string &header_value) {
+  lock_guard<mutex> guard(log_read_write);
+  retry_after = header_value;
+}
+
+int TestHttpClient::fetch_response_code(const string &hostname) {
   if (temporary_response_code_remaining_attempts > 0) {
     int code = temporary_response_code;
     temporary_response_code_remaining_attempts--;
     return code;
   }
+  auto host_response_code = host_response_codes.find(hostname);
+  if (host_response_code != host_response_codes.end()) {
+    return host_response_code->second;
+  }
   return response_code;
 }
 
@@ -75,5 +121,8 @@ void TestHttpClient::reset() {
   lock_guard<mutex> guard(log_read_write);
   requests_list.clear();
   response_code = 200;
+  host_response_codes.clear();
   temporary_response_code_remaining_attempts = 0;
+  response_delay_ms = 0;
+  retry_after = "";
 }
@@ -16,11 +16,13 @@ See the Apache License Version 2.0 for the specific language governing permissio
 
 #include "../../include/snowplow/http/http_client.hpp"
 
+#include <map>
 #include <mutex>
 
 using std::string;
 using std::list;
 using std::mutex;
+using std::map;
 
 namespace snowplow {
 /**
@@ -35,6 +37,7 @@ public:
   struct Request {
     Request(){};
     RequestMethod method;
+    string hostname;
     string query_string;
     string post_data;
     list<int> row_ids;
@@ -43,12 +46,18 @@ public:
 
   static list<Request> requests_list;
   static int response_code;
+  static map<string, int> host_response_codes;
   static int temporary_response_code;
   static int temporary_response_code_remaining_attempts;
+  static int response_delay_ms;
+  static string retry_after;
   static mutex log_read_write;
 
   static void set_http_response_code(int http_response_code);
+  static void set_http_response_code_for_host(const string &hostname, int http_response_code);
   static void set_temporary_response_code(int http_response_code, int number_of_attempts = 1);
+  static void set_response_delay_ms(int delay_ms);
+  static void set_retry_after(const string &header_value);
   static list<Request> get_requests_list();
   static void reset();
 
@@ -58,7 +67,7 @@ protected:
   HttpRequestResult http_request(const RequestMethod method, const CrackedUrl url, const string & query_string, const string & post_data, list<int> row_ids, bool oversize);
   
 private:
-  static int fetch_response_code();
+  static int fetch_response_code(const string &hostname);
 
   list<Request> m_requests_list;
 };
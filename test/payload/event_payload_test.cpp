@@ -30,4 +30,16 @@ TEST_CASE("event payload") {
     REQUIRE(pl.get()["eid"] == pl.get_event_id());
     REQUIRE(pl.get()["dtm"] == std::to_string(pl.get_timestamp()));
   }
+
+  SECTION("generates a random UUID_V4 event ID by default") {
+    REQUIRE(pl.get_event_id().size() == 36);
+    REQUIRE(pl.get_event_id()[14] == '4');
+  }
+
+  SECTION("generates a time-ordered event ID of the given version") {
+    EventPayload time_ordered(UUID_V7);
+    REQUIRE(time_ordered.get_event_id().size() == 36);
+    REQUIRE(time_ordered.get_event_id()[14] == '7');
+    REQUIRE(time_ordered.get()["eid"] == time_ordered.get_event_id());
+  }
 }
@@ -0,0 +1,81 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "../../include/snowplow/payload/json_writer.hpp"
+#include "../catch.hpp"
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace snowplow;
+using std::string;
+using std::vector;
+
+TEST_CASE("json_writer") {
+  JsonWriter writer;
+
+  SECTION("writes nested objects and arrays with separators") {
+    vector<int> numbers = {1, -2, 3};
+    writer.begin_object()
+        .field("a", 1)
+        .key("b")
+        .begin_object()
+        .field("c", true)
+        .field("d", nullptr)
+        .end_object()
+        .field("e", numbers)
+        .key("f")
+        .begin_array()
+        .begin_object()
+        .end_object()
+        .value("x")
+        .end_array()
+        .end_object();
+    REQUIRE(writer.str() == "{\"a\":1,\"b\":{\"c\":true,\"d\":null},\"e\":[1,-2,3],\"f\":[{},\"x\"]}");
+  }
+
+  SECTION("skips optional fields that are not set") {
+    string label = "label";
+    string *missing = NULL;
+    writer.begin_object().field("label", &label).field("missing", missing).end_object();
+    REQUIRE(writer.str() == "{\"label\":\"label\"}");
+  }
+
+  SECTION("escapes strings like json::dump") {
+    string value = string("quote \" backslash \\ newline \n tab \t bell \x07 nul ", 31) + '\0' + " unicode \xC3\xA9";
+    writer.value(value);
+    REQUIRE(writer.str() == json(value).dump());
+  }
+
+  SECTION("formats numbers like json::dump") {
+    vector<double> doubles = {0.0, 25.6, 3.0, -1.5, 0.1, 1.0 / 3.0, 1e20, 1.5e-7, 123456789.123, std::numeric_limits<double>::max()};
+    for (double d : doubles) {
+      JsonWriter number_writer;
+      number_writer.value(d);
+      REQUIRE(json::parse(number_writer.str()).get<double>() == d);
+      REQUIRE(json::parse(number_writer.str()).is_number_float());
+    }
+
+    writer.begin_array()
+        .value(std::numeric_limits<long long>::min())
+        .value(std::numeric_limits<unsigned long long>::max())
+        .value(std::numeric_limits<double>::infinity())
+        .end_array();
+    REQUIRE(writer.str() == "[-9223372036854775808,18446744073709551615,null]");
+  }
+
+  SECTION("writes JSON trees as values") {
+    writer.begin_object().field("tree", "{\"k\":[1,2]}"_json).end_object();
+    REQUIRE(writer.str() == "{\"tree\":{\"k\":[1,2]}}");
+  }
+}
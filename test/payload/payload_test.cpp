@@ -35,6 +35,16 @@ TEST_CASE("payload") {
     REQUIRE(pl.get()["hello"] == "world");
   }
 
+  SECTION("add should move rvalue values into the payload") {
+    string value(100, 'x');
+    pl.add("hello", std::move(value));
+    REQUIRE(pl.get_pairs().at("hello") == string(100, 'x'));
+
+    Payload moved(std::move(pl));
+    REQUIRE(moved.get_pairs().size() == 1);
+    REQUIRE(pl.get_pairs().empty());
+  }
+
   SECTION("add_map should add all valid non-empty kv pairs") {
     map<string, string> test_map = {{"hello", "world"}, {"e", "pv"}};
     pl.add_map(test_map);
@@ -60,4 +70,10 @@ TEST_CASE("payload") {
     REQUIRE(pl.get()["cx"] == "eyJoYXBweSI6dHJ1ZSwicGkiOjMuMTQxfQ==");
     REQUIRE(pl.get()["co"] == "{\"happy\":true,\"pi\":3.141}");
   }
+
+  SECTION("add_json should use the URL-safe base64 alphabet without padding if requested") {
+    json j = "{ \"happy\": true, \"pi\": 3.141 }"_json;
+    pl.add_json(j, true, "cx", "co", true);
+    REQUIRE(pl.get()["cx"] == "eyJoYXBweSI6dHJ1ZSwicGkiOjMuMTQxfQ");
+  }
 }
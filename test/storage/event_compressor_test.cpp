@@ -0,0 +1,122 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "../../include/snowplow/storage/event_compressor.hpp"
+#include "../../include/snowplow/detail/utils/utils.hpp"
+#include "../catch.hpp"
+
+using namespace snowplow;
+using std::runtime_error;
+
+static vector<string> get_sample_payloads(int count) {
+  vector<string> samples;
+  for (int i = 0; i < count; i++) {
+    Payload p;
+    p.add("e", "ue");
+    p.add("eid", Utils::get_uuid4());
+    p.add("dtm", std::to_string(1700000000000ULL + i));
+    p.add("tv", "cpp-2.0.0");
+    p.add("p", "pc");
+    p.add("aid", "edge-box");
+    p.add("tna", "sp");
+    p.add("cx", "eyJzY2hlbWEiOiJpZ2x1OmNvbS5zbm93cGxvd2FuYWx5dGljcy5zbm93cGxvdy9jb250ZXh0cy9qc29uc2NoZW1hLzEtMC0wIn0");
+    p.add("ue_pr", "{\"schema\":\"iglu:com.acme/reading/jsonschema/1-0-0\",\"data\":{\"sensor\":" + std::to_string(i % 10) + "}}");
+    samples.push_back(Utils::serialize_payload_binary(p));
+  }
+  return samples;
+}
+
+TEST_CASE("event compressor") {
+  SECTION("headers start with the version byte and the dictionary ID") {
+    string header = EventCompressor::get_header(3);
+    REQUIRE(string("\x02\x03", 2) == header);
+    REQUIRE(EventCompressor::is_compressed(header.data(), header.size()));
+    REQUIRE(3 == EventCompressor::get_dictionary_id(header.data(), header.size()));
+
+    header = EventCompressor::get_header(300);
+    REQUIRE(3 == header.size());
+    REQUIRE(300 == EventCompressor::get_dictionary_id(header.data(), header.size()));
+    REQUIRE(-1 == EventCompressor::get_dictionary_id(header.data(), 2));
+
+    string json = "{\"e\":\"pv\"}";
+    REQUIRE_FALSE(EventCompressor::is_compressed(json.data(), json.size()));
+    REQUIRE(-1 == EventCompressor::get_dictionary_id(json.data(), json.size()));
+  }
+
+  SECTION("leaves payloads unchanged until a dictionary is set") {
+    EventCompressor compressor;
+    string payload = get_sample_payloads(1).front();
+    REQUIRE(0 == compressor.get_compression_dictionary_id());
+    REQUIRE(payload == compressor.compress(payload));
+  }
+
+  if (!EventCompressor::is_available()) {
+    SECTION("requires zstd to compress or decompress") {
+      EventCompressor compressor;
+      REQUIRE(EventCompressor::train_dictionary(get_sample_payloads(10), 1024).empty());
+      REQUIRE_THROWS_AS(compressor.set_compression_dictionary(1, "dictionary"), runtime_error);
+      string header = EventCompressor::get_header(1);
+      REQUIRE_THROWS_AS(compressor.decompress(header.data(), header.size()), runtime_error);
+    }
+    return;
+  }
+
+  SECTION("compresses payloads with a trained dictionary") {
+    vector<string> samples = get_sample_payloads(500);
+    string dictionary = EventCompressor::train_dictionary(samples, 16 * 1024);
+    REQUIRE_FALSE(dictionary.empty());
+    REQUIRE(dictionary.size() <= 16 * 1024);
+
+    EventCompressor compressor;
+    compressor.set_compression_dictionary(1, dictionary);
+    REQUIRE(1 == compressor.get_compression_dictionary_id());
+
+    string payload = get_sample_payloads(1).front();
+    string compressed = compressor.compress(payload);
+    REQUIRE(EventCompressor::is_compressed(compressed.data(), compressed.size()));
+    REQUIRE(1 == EventCompressor::get_dictionary_id(compressed.data(), compressed.size()));
+    REQUIRE(compressed.size() * 2 < payload.size());
+    REQUIRE(payload == compressor.decompress(compressed.data(), compressed.size()));
+  }
+
+  SECTION("falls back to a raw content dictionary with too few samples") {
+    vector<string> samples = get_sample_payloads(2);
+    string dictionary = EventCompressor::train_dictionary(samples, 16 * 1024);
+    REQUIRE(samples[0] + samples[1] == dictionary);
+
+    EventCompressor compressor;
+    compressor.set_compression_dictionary(1, dictionary);
+    string payload = get_sample_payloads(1).front();
+    string compressed = compressor.compress(payload);
+    REQUIRE(compressed.size() < payload.size());
+    REQUIRE(payload == compressor.decompress(compressed.data(), compressed.size()));
+  }
+
+  SECTION("decompresses payloads of previous dictionaries") {
+    EventCompressor compressor;
+    compressor.set_compression_dictionary(1, EventCompressor::train_dictionary(get_sample_payloads(500), 16 * 1024));
+    string payload = get_sample_payloads(1).front();
+    string compressed = compressor.compress(payload);
+
+    compressor.set_compression_dictionary(2, EventCompressor::train_dictionary(get_sample_payloads(500), 16 * 1024));
+    REQUIRE(2 == compressor.get_compression_dictionary_id());
+    REQUIRE(payload == compressor.decompress(compressed.data(), compressed.size()));
+
+    compressor.remove_decompression_dictionary(1);
+    REQUIRE_FALSE(compressor.has_decompression_dictionary(1));
+    REQUIRE_THROWS_AS(compressor.decompress(compressed.data(), compressed.size()), runtime_error);
+
+    EventCompressor other_compressor;
+    REQUIRE_THROWS_AS(other_compressor.decompress(compressed.data(), compressed.size()), runtime_error);
+  }
+}
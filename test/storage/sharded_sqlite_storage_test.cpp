@@ -0,0 +1,246 @@
+/*
+Copyright (c) 2023 Snowplow Analytics Ltd. All rights reserved.
+
+This program is licensed to you under the Apache License Version 2.0,
+and you may not use this file except in compliance with the Apache License Version 2.0.
+You may obtain a copy of the Apache License Version 2.0 at http://www.apache.org/licenses/LICENSE-2.0.
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Apache License Version 2.0 is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the Apache License Version 2.0 for the specific language governing permissions and limitations there under.
+*/
+
+#include "../../include/snowplow/storage/sharded_sqlite_storage.hpp"
+#include "../../include/snowplow/detail/utils/utils.hpp"
+#include "../catch.hpp"
+#include <cstdio>
+#include <thread>
+
+using namespace snowplow;
+using std::invalid_argument;
+using std::to_string;
+
+namespace {
+Payload event_payload(int i) {
+  Payload payload;
+  payload.add("eid", to_string(i));
+  return payload;
+}
+
+void remove_shards(const string &db_name, int shard_count) {
+  for (int shard = 0; shard < shard_count; shard++) {
+    remove(ShardedSqliteStorage::get_shard_db_name(db_name, shard).c_str());
+  }
+}
+} // namespace
+
+TEST_CASE("Sharded SQLite storage") {
+  remove_shards("test-sharded.db", 3);
+
+  SECTION("validates the configuration and names the shard databases") {
+    REQUIRE_THROWS_AS(ShardedSqliteStorage("test-sharded.db", 0), invalid_argument);
+    REQUIRE("test-sharded-2.db" == ShardedSqliteStorage::get_shard_db_name("test-sharded.db", 2));
+    REQUIRE("dir.v1/events-0" == ShardedSqliteStorage::get_shard_db_name("dir.v1/events", 0));
+  }
+
+  SECTION("spreads events across shards and merges batches with IDs encoding the shard") {
+    {
+      ShardedSqliteStorage storage("test-sharded.db", 3, SHARD_ROUND_ROBIN);
+      REQUIRE(3 == storage.get_shard_count());
+      for (int i = 0; i < 7; i++) {
+        storage.add_event(event_payload(i));
+      }
+
+      // round-robin puts 3, 2 and 2 events into the shards
+      list<EventRow> shard_rows;
+      SqliteStorage("test-sharded-0.db").get_all_event_rows(&shard_rows);
+      REQUIRE(3 == shard_rows.size());
+      shard_rows.clear();
+      SqliteStorage("test-sharded-1.db").get_all_event_rows(&shard_rows);
+      REQUIRE(2 == shard_rows.size());
+
+      list<EventRow> rows;
+      storage.get_event_rows_batch(&rows, 4);
+      REQUIRE(4 == rows.size());
+      vector<string> eids;
+      set<int> ids;
+      for (auto const &row : rows) {
+        eids.push_back(row.event.get_value("eid"));
+        ids.insert(row.id);
+      }
+      REQUIRE(eids == vector<string>({"0", "1", "2", "3"}));
+
+      rows.clear();
+      storage.get_event_rows_batch_excluding(&rows, 10, ids);
+      REQUIRE(3 == rows.size());
+      REQUIRE("6" == rows.front().event.get_value("eid"));
+
+      storage.delete_event_rows_with_ids(list<int>(ids.begin(), ids.end()));
+      unsigned long long event_count = 0;
+      unsigned long long byte_size = 0;
+      REQUIRE(storage.get_event_queue_size(&event_count, &byte_size));
+      REQUIRE(3 == event_count);
+      REQUIRE(3 * Utils::serialize_payload(event_payload(4)).length() == byte_size);
+
+      rows.clear();
+      storage.get_all_event_rows(&rows);
+      REQUIRE(3 == rows.size());
+      storage.record_failed_attempt({rows.front().id}, Utils::get_unix_epoch_ms() + 60000);
+      REQUIRE(storage.get_next_attempt_at_ms() > Utils::get_unix_epoch_ms());
+      storage.move_event_rows_to_dead_letter({rows.front().id});
+      list<EventRow> dead_letter_rows;
+      storage.get_all_dead_letter_event_rows(&dead_letter_rows);
+      REQUIRE(1 == dead_letter_rows.size());
+      REQUIRE(rows.front().event.get_value("eid") == dead_letter_rows.front().event.get_value("eid"));
+    }
+    remove_shards("test-sharded.db", 3);
+  }
+
+  SECTION("shares a batch between the priority lanes of all shards") {
+    {
+      ShardedSqliteStorage storage("test-sharded.db", 2, SHARD_ROUND_ROBIN);
+      // low priority events in the first shard, high priority events in the second one
+      for (int i = 0; i < 10; i++) {
+        storage.add_event(event_payload(i));
+        Payload high = event_payload(100 + i);
+        high.set_priority(2);
+        storage.add_event(high);
+      }
+
+      // lane weights are priority + 1: 3 of 4 slots for the high lane, 1 for the low lane
+      list<EventRow> rows;
+      storage.get_event_rows_batch(&rows, 4);
+      REQUIRE(4 == rows.size());
+      vector<string> eids;
+      for (auto const &row : rows) {
+        eids.push_back(row.event.get_value("eid"));
+      }
+      REQUIRE(eids == vector<string>({"100", "101", "102", "0"}));
+      REQUIRE(2 == rows.front().priority);
+      REQUIRE(1 == rows.front().id % 2);
+
+      // slots unused by the high lane go to the low lane
+      rows.clear();
+      storage.get_event_rows_batch(&rows, 15);
+      REQUIRE(15 == rows.size());
+      REQUIRE(0 == rows.back().priority);
+    }
+    remove_shards("test-sharded.db", 2);
+  }
+
+  SECTION("removes oldest and random rows from the largest shards") {
+    {
+      ShardedSqliteStorage storage("test-sharded.db", 3, SHARD_ROUND_ROBIN);
+      list<Payload> payloads;
+      for (int i = 0; i < 6; i++) {
+        payloads.push_back(event_payload(i));
+      }
+      storage.add_events(payloads);
+      storage.add_event(event_payload(6));
+      storage.add_event(event_payload(7));
+
+      // 6 events in the first shard, one in each of the others
+      storage.delete_oldest_event_rows(4, {});
+      list<EventRow> rows;
+      storage.get_all_event_rows(&rows);
+      REQUIRE(4 == rows.size());
+      REQUIRE("4" == rows.front().event.get_value("eid"));
+
+      storage.delete_random_event_row({});
+      unsigned long long event_count = 0;
+      unsigned long long byte_size = 0;
+      storage.get_event_queue_size(&event_count, &byte_size);
+      REQUIRE(3 == event_count);
+
+      // excluded rows are kept, whichever shard they are in
+      rows.clear();
+      storage.get_all_event_rows(&rows);
+      set<int> excluded_ids;
+      for (auto const &row : rows) {
+        excluded_ids.insert(row.id);
+      }
+      excluded_ids.erase(rows.back().id);
+      storage.delete_random_event_row(excluded_ids);
+      storage.delete_oldest_event_rows(1, excluded_ids);
+      list<EventRow> remaining_rows;
+      storage.get_all_event_rows(&remaining_rows);
+      set<int> remaining_ids;
+      for (auto const &row : remaining_rows) {
+        remaining_ids.insert(row.id);
+      }
+      REQUIRE(excluded_ids == remaining_ids);
+
+      storage.delete_all_event_rows();
+      storage.get_event_queue_size(&event_count, &byte_size);
+      REQUIRE(0 == event_count);
+    }
+    remove_shards("test-sharded.db", 3);
+  }
+
+  SECTION("inserts from each thread into its own shard") {
+    {
+      ShardedSqliteStorage storage("test-sharded.db", 3);
+      vector<std::thread> threads;
+      for (int t = 0; t < 3; t++) {
+        threads.push_back(std::thread([&storage, t] {
+          for (int i = 0; i < 10; i++) {
+            storage.add_event(event_payload(t * 100 + i));
+          }
+        }));
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+
+      list<EventRow> rows;
+      storage.get_all_event_rows(&rows);
+      REQUIRE(30 == rows.size());
+      map<int, set<int>> threads_by_shard;
+      for (auto const &row : rows) {
+        threads_by_shard[row.id % 3].insert(std::stoi(row.event.get_value("eid")) / 100);
+      }
+      for (auto const &shard : threads_by_shard) {
+        REQUIRE(1 == shard.second.size());
+      }
+    }
+    remove_shards("test-sharded.db", 3);
+  }
+
+  SECTION("stores the session in the first shard") {
+    {
+      ShardedSqliteStorage storage("test-sharded.db", 2);
+      json session = {{"userId", "abc"}};
+      storage.set_session(session);
+      REQUIRE(session == *storage.get_session());
+      REQUIRE(session == *SqliteStorage("test-sharded-0.db").get_session());
+      storage.delete_session();
+      REQUIRE(storage.get_session() == nullptr);
+    }
+    remove_shards("test-sharded.db", 2);
+  }
+
+  SECTION("sums the storage size of the shards and maintains each shard") {
+    {
+      ShardedSqliteStorage storage("test-sharded.db", 2, SHARD_ROUND_ROBIN);
+      Payload p;
+      p.add("e", "pv");
+      p.add("url", string(2000, 'x'));
+      // each batch goes to the next shard, enough for both shards to be worth maintaining
+      storage.add_events(list<Payload>(1000, p));
+      storage.add_events(list<Payload>(1000, p));
+      storage.delete_all_event_rows();
+      storage.perform_maintenance();
+
+      unsigned long long file_byte_size = 0;
+      unsigned long long wal_byte_size = 0;
+      REQUIRE(storage.get_storage_size(&file_byte_size, &wal_byte_size));
+      REQUIRE(0 == wal_byte_size);
+      unsigned long long shard_file_byte_size = 0;
+      REQUIRE(SqliteStorage("test-sharded-1.db").get_storage_size(&shard_file_byte_size, &wal_byte_size));
+      REQUIRE(shard_file_byte_size < file_byte_size);
+      REQUIRE(file_byte_size < 100 * 2000);
+    }
+    remove_shards("test-sharded.db", 2);
+  }
+}
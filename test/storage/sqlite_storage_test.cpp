@@ -12,7 +12,10 @@ See the Apache License Version 2.0 for the specific language governing permissio
 */
 
 #include "../../include/snowplow/storage/sqlite_storage.hpp"
+#include "../../include/snowplow/detail/utils/utils.hpp"
 #include "../catch.hpp"
+#include <cstdio>
+#include <thread>
 
 using namespace snowplow;
 using std::runtime_error;
@@ -88,6 +91,618 @@ TEST_CASE("SQLite storage") {
     storage.delete_all_event_rows();
   }
 
+  SECTION("selects event rows excluding the given IDs") {
+    SqliteStorage storage("test1.db");
+    storage.delete_all_event_rows();
+    Payload p;
+    p.add("e", "pv");
+    for (int i = 0; i < 10; i++) {
+      storage.add_event(p);
+    }
+
+    list<EventRow> first_rows;
+    storage.get_event_rows_batch(&first_rows, 3);
+    set<int> excluded_ids;
+    for (auto const &row : first_rows) {
+      excluded_ids.insert(row.id);
+    }
+
+    list<EventRow> rows;
+    storage.get_event_rows_batch_excluding(&rows, 5, excluded_ids);
+    REQUIRE(5 == rows.size());
+    for (auto const &row : rows) {
+      REQUIRE(excluded_ids.find(row.id) == excluded_ids.end());
+    }
+
+    // default implementation of the EventStore interface gives the same result
+    list<EventRow> default_rows;
+    storage.EventStore::get_event_rows_batch_excluding(&default_rows, 5, excluded_ids);
+    REQUIRE(5 == default_rows.size());
+    auto row = rows.begin();
+    for (auto const &default_row : default_rows) {
+      REQUIRE(row->id == default_row.id);
+      ++row;
+    }
+
+    rows.clear();
+    storage.get_event_rows_batch_excluding(&rows, 100, excluded_ids);
+    REQUIRE(7 == rows.size());
+
+    storage.delete_all_event_rows();
+  }
+
+  SECTION("skips rows waiting for their next attempt and moves exhausted rows to dead-letter table") {
+    SqliteStorage storage("test1.db");
+    storage.delete_all_event_rows();
+    storage.delete_all_dead_letter_event_rows();
+    Payload p;
+    p.add("e", "pv");
+    for (int i = 0; i < 3; i++) {
+      storage.add_event(p);
+    }
+
+    list<EventRow> rows;
+    storage.get_event_rows_batch(&rows, 10);
+    REQUIRE(3 == rows.size());
+    REQUIRE(0 == rows.front().attempts);
+    REQUIRE(0 == storage.get_next_attempt_at_ms());
+    int first_id = rows.front().id;
+    int last_id = rows.back().id;
+
+    // first row waits for its next attempt
+    unsigned long long next_attempt_at_ms = Utils::get_unix_epoch_ms() + 60000;
+    storage.record_failed_attempt({first_id}, next_attempt_at_ms);
+    REQUIRE(next_attempt_at_ms == storage.get_next_attempt_at_ms());
+    rows.clear();
+    storage.get_event_rows_batch(&rows, 10);
+    REQUIRE(2 == rows.size());
+    REQUIRE(first_id != rows.front().id);
+    rows.clear();
+    storage.get_all_event_rows(&rows);
+    REQUIRE(3 == rows.size());
+    REQUIRE(1 == rows.front().attempts);
+
+    // row is eligible again once the next attempt time passed
+    storage.record_failed_attempt({first_id}, 1);
+    rows.clear();
+    storage.get_event_rows_batch(&rows, 10);
+    REQUIRE(3 == rows.size());
+    REQUIRE(2 == rows.front().attempts);
+
+    // dead-letter rows are removed from the queue
+    storage.move_event_rows_to_dead_letter({first_id, last_id});
+    rows.clear();
+    storage.get_all_event_rows(&rows);
+    REQUIRE(1 == rows.size());
+    list<EventRow> dead_letter_rows;
+    storage.get_all_dead_letter_event_rows(&dead_letter_rows);
+    REQUIRE(2 == dead_letter_rows.size());
+    REQUIRE(dead_letter_rows.front().id < dead_letter_rows.back().id);
+    REQUIRE(3 == dead_letter_rows.front().attempts);
+    REQUIRE(1 == dead_letter_rows.back().attempts);
+    REQUIRE("pv" == dead_letter_rows.front().event.get_value("e"));
+
+    storage.delete_all_event_rows();
+    storage.delete_all_dead_letter_event_rows();
+  }
+
+  SECTION("keeps dead-letter rows of events moved across a drained queue") {
+    SqliteStorage storage("test1.db");
+    storage.delete_all_event_rows();
+    storage.delete_all_dead_letter_event_rows();
+
+    // event row IDs start over once the queue is empty
+    for (const string &value : {"first", "second"}) {
+      Payload p;
+      p.add("e", "pv");
+      p.add("eid", value);
+      storage.add_event(p);
+      list<EventRow> rows;
+      storage.get_all_event_rows(&rows);
+      storage.move_event_rows_to_dead_letter({rows.front().id});
+    }
+
+    list<EventRow> dead_letter_rows;
+    storage.get_all_dead_letter_event_rows(&dead_letter_rows);
+    REQUIRE(2 == dead_letter_rows.size());
+    REQUIRE("first" == dead_letter_rows.front().event.get_value("eid"));
+    REQUIRE("second" == dead_letter_rows.back().event.get_value("eid"));
+    storage.delete_all_dead_letter_event_rows();
+  }
+
+  SECTION("maintains the queue size and removes oldest and random rows") {
+    SqliteStorage storage("test1.db");
+    storage.delete_all_event_rows();
+    Payload p;
+    p.add("e", "pv");
+    unsigned long long event_size = Utils::serialize_payload(p).length();
+    for (int i = 0; i < 5; i++) {
+      storage.add_event(p);
+    }
+
+    unsigned long long event_count = 0;
+    unsigned long long byte_size = 0;
+    REQUIRE(storage.get_event_queue_size(&event_count, &byte_size));
+    REQUIRE(5 == event_count);
+    REQUIRE(5 * event_size == byte_size);
+
+    // counters are restored from the database when it is opened again
+    {
+      SqliteStorage reopened("test1.db");
+      REQUIRE(reopened.get_event_queue_size(&event_count, &byte_size));
+      REQUIRE(5 == event_count);
+      REQUIRE(5 * event_size == byte_size);
+    }
+
+    list<EventRow> rows;
+    storage.get_all_event_rows(&rows);
+    int first_id = rows.front().id;
+    int last_id = rows.back().id;
+
+    storage.delete_oldest_event_rows(2, {});
+    rows.clear();
+    storage.get_all_event_rows(&rows);
+    REQUIRE(3 == rows.size());
+    REQUIRE(first_id + 2 == rows.front().id);
+    storage.get_event_queue_size(&event_count, &byte_size);
+    REQUIRE(3 == event_count);
+
+    storage.delete_random_event_row({});
+    storage.delete_event_rows_with_ids({last_id});
+    rows.clear();
+    storage.get_all_event_rows(&rows);
+    storage.get_event_queue_size(&event_count, &byte_size);
+    REQUIRE(rows.size() == event_count);
+    REQUIRE(rows.size() * event_size == byte_size);
+    REQUIRE(event_count >= 1);
+
+    storage.move_event_rows_to_dead_letter({rows.front().id});
+    storage.get_event_queue_size(&event_count, &byte_size);
+    REQUIRE(rows.size() - 1 == event_count);
+
+    storage.delete_all_event_rows();
+    storage.delete_all_dead_letter_event_rows();
+    storage.get_event_queue_size(&event_count, &byte_size);
+    REQUIRE(0 == event_count);
+    REQUIRE(0 == byte_size);
+  }
+
+  SECTION("keeps excluded rows when removing oldest and random rows") {
+    SqliteStorage storage("test1.db");
+    storage.delete_all_event_rows();
+    Payload a;
+    a.add("e", "pv");
+    a.add("eid", "a");
+    storage.add_event(a);
+
+    // a row in flight is kept, so a new event can't take over its ID
+    list<EventRow> batch;
+    storage.get_event_rows_batch(&batch, 10);
+    set<int> in_flight_ids = {batch.front().id};
+    storage.delete_oldest_event_rows(1, in_flight_ids);
+    storage.delete_random_event_row(in_flight_ids);
+    Payload b;
+    b.add("e", "pv");
+    b.add("eid", "b");
+    storage.add_event(b);
+    storage.delete_event_rows_with_ids({batch.front().id});
+
+    list<EventRow> rows;
+    storage.get_all_event_rows(&rows);
+    REQUIRE(1 == rows.size());
+    REQUIRE("b" == rows.front().event.get_value("eid"));
+
+    // the random row is taken from the rows that aren't excluded
+    for (int i = 0; i < 5; i++) {
+      storage.add_event(a);
+    }
+    rows.clear();
+    storage.get_all_event_rows(&rows);
+    set<int> all_but_first;
+    for (auto const &row : rows) {
+      all_but_first.insert(row.id);
+    }
+    all_but_first.erase(rows.front().id);
+    storage.delete_random_event_row(all_but_first);
+    rows.clear();
+    storage.get_all_event_rows(&rows);
+    REQUIRE(5 == rows.size());
+    REQUIRE("a" == rows.front().event.get_value("eid"));
+
+    storage.delete_all_event_rows();
+  }
+
+  SECTION("counts the bytes of events with multi-byte UTF-8 values") {
+    SqliteStorage storage("test1.db");
+    storage.delete_all_event_rows();
+    Payload p;
+    p.add("e", "se");
+    p.add("se_ca", "\xc5\xbe\xc3\xa1\xc4\x8d\xe2\x82\xac\xf0\x9f\x98\x80");
+    unsigned long long event_size = Utils::serialize_payload(p).length();
+    for (int i = 0; i < 5; i++) {
+      storage.add_event(p);
+    }
+
+    unsigned long long event_count = 0;
+    unsigned long long byte_size = 0;
+    storage.get_event_queue_size(&event_count, &byte_size);
+    REQUIRE(5 * event_size == byte_size);
+    {
+      SqliteStorage reopened("test1.db");
+      reopened.get_event_queue_size(&event_count, &byte_size);
+      REQUIRE(5 * event_size == byte_size);
+    }
+
+    list<EventRow> rows;
+    storage.get_all_event_rows(&rows);
+    REQUIRE(p.get_pairs() == rows.front().event.get_pairs());
+    storage.delete_oldest_event_rows(2, {});
+    storage.move_event_rows_to_dead_letter({rows.back().id});
+    storage.get_event_queue_size(&event_count, &byte_size);
+    REQUIRE(2 == event_count);
+    REQUIRE(2 * event_size == byte_size);
+
+    list<int> row_ids;
+    for (auto const &row : rows) {
+      row_ids.push_back(row.id);
+    }
+    storage.delete_event_rows_with_ids(row_ids);
+    storage.get_event_queue_size(&event_count, &byte_size);
+    REQUIRE(0 == event_count);
+    REQUIRE(0 == byte_size);
+    storage.delete_all_dead_letter_event_rows();
+  }
+
+  SECTION("inserts a batch of events in one transaction") {
+    SqliteStorage storage("test1.db");
+    storage.delete_all_event_rows();
+    list<Payload> payloads;
+    for (int i = 0; i < 3; i++) {
+      Payload p;
+      p.add("e", "pv");
+      p.add("eid", std::to_string(i));
+      payloads.push_back(p);
+    }
+    unsigned long long event_size = Utils::serialize_payload(payloads.front()).length();
+
+    storage.add_events(payloads);
+    storage.add_events({});
+
+    list<EventRow> rows;
+    storage.get_all_event_rows(&rows);
+    REQUIRE(3 == rows.size());
+    REQUIRE("0" == rows.front().event.get_pairs().at("eid"));
+    REQUIRE("2" == rows.back().event.get_pairs().at("eid"));
+
+    unsigned long long event_count = 0;
+    unsigned long long byte_size = 0;
+    storage.get_event_queue_size(&event_count, &byte_size);
+    REQUIRE(3 == event_count);
+    REQUIRE(3 * event_size == byte_size);
+
+    storage.delete_all_event_rows();
+  }
+
+  SECTION("selects events while other threads insert them") {
+    SqliteStorage storage("test1.db");
+    storage.delete_all_event_rows();
+    Payload p;
+    p.add("e", "pv");
+
+    std::thread writer([&storage, &p] {
+      for (int i = 0; i < 200; i++) {
+        storage.add_event(p);
+      }
+    });
+    int selected = 0;
+    while (selected < 200) {
+      list<EventRow> rows;
+      storage.get_event_rows_batch(&rows, 50);
+      list<int> ids;
+      for (auto const &row : rows) {
+        REQUIRE("pv" == row.event.get_value("e"));
+        ids.push_back(row.id);
+      }
+      storage.delete_event_rows_with_ids(ids);
+      selected += int(rows.size());
+    }
+    writer.join();
+
+    unsigned long long event_count = 0;
+    unsigned long long byte_size = 0;
+    storage.get_event_queue_size(&event_count, &byte_size);
+    REQUIRE(0 == event_count);
+  }
+
+  SECTION("in-memory database is read through its only connection") {
+    SqliteStorage storage(":memory:");
+    Payload p;
+    p.add("e", "pv");
+    storage.add_event(p);
+    list<EventRow> rows;
+    storage.get_event_rows_batch(&rows, 10);
+    REQUIRE(1 == rows.size());
+  }
+
+  SECTION("stores events in the binary encoding and reads events stored as JSON") {
+    Payload p;
+    p.add("e", "se");
+    p.add("se_ca", "category");
+    p.add("custom", "value");
+    {
+      SqliteStorage storage("test1.db");
+      storage.delete_all_event_rows();
+      storage.add_event(p);
+    }
+
+    SqliteStorage storage("test1.db", BINARY_ENCODING);
+    storage.add_event(p);
+    storage.add_serialized_event(p, Utils::serialize_payload(p));
+    storage.add_events({p});
+
+    list<EventRow> rows;
+    storage.get_event_rows_batch(&rows, 10);
+    REQUIRE(4 == rows.size());
+    for (auto const &row : rows) {
+      REQUIRE(p.get_pairs() == row.event.get_pairs());
+    }
+
+    unsigned long long event_count = 0;
+    unsigned long long byte_size = 0;
+    storage.get_event_queue_size(&event_count, &byte_size);
+    unsigned long long json_size = Utils::serialize_payload(p).size();
+    unsigned long long binary_size = Utils::serialize_payload_binary(p).size();
+    REQUIRE(binary_size < json_size);
+    REQUIRE(json_size + 3 * binary_size == byte_size);
+
+    storage.move_event_rows_to_dead_letter({rows.back().id});
+    list<EventRow> dead_letter_rows;
+    storage.get_all_dead_letter_event_rows(&dead_letter_rows);
+    REQUIRE(p.get_pairs() == dead_letter_rows.back().event.get_pairs());
+    storage.delete_all_event_rows();
+    storage.delete_all_dead_letter_event_rows();
+  }
+
+  SECTION("moves rows that can't be decoded to the dead-letter table") {
+    SqliteStorage storage("test1.db");
+    storage.delete_all_event_rows();
+    storage.delete_all_dead_letter_event_rows();
+    Payload p;
+    p.add("e", "pv");
+    storage.add_event(p);
+    storage.add_serialized_event(p, "{\"e\":");
+    storage.add_event(p);
+
+    list<EventRow> rows;
+    storage.get_event_rows_batch(&rows, 10);
+    REQUIRE(2 == rows.size());
+    REQUIRE(p.get_pairs() == rows.back().event.get_pairs());
+
+    unsigned long long event_count = 0;
+    unsigned long long byte_size = 0;
+    storage.get_event_queue_size(&event_count, &byte_size);
+    REQUIRE(2 == event_count);
+    rows.clear();
+    storage.get_all_event_rows(&rows);
+    REQUIRE(2 == rows.size());
+
+    list<EventRow> dead_letter_rows;
+    storage.get_all_dead_letter_event_rows(&dead_letter_rows);
+    REQUIRE(dead_letter_rows.empty());
+    storage.delete_all_event_rows();
+    storage.delete_all_dead_letter_event_rows();
+  }
+
+  SECTION("compresses events with a dictionary trained on stored events") {
+    if (!EventCompressor::is_available()) {
+      REQUIRE_THROWS_AS(SqliteStorage("test-compressed.db", COMPRESSED_ENCODING), std::invalid_argument);
+      return;
+    }
+    for (string suffix : {"", "-wal", "-shm"}) {
+      std::remove(("test-compressed.db" + suffix).c_str());
+    }
+
+    list<Payload> payloads;
+    for (int i = 0; i < 1000; i++) {
+      Payload p;
+      p.add("e", "se");
+      p.add("eid", Utils::get_uuid4());
+      p.add("tv", "cpp-2.0.0");
+      p.add("p", "pc");
+      p.add("aid", "edge-box");
+      p.add("se_ca", "category");
+      p.add("se_ac", "action-" + std::to_string(i % 5));
+      p.add("url", "https://www.example.com/products/category-" + std::to_string(i % 5));
+      payloads.push_back(p);
+    }
+    Payload p = payloads.front();
+
+    SqliteStorage storage("test-compressed.db", COMPRESSED_ENCODING);
+    storage.add_events(payloads);
+    // trained when reading events rather than while storing them
+    REQUIRE(0 == storage.get_dictionary_id());
+    list<EventRow> batch;
+    storage.get_event_rows_batch(&batch, 1);
+    REQUIRE(0 < storage.get_dictionary_id());
+    int dictionary_id = storage.get_dictionary_id();
+
+    unsigned long long event_count = 0;
+    unsigned long long uncompressed_byte_size = 0;
+    storage.get_event_queue_size(&event_count, &uncompressed_byte_size);
+    REQUIRE(1000 == event_count);
+    storage.add_event(p);
+    unsigned long long byte_size = 0;
+    storage.get_event_queue_size(&event_count, &byte_size);
+    REQUIRE((byte_size - uncompressed_byte_size) * 2 < Utils::serialize_payload_binary(p).size());
+
+    // retraining keeps the dictionary used by stored events
+    REQUIRE(storage.train_dictionary());
+    REQUIRE(dictionary_id < storage.get_dictionary_id());
+    storage.add_serialized_event(p, Utils::serialize_payload(p));
+
+    list<EventRow> rows;
+    storage.get_all_event_rows(&rows);
+    REQUIRE(1002 == rows.size());
+    REQUIRE(p.get_pairs() == rows.front().event.get_pairs());
+    REQUIRE(p.get_pairs() == rows.back().event.get_pairs());
+    REQUIRE(p.get_pairs() == std::next(rows.begin(), 1000)->event.get_pairs());
+
+    storage.move_event_rows_to_dead_letter({rows.back().id});
+    {
+      // dictionaries are loaded when reading events compressed with them in any encoding
+      SqliteStorage other_storage("test-compressed.db");
+      list<EventRow> other_rows;
+      other_storage.get_event_rows_batch(&other_rows, 2000);
+      REQUIRE(1001 == other_rows.size());
+      REQUIRE(p.get_pairs() == other_rows.back().event.get_pairs());
+      list<EventRow> dead_letter_rows;
+      other_storage.get_all_dead_letter_event_rows(&dead_letter_rows);
+      REQUIRE(p.get_pairs() == dead_letter_rows.back().event.get_pairs());
+    }
+
+    // the latest dictionary is used after reopening the database
+    int latest_dictionary_id = storage.get_dictionary_id();
+    storage.delete_all_event_rows();
+    storage.delete_all_dead_letter_event_rows();
+    SqliteStorage reopened_storage("test-compressed.db", COMPRESSED_ENCODING);
+    REQUIRE(latest_dictionary_id == reopened_storage.get_dictionary_id());
+  }
+
+  SECTION("retrains the dictionary when the compression ratio drops") {
+    if (!EventCompressor::is_available()) {
+      return;
+    }
+    for (string suffix : {"", "-wal", "-shm"}) {
+      std::remove(("test-compressed.db" + suffix).c_str());
+    }
+    auto make_payloads = [](const string &prefix) {
+      list<Payload> payloads;
+      for (int i = 0; i < 1000; i++) {
+        Payload p;
+        p.add("e", "se");
+        p.add("eid", Utils::get_uuid4());
+        p.add(prefix + "_ca", prefix + "-category-" + std::to_string(i % 5));
+        p.add(prefix + "_url", "https://" + prefix + ".example.com/" + prefix + "/" + std::to_string(i % 5) + "/" + Utils::get_uuid4());
+        payloads.push_back(p);
+      }
+      return payloads;
+    };
+
+    SqliteStorage storage("test-compressed.db", COMPRESSED_ENCODING);
+    list<EventRow> batch;
+    storage.add_events(make_payloads("se"));
+    storage.get_event_rows_batch(&batch, 1);
+    int dictionary_id = storage.get_dictionary_id();
+    REQUIRE(0 < dictionary_id);
+
+    // the first sample compressed with the dictionary keeps it
+    storage.add_events(make_payloads("se"));
+    storage.get_event_rows_batch(&batch, 1);
+    REQUIRE(dictionary_id == storage.get_dictionary_id());
+
+    // events that the dictionary doesn't fit trigger a new one
+    storage.add_events(make_payloads("xyzzy"));
+    storage.get_event_rows_batch(&batch, 1);
+    REQUIRE(dictionary_id < storage.get_dictionary_id());
+
+    storage.delete_all_event_rows();
+  }
+
+  SECTION("returns the space of deleted events to the file system") {
+    for (string suffix : {"", "-wal", "-shm"}) {
+      std::remove(("test-vacuum.db" + suffix).c_str());
+    }
+    SqliteStorage storage("test-vacuum.db");
+    Payload p;
+    p.add("e", "pv");
+    p.add("url", string(2000, 'x'));
+    storage.add_events(list<Payload>(1000, p));
+    storage.perform_maintenance();
+
+    unsigned long long file_byte_size = 0;
+    unsigned long long wal_byte_size = 0;
+    REQUIRE(storage.get_storage_size(&file_byte_size, &wal_byte_size));
+    REQUIRE(1000 * 2000 < file_byte_size);
+    REQUIRE(0 == wal_byte_size);
+
+    storage.delete_oldest_event_rows(900, {});
+    REQUIRE(storage.get_storage_size(&file_byte_size, &wal_byte_size));
+    REQUIRE(0 < wal_byte_size);
+
+    storage.perform_maintenance();
+    REQUIRE(storage.get_storage_size(&file_byte_size, &wal_byte_size));
+    REQUIRE(file_byte_size < 200 * 2000 + 100 * 1024);
+    REQUIRE(0 == wal_byte_size);
+
+    list<EventRow> rows;
+    storage.get_all_event_rows(&rows);
+    REQUIRE(100 == rows.size());
+
+    // a few events passing through leave too little behind to rewrite the database
+    storage.add_events(list<Payload>(10, p));
+    storage.delete_oldest_event_rows(10, {});
+    storage.perform_maintenance();
+    REQUIRE(storage.get_storage_size(&file_byte_size, &wal_byte_size));
+    REQUIRE(0 < wal_byte_size);
+
+    SqliteStorage memory_storage(":memory:");
+    REQUIRE_FALSE(memory_storage.get_storage_size(&file_byte_size, &wal_byte_size));
+    memory_storage.perform_maintenance();
+  }
+
+  SECTION("serves higher priority lanes first without starving lower lanes") {
+    SqliteStorage storage("test1.db");
+    storage.delete_all_event_rows();
+    Payload low;
+    low.add("e", "pv");
+    Payload high;
+    high.add("e", "se");
+    high.set_priority(2);
+    for (int i = 0; i < 10; i++) {
+      storage.add_event(low);
+    }
+    for (int i = 0; i < 10; i++) {
+      storage.add_event(high);
+    }
+
+    // lane weights are priority + 1: 3 of 4 slots for the high lane, 1 for the low lane
+    list<EventRow> rows;
+    storage.get_event_rows_batch(&rows, 4);
+    REQUIRE(4 == rows.size());
+    REQUIRE(2 == rows.front().priority);
+    REQUIRE("se" == rows.front().event.get_value("e"));
+    REQUIRE(0 == rows.back().priority);
+    int first_high_id = rows.front().id;
+
+    // excluded rows are skipped in each lane
+    set<int> excluded_ids;
+    for (auto const &row : rows) {
+      excluded_ids.insert(row.id);
+    }
+    list<EventRow> next_rows;
+    storage.get_event_rows_batch_excluding(&next_rows, 4, excluded_ids);
+    REQUIRE(4 == next_rows.size());
+    REQUIRE(first_high_id + 3 == next_rows.front().id);
+
+    // slots unused by the high lane go to the low lane
+    storage.delete_event_rows_with_ids({first_high_id, first_high_id + 1, first_high_id + 2, first_high_id + 3,
+                                        first_high_id + 4, first_high_id + 5, first_high_id + 6, first_high_id + 7, first_high_id + 8});
+    rows.clear();
+    storage.get_event_rows_batch(&rows, 4);
+    REQUIRE(4 == rows.size());
+    REQUIRE(first_high_id + 9 == rows.front().id);
+    REQUIRE(0 == rows.back().priority);
+
+    // oldest events of the lowest lane are dropped first
+    storage.delete_oldest_event_rows(10, {});
+    rows.clear();
+    storage.get_all_event_rows(&rows);
+    REQUIRE(1 == rows.size());
+    REQUIRE(2 == rows.front().priority);
+
+    storage.delete_all_event_rows();
+  }
+
   SECTION("should be able to insert only one session object into the database") {
     SqliteStorage storage("test1.db");
 
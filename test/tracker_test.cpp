@@ -19,9 +19,12 @@ See the Apache License Version 2.0 for the specific language governing permissio
 #include "../include/snowplow/events/screen_view_event.hpp"
 #include "../include/snowplow/events/self_describing_event.hpp"
 #include "../include/snowplow/events/timing_event.hpp"
+#include "../include/snowplow/events/typed_self_describing_event.hpp"
 #include "../include/snowplow/storage/sqlite_storage.hpp"
 #include "http/test_http_client.hpp"
 #include "catch.hpp"
+#include <chrono>
+#include <thread>
 
 using namespace snowplow;
 using std::invalid_argument;
@@ -29,6 +32,19 @@ using std::runtime_error;
 using std::to_string;
 using std::make_shared;
 
+struct SaveGame {
+  static const char *schema() { return "iglu:com.example_company/save-game/jsonschema/1-0-2"; }
+
+  int level;
+  string save_id;
+  bool hard_mode;
+  double *score;
+
+  void write(JsonWriter &writer) const {
+    writer.field("level", level).field("saveId", save_id).field("hardMode", hard_mode).field("score", score);
+  }
+};
+
 TEST_CASE("tracker") {
   auto storage = make_shared<SqliteStorage>("test-tracker.db");
 
@@ -38,14 +54,24 @@ TEST_CASE("tracker") {
   private:
     bool m_started = false;
     vector<Payload> m_payloads;
+    std::mutex m_payloads_access; // payloads are also added by the tracker ticker
 
   public:
     MockEmitter(std::shared_ptr<EventStore> event_store) : Emitter(move(event_store), "com.acme", Method::POST, Protocol::HTTP, 0, 0, 0, unique_ptr<HttpClient>(new TestHttpClient())) {}
     void start() { m_started = true; }
     void stop() { m_started = false; }
-    void add(Payload payload) { m_payloads.push_back(payload); }
-    void flush() { m_payloads.clear(); }
-    vector<Payload> get_added_payloads() { return m_payloads; }
+    void add(Payload payload) {
+      std::lock_guard<std::mutex> guard(m_payloads_access);
+      m_payloads.push_back(payload);
+    }
+    void flush() {
+      std::lock_guard<std::mutex> guard(m_payloads_access);
+      m_payloads.clear();
+    }
+    vector<Payload> get_added_payloads() {
+      std::lock_guard<std::mutex> guard(m_payloads_access);
+      return m_payloads;
+    }
     bool is_started() { return m_started; }
   };
 
@@ -84,6 +110,40 @@ TEST_CASE("tracker") {
     REQUIRE(sv_id_1 != sv_id_2);
   }
 
+  SECTION("Tracker uses time-ordered event IDs if configured") {
+    auto emitter = make_shared<MockEmitter>(storage);
+    TrackerConfiguration tracker_config("ns1", "app1", pc);
+    tracker_config.set_event_id_version(UUID_V7);
+    REQUIRE(tracker_config.get_event_id_version() == UUID_V7);
+    Tracker tracker(tracker_config, emitter);
+
+    string event_id = tracker.track(StructuredEvent("hello", "world"));
+    REQUIRE(event_id.size() == 36);
+    REQUIRE(event_id[14] == '7');
+
+    auto payload = emitter->get_added_payloads()[0].get();
+    REQUIRE(payload[SNOWPLOW_EID] == event_id);
+
+    // payloads built outside the tracker keep the default version
+    REQUIRE(EventPayload().get_event_id()[14] == '4');
+  }
+
+  SECTION("Tracker runs the cached clock while it exists if configured") {
+    auto emitter = make_shared<MockEmitter>(storage);
+    TrackerConfiguration tracker_config("ns1", "app1", pc);
+    REQUIRE(tracker_config.get_clock_source() == SYSTEM_CLOCK);
+    tracker_config.set_clock_source(CACHED_CLOCK);
+    {
+      Tracker tracker(tracker_config, emitter);
+      REQUIRE(CachedClock::is_running());
+
+      tracker.track(StructuredEvent("hello", "world"));
+      auto payload = emitter->get_added_payloads()[0].get();
+      REQUIRE(payload[SNOWPLOW_TIMESTAMP].size() == 13);
+    }
+    REQUIRE_FALSE(CachedClock::is_running());
+  }
+
   SECTION("Tracker controls should provide expected behaviour") {
     auto emitter = make_shared<MockEmitter>(storage);
     auto session = make_shared<ClientSession>(storage, 5000, 5000);
@@ -469,6 +529,30 @@ TEST_CASE("tracker") {
     REQUIRE(payload[SNOWPLOW_UNSTRUCTURED_ENCODED] == base64_encode(str, json.length()));
   }
 
+  SECTION("track TypedSelfDescribingEvent generates the same event body as SelfDescribingEvent") {
+    auto emitter = make_shared<MockEmitter>(storage);
+    TrackerConfiguration tracker_config("ns", "app");
+    tracker_config.set_use_base64(false);
+    tracker_config.set_desktop_context(false);
+    Tracker tracker(tracker_config, emitter);
+
+    double score = 12.5;
+    SaveGame save_game = {5, "ju302", true, &score};
+    TypedSelfDescribingEvent<SaveGame> typed(save_game);
+    tracker.track(typed);
+
+    SelfDescribingJson sdj("iglu:com.example_company/save-game/jsonschema/1-0-2", "{\"level\":5,\"saveId\":\"ju302\",\"hardMode\":true,\"score\":12.5}"_json);
+    SelfDescribingEvent sde(sdj);
+    tracker.track(sde);
+
+    REQUIRE(emitter->get_added_payloads().size() == 2);
+    auto typed_payload = emitter->get_added_payloads()[0].get();
+    auto payload = emitter->get_added_payloads()[1].get();
+
+    REQUIRE(typed_payload[SNOWPLOW_EVENT] == SNOWPLOW_EVENT_SELF_DESCRIBING);
+    REQUIRE(json::parse(typed_payload[SNOWPLOW_UNSTRUCTURED]) == json::parse(payload[SNOWPLOW_UNSTRUCTURED]));
+  }
+
   SECTION("adds payload from event Subject instance") {
     auto emitter = make_shared<MockEmitter>(storage);
 
@@ -516,4 +600,184 @@ TEST_CASE("tracker") {
     REQUIRE(payload[SNOWPLOW_LANGUAGE] == "en");
     REQUIRE(payload[SNOWPLOW_TIMEZONE] == "GMT");
   }
+
+  SECTION("event priority is passed to the emitter") {
+    auto emitter = make_shared<MockEmitter>(storage);
+    Tracker tracker(emitter);
+
+    StructuredEvent event("category", "action");
+    REQUIRE(0 == event.get_priority());
+    REQUIRE_THROWS_AS(event.set_priority(-1), invalid_argument);
+    event.set_priority(2);
+    tracker.track(event);
+
+    REQUIRE(emitter->get_added_payloads().size() == 1);
+    REQUIRE(2 == emitter->get_added_payloads()[0].get_priority());
+  }
+
+  SECTION("event filters drop events before they are passed to the emitter") {
+    auto emitter = make_shared<MockEmitter>(storage);
+    auto subject = make_shared<Subject>();
+    subject->set_user_id("tracker-user");
+    TrackerConfiguration config("ns");
+    vector<string> filtered_user_ids;
+    config.add_event_filter([&](const EventFilterInput &input) {
+      filtered_user_ids.push_back(input.user_id);
+      return input.event_type != SNOWPLOW_EVENT_STRUCTURED;
+    });
+    config.add_event_filter(EventFilters::rate_limit(0.001, 1, SNOWPLOW_SCHEMA_SCREEN_VIEW));
+    Tracker tracker(config, emitter, subject);
+
+    REQUIRE(tracker.track(StructuredEvent("category", "action")).empty());
+
+    auto event_subject = make_shared<Subject>();
+    event_subject->set_user_id("event-user");
+    ScreenViewEvent screen_view;
+    string screen_name = "home";
+    screen_view.name = &screen_name;
+    screen_view.set_subject(event_subject);
+    REQUIRE(!tracker.track(screen_view).empty());
+    REQUIRE(tracker.track(screen_view).empty());
+
+    REQUIRE(emitter->get_added_payloads().size() == 1);
+    REQUIRE(emitter->get_added_payloads()[0].get()[SNOWPLOW_UID] == "event-user");
+    REQUIRE(filtered_user_ids == vector<string>({"tracker-user", "event-user", "event-user"}));
+  }
+
+  SECTION("event filters receive the anonymous user ID of the client session") {
+    auto emitter = make_shared<MockEmitter>(storage);
+    auto session = make_shared<ClientSession>(storage, 5000, 5000);
+    TrackerConfiguration config("ns");
+    vector<string> anonymous_user_ids;
+    config.add_event_filter([&](const EventFilterInput &input) {
+      anonymous_user_ids.push_back(input.anonymous_user_id);
+      return true;
+    });
+    Tracker tracker(config, emitter, nullptr, session);
+
+    tracker.track(StructuredEvent("category", "action"));
+
+    REQUIRE(anonymous_user_ids.size() == 1);
+    REQUIRE(!anonymous_user_ids[0].empty());
+    REQUIRE(anonymous_user_ids[0] == session->get_user_id());
+  }
+
+  SECTION("aggregated structured events are tracked as summaries after the aggregation window") {
+    auto emitter = make_shared<MockEmitter>(storage);
+    TrackerConfiguration config("ns");
+    config.set_use_base64(false);
+    config.add_aggregated_event("metrics", "latency");
+    config.set_aggregation_window(50);
+    Tracker tracker(config, emitter);
+
+    for (int i = 1; i <= 100; i++) {
+      double value = i;
+      StructuredEvent event("metrics", "latency");
+      event.value = &value;
+      REQUIRE(tracker.track(event).empty());
+    }
+    REQUIRE(emitter->get_added_payloads().empty());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    REQUIRE(!tracker.track(StructuredEvent("metrics", "other")).empty());
+    REQUIRE(emitter->get_added_payloads().size() == 2);
+    auto summary = emitter->get_added_payloads()[0].get();
+    REQUIRE(summary[SNOWPLOW_EVENT] == SNOWPLOW_EVENT_STRUCTURED);
+    REQUIRE(summary[SNOWPLOW_SE_CATEGORY] == "metrics");
+    REQUIRE(summary[SNOWPLOW_SE_ACTION] == "latency");
+    REQUIRE(summary[SNOWPLOW_SE_VALUE] == "5050.000000");
+    REQUIRE(summary[SNOWPLOW_SE_PROPERTY] == "{\"count\":100,\"max\":100.0,\"min\":1.0}");
+    REQUIRE(emitter->get_added_payloads()[1].get()[SNOWPLOW_SE_ACTION] == "other");
+  }
+
+  SECTION("summaries of idle trackers are tracked by the ticker with the subject and context of the first event") {
+    auto emitter = make_shared<MockEmitter>(storage);
+    TrackerConfiguration config("ns");
+    config.set_use_base64(false);
+    config.add_aggregated_event("metrics", "latency");
+    config.set_aggregation_window(50);
+    Tracker tracker(config, emitter);
+
+    auto event_subject = make_shared<Subject>();
+    event_subject->set_user_id("first-user");
+    StructuredEvent event("metrics", "latency");
+    event.set_subject(event_subject);
+    event.set_context({SelfDescribingJson("iglu:com.acme/host/jsonschema/1-0-0", "{\"name\":\"edge-1\"}"_json)});
+    REQUIRE(tracker.track(event).empty());
+    event.set_subject(nullptr);
+    REQUIRE(tracker.track(event).empty());
+
+    auto tracked_at = std::chrono::steady_clock::now();
+    while (emitter->get_added_payloads().empty() && std::chrono::steady_clock::now() < tracked_at + std::chrono::seconds(2)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    REQUIRE(emitter->get_added_payloads().size() == 1);
+    auto summary = emitter->get_added_payloads()[0].get();
+    REQUIRE(summary[SNOWPLOW_SE_PROPERTY] == "{\"count\":2}");
+    REQUIRE(summary[SNOWPLOW_UID] == "first-user");
+    REQUIRE(summary[SNOWPLOW_CONTEXT].find("edge-1") != string::npos);
+  }
+
+  SECTION("thread buffers pass events to the emitter in batches") {
+    storage->delete_all_event_rows();
+    auto emitter = make_shared<MockEmitter>(storage);
+    TrackerConfiguration config("ns");
+    config.set_thread_buffer_size(3);
+    config.set_thread_buffer_max_age(0);
+    Tracker tracker(config, emitter);
+
+    list<EventRow> rows;
+    tracker.track(StructuredEvent("category", "1"));
+    tracker.track(StructuredEvent("category", "2"));
+    storage->get_all_event_rows(&rows);
+    REQUIRE(rows.empty());
+
+    tracker.track(StructuredEvent("category", "3"));
+    storage->get_all_event_rows(&rows);
+    REQUIRE(3 == rows.size());
+    REQUIRE(emitter->get_added_payloads().empty());
+
+    // events buffered by a thread that exited are passed on when the tracker is flushed
+    std::thread([&tracker] { tracker.track(StructuredEvent("category", "4")); }).join();
+    rows.clear();
+    storage->get_all_event_rows(&rows);
+    REQUIRE(3 == rows.size());
+
+    tracker.flush();
+    rows.clear();
+    storage->get_all_event_rows(&rows);
+    REQUIRE(4 == rows.size());
+    REQUIRE("4" == rows.back().event.get_value(SNOWPLOW_SE_ACTION));
+    storage->delete_all_event_rows();
+  }
+
+  SECTION("thread buffers of idle threads are passed on within the maximum age") {
+    storage->delete_all_event_rows();
+    auto emitter = make_shared<MockEmitter>(storage);
+    TrackerConfiguration config("ns");
+    config.set_thread_buffer_size(100);
+    config.set_thread_buffer_max_age(200);
+    Tracker tracker(config, emitter);
+
+    auto tracked_at = std::chrono::steady_clock::now();
+    std::thread([&tracker] { tracker.track(StructuredEvent("category", "idle")); }).join();
+    list<EventRow> rows;
+    storage->get_all_event_rows(&rows);
+    REQUIRE(rows.empty());
+
+    while (rows.empty() && std::chrono::steady_clock::now() < tracked_at + std::chrono::seconds(2)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      storage->get_all_event_rows(&rows);
+    }
+    REQUIRE(1 == rows.size());
+    REQUIRE(std::chrono::steady_clock::now() - tracked_at < std::chrono::milliseconds(200 + 100));
+
+    // stopping the tracker keeps buffered events in the event store
+    tracker.track(StructuredEvent("category", "stopped"));
+    tracker.stop();
+    rows.clear();
+    storage->get_all_event_rows(&rows);
+    REQUIRE(2 == rows.size());
+    storage->delete_all_event_rows();
+  }
 }
@@ -12,13 +12,20 @@ See the Apache License Version 2.0 for the specific language governing permissio
 */
 
 #include "../include/snowplow/detail/utils/utils.hpp"
+#include "../include/snowplow/detail/utils/cached_clock.hpp"
 #include "catch.hpp"
 #include <algorithm>
+#include <chrono>
 #include <regex>
+#include <set>
+#include <thread>
+#include <vector>
 
 using namespace snowplow;
 using std::regex;
+using std::runtime_error;
 using std::to_string;
+using std::vector;
 
 TEST_CASE("utils") {
   SECTION("get_uuid4 should return valid uuid up to the spefication") {
@@ -39,6 +46,33 @@ TEST_CASE("utils") {
     REQUIRE(uuid_lower == uuid);
   }
 
+  SECTION("get_uuid4 should return unique values across threads") {
+    vector<string> first_thread_uuids;
+    vector<string> second_thread_uuids;
+    std::thread first([&] { for (int i = 0; i < 1000; i++) { first_thread_uuids.push_back(Utils::get_uuid4()); } });
+    std::thread second([&] { for (int i = 0; i < 1000; i++) { second_thread_uuids.push_back(Utils::get_uuid4()); } });
+    first.join();
+    second.join();
+
+    std::set<string> unique_uuids(first_thread_uuids.begin(), first_thread_uuids.end());
+    unique_uuids.insert(second_thread_uuids.begin(), second_thread_uuids.end());
+    REQUIRE(2000 == unique_uuids.size());
+  }
+
+  SECTION("get_uuid7 should return valid time-ordered uuid") {
+    regex r_uuid7("[0-9a-f]{8}-[0-9a-f]{4}-7[0-9a-f]{3}-[89ab][0-9a-f]{3}-[0-9a-f]{12}");
+    unsigned long long time_before = Utils::get_unix_epoch_ms();
+    string uuid = Utils::get_uuid7();
+    unsigned long long time_after = Utils::get_unix_epoch_ms();
+    REQUIRE(true == regex_match(uuid, r_uuid7));
+
+    string timestamp_hex = uuid.substr(0, 8) + uuid.substr(9, 4);
+    unsigned long long timestamp = std::stoull(timestamp_hex, nullptr, 16);
+    REQUIRE(timestamp >= time_before);
+    REQUIRE(timestamp <= time_after);
+    REQUIRE(uuid != Utils::get_uuid7());
+  }
+
   SECTION("int_list_to_string will successfully convert a list of integers to a string") {
     list<int> int_list;
     int_list.push_back(1);
@@ -57,12 +91,17 @@ TEST_CASE("utils") {
     queryPairs["k3"] = "s+p+a+c+e";
 
     REQUIRE("e=pv&k2=s%20p%20a%20c%20e&k3=s%2Bp%2Ba%2Bc%2Be" == Utils::map_to_query_string(queryPairs));
+    REQUIRE("" == Utils::map_to_query_string(map<string, string>()));
+    REQUIRE("k%3D=" == Utils::map_to_query_string({{"k=", ""}}));
   }
 
   SECTION("url_encode should correctly encode a string for sending as part of a url") {
     REQUIRE("e%20pv" == Utils::url_encode("e pv"));
     REQUIRE("%3C%20%3E%20%23%20%25%20%7B%20%7D%20%7C%20%5C%20%5E%20%7E%20%5B%20%5D%20%60%20%3B%20%2F%20%3F%20%3A%20%40%20%3D%20%26%20%24%20%2B%20%22" ==
             Utils::url_encode("< > # % { } | \\ ^ ~ [ ] ` ; / ? : @ = & $ + \""));
+    REQUIRE("" == Utils::url_encode(""));
+    REQUIRE("AZaz09-_." == Utils::url_encode("AZaz09-_."));
+    REQUIRE("%C3%A9t%C3%A9%00%FF" == Utils::url_encode(string("\xC3\xA9t\xC3\xA9\x00\xFF", 7)));
   }
 
   SECTION("serialize_payload will successfully convert a Payload into a JSON string") {
@@ -74,6 +113,15 @@ TEST_CASE("utils") {
     REQUIRE("{\"e\":\"pv\",\"p\":\"srv\",\"tv\":\"cpp-0.1.0\"}" == Utils::serialize_payload(p));
   }
 
+  SECTION("serialize_payload escapes values the same way as the JSON library") {
+    Payload p;
+    p.add("co", "{\"quote\":\"\\\"\",\"tab\":\"\t\"}");
+    p.add("url", "https://example.com/?q=\x01\x1f");
+    p.add("ua", "caf\xC3\xA9");
+
+    REQUIRE(json(p.get()).dump() == Utils::serialize_payload(p));
+  }
+
   SECTION("deserialize_json_str will successfully convert a JSON string into a Payload") {
     string j_str = "{\"e\":\"pv\",\"p\":\"srv\",\"tv\":\"cpp-0.1.0\"}";
     Payload p = Utils::deserialize_json_str(j_str);
@@ -83,10 +131,65 @@ TEST_CASE("utils") {
     REQUIRE(p.get()["tv"] == "cpp-0.1.0");
   }
 
+  SECTION("serialize_payload_binary encodes known keys as IDs and round trips through deserialize_payload") {
+    Payload p;
+    p.add("e", "pv");
+    p.add("custom_key", string("zero\0byte", 9));
+    p.add("ua", string(200, 'x'));
+    p.add("empty", "");
+
+    string binary = Utils::serialize_payload_binary(p);
+    REQUIRE(1 == binary[0]);
+    REQUIRE(binary.size() < Utils::serialize_payload(p).size());
+    // version, "e" key ID, value length and value
+    Payload event_type;
+    event_type.add("e", "pv");
+    REQUIRE(string("\x01\x01\x02pv", 5) == Utils::serialize_payload_binary(event_type));
+
+    Payload decoded = Utils::deserialize_payload(binary.data(), binary.size());
+    REQUIRE(p.get_pairs() == decoded.get_pairs());
+  }
+
+  SECTION("deserialize_payload reads JSON payloads and rejects truncated binary payloads") {
+    string j_str = "{\"e\":\"pv\",\"p\":\"srv\"}";
+    Payload p = Utils::deserialize_payload(j_str.data(), j_str.size());
+    REQUIRE(p.get_value("e") == "pv");
+    REQUIRE(p.get_value("p") == "srv");
+
+    Payload payload;
+    payload.add("e", "pv");
+    string binary = Utils::serialize_payload_binary(payload);
+    REQUIRE_THROWS_AS(Utils::deserialize_payload(binary.data(), binary.size() - 1), runtime_error);
+    string unknown_key("\x01\x7f\x00", 3);
+    REQUIRE_THROWS_AS(Utils::deserialize_payload(unknown_key.data(), unknown_key.size()), runtime_error);
+  }
+
   SECTION("get_unix_epoch_ms should return the time since epoch in milliseconds") {
     REQUIRE(13 == std::to_string(Utils::get_unix_epoch_ms()).length());
   }
 
+  SECTION("get_unix_epoch_ms should read the cached clock while it is running") {
+    CachedClock::acquire();
+    REQUIRE(CachedClock::is_running());
+    unsigned long long system_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    unsigned long long cached_ms = Utils::get_unix_epoch_ms();
+    REQUIRE(cached_ms + 100 >= system_ms);
+    REQUIRE(cached_ms <= system_ms + 100);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(Utils::get_unix_epoch_ms() > cached_ms);
+
+    CachedClock::release();
+    REQUIRE_FALSE(CachedClock::is_running());
+  }
+
+  SECTION("uint_to_string should format integers like to_string") {
+    vector<unsigned long long> values = {0, 7, 10, 99, 100, 101, 1653042535123, 18446744073709551615ULL};
+    for (unsigned long long value : values) {
+      REQUIRE(std::to_string(value) == Utils::uint_to_string(value));
+    }
+  }
+
   SECTION("get_unix_epoch_ms_as_datetime_string should return the ISO formatted datetime") {
     REQUIRE("2022-05-20T10:28:55.123Z" == Utils::get_unix_epoch_ms_as_datetime_string(1653042535123));
   }